@@ -40,7 +40,7 @@ typedef bool lto_bool_t;
  * @{
  */
 
-#define LTO_API_VERSION 16
+#define LTO_API_VERSION 18
 
 /**
  * \since prior to LTO_API_VERSION=3
@@ -477,6 +477,34 @@ lto_codegen_compile(lto_code_gen_t cg, size_t* length);
 extern lto_bool_t
 lto_codegen_compile_to_file(lto_code_gen_t cg, const char** name);
 
+/**
+ * Sets the number of partitions the merged module is split into by
+ * lto_codegen_compile_to_files() and lto_codegen_compile_optimized_to_files().
+ * Each partition is code generated on its own thread into its own native
+ * object file. The default is 1.
+ *
+ * \since LTO_API_VERSION=17
+ */
+extern void
+lto_codegen_set_parallelism(lto_code_gen_t cg, unsigned int parallelism);
+
+/**
+ * Generates code for all added modules into as many native object files as
+ * partitions set with lto_codegen_set_parallelism(). This calls
+ * lto_codegen_optimize then lto_codegen_compile_optimized_to_files.
+ *
+ * The names of the files are written to names and their number to num_names.
+ * Linked together, the files are equivalent to the single object file written
+ * by lto_codegen_compile_to_file(). The array of names is owned by the
+ * lto_code_gen_t and will be freed when lto_codegen_dispose() is called, or
+ * lto_codegen_compile_to_files() is called again. Returns true on error.
+ *
+ * \since LTO_API_VERSION=17
+ */
+extern lto_bool_t
+lto_codegen_compile_to_files(lto_code_gen_t cg, const char*** names,
+                             unsigned int* num_names);
+
 /**
  * Runs optimization for the merged module. Returns true on error.
  *
@@ -500,6 +528,21 @@ lto_codegen_optimize(lto_code_gen_t cg);
 extern const void*
 lto_codegen_compile_optimized(lto_code_gen_t cg, size_t* length);
 
+/**
+ * Splits the optimized merged module into the number of partitions set with
+ * lto_codegen_set_parallelism() and generates code for each partition in
+ * parallel, into its own native object file. It will not run any IR
+ * optimizations on the merged module.
+ *
+ * The names of the files are returned as for lto_codegen_compile_to_files().
+ * Returns true on error.
+ *
+ * \since LTO_API_VERSION=17
+ */
+extern lto_bool_t
+lto_codegen_compile_optimized_to_files(lto_code_gen_t cg, const char*** names,
+                                       unsigned int* num_names);
+
 /**
  * Returns the runtime API version.
  *
@@ -547,6 +590,49 @@ extern void
 lto_codegen_set_should_embed_uselists(lto_code_gen_t cg,
                                       lto_bool_t ShouldEmbedUselists);
 
+/**
+ * Sets the directory in which the native objects produced by
+ * lto_codegen_compile(), lto_codegen_compile_to_file() and
+ * lto_codegen_compile_to_files() are cached. When the merged module and the
+ * code generation options are unchanged, the objects are then taken from the
+ * cache instead of being optimized and generated again. The directory is
+ * created if needed. An empty path or NULL, the default, disables the cache.
+ *
+ * \since LTO_API_VERSION=18
+ */
+extern void
+lto_codegen_set_cache_dir(lto_code_gen_t cg, const char *cache_dir);
+
+/**
+ * Sets the minimum interval, in seconds, between two scans of the cache
+ * directory for objects to prune. A value of 0 scans the directory after each
+ * store, and a negative value disables pruning. The default is 1200.
+ *
+ * \since LTO_API_VERSION=18
+ */
+extern void
+lto_codegen_set_cache_pruning_interval(lto_code_gen_t cg, int interval);
+
+/**
+ * Sets the time, in seconds, after which an unused object is pruned from the
+ * cache. A value of 0 disables the expiration. The default is one week.
+ *
+ * \since LTO_API_VERSION=18
+ */
+extern void
+lto_codegen_set_cache_entry_expiration(lto_code_gen_t cg,
+                                       unsigned int expiration);
+
+/**
+ * Sets the maximum size, in bytes, of the cache directory. The least recently
+ * used objects are pruned beyond it. A value of 0, the default, does not limit
+ * the size.
+ *
+ * \since LTO_API_VERSION=18
+ */
+extern void
+lto_codegen_set_cache_max_size(lto_code_gen_t cg, size_t max_size);
+
 #ifdef __cplusplus
 }
 #endif
@@ -165,7 +165,11 @@ protected:
   static llvm::Statistic VARNAME = { DEBUG_TYPE, DESC, 0, 0 }
 
 /// \brief Enable the collection and printing of statistics.
-void EnableStatistics();
+///
+/// If \p PrintOnExit is false, the statistics are collected for
+/// PrintStatisticsJSON, but are not printed when llvm_shutdown is called
+/// unless -stats is given.
+void EnableStatistics(bool PrintOnExit = true);
 
 /// \brief Check if statistics are enabled.
 bool AreStatisticsEnabled();
@@ -176,6 +180,11 @@ void PrintStatistics();
 /// \brief Print statistics to the given output stream.
 void PrintStatistics(raw_ostream &OS);
 
+/// \brief Print statistics to the given output stream as a JSON array of
+/// objects with "name", "desc" and "value" members, sorted like the output of
+/// PrintStatistics.
+void PrintStatisticsJSON(raw_ostream &OS);
+
 } // End llvm namespace
 
 #endif
@@ -21,6 +21,7 @@
 #ifndef LLVM_ANALYSIS_CALLGRAPHSCCPASS_H
 #define LLVM_ANALYSIS_CALLGRAPHSCCPASS_H
 
+#include "llvm/ADT/SmallPtrSet.h"
 #include "llvm/Analysis/CallGraph.h"
 #include "llvm/Pass.h"
 
@@ -83,11 +84,14 @@ public:
 class CallGraphSCC {
   void *Context; // The CGPassManager object that is vending this.
   std::vector<CallGraphNode*> Nodes;
+  // The nodes whose call edges the running pass reported changing.
+  SmallPtrSet<CallGraphNode*, 4> ChangedNodes;
 public:
   CallGraphSCC(void *context) : Context(context) {}
   
   void initialize(CallGraphNode*const*I, CallGraphNode*const*E) {
     Nodes.assign(I, E);
+    ChangedNodes.clear();
   }
   
   bool isSingular() const { return Nodes.size() == 1; }
@@ -96,6 +100,22 @@ public:
   /// ReplaceNode - This informs the SCC and the pass manager that the specified
   /// Old node has been deleted, and New is to be used in its place.
   void ReplaceNode(CallGraphNode *Old, CallGraphNode *New);
+
+  /// reportCallEdgeAdded/reportCallEdgeRemoved - These inform the pass manager
+  /// that the pass added or removed a call edge from Caller, a node of this
+  /// SCC, to Callee, after updating the call graph itself.  A pass that
+  /// reports any of its call edge changes must report all of them: the pass
+  /// manager then only checks the reported nodes against their functions,
+  /// instead of rescanning the whole SCC.
+  void reportCallEdgeAdded(CallGraphNode *Caller, CallGraphNode *Callee);
+  void reportCallEdgeRemoved(CallGraphNode *Caller, CallGraphNode *Callee);
+
+  /// getChangedNodes - Return the nodes whose call edges were reported
+  /// changed since the last call to clearChangedNodes.
+  const SmallPtrSetImpl<CallGraphNode*> &getChangedNodes() const {
+    return ChangedNodes;
+  }
+  void clearChangedNodes() { ChangedNodes.clear(); }
   
   typedef std::vector<CallGraphNode*>::const_iterator iterator;
   iterator begin() const { return Nodes.begin(); }
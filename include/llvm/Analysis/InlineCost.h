@@ -14,7 +14,12 @@
 #ifndef LLVM_ANALYSIS_INLINECOST_H
 #define LLVM_ANALYSIS_INLINECOST_H
 
+#include "llvm/ADT/DenseMap.h"
+#include "llvm/ADT/SmallPtrSet.h"
+#include "llvm/ADT/SmallVector.h"
 #include "llvm/Analysis/CallGraphSCCPass.h"
+#include "llvm/IR/Attributes.h"
+#include "llvm/IR/ValueHandle.h"
 #include <cassert>
 #include <climits>
 
@@ -55,10 +60,10 @@ class InlineCost {
   };
 
   /// \brief The estimated cost of inlining this callsite.
-  const int Cost;
+  int Cost;
 
   /// \brief The adjusted threshold against which this cost was computed.
-  const int Threshold;
+  int Threshold;
 
   // Trivial constructor, interesting logic in the factory functions below.
   InlineCost(int Cost, int Threshold) : Cost(Cost), Threshold(Threshold) {}
@@ -99,10 +104,61 @@ public:
 };
 
 /// \brief Cost analyzer used by inliner.
+///
+/// The cost of a call site whose arguments give the analysis nothing to
+/// simplify (no constants, no allocas, no pointers into the same object) only
+/// depends on the callee and on a few properties of the call site, so it is
+/// cached per callee during a walk of the call graph. The functions of the
+/// current SCC, which the inliner and the function passes modify, are not
+/// cached, and the cache of a callee is dropped when it is deleted.
 class InlineCostAnalysis : public CallGraphSCCPass {
   TargetTransformInfoWrapperPass *TTIWP;
   AssumptionCacheTracker *ACT;
 
+  /// \brief The properties of a call site that its cost depends on, besides
+  /// the callee, when its arguments cannot be simplified.
+  struct CallSiteKey {
+    int Threshold;
+    AttributeSet Attrs;
+    /// The arguments that are pointers with a known constant offset from
+    /// their base, as a bit mask.
+    uint64_t ConstantOffsetPtrArgs;
+    bool IsCallerRecursive;
+    bool OnlyOneCallAndLocalLinkage;
+    bool IsFollowedByUnreachable;
+
+    bool operator==(const CallSiteKey &RHS) const {
+      return Threshold == RHS.Threshold && Attrs == RHS.Attrs &&
+             ConstantOffsetPtrArgs == RHS.ConstantOffsetPtrArgs &&
+             IsCallerRecursive == RHS.IsCallerRecursive &&
+             OnlyOneCallAndLocalLinkage == RHS.OnlyOneCallAndLocalLinkage &&
+             IsFollowedByUnreachable == RHS.IsFollowedByUnreachable;
+    }
+  };
+
+  /// \brief A callback to drop the costs cached for a function when it is
+  /// deleted.
+  class FunctionCallbackVH : public CallbackVH {
+    InlineCostAnalysis *ICA;
+    void deleted() override;
+
+  public:
+    typedef DenseMapInfo<Value *> DMI;
+
+    FunctionCallbackVH(Value *V, InlineCostAnalysis *ICA = nullptr)
+        : CallbackVH(V), ICA(ICA) {}
+  };
+
+  friend FunctionCallbackVH;
+
+  typedef SmallVector<std::pair<CallSiteKey, InlineCost>, 4> CalleeCosts;
+  typedef DenseMap<FunctionCallbackVH, CalleeCosts, FunctionCallbackVH::DMI>
+      CostCacheMap;
+  CostCacheMap CostCache;
+
+  /// \brief The functions of the SCC being processed.
+  SmallPtrSet<Function *, 8> SCCFunctions;
+
 public:
   static char ID;
 
@@ -111,7 +167,9 @@ public:
 
   // Pass interface implementation.
   void getAnalysisUsage(AnalysisUsage &AU) const override;
+  bool doInitialization(CallGraph &CG) override;
   bool runOnSCC(CallGraphSCC &SCC) override;
+  bool doFinalization(CallGraph &CG) override;
 
   /// \brief Get an InlineCost object representing the cost of inlining this
   /// callsite.
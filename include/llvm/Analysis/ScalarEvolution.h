@@ -417,6 +417,15 @@ namespace llvm {
     /// Analyze the expression.
     const SCEV *createSCEV(Value *V);
 
+    /// getOrCreateAddExpr, getOrCreateMulExpr - Return the uniqued expression
+    /// of the sorted operands, without simplifying it. This is used once the
+    /// simplifications are done, or past the depth limit of getAddExpr and
+    /// getMulExpr.
+    const SCEV *getOrCreateAddExpr(SmallVectorImpl<const SCEV *> &Ops,
+                                   SCEV::NoWrapFlags Flags);
+    const SCEV *getOrCreateMulExpr(SmallVectorImpl<const SCEV *> &Ops,
+                                   SCEV::NoWrapFlags Flags);
+
     /// createNodeForPHI - Provide the special handling we need to analyze PHI
     /// SCEVs.
     const SCEV *createNodeForPHI(PHINode *PN);
@@ -611,40 +620,48 @@ namespace llvm {
     const SCEV *getZeroExtendExpr(const SCEV *Op, Type *Ty);
     const SCEV *getSignExtendExpr(const SCEV *Op, Type *Ty);
     const SCEV *getAnyExtendExpr(const SCEV *Op, Type *Ty);
+    /// getAddExpr, getMulExpr - Return a canonical add or multiply expression.
+    /// \p Depth is the depth of the recursive simplifications; past
+    /// -scalar-evolution-max-arith-depth, the expression is built as is.
     const SCEV *getAddExpr(SmallVectorImpl<const SCEV *> &Ops,
-                           SCEV::NoWrapFlags Flags = SCEV::FlagAnyWrap);
+                           SCEV::NoWrapFlags Flags = SCEV::FlagAnyWrap,
+                           unsigned Depth = 0);
     const SCEV *getAddExpr(const SCEV *LHS, const SCEV *RHS,
-                           SCEV::NoWrapFlags Flags = SCEV::FlagAnyWrap) {
+                           SCEV::NoWrapFlags Flags = SCEV::FlagAnyWrap,
+                           unsigned Depth = 0) {
       SmallVector<const SCEV *, 2> Ops;
       Ops.push_back(LHS);
       Ops.push_back(RHS);
-      return getAddExpr(Ops, Flags);
+      return getAddExpr(Ops, Flags, Depth);
     }
     const SCEV *getAddExpr(const SCEV *Op0, const SCEV *Op1, const SCEV *Op2,
-                           SCEV::NoWrapFlags Flags = SCEV::FlagAnyWrap) {
+                           SCEV::NoWrapFlags Flags = SCEV::FlagAnyWrap,
+                           unsigned Depth = 0) {
       SmallVector<const SCEV *, 3> Ops;
       Ops.push_back(Op0);
       Ops.push_back(Op1);
       Ops.push_back(Op2);
-      return getAddExpr(Ops, Flags);
+      return getAddExpr(Ops, Flags, Depth);
     }
     const SCEV *getMulExpr(SmallVectorImpl<const SCEV *> &Ops,
-                           SCEV::NoWrapFlags Flags = SCEV::FlagAnyWrap);
+                           SCEV::NoWrapFlags Flags = SCEV::FlagAnyWrap,
+                           unsigned Depth = 0);
     const SCEV *getMulExpr(const SCEV *LHS, const SCEV *RHS,
-                           SCEV::NoWrapFlags Flags = SCEV::FlagAnyWrap)
-    {
+                           SCEV::NoWrapFlags Flags = SCEV::FlagAnyWrap,
+                           unsigned Depth = 0) {
       SmallVector<const SCEV *, 2> Ops;
       Ops.push_back(LHS);
       Ops.push_back(RHS);
-      return getMulExpr(Ops, Flags);
+      return getMulExpr(Ops, Flags, Depth);
     }
     const SCEV *getMulExpr(const SCEV *Op0, const SCEV *Op1, const SCEV *Op2,
-                           SCEV::NoWrapFlags Flags = SCEV::FlagAnyWrap) {
+                           SCEV::NoWrapFlags Flags = SCEV::FlagAnyWrap,
+                           unsigned Depth = 0) {
       SmallVector<const SCEV *, 3> Ops;
       Ops.push_back(Op0);
       Ops.push_back(Op1);
       Ops.push_back(Op2);
-      return getMulExpr(Ops, Flags);
+      return getMulExpr(Ops, Flags, Depth);
     }
     const SCEV *getUDivExpr(const SCEV *LHS, const SCEV *RHS);
     const SCEV *getUDivExactExpr(const SCEV *LHS, const SCEV *RHS);
@@ -695,7 +712,8 @@ namespace llvm {
 
     /// getMinusSCEV - Return LHS-RHS.  Minus is represented in SCEV as A+B*-1.
     const SCEV *getMinusSCEV(const SCEV *LHS, const SCEV *RHS,
-                             SCEV::NoWrapFlags Flags = SCEV::FlagAnyWrap);
+                             SCEV::NoWrapFlags Flags = SCEV::FlagAnyWrap,
+                             unsigned Depth = 0);
 
     /// getTruncateOrZeroExtend - Return a SCEV corresponding to a conversion
     /// of the input value to the specified type.  If the type must be
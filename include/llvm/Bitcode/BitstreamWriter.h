@@ -61,12 +61,6 @@ class BitstreamWriter {
   };
   std::vector<BlockInfo> BlockInfoRecords;
 
-  // BackpatchWord - Backpatch a 32-bit word in the output with the specified
-  // value.
-  void BackpatchWord(unsigned ByteNo, unsigned NewWord) {
-    support::endian::write32le(&Out[ByteNo], NewWord);
-  }
-
   void WriteByte(unsigned char Value) {
     Out.push_back(Value);
   }
@@ -99,6 +93,34 @@ public:
   /// \brief Retrieve the current position in the stream, in bits.
   uint64_t GetCurrentBitNo() const { return GetBufferOffset() * 8 + CurBit; }
 
+  /// \brief Backpatch a 32-bit word in the output at the bit position \p BitNo
+  /// with the specified value. The position need not be word aligned, but the
+  /// bits must have been flushed to the output already.
+  void BackpatchWord(uint64_t BitNo, unsigned NewWord) {
+    unsigned ByteNo = BitNo / 8;
+    unsigned StartBit = BitNo & 7;
+    if (!StartBit) {
+      support::endian::write32le(&Out[ByteNo], NewWord);
+      return;
+    }
+
+    // The word straddles five bytes: merge it with the bits around it.
+    assert(ByteNo + 5 <= Out.size() && "Backpatching unflushed bits");
+    uint64_t Bits = support::endian::read32le(&Out[ByteNo]) |
+                    (uint64_t(uint8_t(Out[ByteNo + 4])) << 32);
+    uint64_t Mask = uint64_t(~0U) << StartBit;
+    Bits = (Bits & ~Mask) | (uint64_t(NewWord) << StartBit);
+    support::endian::write32le(&Out[ByteNo], uint32_t(Bits));
+    Out[ByteNo + 4] = char(Bits >> 32);
+  }
+
+  /// \brief Backpatch a 64-bit value, emitted as two 32-bit fixed fields, at
+  /// the bit position \p BitNo.
+  void BackpatchWord64(uint64_t BitNo, uint64_t Val) {
+    BackpatchWord(BitNo, uint32_t(Val));
+    BackpatchWord(BitNo + 32, uint32_t(Val >> 32));
+  }
+
   //===--------------------------------------------------------------------===//
   // Basic Primitives for emitting bits to the stream.
   //===--------------------------------------------------------------------===//
@@ -232,10 +254,10 @@ public:
 
     // Compute the size of the block, in words, not counting the size field.
     unsigned SizeInWords = GetWordIndex() - B.StartSizeWord - 1;
-    unsigned ByteNo = B.StartSizeWord*4;
+    uint64_t BitNo = uint64_t(B.StartSizeWord) * 32;
 
     // Update the block size field in the header of this sub-block.
-    BackpatchWord(ByteNo, SizeInWords);
+    BackpatchWord(BitNo, SizeInWords);
 
     // Restore the inner block's code size and abbrev table.
     CurCodeSize = B.PrevCodeSize;
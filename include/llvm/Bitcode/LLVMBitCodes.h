@@ -22,7 +22,7 @@
 
 namespace llvm {
 namespace bitc {
-  // The only top-level block type defined is for a module.
+  // The top-level block types are the module and the function summary.
   enum BlockIDs {
     // Blocks
     MODULE_BLOCK_ID          = FIRST_APPLICATION_BLOCKID,
@@ -42,7 +42,11 @@ namespace bitc {
 
     TYPE_BLOCK_ID_NEW,
 
-    USELIST_BLOCK_ID
+    USELIST_BLOCK_ID,
+
+    // Top-level block holding the function summaries of a module, or the
+    // combined summaries of several modules.
+    FUNCTION_SUMMARY_BLOCK_ID
   };
 
 
@@ -168,6 +172,8 @@ namespace bitc {
     METADATA_OBJC_PROPERTY = 30,  // [distinct, name, file, line, ...]
     METADATA_IMPORTED_ENTITY=31,  // [distinct, tag, scope, entity, line, name]
     METADATA_MODULE=32,           // [distinct, scope, name, ...]
+    METADATA_INDEX_OFFSET  = 33,  // [offset low 32 bits, offset high 32 bits]
+    METADATA_INDEX         = 34,  // [n x bitpos delta]
   };
 
   // The constants block (CONSTANTS_BLOCK_ID) describes emission for each
@@ -361,6 +367,17 @@ namespace bitc {
     USELIST_CODE_BB      = 2  // BB: [index..., bb-id]
   };
 
+  /// FUNCTION_SUMMARY blocks describe the function definitions of one or
+  /// several modules. Symbol and module path ids are implicitly assigned in
+  /// the order of the SYMBOL and MODULE_PATH records.
+  enum FunctionSummaryCodes {
+    FS_CODE_SYMBOL      = 1,  // SYMBOL:      [strchr x N]
+    FS_CODE_MODULE_PATH = 2,  // MODULE_PATH: [strchr x N]
+    // ENTRY: [symbolid, modulepathid, linkage, instcount, flags,
+    //         n x (calleesymbolid, numcalls)]
+    FS_CODE_ENTRY       = 3
+  };
+
   enum AttributeKindCodes {
     // = 0 is unused
     ATTR_KIND_ALIGNMENT = 1,
@@ -24,6 +24,7 @@
 namespace llvm {
   class BitstreamWriter;
   class DataStreamer;
+  class FunctionInfoIndex;
   class LLVMContext;
   class Module;
   class ModulePass;
@@ -58,6 +59,19 @@ namespace llvm {
   parseBitcodeFile(MemoryBufferRef Buffer, LLVMContext &Context,
                    DiagnosticHandlerFunction DiagnosticHandler = nullptr);
 
+  /// Check if the specified bitcode buffer contains a function summary
+  /// block.
+  bool hasFunctionSummary(MemoryBufferRef Buffer,
+                          DiagnosticHandlerFunction DiagnosticHandler);
+
+  /// Parse the function summary block of the specified bitcode buffer, which
+  /// is either a module emitted with its summaries, or a combined index
+  /// written by WriteFunctionSummaryToFile. The module itself is not read.
+  /// The summaries of a module are attributed to the buffer identifier.
+  ErrorOr<std::unique_ptr<FunctionInfoIndex>>
+  getFunctionInfoIndex(MemoryBufferRef Buffer,
+                       DiagnosticHandlerFunction DiagnosticHandler);
+
   /// \brief Write the specified module to the specified raw output stream.
   ///
   /// For streams where it matters, the given stream should be in "binary"
@@ -66,8 +80,17 @@ namespace llvm {
   /// If \c ShouldPreserveUseListOrder, encode the use-list order for each \a
   /// Value in \c M.  These will be reconstructed exactly when \a M is
   /// deserialized.
+  ///
+  /// If \c EmitFunctionSummary, emit the summaries of the functions defined
+  /// in \c M, for use by a summary-based cross-module import.
   void WriteBitcodeToFile(const Module *M, raw_ostream &Out,
-                          bool ShouldPreserveUseListOrder = false);
+                          bool ShouldPreserveUseListOrder = false,
+                          bool EmitFunctionSummary = false);
+
+  /// Write the specified function summary index, usually a combined index, to
+  /// the specified raw output stream as a bitcode file without module.
+  void WriteFunctionSummaryToFile(const FunctionInfoIndex &Index,
+                                  raw_ostream &Out);
 
   /// isBitcodeWrapper - Return true if the given bytes are the magic bytes
   /// for an LLVM IR bitcode wrapper.
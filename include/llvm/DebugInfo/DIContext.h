@@ -15,6 +15,7 @@
 #ifndef LLVM_DEBUGINFO_DICONTEXT_H
 #define LLVM_DEBUGINFO_DICONTEXT_H
 
+#include "llvm/ADT/ArrayRef.h"
 #include "llvm/ADT/DenseMap.h"
 #include "llvm/ADT/SmallVector.h"
 #include "llvm/Object/ObjectFile.h"
@@ -22,6 +23,7 @@
 #include "llvm/Support/Casting.h"
 #include "llvm/Support/DataTypes.h"
 #include <string>
+#include <vector>
 
 namespace llvm {
 
@@ -132,6 +134,16 @@ public:
       uint64_t Size, DILineInfoSpecifier Specifier = DILineInfoSpecifier()) = 0;
   virtual DIInliningInfo getInliningInfoForAddress(uint64_t Address,
       DILineInfoSpecifier Specifier = DILineInfoSpecifier()) = 0;
+  /// Returns the line info of each of \p Addresses, in the same order.
+  virtual std::vector<DILineInfo> getLineInfoForAddresses(
+      ArrayRef<uint64_t> Addresses,
+      DILineInfoSpecifier Specifier = DILineInfoSpecifier()) {
+    std::vector<DILineInfo> Result;
+    Result.reserve(Addresses.size());
+    for (uint64_t Address : Addresses)
+      Result.push_back(getLineInfoForAddress(Address, Specifier));
+    return Result;
+  }
 private:
   const DIContextKind Kind;
 };
@@ -124,6 +124,18 @@ class DWARFUnit {
   // The compile unit debug information entry items.
   std::vector<DWARFDebugInfoEntryMinimal> DieArray;
 
+  // An address range covered by a subprogram DIE, as its index in DieArray.
+  struct SubprogramRange {
+    uint64_t LowPC;
+    uint64_t HighPC;
+    uint32_t DIEIndex;
+  };
+  // Sorted, non-overlapping address ranges, each mapped to the first
+  // subprogram DIE that covers it. Built by the first address lookup, and
+  // cleared with the DIEs.
+  std::vector<SubprogramRange> SubprogramRanges;
+  bool SubprogramRangesBuilt;
+
   class DWOHolder {
     object::OwningBinary<object::ObjectFile> DWOFile;
     std::unique_ptr<DWARFContext> DWOContext;
@@ -273,6 +285,10 @@ private:
   /// it was actually constructed.
   bool parseDWO();
 
+  /// buildSubprogramRanges - Fills SubprogramRanges from the address ranges
+  /// of the subprogram DIEs.
+  void buildSubprogramRanges();
+
   /// getSubprogramForAddress - Returns subprogram DIE with address range
   /// encompassing the provided address. The pointer is alive as long as parsed
   /// compile unit DIEs are not cleared.
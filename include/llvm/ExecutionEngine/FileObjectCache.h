@@ -0,0 +1,94 @@
+//===- FileObjectCache.h - Persistent object cache for the JIT --*- C++ -*-===//
+//
+//                     The LLVM Compiler Infrastructure
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+//
+// This file declares FileObjectCache, an ObjectCache for MCJIT and Orc that
+// keeps the compiled objects in a directory, so that they are reused across
+// processes.
+//
+//===----------------------------------------------------------------------===//
+
+#ifndef LLVM_EXECUTIONENGINE_FILEOBJECTCACHE_H
+#define LLVM_EXECUTIONENGINE_FILEOBJECTCACHE_H
+
+#include "llvm/ADT/DenseMap.h"
+#include "llvm/ExecutionEngine/ObjectCache.h"
+#include "llvm/Support/CachePruning.h"
+#include <mutex>
+#include <string>
+
+namespace llvm {
+
+class TargetMachine;
+
+/// An ObjectCache that stores the objects in a directory.
+///
+/// An object is keyed by an MD5 hash of the bitcode of its module, of the
+/// target triple, CPU and features, of the code generation options of the
+/// TargetMachine, including its TargetOptions, and of the version of LLVM.
+/// The directory can be shared by several processes: objects are written to
+/// temporary files that are renamed into place, so that a lookup never sees a
+/// partially written object. The objects are memory mapped when they are
+/// loaded.
+///
+/// The cache is only an optimization: an object that cannot be read is a miss,
+/// and a store that fails leaves the cache without the object.
+class FileObjectCache : public ObjectCache {
+public:
+  /// Cache the objects compiled by \p TM in the directory \p Path, which is
+  /// created if needed.
+  FileObjectCache(StringRef Path, const TargetMachine &TM);
+  ~FileObjectCache() override;
+
+  /// Remove the least recently used objects when the objects take more than
+  /// \p MaxSizeInBytes bytes. A value of 0, the default, disables it.
+  FileObjectCache &setMaxSize(uint64_t MaxSizeInBytes) {
+    Pruning.setMaxSize(MaxSizeInBytes);
+    return *this;
+  }
+
+  /// Remove the objects that have not been used for \p ExpireAfter seconds. A
+  /// value of 0, the default, disables it.
+  FileObjectCache &setEntryExpiration(unsigned ExpireAfter) {
+    Pruning.setEntryExpiration(ExpireAfter);
+    return *this;
+  }
+
+  /// Scan the directory to remove objects at most every \p PruningInterval
+  /// seconds. The default is 0: the directory is scanned after each store if
+  /// a maximum size or an expiration is set.
+  FileObjectCache &setPruningInterval(int PruningInterval) {
+    Pruning.setPruningInterval(PruningInterval);
+    return *this;
+  }
+
+  void notifyObjectCompiled(const Module *M, MemoryBufferRef Obj) override;
+  std::unique_ptr<MemoryBuffer> getObject(const Module *M) override;
+
+  /// Return the key of the object compiled from \p M, or an empty string if
+  /// \p M cannot be materialized.
+  std::string getKey(const Module &M) const;
+
+private:
+  std::string getObjectPath(StringRef Key) const;
+
+  std::string Path;
+  // The target part of the keys.
+  std::string TargetKey;
+  CachePruning Pruning;
+
+  // The keys of the modules looked up and not compiled yet. The JIT compiles
+  // a module after looking it up, and code generation may change the module,
+  // so its key must be computed before.
+  std::mutex KeysMutex;
+  DenseMap<const Module *, std::string> PendingKeys;
+};
+
+} // namespace llvm
+
+#endif // LLVM_EXECUTIONENGINE_FILEOBJECTCACHE_H
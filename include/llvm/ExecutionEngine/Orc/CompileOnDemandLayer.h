@@ -20,8 +20,15 @@
 #include "LogicalDylib.h"
 #include "llvm/ADT/STLExtras.h"
 #include "llvm/ExecutionEngine/SectionMemoryManager.h"
+#include "llvm/IR/CallSite.h"
+#include "llvm/Support/Atomic.h"
+#include "llvm/Support/ThreadPool.h"
 #include "llvm/Transforms/Utils/Cloning.h"
+#include <algorithm>
+#include <condition_variable>
+#include <deque>
 #include <list>
+#include <mutex>
 #include <set>
 
 #include "llvm/Support/Debug.h"
@@ -36,6 +43,15 @@ namespace orc {
 /// added to the layer below. When a stub is called it triggers the extraction
 /// of the function body from the original module. The extracted body is then
 /// compiled and executed.
+///
+///   The layer can also compile functions speculatively on a background
+/// thread: compiling a function on demand then queues the functions it calls,
+/// per the module's static call graph, so that they are usually ready by the
+/// time they are first called. The compiles, and the other operations on the
+/// layers below, are serialized, so with background compilation enabled the
+/// layers below and the LLVMContexts of the added modules must only be used
+/// through this layer. A function compiled on demand goes ahead of the queued
+/// ones, so it waits for at most one compile of the background thread.
 template <typename BaseLayerT, typename CompileCallbackMgrT,
           typename PartitioningFtor =
             std::function<std::set<Function*>(Function&)>>
@@ -79,6 +95,7 @@ private:
   struct LogicalModuleResources {
     std::shared_ptr<Module> SourceModule;
     std::set<const Function*> StubsToClone;
+    std::set<const Function*> Speculated;
   };
 
   struct LogicalDylibResources {
@@ -94,15 +111,41 @@ private:
   typedef typename CODLogicalDylib::LogicalModuleHandle LogicalModuleHandle;
   typedef std::list<CODLogicalDylib> LogicalDylibList;
 
+  struct SpeculationTarget {
+    CODLogicalDylib *LD;
+    LogicalModuleHandle LMH;
+    Function *F;
+  };
+
 public:
   /// @brief Handle to a set of loaded modules.
   typedef typename LogicalDylibList::iterator ModuleSetHandleT;
 
   /// @brief Construct a compile-on-demand layer instance.
+  ///
+  ///   If CompileInBackground is true, the callees of the compiled functions
+  /// are compiled speculatively on a background thread. Their stubs keep
+  /// calling the compile callbacks until their bodies are ready, and a call
+  /// that reaches a function being compiled waits for its body.
   CompileOnDemandLayer(BaseLayerT &BaseLayer, CompileCallbackMgrT &CallbackMgr,
-                       bool CloneStubsIntoPartitions)
+                       bool CloneStubsIntoPartitions,
+                       bool CompileInBackground = false)
       : BaseLayer(BaseLayer), CompileCallbackMgr(CallbackMgr),
-        CloneStubsIntoPartitions(CloneStubsIntoPartitions) {}
+        CloneStubsIntoPartitions(CloneStubsIntoPartitions) {
+    if (CompileInBackground)
+      BackgroundCompiles = llvm::make_unique<ThreadPool>(1);
+  }
+
+  ~CompileOnDemandLayer() {
+    if (!BackgroundCompiles)
+      return;
+    // Drop the pending speculation, and wait for the function being compiled.
+    {
+      std::lock_guard<std::mutex> Lock(SpeculationMutex);
+      SpeculationQueue.clear();
+    }
+    BackgroundCompiles->wait();
+  }
 
   /// @brief Add a module to the compile-on-demand layer.
   template <typename ModuleSetT, typename MemoryManagerPtrT,
@@ -114,6 +157,8 @@ public:
     assert(MemMgr == nullptr &&
            "User supplied memory managers not supported with COD yet.");
 
+    std::lock_guard<std::recursive_mutex> Lock(CompileMutex);
+
     LogicalDylibs.push_back(CODLogicalDylib(BaseLayer));
     auto &LDResources = LogicalDylibs.back().getDylibResources();
 
@@ -142,6 +187,16 @@ public:
   ///   This will remove all modules in the layers below that were derived from
   /// the module represented by H.
   void removeModuleSet(ModuleSetHandleT H) {
+    std::lock_guard<std::recursive_mutex> Lock(CompileMutex);
+    {
+      std::lock_guard<std::mutex> SpeculationLock(SpeculationMutex);
+      SpeculationQueue.erase(
+          std::remove_if(SpeculationQueue.begin(), SpeculationQueue.end(),
+                         [&H](const SpeculationTarget &Target) {
+                           return Target.LD == &*H;
+                         }),
+          SpeculationQueue.end());
+    }
     LogicalDylibs.erase(H);
   }
 
@@ -150,18 +205,34 @@ public:
   /// @param ExportedSymbolsOnly If true, search only for exported symbols.
   /// @return A handle for the given named symbol, if it exists.
   JITSymbol findSymbol(StringRef Name, bool ExportedSymbolsOnly) {
-    return BaseLayer.findSymbol(Name, ExportedSymbolsOnly);
+    std::lock_guard<std::recursive_mutex> Lock(CompileMutex);
+    return guardSymbol(BaseLayer.findSymbol(Name, ExportedSymbolsOnly));
   }
 
   /// @brief Get the address of a symbol provided by this layer, or some layer
   ///        below this one.
   JITSymbol findSymbolIn(ModuleSetHandleT H, const std::string &Name,
                          bool ExportedSymbolsOnly) {
-    return H->findSymbol(Name, ExportedSymbolsOnly);
+    std::lock_guard<std::recursive_mutex> Lock(CompileMutex);
+    return guardSymbol(H->findSymbol(Name, ExportedSymbolsOnly));
   }
 
 private:
 
+  // Materializing a symbol links its object in the layers below, which must
+  // not run concurrently with a background compile.
+  JITSymbol guardSymbol(JITSymbol Sym) {
+    if (!Sym || !BackgroundCompiles)
+      return Sym;
+    JITSymbolFlags Flags = Sym.getFlags();
+    return JITSymbol(
+        [this, Sym]() mutable {
+          std::lock_guard<std::recursive_mutex> Lock(CompileMutex);
+          return Sym.getAddress();
+        },
+        Flags);
+  }
+
   void addLogicalModule(CODLogicalDylib &LD, std::shared_ptr<Module> SrcM) {
 
     // Bump the linkage and rename any anonymous/privote members in SrcM to
@@ -207,7 +278,7 @@ private:
       makeStub(*StubF, *FnBodyPtr);
       CCInfo.setCompileAction(
         [this, &LD, LMH, &F]() {
-          return this->extractAndCompile(LD, LMH, F);
+          return this->compileOnDemand(LD, LMH, F);
         });
     }
 
@@ -249,19 +320,83 @@ private:
     return MangledName;
   }
 
+  volatile uintptr_t *getFnBodyPointer(CODLogicalDylib &LD,
+                                       LogicalModuleHandle LMH,
+                                       const Function &F) {
+    Module &SrcM = *LD.getLogicalModuleResources(LMH).SourceModule;
+    auto FnPtrSym =
+      BaseLayer.findSymbolIn(*LD.moduleHandlesBegin(LMH),
+                             Mangle((F.getName() + "$orc_addr").str(),
+                                    SrcM.getDataLayout()),
+                             false);
+    assert(FnPtrSym && "Couldn't find function body pointer.");
+    return reinterpret_cast<volatile uintptr_t*>(
+        static_cast<uintptr_t>(FnPtrSym.getAddress()));
+  }
+
+  // Compile F for a call that reached its compile callback. This goes ahead
+  // of the speculative compiles that have not started yet.
+  TargetAddress compileOnDemand(CODLogicalDylib &LD, LogicalModuleHandle LMH,
+                                Function &F) {
+    if (!BackgroundCompiles)
+      return extractAndCompile(LD, LMH, F, /*Speculative=*/false);
+
+    {
+      std::lock_guard<std::mutex> Lock(SpeculationMutex);
+      ++NumDemandedCompiles;
+    }
+    TargetAddress Addr;
+    {
+      std::lock_guard<std::recursive_mutex> Lock(CompileMutex);
+      Addr = extractAndCompile(LD, LMH, F, /*Speculative=*/false);
+    }
+    {
+      std::lock_guard<std::mutex> Lock(SpeculationMutex);
+      --NumDemandedCompiles;
+    }
+    DemandedCompilesDone.notify_all();
+    return Addr;
+  }
+
+  // Extract the partition of F from the source module, compile it, and point
+  // the stubs of its functions at their bodies. With background compilation,
+  // the caller holds CompileMutex.
   TargetAddress extractAndCompile(CODLogicalDylib &LD,
                                   LogicalModuleHandle LMH,
-                                  Function &F) {
+                                  Function &F, bool Speculative) {
     Module &SrcM = *LD.getLogicalModuleResources(LMH).SourceModule;
 
-    // If F is a declaration we must already have compiled it.
+    // If F is a declaration we must already have compiled it, as part of
+    // another partition or in the background while the caller was waiting
+    // for CompileMutex. Its body pointer holds its address.
     if (F.isDeclaration())
-      return 0;
+      return *getFnBodyPointer(LD, LMH, F);
 
-    // Grab the name of the function being called here.
-    std::string CalledFnName = Mangle(F.getName(), SrcM.getDataLayout());
+    DEBUG_WITH_TYPE("orc-cod", dbgs() << "Compiling @" << F.getName()
+                                      << (Speculative ? " in the background"
+                                                      : " on demand")
+                                      << "\n");
 
     auto Partition = LD.getDylibResources().Partitioner(F);
+
+    // Collect the callees of a partition compiled on demand before its bodies
+    // are moved out of the source module. The callees of the speculative
+    // compiles are not queued in turn, so that the background thread does
+    // not compile the whole call graph.
+    std::vector<Function*> Callees;
+    if (BackgroundCompiles && !Speculative)
+      for (auto *SubF : Partition)
+        for (auto &BB : *SubF)
+          for (auto &I : BB) {
+            CallSite CS(&I);
+            if (!CS)
+              continue;
+            if (auto *Callee = dyn_cast<Function>(
+                  CS.getCalledValue()->stripPointerCasts()))
+              if (!Callee->isDeclaration())
+                Callees.push_back(Callee);
+          }
+
     auto PartitionH = emitPartition(LD, LMH, Partition);
 
     TargetAddress CalledAddr = 0;
@@ -270,29 +405,66 @@ private:
       auto FnBodySym =
         BaseLayer.findSymbolIn(PartitionH, Mangle(FName, SrcM.getDataLayout()),
                                false);
-      auto FnPtrSym =
-        BaseLayer.findSymbolIn(*LD.moduleHandlesBegin(LMH),
-                               Mangle(FName + "$orc_addr",
-                                      SrcM.getDataLayout()),
-                               false);
       assert(FnBodySym && "Couldn't find function body.");
-      assert(FnPtrSym && "Couldn't find function body pointer.");
 
       TargetAddress FnBodyAddr = FnBodySym.getAddress();
-      void *FnPtrAddr = reinterpret_cast<void*>(
-          static_cast<uintptr_t>(FnPtrSym.getAddress()));
 
       // If this is the function we're calling record the address so we can
       // return it from this function.
       if (SubF == &F)
         CalledAddr = FnBodyAddr;
 
-      memcpy(FnPtrAddr, &FnBodyAddr, sizeof(uintptr_t));
+      // Update the body pointer with a single store, once the body is
+      // visible, so that a thread calling the stub concurrently either calls
+      // the compile callback or the complete body.
+      sys::MemoryFence();
+      *getFnBodyPointer(LD, LMH, *SubF) = static_cast<uintptr_t>(FnBodyAddr);
     }
 
+    for (auto *Callee : Callees)
+      speculate(LD, LMH, *Callee);
+
     return CalledAddr;
   }
 
+  // Queue F for compilation on the background thread, unless it has already
+  // been compiled or queued.
+  void speculate(CODLogicalDylib &LD, LogicalModuleHandle LMH, Function &F) {
+    auto &LMResources = LD.getLogicalModuleResources(LMH);
+    if (F.isDeclaration() || !LMResources.Speculated.insert(&F).second)
+      return;
+    DEBUG_WITH_TYPE("orc-cod", dbgs() << "Queued @" << F.getName()
+                                      << " for background compilation\n");
+    {
+      std::lock_guard<std::mutex> Lock(SpeculationMutex);
+      SpeculationQueue.push_back({&LD, LMH, &F});
+    }
+    BackgroundCompiles->async([this]() { compileNextSpeculationTarget(); });
+  }
+
+  void compileNextSpeculationTarget() {
+    // Let the compiles that the application waits for go first.
+    {
+      std::unique_lock<std::mutex> Lock(SpeculationMutex);
+      DemandedCompilesDone.wait(Lock,
+                                [this]() { return !NumDemandedCompiles; });
+    }
+
+    std::lock_guard<std::recursive_mutex> Lock(CompileMutex);
+    SpeculationTarget Target;
+    {
+      std::lock_guard<std::mutex> SpeculationLock(SpeculationMutex);
+      // The target may have been dropped with its module set.
+      if (SpeculationQueue.empty())
+        return;
+      Target = SpeculationQueue.front();
+      SpeculationQueue.pop_front();
+    }
+    if (!Target.F->isDeclaration())
+      extractAndCompile(*Target.LD, Target.LMH, *Target.F,
+                        /*Speculative=*/true);
+  }
+
   template <typename PartitionT>
   BaseLayerModuleSetHandleT emitPartition(CODLogicalDylib &LD,
                                           LogicalModuleHandle LMH,
@@ -345,6 +517,21 @@ private:
   CompileCallbackMgrT &CompileCallbackMgr;
   LogicalDylibList LogicalDylibs;
   bool CloneStubsIntoPartitions;
+
+  // With background compilation, guards the logical dylibs, the layers below
+  // and the source modules, which the compile callbacks and the background
+  // thread use.
+  std::recursive_mutex CompileMutex;
+
+  // Guards the queue of the functions to compile in the background, and the
+  // count of the compiles that the application waits for. It is never held
+  // during a compile.
+  std::mutex SpeculationMutex;
+  std::deque<SpeculationTarget> SpeculationQueue;
+  unsigned NumDemandedCompiles = 0;
+  std::condition_variable DemandedCompilesDone;
+
+  std::unique_ptr<ThreadPool> BackgroundCompiles;
 };
 
 } // End namespace orc.
@@ -0,0 +1,158 @@
+//===- SlabMemoryManager.h - Slab-based memory manager for the JIT -*- C++ -*-//
+//
+//                     The LLVM Compiler Infrastructure
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+//
+// This file contains the declaration of a memory manager for MCJIT and Orc
+// that carves the sections of many objects out of a few large slabs.
+//
+//===----------------------------------------------------------------------===//
+
+#ifndef LLVM_EXECUTIONENGINE_SLABMEMORYMANAGER_H
+#define LLVM_EXECUTIONENGINE_SLABMEMORYMANAGER_H
+
+#include "llvm/ADT/SmallVector.h"
+#include "llvm/ExecutionEngine/RTDyldMemoryManager.h"
+#include "llvm/Support/Memory.h"
+#include <map>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+namespace llvm {
+
+/// A pool of page ranges carved out of large read-write slabs of memory, to be
+/// shared by the SlabMemoryManagers of a JIT.
+///
+/// The pages that are released go back to the pool with read-write
+/// permissions, and a slab that becomes entirely free is returned to the
+/// system. This class is thread-safe.
+class SlabAllocator {
+  SlabAllocator(const SlabAllocator &) = delete;
+  void operator=(const SlabAllocator &) = delete;
+
+public:
+  /// Create a pool whose slabs are of (at least) \p SlabSize bytes. Larger
+  /// requests get a slab of their own.
+  explicit SlabAllocator(size_t SlabSize = 4 * 1024 * 1024);
+  ~SlabAllocator();
+
+  /// Return a read-write range of whole pages of at least \p Size bytes, or an
+  /// empty block if the system is out of memory.
+  sys::MemoryBlock allocatePages(size_t Size);
+
+  /// Give back a range returned by allocatePages, with any permissions.
+  void releasePages(sys::MemoryBlock Block);
+
+  /// Return the number of bytes of the slabs currently mapped.
+  size_t getMappedSize() const;
+
+private:
+  struct Slab {
+    sys::MemoryBlock Block;
+    // Free page ranges, as start address to size, never adjacent.
+    std::map<uintptr_t, size_t> FreeRanges;
+    size_t FreeSize;
+  };
+
+  size_t SlabSize;
+  mutable std::mutex Mutex;
+  // Slabs by start address.
+  std::map<uintptr_t, Slab> Slabs;
+};
+
+/// A memory manager for MCJIT and Orc that packs the sections of the objects
+/// in page ranges of a SlabAllocator, which can be shared with other memory
+/// managers.
+///
+/// Unlike SectionMemoryManager, it asks RuntimeDyld for the total size of the
+/// sections of each object, and allocates them together: the code, the
+/// read-only data and the read-write data of an object each take a single
+/// range of pages, which finalizeMemory protects with a single call. The pages
+/// of adjacent objects that are finalized together are protected together.
+///
+/// The memory of the objects is released when the memory manager is
+/// destroyed. To free the memory of each module of an Orc JIT, give each
+/// module set a SlabMemoryManager of its own over a shared SlabAllocator.
+class SlabMemoryManager : public RTDyldMemoryManager {
+  SlabMemoryManager(const SlabMemoryManager &) = delete;
+  void operator=(const SlabMemoryManager &) = delete;
+
+public:
+  /// Create a memory manager allocating from \p Allocator, or from a
+  /// SlabAllocator of its own if it is null.
+  explicit SlabMemoryManager(
+      std::shared_ptr<SlabAllocator> Allocator = nullptr);
+  ~SlabMemoryManager() override;
+
+  bool needsToReserveAllocationSpace() override { return true; }
+
+  /// \brief Reserve the pages of the sections of the next object, so that
+  /// they are allocated contiguously.
+  void reserveAllocationSpace(uintptr_t CodeSize, uintptr_t DataSizeRO,
+                              uintptr_t DataSizeRW) override;
+
+  /// \brief Allocates a memory block of (at least) the given size suitable for
+  /// executable code.
+  ///
+  /// The value of \p Alignment must be a power of two.  If \p Alignment is zero
+  /// a default alignment of 16 will be used.
+  uint8_t *allocateCodeSection(uintptr_t Size, unsigned Alignment,
+                               unsigned SectionID,
+                               StringRef SectionName) override;
+
+  /// \brief Allocates a memory block of (at least) the given size suitable for
+  /// data.
+  ///
+  /// The value of \p Alignment must be a power of two.  If \p Alignment is zero
+  /// a default alignment of 16 will be used.
+  uint8_t *allocateDataSection(uintptr_t Size, unsigned Alignment,
+                               unsigned SectionID, StringRef SectionName,
+                               bool isReadOnly) override;
+
+  /// \brief Apply the permissions of the sections allocated since the last
+  /// call, merging the adjacent page ranges, and invalidate the instruction
+  /// cache for the new code.
+  ///
+  /// \returns true if an error occurred, false otherwise.
+  bool finalizeMemory(std::string *ErrMsg = nullptr) override;
+
+  /// \brief Invalidate instruction cache for the code sections allocated since
+  /// the last call to finalizeMemory.
+  virtual void invalidateInstructionCache();
+
+  /// \brief Return the allocator the memory manager allocates from.
+  const std::shared_ptr<SlabAllocator> &getAllocator() const {
+    return Allocator;
+  }
+
+private:
+  struct MemoryGroup {
+    // Page ranges owned by this memory manager.
+    SmallVector<sys::MemoryBlock, 4> Ranges;
+    // The free part of the last range.
+    uintptr_t Next = 0;
+    uintptr_t End = 0;
+    // The sections allocated since the last finalizeMemory.
+    SmallVector<sys::MemoryBlock, 16> Pending;
+  };
+
+  bool reserve(MemoryGroup &MemGroup, uintptr_t Size);
+  uint8_t *allocateSection(MemoryGroup &MemGroup, uintptr_t Size,
+                           unsigned Alignment);
+  std::error_code applyMemoryGroupPermissions(MemoryGroup &MemGroup,
+                                              unsigned Permissions);
+
+  std::shared_ptr<SlabAllocator> Allocator;
+  MemoryGroup CodeMem;
+  MemoryGroup RWDataMem;
+  MemoryGroup RODataMem;
+};
+
+}
+
+#endif // LLVM_EXECUTIONENGINE_SLABMEMORYMANAGER_H
@@ -0,0 +1,150 @@
+//===-- llvm/IR/FunctionInfo.h - Function Summary Index ---------*- C++ -*-===//
+//
+//                     The LLVM Compiler Infrastructure
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+//
+/// @file
+/// This file contains the declarations of the classes that hold the function
+/// summary index and the related per-function summary information.
+///
+/// The summaries are emitted in a dedicated bitcode block next to the module,
+/// and the summaries of several modules can be combined into a single index.
+/// That index lets a link decide which functions to import into each module
+/// without having to load every module into memory at once.
+//
+//===----------------------------------------------------------------------===//
+
+#ifndef LLVM_IR_FUNCTIONINFO_H
+#define LLVM_IR_FUNCTIONINFO_H
+
+#include "llvm/ADT/ArrayRef.h"
+#include "llvm/ADT/StringMap.h"
+#include "llvm/IR/GlobalValue.h"
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace llvm {
+
+class Function;
+class Module;
+
+/// \brief Summary of a function definition, holding the information needed
+/// to decide whether to import it in another module.
+class FunctionSummary {
+public:
+  /// A call edge out of the summarized function.
+  struct CallEdge {
+    /// Name of the called function.
+    std::string Callee;
+    /// Number of call sites calling Callee from the summarized function.
+    unsigned NumCalls;
+  };
+
+private:
+  /// Path of the module defining the function. Points into the module path
+  /// table of the owning FunctionInfoIndex.
+  StringRef ModulePath;
+
+  /// Linkage of the function in its defining module.
+  GlobalValue::LinkageTypes Linkage;
+
+  /// Number of instructions in the function body.
+  unsigned InstCount;
+
+  /// False if the function body cannot be copied in another module, e.g.
+  /// because it refers to a value that is private to its defining module.
+  bool EligibleToImport;
+
+  /// Calls made by the function to other named functions.
+  std::vector<CallEdge> Calls;
+
+public:
+  FunctionSummary(GlobalValue::LinkageTypes Linkage, unsigned InstCount,
+                  bool EligibleToImport = true)
+      : Linkage(Linkage), InstCount(InstCount),
+        EligibleToImport(EligibleToImport) {}
+
+  StringRef modulePath() const { return ModulePath; }
+  void setModulePath(StringRef Path) { ModulePath = Path; }
+
+  GlobalValue::LinkageTypes linkage() const { return Linkage; }
+  unsigned instCount() const { return InstCount; }
+
+  bool isEligibleToImport() const { return EligibleToImport; }
+  void setNotEligibleToImport() { EligibleToImport = false; }
+
+  ArrayRef<CallEdge> calls() const { return Calls; }
+  void addCall(StringRef Callee, unsigned NumCalls) {
+    Calls.push_back({Callee, NumCalls});
+  }
+};
+
+/// List of the summaries of the definitions of a function, one per module
+/// defining it.
+typedef std::vector<std::unique_ptr<FunctionSummary>> FunctionSummaryList;
+
+/// \brief Index of the function summaries of one or several modules.
+///
+/// A per-module index is built from the module IR or read from the summary
+/// block of the module bitcode. A combined index is built by merging the
+/// per-module indexes of all the modules taking part in a link.
+class FunctionInfoIndex {
+  /// Map from function name to the summaries of its definitions.
+  StringMap<FunctionSummaryList> FunctionMap;
+
+  /// Map from module path to module id. Ids are assigned in insertion order.
+  StringMap<uint64_t> ModulePathStringTable;
+
+public:
+  typedef StringMap<FunctionSummaryList>::const_iterator const_iterator;
+
+  FunctionInfoIndex() = default;
+
+  const_iterator begin() const { return FunctionMap.begin(); }
+  const_iterator end() const { return FunctionMap.end(); }
+  bool empty() const { return FunctionMap.empty(); }
+
+  /// Add a module path to the index if not already present, and return the
+  /// path as stored in the index.
+  StringRef addModulePath(StringRef Path);
+
+  /// Table of module paths in the index, mapped to their module id.
+  const StringMap<uint64_t> &modulePaths() const {
+    return ModulePathStringTable;
+  }
+
+  /// Add the summary of a definition of function \p Name, found in the module
+  /// at \p ModulePath.
+  void addFunctionSummary(StringRef Name, StringRef ModulePath,
+                          std::unique_ptr<FunctionSummary> Summary);
+
+  /// Return the summaries of the definitions of function \p Name, or null if
+  /// the index does not know about it.
+  const FunctionSummaryList *findFunctionSummaries(StringRef Name) const;
+
+  /// Move all the summaries and module paths of \p Other into this index.
+  void mergeFrom(std::unique_ptr<FunctionInfoIndex> Other);
+};
+
+/// Return true if \p GV is a local constant whose address is not significant.
+/// Such a constant is copied along with the imported functions referring to
+/// it instead of preventing their import.
+bool isImportableLocalConstant(const GlobalValue &GV);
+
+/// Compute the summary of the definition \p F.
+std::unique_ptr<FunctionSummary> computeFunctionSummary(const Function &F);
+
+/// Compute the summary index of all the function definitions of \p M. The
+/// summaries are attributed to the module path \p ModulePath, which defaults
+/// to the module identifier.
+std::unique_ptr<FunctionInfoIndex>
+buildFunctionInfoIndex(const Module &M, StringRef ModulePath = StringRef());
+
+} // End llvm namespace
+
+#endif
@@ -95,6 +95,11 @@ private:
 
 } // End legacy namespace
 
+/// If -pass-report is given, write the report of the pass executions and of
+/// the statistics to its file now, replacing any previous report. Otherwise,
+/// the report is written when llvm_shutdown is called.
+void writePassReport();
+
 // Create wrappers for C Binding types (see CBindingWrapping.h).
 DEFINE_STDCXX_CONVERSION_FUNCTIONS(legacy::PassManagerBase, LLVMPassManagerRef)
 
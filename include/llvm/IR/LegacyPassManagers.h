@@ -19,6 +19,7 @@
 #include "llvm/ADT/SmallPtrSet.h"
 #include "llvm/ADT/SmallVector.h"
 #include "llvm/Pass.h"
+#include "llvm/Support/Timer.h"
 #include <map>
 #include <vector>
 
@@ -474,6 +475,47 @@ public:
 
 Timer *getPassTimer(Pass *);
 
+/// PassReportRegion - If -pass-report is given, this records the time, the
+/// change in the number of instructions and the increase of the peak resident
+/// set size of an execution of a pass, from the construction of the object to
+/// its destruction. It does nothing otherwise.
+class PassReportRegion {
+  Pass *P;
+  const char *Kind;
+  std::string Unit;
+  Module *M;
+  SmallVector<Function *, 1> Functions;
+  TimeRecord StartTime;
+  size_t StartInstructions;
+  size_t StartPeakRSS;
+
+  PassReportRegion(const PassReportRegion &) = delete;
+  void operator=(const PassReportRegion &) = delete;
+
+  void start();
+  size_t countInstructions() const;
+
+public:
+  /// Record an execution of \p P on \p F.
+  PassReportRegion(Pass *P, Function &F);
+  /// Record an execution of \p P on \p M.
+  PassReportRegion(Pass *P, Module &M);
+  /// Record an execution of \p P on the strongly connected component of the
+  /// call graph made of \p SCC, which is named after its first function.
+  PassReportRegion(Pass *P, ArrayRef<Function *> SCC);
+  ~PassReportRegion();
+
+  /// Replace the functions of the strongly connected component, if the pass
+  /// replaced some of them.
+  void setSCC(ArrayRef<Function *> SCC) {
+    Functions.clear();
+    Functions.append(SCC.begin(), SCC.end());
+  }
+
+  /// Return true if -pass-report is given.
+  static bool isEnabled();
+};
+
 }
 
 #endif
@@ -46,8 +46,19 @@ bool verifyFunction(const Function &F, raw_ostream *OS = nullptr);
 /// If there are no errors, the function returns false. If an error is found,
 /// a message describing the error is written to OS (if non-null) and true is
 /// returned.
+///
+/// The function bodies are verified on the number of threads given by
+/// -verify-threads, one by default.
 bool verifyModule(const Module &M, raw_ostream *OS = nullptr);
 
+/// \brief Check a module for errors, verifying the function bodies on
+/// \p NumThreads threads, or one per hardware thread if it is zero.
+///
+/// The module-level checks run on the calling thread once the functions are
+/// verified, and the messages are written in the same order whatever the
+/// number of threads.
+bool verifyModule(const Module &M, raw_ostream *OS, unsigned NumThreads);
+
 /// \brief Create a verifier pass.
 ///
 /// Check a module or function for validity. This is essentially a pass wrapped
@@ -40,6 +40,7 @@
 #include "llvm/ADT/SmallPtrSet.h"
 #include "llvm/ADT/StringMap.h"
 #include "llvm/Linker/Linker.h"
+#include "llvm/Support/CodeGen.h"
 #include "llvm/Target/TargetOptions.h"
 #include <string>
 #include <vector>
@@ -79,6 +80,29 @@ struct LTOCodeGenerator {
   void setAttr(const char *mAttr) { MAttr = mAttr; }
   void setOptLevel(unsigned optLevel) { OptLevel = optLevel; }
 
+  // Set the number of partitions the merged module is split into by the
+  // compilexxxToFiles() functions. Each partition is code generated on its
+  // own thread into its own object file.
+  void setParallelism(unsigned N) { Parallelism = N ? N : 1; }
+
+  // Cache the native objects produced by the compilexxx() functions in the
+  // given directory: compiling the same merged module with the same options
+  // again then skips optimization and code generation. An empty path disables
+  // the cache.
+  void setCacheDir(StringRef Path) { CacheDir = Path; }
+
+  // Set the pruning policy of the cache directory, applied after storing new
+  // objects; see CachePruning. By default, the directory is scanned at most
+  // every 20 minutes for the objects unused in the last week, and its size is
+  // not limited.
+  void setCachePruningInterval(int Interval) {
+    CachePruningInterval = Interval;
+  }
+  void setCacheEntryExpiration(unsigned Expiration) {
+    CacheEntryExpiration = Expiration;
+  }
+  void setMaxCacheSize(uint64_t Size) { MaxCacheSize = Size; }
+
   void setShouldInternalize(bool Value) { ShouldInternalize = Value; }
   void setShouldEmbedUselists(bool Value) { ShouldEmbedUselists = Value; }
 
@@ -112,6 +136,19 @@ struct LTOCodeGenerator {
                        bool disableVectorization,
                        std::string &errMsg);
 
+  // As with compile_to_file(), but the merged module is split into the number
+  // of partitions set with setParallelism() and each partition is compiled
+  // into its own object file, in parallel. Linked together, the object files
+  // are equivalent to the single object file produced by compile_to_file().
+  // The paths to the object files are returned to the caller via argument
+  // "names"; they remain valid until the next compilation. Return true on
+  // success.
+  bool compile_to_files(std::vector<const char *> &names,
+                        bool disableInline,
+                        bool disableGVNLoadPRE,
+                        bool disableVectorization,
+                        std::string &errMsg);
+
   // As with compile_to_file(), this function compiles the merged module into
   // single object file. Instead of returning the object-file-path to the caller
   // (linker), it brings the object to a buffer, and return the buffer to the
@@ -133,6 +170,19 @@ struct LTOCodeGenerator {
   // if the compilation was not successful.
   std::unique_ptr<MemoryBuffer> compileOptimized(std::string &errMsg);
 
+  // Compiles the merged optimized module into one object file per partition
+  // set with setParallelism(), as with compile_to_files(). Return true on
+  // success.
+  bool compileOptimizedToFiles(std::vector<const char *> &names,
+                               std::string &errMsg);
+
+  // Compiles the merged optimized module into Out.size() object files written
+  // to the given streams. If there is more than one stream, the module is
+  // split into partitions that are code generated in parallel. Return true on
+  // success.
+  bool compileOptimized(ArrayRef<raw_pwrite_stream *> Out,
+                        std::string &errMsg);
+
   void setDiagnosticHandler(lto_diagnostic_handler_t, void *);
 
   LLVMContext &getContext() { return Context; }
@@ -140,8 +190,16 @@ struct LTOCodeGenerator {
 private:
   void initializeLTOPasses();
 
-  bool compileOptimized(raw_pwrite_stream &out, std::string &errMsg);
   bool compileOptimizedToFile(const char **name, std::string &errMsg);
+
+  std::vector<std::unique_ptr<MemoryBuffer>>
+  lookupCachedObjects(unsigned NumObjects, bool DisableInline,
+                      bool DisableGVNLoadPRE, bool DisableVectorization,
+                      std::string &CacheKey);
+  void storeCachedObjects(StringRef CacheKey, ArrayRef<StringRef> Objects);
+  void storeCachedObjectFiles(StringRef CacheKey,
+                              ArrayRef<std::string> Paths);
+  void pruneCache();
   void applyScopeRestrictions();
   void applyRestriction(GlobalValue &GV, ArrayRef<StringRef> Libcalls,
                         std::vector<const char *> &MustPreserveList,
@@ -169,13 +227,22 @@ private:
   std::string MCpu;
   std::string MAttr;
   std::string NativeObjectPath;
+  std::vector<std::string> NativeObjectPaths;
+  std::string FeatureStr;
+  Reloc::Model RelocModel = Reloc::Default;
+  CodeGenOpt::Level CGOptLevel = CodeGenOpt::Default;
   TargetOptions Options;
   unsigned OptLevel = 2;
+  unsigned Parallelism = 1;
   lto_diagnostic_handler_t DiagHandler = nullptr;
   void *DiagContext = nullptr;
   LTOModule *OwnedModule = nullptr;
   bool ShouldInternalize = true;
   bool ShouldEmbedUselists = false;
+  std::string CacheDir;
+  int CachePruningInterval = 20 * 60;
+  unsigned CacheEntryExpiration = 7 * 24 * 60 * 60;
+  uint64_t MaxCacheSize = 0;
 };
 }
 #endif
@@ -0,0 +1,84 @@
+//===-NativeObjectCache.h - Cache of the native objects produced by LTO ---===//
+//
+//                     The LLVM Compiler Infrastructure
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+//
+// This file declares the NativeObjectCache class, an on-disk cache of the
+// native objects produced by LTO code generation.
+//
+//   An entry is keyed by a hash of everything that determines the objects: the
+// bitcode of the module to optimize, the target and code generation options,
+// and the version of LLVM. Relinking unchanged inputs then skips optimization
+// and code generation.
+//
+//   The cache directory can be shared by concurrent links. Objects are written
+// to temporary files that are renamed into place, so that a lookup never sees
+// a partially written object, and the stores of the same entry are serialized
+// with a LockFileManager. Use CachePruning to bound the size of the directory.
+//
+//===----------------------------------------------------------------------===//
+
+#ifndef LLVM_LTO_NATIVEOBJECTCACHE_H
+#define LLVM_LTO_NATIVEOBJECTCACHE_H
+
+#include "llvm/ADT/ArrayRef.h"
+#include "llvm/ADT/StringRef.h"
+#include "llvm/Support/MD5.h"
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace llvm {
+class MemoryBuffer;
+class Module;
+class TargetOptions;
+
+/// Accumulate everything that determines the native objects produced from a
+/// module into a NativeObjectCache key.
+class NativeObjectCacheKey {
+  MD5 Hasher;
+
+public:
+  /// Start a key, with the version of LLVM.
+  NativeObjectCacheKey();
+
+  /// Add \p M, as bitcode.
+  void add(const Module &M);
+  void add(const TargetOptions &Options);
+  void add(StringRef Str);
+  void add(uint64_t Value);
+
+  /// Return the key, as a string of hexadecimal digits suitable for a file
+  /// name. Nothing can be added afterwards.
+  std::string str();
+};
+
+/// An on-disk cache of the native objects produced by LTO code generation.
+///
+/// The cache is only an optimization: an entry that cannot be read is a miss,
+/// and a store that fails leaves the cache without the entry.
+class NativeObjectCache {
+  std::string Path;
+
+  std::string getObjectPath(StringRef Key, unsigned I) const;
+
+public:
+  /// Use the directory \p Path, which is created if needed.
+  explicit NativeObjectCache(StringRef Path) : Path(Path) {}
+
+  /// Return the \p NumObjects objects stored for \p Key, or an empty vector if
+  /// any of them is missing. The entry is marked as recently used.
+  std::vector<std::unique_ptr<MemoryBuffer>> lookup(StringRef Key,
+                                                    unsigned NumObjects);
+
+  /// Store \p Objects for \p Key. If another process is storing the same
+  /// entry, the objects are left for it to store.
+  void store(StringRef Key, ArrayRef<StringRef> Objects);
+};
+}
+
+#endif
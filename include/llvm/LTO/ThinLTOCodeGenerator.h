@@ -0,0 +1,115 @@
+//===-ThinLTOCodeGenerator.h - LLVM Link Time Optimizer -------------------===//
+//
+//                     The LLVM Compiler Infrastructure
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+//
+// This file declares the ThinLTOCodeGenerator class.
+//
+//   Unlike LTOCodeGenerator, which links every module into a single merged
+// module, the ThinLTOCodeGenerator keeps the modules separate: memory and time
+// grow with the size of the largest module rather than with the size of the
+// whole program.
+//
+//   A combined function summary index is built from the summaries of all the
+// modules (see llvm/IR/FunctionInfo.h). Each module is then, independently
+// and in parallel with the others:
+//   - loaded in its own LLVMContext,
+//   - augmented with the definitions of the small functions it calls, imported
+//     from the other modules as selected with the combined index,
+//   - optimized and code generated into its own object file.
+//
+//===----------------------------------------------------------------------===//
+
+#ifndef LLVM_LTO_THINLTOCODEGENERATOR_H
+#define LLVM_LTO_THINLTOCODEGENERATOR_H
+
+#include "llvm/ADT/StringRef.h"
+#include "llvm/Support/CodeGen.h"
+#include "llvm/Support/MemoryBuffer.h"
+#include "llvm/Target/TargetOptions.h"
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace llvm {
+class FunctionInfoIndex;
+class Module;
+
+//===----------------------------------------------------------------------===//
+/// Driver for the summary-based "thin" link time optimization.
+///
+class ThinLTOCodeGenerator {
+public:
+  /// Add a bitcode module to the link. \p Identifier is used as the module
+  /// path in the combined index. The data must outlive the code generator.
+  void addModule(StringRef Identifier, StringRef Data);
+
+  void setTargetOptions(TargetOptions Options) { this->Options = Options; }
+  void setCpu(StringRef Cpu) { MCpu = Cpu; }
+  void setAttr(StringRef Attr) { MAttr = Attr; }
+  void setCodePICModel(Reloc::Model Model) { RelocModel = Model; }
+  void setOptLevel(unsigned Level) { OptLevel = Level; }
+
+  /// Set the maximum number of modules processed in parallel. Defaults to
+  /// the number of threads supported by the host.
+  void setThreadCount(unsigned Count) { ThreadCount = Count; }
+
+  /// Cache the object file of each module in \p Path, keyed by the module
+  /// after import and the code generation options. An empty path disables the
+  /// cache. See LTOCodeGenerator::setCacheDir for the pruning policy.
+  void setCacheDir(StringRef Path) { CacheDir = Path; }
+  void setCachePruningInterval(int Interval) {
+    CachePruningInterval = Interval;
+  }
+  void setCacheEntryExpiration(unsigned Expiration) {
+    CacheEntryExpiration = Expiration;
+  }
+  void setMaxCacheSize(uint64_t Size) { MaxCacheSize = Size; }
+
+  /// Build the combined function summary index of the modules added so far.
+  /// The summaries are read from the summary block of each module when
+  /// present, and computed from the IR otherwise. Return null on failure.
+  std::unique_ptr<FunctionInfoIndex> linkCombinedIndex(std::string &ErrMsg);
+
+  /// Import in \p TheModule the definitions it needs from the other modules,
+  /// as selected with \p Index. \p TheModule must have been created with one
+  /// of the module identifiers. Return true if \p TheModule was changed.
+  bool crossModuleImport(Module &TheModule, const FunctionInfoIndex &Index);
+
+  /// Import, optimize and code generate each module, in parallel. On success,
+  /// the object files are available through getProducedBinaries(), in the
+  /// order in which the modules were added. Return true on success.
+  bool run(std::string &ErrMsg);
+
+  std::vector<std::unique_ptr<MemoryBuffer>> &getProducedBinaries() {
+    return ProducedBinaries;
+  }
+
+private:
+  /// Optimize \p TheModule, already augmented with the imported definitions,
+  /// and code generate it. Return null and set \p ErrMsg on failure.
+  std::unique_ptr<MemoryBuffer> optimizeAndCodegen(Module &TheModule,
+                                                   std::string &ErrMsg);
+
+  /// The modules to link, as (identifier, data) buffers.
+  std::vector<MemoryBufferRef> Modules;
+
+  std::vector<std::unique_ptr<MemoryBuffer>> ProducedBinaries;
+
+  TargetOptions Options;
+  std::string MCpu;
+  std::string MAttr;
+  Reloc::Model RelocModel = Reloc::Default;
+  unsigned OptLevel = 2;
+  unsigned ThreadCount = 0;
+  std::string CacheDir;
+  int CachePruningInterval = 20 * 60;
+  unsigned CacheEntryExpiration = 7 * 24 * 60 * 60;
+  uint64_t MaxCacheSize = 0;
+};
+}
+#endif
@@ -652,9 +652,17 @@ private:
   /// were adjusted.
   bool layoutOnce(MCAsmLayout &Layout);
 
-  /// \brief Perform one layout iteration of the given section and return true
-  /// if any offsets were adjusted.
-  bool layoutSectionOnce(MCAsmLayout &Layout, MCSection &Sec);
+  /// \brief Relax the fragments of the given section until none of them
+  /// changes size, and return true if any offsets were adjusted.
+  bool layoutSection(MCAsmLayout &Layout, MCSection &Sec);
+
+  /// \brief Relax the fragment if it needs it, and return true if its size
+  /// changed.
+  bool relaxFragment(MCAsmLayout &Layout, MCFragment &F);
+
+  /// \brief Return the range of layout orders, within the section of \p F, of
+  /// the fragments whose sizes the relaxation of \p F depends on.
+  std::pair<unsigned, unsigned> getRelaxationSpan(MCFragment &F) const;
 
   bool relaxInstruction(MCAsmLayout &Layout, MCRelaxableFragment &IF);
 
@@ -686,10 +694,16 @@ public:
   /// defining a separate atom.
   bool isSymbolLinkerVisible(const MCSymbol &SD) const;
 
-  /// Emit the section contents using the given object writer.
+  /// Emit the section contents using the object writer of the assembler.
   void writeSectionData(const MCSection *Section,
                         const MCAsmLayout &Layout) const;
 
+  /// Emit the section contents using the given object writer, which may write
+  /// to another stream than the one of the assembler. This only reads the
+  /// final layout, so several sections may be emitted concurrently.
+  void writeSectionData(const MCSection *Section, const MCAsmLayout &Layout,
+                        MCObjectWriter &OW) const;
+
   /// Check whether a given symbol has been flagged with .thumb_func.
   bool isThumbFunc(const MCSymbol *Func) const;
 
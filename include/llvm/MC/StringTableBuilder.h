@@ -35,9 +35,17 @@ public:
     MachO
   };
 
+  /// \brief The number of strings from which finalize sorts them on several
+  /// threads, when it is given more than one.
+  static const size_t ParallelSortThreshold = 1 << 12;
+
   /// \brief Analyze the strings and build the final table. No more strings can
   /// be added after this point.
-  void finalize(Kind kind);
+  ///
+  /// The strings are sorted on \p NumThreads threads when there are many of
+  /// them, 0 meaning one per hardware thread. The table does not depend on
+  /// the number of threads.
+  void finalize(Kind kind, unsigned NumThreads = 1);
 
   /// \brief Retrieve the string table data. Can only be used after the table
   /// is finalized.
@@ -14,6 +14,9 @@
 #ifndef LLVM_OBJECT_ARCHIVE_H
 #define LLVM_OBJECT_ARCHIVE_H
 
+#include "llvm/ADT/ArrayRef.h"
+#include "llvm/ADT/DenseMap.h"
+#include "llvm/ADT/SmallVector.h"
 #include "llvm/ADT/StringRef.h"
 #include "llvm/ADT/iterator_range.h"
 #include "llvm/Object/Binary.h"
@@ -202,9 +205,23 @@ public:
     return v->isArchive();
   }
 
-  // check if a symbol is in the archive
+  /// Build a hash index of the symbol table, so that findSym and findSyms
+  /// no longer scan it. This is worth it for the clients that look up many
+  /// names in the same archive. It must not be called while other threads
+  /// look symbols up.
+  void buildSymbolIndex();
+
+  /// Return the member that defines the symbol \p name, or child_end() if
+  /// there is none. This scans the symbol table, unless buildSymbolIndex()
+  /// was called.
   child_iterator findSym(StringRef name) const;
 
+  /// Look up each of \p Names like findSym, and append the member that
+  /// defines it, or child_end(), to \p Members, in the same order. Without
+  /// an index, the symbol table is scanned once for all the names.
+  void findSyms(ArrayRef<StringRef> Names,
+                SmallVectorImpl<child_iterator> &Members) const;
+
   bool hasSymbolTable() const;
   child_iterator getSymbolTableChild() const { return SymbolTable; }
   uint32_t getNumberOfSymbols() const;
@@ -215,6 +232,13 @@ private:
   child_iterator FirstRegular;
   unsigned Format : 2;
   unsigned IsThin : 1;
+  unsigned HasSymbolIndex : 1;
+
+  /// The first symbol of each name in the symbol table, built by
+  /// buildSymbolIndex(). The names point into the symbol table.
+  DenseMap<StringRef, Symbol> SymbolIndex;
+
+  child_iterator getSymbolMember(const Symbol &Sym) const;
 };
 
 }
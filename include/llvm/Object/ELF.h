@@ -30,7 +30,9 @@
 #include "llvm/Support/MemoryBuffer.h"
 #include "llvm/Support/raw_ostream.h"
 #include <algorithm>
+#include <atomic>
 #include <limits>
+#include <mutex>
 #include <utility>
 
 namespace llvm {
@@ -38,6 +40,29 @@ namespace object {
 
 StringRef getELFRelocationTypeName(uint32_t Machine, uint32_t Type);
 
+/// This function returns the hash value for a symbol in the .dynsym section
+/// Name of the API remains consistent as specified in the libelf
+/// REF : http://www.sco.com/developers/gabi/latest/ch5.dynamic.html#hash
+static inline unsigned elf_hash(StringRef symbolName) {
+  unsigned h = 0, g;
+  for (unsigned i = 0, j = symbolName.size(); i < j; i++) {
+    h = (h << 4) + (unsigned char)symbolName[i];
+    g = h & 0xf0000000L;
+    if (g != 0)
+      h ^= g >> 24;
+    h &= ~g;
+  }
+  return h;
+}
+
+/// This function returns the hash value for a symbol in the .gnu.hash section.
+static inline uint32_t gnu_hash(StringRef symbolName) {
+  uint32_t h = 5381;
+  for (unsigned char c : symbolName)
+    h = (h << 5) + h + c;
+  return h;
+}
+
 // Subclasses of ELFFile may need this for template instantiation
 inline std::pair<unsigned char, unsigned char>
 getElfArchType(StringRef Object) {
@@ -229,6 +254,30 @@ private:
   void LoadVersionNeeds(const Elf_Shdr *ec) const;
   void LoadVersionMap() const;
 
+  const Elf_Shdr *dot_hash_sec;     // .hash
+  const Elf_Shdr *dot_gnu_hash_sec; // .gnu.hash
+
+  // The defined symbols and the sections by name. These are built the first
+  // time a name is looked up, unless the file has a hash table for it. The
+  // names point into the string tables of the file. The lookups are const and
+  // may be made from several threads, so the indexes are built under
+  // IndexMutex, and are only read once their flag is set.
+  typedef DenseMap<StringRef, const Elf_Sym *> SymbolIndex_t;
+  mutable SymbolIndex_t StaticSymbolIndex;
+  mutable SymbolIndex_t DynamicSymbolIndex;
+  mutable std::atomic<bool> HasStaticSymbolIndex;
+  mutable std::atomic<bool> HasDynamicSymbolIndex;
+  mutable DenseMap<StringRef, const Elf_Shdr *> SectionIndex;
+  mutable std::atomic<bool> HasSectionIndex;
+  mutable std::mutex IndexMutex;
+
+  ArrayRef<Elf_Word> getDynamicHashTable(const Elf_Shdr *Sec) const;
+  bool isDefinedDynamicSymbol(uint32_t Index, StringRef Name) const;
+  const Elf_Sym *findInHashTable(ArrayRef<Elf_Word> Table,
+                                 StringRef Name) const;
+  const Elf_Sym *findInGnuHashTable(ArrayRef<Elf_Word> Table,
+                                    StringRef Name) const;
+
 public:
   template<typename T>
   const T        *getEntry(uint32_t Section, uint32_t Entry) const;
@@ -390,6 +439,18 @@ public:
   uint64_t getSymbolIndex(const Elf_Sym *sym) const;
   ErrorOr<ArrayRef<uint8_t> > getSectionContents(const Elf_Shdr *Sec) const;
   StringRef getLoadName() const;
+
+  /// \brief Get the first defined symbol named \p Name of the symbol table,
+  /// or of the dynamic symbol table if \p IsDynamic, or null if there is none.
+  ///
+  /// The dynamic symbols are looked up in the .gnu.hash or .hash section when
+  /// the file has one, in place. Otherwise, an index of the names of the
+  /// table is built the first time it is looked up.
+  const Elf_Sym *getSymbolByName(StringRef Name, bool IsDynamic) const;
+
+  /// \brief Get the first section named \p Name, or null if there is none.
+  /// An index of the names of the sections is built the first time.
+  const Elf_Shdr *getSectionByName(StringRef Name) const;
 };
 
 typedef ELFFile<ELFType<support::little, false>> ELF32LEFile;
@@ -584,7 +645,9 @@ ELFFile<ELFT>::ELFFile(StringRef Object, std::error_code &EC)
     : Buf(Object), SectionHeaderTable(nullptr), dot_symtab_sec(nullptr),
       SymbolTableSectionHeaderIndex(nullptr), dot_gnu_version_sec(nullptr),
       dot_gnu_version_r_sec(nullptr), dot_gnu_version_d_sec(nullptr),
-      dt_soname(nullptr) {
+      dt_soname(nullptr), dot_hash_sec(nullptr), dot_gnu_hash_sec(nullptr),
+      HasStaticSymbolIndex(false), HasDynamicSymbolIndex(false),
+      HasSectionIndex(false) {
   const uint64_t FileSize = Buf.size();
 
   if (sizeof(Elf_Ehdr) > FileSize) {
@@ -690,6 +753,14 @@ ELFFile<ELFT>::ELFFile(StringRef Object, std::error_code &EC)
       }
       dot_gnu_version_r_sec = &Sec;
       break;
+    case ELF::SHT_HASH:
+      if (!dot_hash_sec)
+        dot_hash_sec = &Sec;
+      break;
+    case ELF::SHT_GNU_HASH:
+      if (!dot_gnu_hash_sec)
+        dot_gnu_hash_sec = &Sec;
+      break;
     }
   }
 
@@ -1019,20 +1090,149 @@ ErrorOr<StringRef> ELFFile<ELFT>::getSymbolVersion(const Elf_Shdr *section,
   return StringRef(getDynamicString(name_offset));
 }
 
-/// This function returns the hash value for a symbol in the .dynsym section
-/// Name of the API remains consistent as specified in the libelf
-/// REF : http://www.sco.com/developers/gabi/latest/ch5.dynamic.html#hash
-static inline unsigned elf_hash(StringRef &symbolName) {
-  unsigned h = 0, g;
-  for (unsigned i = 0, j = symbolName.size(); i < j; i++) {
-    h = (h << 4) + symbolName[i];
-    g = h & 0xf0000000L;
-    if (g != 0)
-      h ^= g >> 24;
-    h &= ~g;
+// Return the words of the hash table \p Sec if it is the one of the dynamic
+// symbol table and fits in the file, or an empty table.
+template <class ELFT>
+ArrayRef<typename ELFFile<ELFT>::Elf_Word>
+ELFFile<ELFT>::getDynamicHashTable(const Elf_Shdr *Sec) const {
+  if (!Sec || !DynSymRegion.Addr || Sec->sh_link >= getNumSections() ||
+      Sec->sh_offset + Sec->sh_size > Buf.size() ||
+      Sec->sh_size % sizeof(Elf_Word))
+    return ArrayRef<Elf_Word>();
+  if (base() + getSection(Sec->sh_link)->sh_offset != DynSymRegion.Addr)
+    return ArrayRef<Elf_Word>();
+  return makeArrayRef(
+      reinterpret_cast<const Elf_Word *>(base() + Sec->sh_offset),
+      Sec->sh_size / sizeof(Elf_Word));
+}
+
+template <class ELFT>
+bool ELFFile<ELFT>::isDefinedDynamicSymbol(uint32_t Index,
+                                           StringRef Name) const {
+  if (Index == 0 ||
+      Index >= dynamic_symbol_end() - dynamic_symbol_begin_raw())
+    return false;
+  const Elf_Sym *Sym = dynamic_symbol_begin_raw() + Index;
+  if (Sym->st_shndx == ELF::SHN_UNDEF || Sym->st_name >= DynStrRegion.Size)
+    return false;
+  return Name == getDynamicString(Sym->st_name);
+}
+
+// Look \p Name up in the SysV hash table \p Table: the symbols of a bucket
+// are chained, in no particular order.
+template <class ELFT>
+const typename ELFFile<ELFT>::Elf_Sym *
+ELFFile<ELFT>::findInHashTable(ArrayRef<Elf_Word> Table,
+                               StringRef Name) const {
+  uint32_t NumBuckets = Table[0], NumChains = Table[1];
+  if (!NumBuckets || 2 + uint64_t(NumBuckets) + NumChains > Table.size())
+    return nullptr;
+  ArrayRef<Elf_Word> Buckets = Table.slice(2, NumBuckets);
+  ArrayRef<Elf_Word> Chains = Table.slice(2 + NumBuckets, NumChains);
+
+  // Keep the first of the symbols with that name, and stop on a cycle.
+  uint32_t Found = 0;
+  uint32_t Index = Buckets[elf_hash(Name) % NumBuckets];
+  for (uint32_t Steps = 0; Index && Index < NumChains && Steps != NumChains;
+       Index = Chains[Index], ++Steps)
+    if ((!Found || Index < Found) && isDefinedDynamicSymbol(Index, Name))
+      Found = Index;
+  return Found ? dynamic_symbol_begin_raw() + Found : nullptr;
+}
+
+// Look \p Name up in the GNU hash table \p Table: a Bloom filter rejects most
+// of the missing names, and the symbols of a bucket are consecutive in the
+// symbol table, with their hashes in the chains.
+template <class ELFT>
+const typename ELFFile<ELFT>::Elf_Sym *
+ELFFile<ELFT>::findInGnuHashTable(ArrayRef<Elf_Word> Table,
+                                  StringRef Name) const {
+  if (Table.size() < 4)
+    return nullptr;
+  uint32_t NumBuckets = Table[0], SymOffset = Table[1];
+  uint32_t BloomSize = Table[2], BloomShift = Table[3];
+  const uint64_t BloomWords = uint64_t(BloomSize) * sizeof(uintX_t) / 4;
+  if (!NumBuckets || 4 + BloomWords + NumBuckets > Table.size())
+    return nullptr;
+  const Elf_Addr *Bloom = reinterpret_cast<const Elf_Addr *>(&Table[4]);
+  ArrayRef<Elf_Word> Buckets = Table.slice(4 + BloomWords, NumBuckets);
+  ArrayRef<Elf_Word> Chains = Table.slice(4 + BloomWords + NumBuckets);
+
+  uint32_t Hash = gnu_hash(Name);
+  if (BloomSize) {
+    const unsigned Bits = sizeof(uintX_t) * 8;
+    uintX_t Mask = (uintX_t(1) << (Hash % Bits)) |
+                   (uintX_t(1) << ((Hash >> BloomShift) % Bits));
+    if ((Bloom[(Hash / Bits) % BloomSize] & Mask) != Mask)
+      return nullptr;
   }
-  return h;
+
+  uint32_t Index = Buckets[Hash % NumBuckets];
+  if (Index < SymOffset)
+    return nullptr;
+  for (; Index - SymOffset < Chains.size(); ++Index) {
+    uint32_t ChainHash = Chains[Index - SymOffset];
+    if ((ChainHash | 1) == (Hash | 1) && isDefinedDynamicSymbol(Index, Name))
+      return dynamic_symbol_begin_raw() + Index;
+    // The lowest bit marks the last symbol of the bucket.
+    if (ChainHash & 1)
+      break;
+  }
+  return nullptr;
+}
+
+template <class ELFT>
+const typename ELFFile<ELFT>::Elf_Sym *
+ELFFile<ELFT>::getSymbolByName(StringRef Name, bool IsDynamic) const {
+  if (IsDynamic) {
+    ArrayRef<Elf_Word> Table = getDynamicHashTable(dot_gnu_hash_sec);
+    if (!Table.empty())
+      return findInGnuHashTable(Table, Name);
+    Table = getDynamicHashTable(dot_hash_sec);
+    if (!Table.empty())
+      return findInHashTable(Table, Name);
+  }
+
+  SymbolIndex_t &Index = IsDynamic ? DynamicSymbolIndex : StaticSymbolIndex;
+  std::atomic<bool> &HasIndex =
+      IsDynamic ? HasDynamicSymbolIndex : HasStaticSymbolIndex;
+  if (!HasIndex.load(std::memory_order_acquire)) {
+    std::lock_guard<std::mutex> Lock(IndexMutex);
+    if (!HasIndex.load(std::memory_order_relaxed)) {
+      Elf_Sym_Range Symbols = IsDynamic ? dynamic_symbols() : symbols();
+      Index.resize(std::distance(Symbols.begin(), Symbols.end()) * 4 / 3 + 1);
+      for (const Elf_Sym &Sym : Symbols) {
+        if (Sym.st_shndx == ELF::SHN_UNDEF)
+          continue;
+        if (IsDynamic && Sym.st_name >= DynStrRegion.Size)
+          continue;
+        ErrorOr<StringRef> SymName = getSymbolName(&Sym, IsDynamic);
+        if (SymName && !SymName->empty())
+          Index.insert(std::make_pair(*SymName, &Sym));
+      }
+      HasIndex.store(true, std::memory_order_release);
+    }
+  }
+  return Index.lookup(Name);
 }
+
+template <class ELFT>
+const typename ELFFile<ELFT>::Elf_Shdr *
+ELFFile<ELFT>::getSectionByName(StringRef Name) const {
+  if (!HasSectionIndex.load(std::memory_order_acquire)) {
+    std::lock_guard<std::mutex> Lock(IndexMutex);
+    if (!HasSectionIndex.load(std::memory_order_relaxed)) {
+      for (const Elf_Shdr &Sec : sections()) {
+        ErrorOr<StringRef> SecName = getSectionName(&Sec);
+        if (SecName)
+          SectionIndex.insert(std::make_pair(*SecName, &Sec));
+      }
+      HasSectionIndex.store(true, std::memory_order_release);
+    }
+  }
+  return SectionIndex.lookup(Name);
+}
+
 } // end namespace object
 } // end namespace llvm
 
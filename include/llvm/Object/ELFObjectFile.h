@@ -62,6 +62,15 @@ public:
 
   elf_symbol_iterator_range symbols() const;
 
+  /// \brief Find the first defined symbol named \p Name of the symbol table,
+  /// or of the dynamic symbol table if \p IsDynamic. Return the end of that
+  /// table if there is none.
+  virtual elf_symbol_iterator findSymbol(StringRef Name,
+                                         bool IsDynamic) const = 0;
+
+  /// \brief Find the first section named \p Name, or return section_end().
+  virtual section_iterator findSection(StringRef Name) const = 0;
+
   static inline bool classof(const Binary *v) { return v->isELF(); }
 };
 
@@ -334,6 +343,10 @@ public:
 
   elf_symbol_iterator_range getDynamicSymbolIterators() const override;
 
+  elf_symbol_iterator findSymbol(StringRef Name,
+                                 bool IsDynamic) const override;
+  section_iterator findSection(StringRef Name) const override;
+
   bool isRelocatableObject() const override;
 };
 
@@ -780,6 +793,22 @@ elf_symbol_iterator ELFObjectFile<ELFT>::dynamic_symbol_end() const {
   return symbol_iterator(SymbolRef(Sym, this));
 }
 
+template <class ELFT>
+elf_symbol_iterator ELFObjectFile<ELFT>::findSymbol(StringRef Name,
+                                                    bool IsDynamic) const {
+  const Elf_Sym *Sym = EF.getSymbolByName(Name, IsDynamic);
+  if (!Sym)
+    return IsDynamic ? dynamic_symbol_end() : symbol_end();
+  return symbol_iterator(SymbolRef(toDRI(Sym, IsDynamic), this));
+}
+
+template <class ELFT>
+section_iterator ELFObjectFile<ELFT>::findSection(StringRef Name) const {
+  if (const Elf_Shdr *Sec = EF.getSectionByName(Name))
+    return section_iterator(SectionRef(toDRI(Sec), this));
+  return section_end();
+}
+
 template <class ELFT>
 section_iterator ELFObjectFile<ELFT>::section_begin() const {
   return section_iterator(SectionRef(toDRI(EF.section_begin()), this));
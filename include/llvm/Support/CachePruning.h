@@ -0,0 +1,87 @@
+//=- CachePruning.h - Helper to manage the pruning of a cache dir -*- C++ -*-=//
+//
+//                     The LLVM Compiler Infrastructure
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+//
+// This file implements pruning of a directory intended for cache storage, using
+// various policies.
+//
+//===----------------------------------------------------------------------===//
+
+#ifndef LLVM_SUPPORT_CACHEPRUNING_H
+#define LLVM_SUPPORT_CACHEPRUNING_H
+
+#include "llvm/ADT/StringRef.h"
+#include "llvm/Support/DataTypes.h"
+#include <string>
+
+namespace llvm {
+
+/// Handle pruning a directory provided by the user, using the configured
+/// policies. Only the files whose name starts with "llvmcache-" are
+/// considered, so the directory can be shared with other content. The lock
+/// files and the temporary files of the entries that are still being written,
+/// whose names contain ".lock" or "-tmp-", are left alone until they are
+/// stale, see setStaleFileExpiration().
+///
+/// The policies are expressed in terms of the last modification time of the
+/// files, which users of the cache are expected to update when an entry is
+/// used.
+class CachePruning {
+public:
+  /// Prepare to prune \p Path.
+  CachePruning(StringRef Path) : Path(Path) {}
+
+  /// Define the pruning interval, in seconds. This is intended to be used to
+  /// avoid scanning the directory too often. It does not impact the decision
+  /// of which file to prune. A value of 0 forces the scan to occur. A
+  /// negative value disables pruning.
+  CachePruning &setPruningInterval(int PruningInterval) {
+    Interval = PruningInterval;
+    return *this;
+  }
+
+  /// Define the expiration for a file, in seconds. When a file hasn't been
+  /// used for \p ExpireAfter seconds, it is removed from the cache. A value
+  /// of 0 disables the expiration-based pruning.
+  CachePruning &setEntryExpiration(unsigned ExpireAfter) {
+    Expiration = ExpireAfter;
+    return *this;
+  }
+
+  /// Define the maximum size for the cache directory, in bytes. The least
+  /// recently used files are removed until the cache fits. A value of 0
+  /// disables the size-based pruning.
+  CachePruning &setMaxSize(uint64_t MaxSizeInBytes) {
+    MaxSize = MaxSizeInBytes;
+    return *this;
+  }
+
+  /// Define the age, in seconds, after which a lock file or a temporary file
+  /// is presumed to be left behind by a process that crashed, and removed.
+  /// Younger ones belong to entries being written and are never removed.
+  CachePruning &setStaleFileExpiration(unsigned StaleAfter) {
+    StaleExpiration = StaleAfter;
+    return *this;
+  }
+
+  /// Perform pruning using the supplied options, returns true if pruning
+  /// occurred, i.e. if the pruning interval had expired.
+  bool prune();
+
+private:
+  // Options that matches the setters above.
+  std::string Path;
+  unsigned Expiration = 0;
+  int Interval = 0;
+  uint64_t MaxSize = 0;
+  unsigned StaleExpiration = 2 * 60 * 60;
+};
+
+} // namespace llvm
+
+#endif
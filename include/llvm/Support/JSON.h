@@ -0,0 +1,29 @@
+//===- llvm/Support/JSON.h - Helpers to write JSON --------------*- C++ -*-===//
+//
+//                     The LLVM Compiler Infrastructure
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+//
+// This file declares helpers for the reports that LLVM writes in JSON.
+//
+//===----------------------------------------------------------------------===//
+
+#ifndef LLVM_SUPPORT_JSON_H
+#define LLVM_SUPPORT_JSON_H
+
+#include "llvm/ADT/StringRef.h"
+
+namespace llvm {
+class raw_ostream;
+
+/// Print \p Str as a quoted JSON string, escaping the quotes, the backslashes
+/// and the control characters. The other bytes are printed unchanged, so \p
+/// Str should be valid UTF-8.
+void printJSONString(raw_ostream &OS, StringRef Str);
+
+} // end namespace llvm
+
+#endif
@@ -45,6 +45,9 @@ class Process {
 public:
   static unsigned getPageSize();
 
+  /// \brief Return the identifier of the current process.
+  static unsigned getProcessId();
+
   /// \brief Return process memory usage.
   /// This static function will return the total amount of memory allocated
   /// by the process. This only counts the memory allocated via the malloc,
@@ -52,6 +55,10 @@ public:
   /// allocated space.
   static size_t GetMallocUsage();
 
+  /// \brief Return the peak resident set size of the process, in bytes, or 0
+  /// if the operating system does not report it.
+  static size_t GetPeakResidentSetSize();
+
   /// This static function will set \p user_time to the amount of CPU time
   /// spent in user (non-kernel) mode and \p sys_time to the amount of CPU
   /// time spent in system (kernel) mode.  If the operating system does not
@@ -0,0 +1,179 @@
+//===-- llvm/Support/ThreadPool.h - A ThreadPool implementation -*- C++ -*-===//
+//
+//                     The LLVM Compiler Infrastructure
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+//
+// This file defines a crude C++11 based thread pool, and a task group that can
+// be used to wait on a subset of the tasks submitted to a pool.
+//
+//===----------------------------------------------------------------------===//
+
+#ifndef LLVM_SUPPORT_THREADPOOL_H
+#define LLVM_SUPPORT_THREADPOOL_H
+
+#include "llvm/Config/llvm-config.h"
+#include "llvm/Support/DataTypes.h"
+
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <future>
+#include <map>
+#include <mutex>
+#include <thread>
+#include <utility>
+#include <vector>
+
+namespace llvm {
+
+class ThreadPoolTaskGroup;
+
+/// A ThreadPool for asynchronous parallel execution on a defined number of
+/// threads.
+///
+/// The pool keeps a vector of threads alive, waiting on a condition variable
+/// for some work to become available. Tasks are executed in FIFO order.
+///
+/// When LLVM is built without thread support, the tasks are queued and only
+/// executed on the calling thread when wait() is called, or when the future
+/// returned by async() is synchronized on.
+class ThreadPool {
+public:
+  typedef std::function<void()> TaskTy;
+  typedef std::packaged_task<void()> PackagedTaskTy;
+
+  /// Construct a pool with the number of threads returned by
+  /// getDefaultThreadCount().
+  ThreadPool();
+
+  /// Construct a pool of \p ThreadCount threads. A count of zero is treated
+  /// as one.
+  explicit ThreadPool(unsigned ThreadCount);
+
+  /// Blocking destructor: the pool will wait for all the threads to complete.
+  ~ThreadPool();
+
+  /// Asynchronous submission of a task to the pool. The returned future can be
+  /// used to wait for the task to finish and is *non-blocking* on destruction.
+  template <typename Function, typename... Args>
+  std::shared_future<void> async(Function &&F, Args &&... ArgList) {
+    auto Task =
+        std::bind(std::forward<Function>(F), std::forward<Args>(ArgList)...);
+    return asyncImpl(std::move(Task), nullptr);
+  }
+
+  /// Asynchronous submission of a task to the pool. The returned future can be
+  /// used to wait for the task to finish and is *non-blocking* on destruction.
+  template <typename Function>
+  std::shared_future<void> async(Function &&F) {
+    return asyncImpl(std::forward<Function>(F), nullptr);
+  }
+
+  /// Blocking wait for all the tasks submitted to the pool to complete,
+  /// including the ones submitted through a ThreadPoolTaskGroup.
+  ///
+  /// This must not be called from a task running on this pool.
+  void wait();
+
+  /// Blocking wait for all the tasks of \p Group to complete. While waiting,
+  /// the calling thread runs the tasks of the group that are still queued, so
+  /// it is safe to call this from a task running on this pool.
+  void wait(ThreadPoolTaskGroup &Group);
+
+  /// Returns the number of worker threads in the pool.
+  unsigned getThreadCount() const { return ThreadCount; }
+
+  /// Returns the number of threads a default constructed pool uses: the
+  /// number of concurrent threads supported by the host, or one when it
+  /// cannot be determined or LLVM is built without thread support.
+  static unsigned getDefaultThreadCount();
+
+private:
+  friend class ThreadPoolTaskGroup;
+
+  /// Asynchronous submission of a task to the pool, optionally on behalf of
+  /// \p Group. The returned future can be used to wait for the task to
+  /// finish and is *non-blocking* on destruction.
+  std::shared_future<void> asyncImpl(TaskTy F, ThreadPoolTaskGroup *Group);
+
+  /// Pop the first queued task belonging to \p Group (or the first queued
+  /// task at all if \p Group is null) and run it on the calling thread.
+  /// Called with QueueLock held through \p LockGuard, which is released while
+  /// the task runs. Returns false if there was no such task.
+  bool runQueuedTask(std::unique_lock<std::mutex> &LockGuard,
+                     ThreadPoolTaskGroup *Group);
+
+  /// Number of worker threads.
+  unsigned ThreadCount;
+
+  /// Tasks waiting for execution in the pool, with the group (if any) they
+  /// were submitted through.
+  std::deque<std::pair<PackagedTaskTy, ThreadPoolTaskGroup *>> Tasks;
+
+  /// Number of tasks of each group that are either queued or running.
+  std::map<ThreadPoolTaskGroup *, unsigned> PendingGroupTasks;
+
+  /// Locking and signaling for accessing the Tasks queue.
+  std::mutex QueueLock;
+  std::condition_variable QueueCondition;
+
+  /// Signaling for job completion.
+  std::condition_variable CompletionCondition;
+
+  /// Keep track of the number of tasks currently running.
+  unsigned ActiveTasks;
+
+#if LLVM_ENABLE_THREADS // avoids warning for unused variable
+  /// Threads in flight.
+  std::vector<std::thread> Threads;
+
+  /// Signal for the destruction of the pool, asking threads to exit.
+  bool EnableFlag;
+#endif
+};
+
+/// A group of tasks submitted to a ThreadPool that can be waited on
+/// independently of the other tasks of the pool.
+///
+/// Several groups can share one pool, and a task running on the pool can
+/// create its own group and wait on it without starving the pool.
+class ThreadPoolTaskGroup {
+public:
+  explicit ThreadPoolTaskGroup(ThreadPool &Pool) : Pool(Pool) {}
+
+  /// Blocking destructor: waits for all the tasks of the group to complete.
+  ~ThreadPoolTaskGroup() { wait(); }
+
+  /// Asynchronous submission of a task to the pool, as part of this group.
+  template <typename Function, typename... Args>
+  std::shared_future<void> async(Function &&F, Args &&... ArgList) {
+    auto Task =
+        std::bind(std::forward<Function>(F), std::forward<Args>(ArgList)...);
+    return Pool.asyncImpl(std::move(Task), this);
+  }
+
+  /// Asynchronous submission of a task to the pool, as part of this group.
+  template <typename Function>
+  std::shared_future<void> async(Function &&F) {
+    return Pool.asyncImpl(std::forward<Function>(F), this);
+  }
+
+  /// Blocking wait for all the tasks of this group to complete.
+  void wait() { Pool.wait(*this); }
+
+  ThreadPool &getPool() const { return Pool; }
+
+private:
+  ThreadPoolTaskGroup(const ThreadPoolTaskGroup &) = delete;
+  void operator=(const ThreadPoolTaskGroup &) = delete;
+
+  ThreadPool &Pool;
+};
+
+} // namespace llvm
+
+#endif // LLVM_SUPPORT_THREADPOOL_H
@@ -0,0 +1,71 @@
+//===- llvm/Support/TimeTrace.h - Timeline of the compilation ---*- C++ -*-===//
+//
+//                     The LLVM Compiler Infrastructure
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+//
+// This file declares a scoped tracing facility, enabled by -time-trace, that
+// records when the passes and the phases of the compilation start and end,
+// on each thread, and writes them in the Chrome trace event format. The trace
+// can be loaded in chrome://tracing to see where the time goes.
+//
+//===----------------------------------------------------------------------===//
+
+#ifndef LLVM_SUPPORT_TIMETRACE_H
+#define LLVM_SUPPORT_TIMETRACE_H
+
+#include "llvm/ADT/StringRef.h"
+#include <chrono>
+#include <string>
+
+namespace llvm {
+
+class TimeTrace;
+
+/// Return the trace of the process if -time-trace is given, or null.
+TimeTrace *getTimeTrace();
+
+/// If -time-trace is given, write the trace recorded so far to its file now,
+/// replacing any previous trace. Otherwise, the trace is written when
+/// llvm_shutdown is called.
+void writeTimeTrace();
+
+/// TimeTraceScope - This records an event of the trace, from the construction
+/// of the object to its destruction, if -time-trace is given. It does nothing
+/// otherwise, so it can be used in hot paths.
+///
+/// \p Name is the phase or the pass, and \p Detail what it is applied to, such
+/// as the name of a function. They are only copied if the trace is enabled.
+class TimeTraceScope {
+  TimeTrace *Trace;
+  std::chrono::steady_clock::time_point Start;
+  std::string Name;
+  std::string Detail;
+
+  TimeTraceScope(const TimeTraceScope &) = delete;
+  void operator=(const TimeTraceScope &) = delete;
+
+public:
+  explicit TimeTraceScope(StringRef Name, StringRef Detail = StringRef())
+      : Trace(getTimeTrace()) {
+    if (!Trace)
+      return;
+    this->Name = Name;
+    this->Detail = Detail;
+    Start = std::chrono::steady_clock::now();
+  }
+  ~TimeTraceScope() {
+    if (Trace)
+      end();
+  }
+
+private:
+  void end();
+};
+
+} // end namespace llvm
+
+#endif
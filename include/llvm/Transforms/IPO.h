@@ -23,6 +23,7 @@ class ModulePass;
 class Pass;
 class Function;
 class BasicBlock;
+class FunctionInfoIndex;
 class GlobalValue;
 
 //===----------------------------------------------------------------------===//
@@ -170,6 +171,13 @@ ModulePass *createBlockExtractorPass();
 /// (prototypes) that are not used.
 ModulePass *createStripDeadPrototypesPass();
 
+//===----------------------------------------------------------------------===//
+/// createFunctionImportPass - This pass imports the definitions of the small
+/// functions called by the module, as found in a function summary index. If
+/// \p Index is null, the index is read from the file given by -summary-file.
+///
+ModulePass *createFunctionImportPass(const FunctionInfoIndex *Index = nullptr);
+
 //===----------------------------------------------------------------------===//
 /// createFunctionAttrsPass - This pass discovers functions that do not access
 /// memory, or only read memory, and gives them the readnone/readonly attribute.
@@ -0,0 +1,60 @@
+//===- llvm/Transforms/IPO/FunctionImport.h - ThinLTO importing -*- C++ -*-===//
+//
+//                     The LLVM Compiler Infrastructure
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+//
+// This file declares the function importer, which copies in a module the
+// definitions it needs from other modules, based on a function summary index.
+//
+//===----------------------------------------------------------------------===//
+
+#ifndef LLVM_TRANSFORMS_IPO_FUNCTIONIMPORT_H
+#define LLVM_TRANSFORMS_IPO_FUNCTIONIMPORT_H
+
+#include "llvm/ADT/StringRef.h"
+#include "llvm/IR/DiagnosticInfo.h"
+#include <functional>
+#include <memory>
+
+namespace llvm {
+class FunctionInfoIndex;
+class LLVMContext;
+class Module;
+
+/// The function importer copies in a module the definitions of the small or
+/// frequently called functions it calls, as found in the summary index.
+///
+/// Imported definitions are made available_externally (or kept linkonce_odr)
+/// so that the module still relies on the defining module for the symbol,
+/// while the optimizer can inline them. The debug info of the imported
+/// definitions is dropped.
+class FunctionImporter {
+public:
+  /// Callback returning the module at a given path, usually lazily loaded.
+  /// The module must be created in the context passed to the callback.
+  typedef std::function<std::unique_ptr<Module>(StringRef ModulePath,
+                                                LLVMContext &Context)>
+      ModuleLoaderTy;
+
+  /// Create an importer using the summaries of \p Index, loading the source
+  /// modules with \p ModuleLoader.
+  FunctionImporter(const FunctionInfoIndex &Index, ModuleLoaderTy ModuleLoader,
+                   DiagnosticHandlerFunction DiagnosticHandler = nullptr);
+
+  /// Import functions in Module \p M based on the summary informations.
+  /// Returns true if \p M was changed.
+  bool importFunctions(Module &M);
+
+private:
+  const FunctionInfoIndex &Index;
+  ModuleLoaderTy ModuleLoader;
+  DiagnosticHandlerFunction DiagnosticHandler;
+};
+
+} // End llvm namespace
+
+#endif
@@ -17,6 +17,7 @@
 
 #include "llvm/Analysis/CallGraphSCCPass.h"
 #include "llvm/ADT/SCCIterator.h"
+#include "llvm/ADT/SmallPtrSet.h"
 #include "llvm/ADT/Statistic.h"
 #include "llvm/Analysis/CallGraph.h"
 #include "llvm/IR/Function.h"
@@ -25,6 +26,7 @@
 #include "llvm/IR/LegacyPassManagers.h"
 #include "llvm/Support/CommandLine.h"
 #include "llvm/Support/Debug.h"
+#include "llvm/Support/TimeTrace.h"
 #include "llvm/Support/Timer.h"
 #include "llvm/Support/raw_ostream.h"
 using namespace llvm;
@@ -35,6 +37,10 @@ static cl::opt<unsigned>
 MaxIterations("max-cg-scc-iterations", cl::ReallyHidden, cl::init(4));
 
 STATISTIC(MaxSCCIterations, "Maximum CGSCCPassMgr iterations on one SCC");
+STATISTIC(NumRefreshedFunctions,
+          "Number of functions rescanned to refresh the call graph");
+STATISTIC(NumCheckedFunctions,
+          "Number of functions rescanned to check the call graph");
 
 //===----------------------------------------------------------------------===//
 // CGPassManager
@@ -96,11 +102,13 @@ private:
   bool RunAllPassesOnSCC(CallGraphSCC &CurSCC, CallGraph &CG,
                          bool &DevirtualizedCall);
   
-  bool RunPassOnSCC(Pass *P, CallGraphSCC &CurSCC,
-                    CallGraph &CG, bool &CallGraphUpToDate,
+  bool RunPassOnSCC(Pass *P, CallGraphSCC &CurSCC, CallGraph &CG,
+                    SmallPtrSetImpl<CallGraphNode *> &DirtyNodes,
                     bool &DevirtualizedCall);
   bool RefreshCallGraph(CallGraphSCC &CurSCC, CallGraph &CG,
-                        bool IsCheckingMode);
+                        bool IsCheckingMode,
+                        const SmallPtrSetImpl<CallGraphNode *> *DirtyNodes =
+                            nullptr);
 };
 
 } // end anonymous namespace.
@@ -108,29 +116,63 @@ private:
 char CGPassManager::ID = 0;
 
 
+/// Return the functions defined in SCC for the -pass-report report, or nothing
+/// if it is disabled.
+static SmallVector<Function *, 4> getReportedFunctions(CallGraphSCC &SCC) {
+  SmallVector<Function *, 4> Functions;
+  if (!PassReportRegion::isEnabled())
+    return Functions;
+  for (CallGraphNode *CGN : SCC)
+    if (Function *F = CGN->getFunction())
+      if (!F->isDeclaration())
+        Functions.push_back(F);
+  return Functions;
+}
+
+/// Return the name of the first function of SCC, to name it in the timeline.
+static StringRef getSCCName(CallGraphSCC &SCC) {
+  for (CallGraphNode *CGN : SCC)
+    if (Function *F = CGN->getFunction())
+      return F->getName();
+  return StringRef();
+}
+
 bool CGPassManager::RunPassOnSCC(Pass *P, CallGraphSCC &CurSCC,
-                                 CallGraph &CG, bool &CallGraphUpToDate,
+                                 CallGraph &CG,
+                                 SmallPtrSetImpl<CallGraphNode *> &DirtyNodes,
                                  bool &DevirtualizedCall) {
   bool Changed = false;
   PMDataManager *PM = P->getAsPMDataManager();
 
   if (!PM) {
     CallGraphSCCPass *CGSP = (CallGraphSCCPass*)P;
-    if (!CallGraphUpToDate) {
-      DevirtualizedCall |= RefreshCallGraph(CurSCC, CG, false);
-      CallGraphUpToDate = true;
+    if (!DirtyNodes.empty()) {
+      DevirtualizedCall |= RefreshCallGraph(CurSCC, CG, false, &DirtyNodes);
+      DirtyNodes.clear();
     }
 
     {
       TimeRegion PassTimer(getPassTimer(CGSP));
+      PassReportRegion ReportRegion(CGSP, getReportedFunctions(CurSCC));
+      TimeTraceScope TraceScope(CGSP->getPassName(), getSCCName(CurSCC));
+      CurSCC.clearChangedNodes();
       Changed = CGSP->runOnSCC(CurSCC);
+      // The pass may have replaced functions of the SCC, as argument
+      // promotion does.
+      ReportRegion.setSCC(getReportedFunctions(CurSCC));
     }
     
     // After the CGSCCPass is done, when assertions are enabled, use
     // RefreshCallGraph to verify that the callgraph was correctly updated.
+    // If the pass reported its call edge changes, only the nodes it changed
+    // need to be checked.
 #ifndef NDEBUG
-    if (Changed)
-      RefreshCallGraph(CurSCC, CG, true);
+    if (Changed) {
+      const SmallPtrSetImpl<CallGraphNode *> &ChangedNodes =
+          CurSCC.getChangedNodes();
+      RefreshCallGraph(CurSCC, CG, true,
+                       ChangedNodes.empty() ? nullptr : &ChangedNodes);
+    }
 #endif
     
     return Changed;
@@ -145,21 +187,23 @@ bool CGPassManager::RunPassOnSCC(Pass *P, CallGraphSCC &CurSCC,
   for (CallGraphNode *CGN : CurSCC) {
     if (Function *F = CGN->getFunction()) {
       dumpPassInfo(P, EXECUTION_MSG, ON_FUNCTION_MSG, F->getName());
+      bool FunctionChanged;
       {
         TimeRegion PassTimer(getPassTimer(FPP));
-        Changed |= FPP->runOnFunction(*F);
+        FunctionChanged = FPP->runOnFunction(*F);
       }
+      // The function pass(es) modified the function, they may have clobbered
+      // its call graph node.  The other functions need not be rescanned.
+      if (FunctionChanged)
+        DirtyNodes.insert(CGN);
+      Changed |= FunctionChanged;
       F->getContext().yield();
     }
   }
   
-  // The function pass(es) modified the IR, they may have clobbered the
-  // callgraph.
-  if (Changed && CallGraphUpToDate) {
+  if (Changed)
     DEBUG(dbgs() << "CGSCCPASSMGR: Pass Dirtied SCC: "
                  << P->getPassName() << '\n');
-    CallGraphUpToDate = false;
-  }
   return Changed;
 }
 
@@ -169,13 +213,18 @@ bool CGPassManager::RunPassOnSCC(Pass *P, CallGraphSCC &CurSCC,
 /// FunctionPasses have potentially munged the callgraph, and can be used after
 /// CallGraphSCC passes to verify that they correctly updated the callgraph.
 ///
+/// If DirtyNodes is given, only the functions of these nodes are rescanned,
+/// as the other ones were not modified since the call graph was last updated,
+/// or, in checking mode, not reported changed by the CallGraphSCC pass.
+///
 /// This function returns true if it devirtualized an existing function call,
 /// meaning it turned an indirect call into a direct call.  This happens when
 /// a function pass like GVN optimizes away stuff feeding the indirect call.
 /// This never happens in checking mode.
 ///
-bool CGPassManager::RefreshCallGraph(CallGraphSCC &CurSCC,
-                                     CallGraph &CG, bool CheckingMode) {
+bool CGPassManager::RefreshCallGraph(
+    CallGraphSCC &CurSCC, CallGraph &CG, bool CheckingMode,
+    const SmallPtrSetImpl<CallGraphNode *> *DirtyNodes) {
   DenseMap<Value*, CallGraphNode*> CallSites;
   
   DEBUG(dbgs() << "CGSCCPASSMGR: Refreshing SCC with " << CurSCC.size()
@@ -194,6 +243,11 @@ bool CGPassManager::RefreshCallGraph(CallGraphSCC &CurSCC,
     CallGraphNode *CGN = *SCCIdx;
     Function *F = CGN->getFunction();
     if (!F || F->isDeclaration()) continue;
+    if (DirtyNodes && !DirtyNodes->count(CGN)) continue;
+    if (CheckingMode)
+      ++NumCheckedFunctions;
+    else
+      ++NumRefreshedFunctions;
     
     // Walk the function body looking for call sites.  Sync up the call sites in
     // CGN with those actually in the function.
@@ -381,14 +435,15 @@ bool CGPassManager::RunAllPassesOnSCC(CallGraphSCC &CurSCC, CallGraph &CG,
                                       bool &DevirtualizedCall) {
   bool Changed = false;
   
-  // Keep track of whether the callgraph is known to be up-to-date or not.
+  // Keep track of the nodes of the callgraph that may be out of date.
   // The CGSSC pass manager runs two types of passes:
   // CallGraphSCC Passes and other random function passes.  Because other
   // random function passes are not CallGraph aware, they may clobber the
-  // call graph by introducing new calls or deleting other ones.  This flag
-  // is set to false when we run a function pass so that we know to clean up
-  // the callgraph when we need to run a CGSCCPass again.
-  bool CallGraphUpToDate = true;
+  // call graph by introducing new calls or deleting other ones.  The nodes of
+  // the functions that a function pass modifies are added to this set so that
+  // we know to clean them up when we need to run a CGSCCPass again.  The
+  // CGSCCPasses keep the callgraph up to date themselves.
+  SmallPtrSet<CallGraphNode *, 8> DirtyNodes;
 
   // Run all passes on current SCC.
   for (unsigned PassNo = 0, e = getNumContainedPasses();
@@ -415,8 +470,7 @@ bool CGPassManager::RunAllPassesOnSCC(CallGraphSCC &CurSCC, CallGraph &CG,
     initializeAnalysisImpl(P);
     
     // Actually run this pass on the current SCC.
-    Changed |= RunPassOnSCC(P, CurSCC, CG,
-                            CallGraphUpToDate, DevirtualizedCall);
+    Changed |= RunPassOnSCC(P, CurSCC, CG, DirtyNodes, DevirtualizedCall);
     
     if (Changed)
       dumpPassInfo(P, MODIFICATION_MSG, ON_CG_MSG, "");
@@ -430,8 +484,8 @@ bool CGPassManager::RunAllPassesOnSCC(CallGraphSCC &CurSCC, CallGraph &CG,
   
   // If the callgraph was left out of date (because the last pass run was a
   // functionpass), refresh it before we move on to the next SCC.
-  if (!CallGraphUpToDate)
-    DevirtualizedCall |= RefreshCallGraph(CurSCC, CG, false);
+  if (!DirtyNodes.empty())
+    DevirtualizedCall |= RefreshCallGraph(CurSCC, CG, false, &DirtyNodes);
   return Changed;
 }
 
@@ -536,6 +590,31 @@ void CallGraphSCC::ReplaceNode(CallGraphNode *Old, CallGraphNode *New) {
   // pointers to the old CallGraphNode.
   scc_iterator<CallGraph*> *CGI = (scc_iterator<CallGraph*>*)Context;
   CGI->ReplaceNode(Old, New);
+
+  if (ChangedNodes.erase(Old))
+    ChangedNodes.insert(New);
+}
+
+static void dumpCallEdge(const char *Change, CallGraphNode *Caller,
+                         CallGraphNode *Callee) {
+  dbgs() << "CGSCCPASSMGR: Pass " << Change << " call edge from '"
+         << Caller->getFunction()->getName() << "' to ";
+  if (Function *F = Callee->getFunction())
+    dbgs() << "'" << F->getName() << "'\n";
+  else
+    dbgs() << "external node\n";
+}
+
+void CallGraphSCC::reportCallEdgeAdded(CallGraphNode *Caller,
+                                       CallGraphNode *Callee) {
+  DEBUG(dumpCallEdge("added", Caller, Callee));
+  ChangedNodes.insert(Caller);
+}
+
+void CallGraphSCC::reportCallEdgeRemoved(CallGraphNode *Caller,
+                                         CallGraphNode *Callee) {
+  DEBUG(dumpCallEdge("removed", Caller, Callee));
+  ChangedNodes.insert(Caller);
 }
 
 
@@ -30,6 +30,7 @@
 #include "llvm/IR/InstVisitor.h"
 #include "llvm/IR/IntrinsicInst.h"
 #include "llvm/IR/Operator.h"
+#include "llvm/Support/CommandLine.h"
 #include "llvm/Support/Debug.h"
 #include "llvm/Support/raw_ostream.h"
 
@@ -38,6 +39,12 @@ using namespace llvm;
 #define DEBUG_TYPE "inline-cost"
 
 STATISTIC(NumCallsAnalyzed, "Number of call sites analyzed");
+STATISTIC(NumCallsCached, "Number of call sites whose cached cost was reused");
+
+static cl::opt<bool> EnableCostCache(
+    "inline-cost-cache", cl::Hidden, cl::init(true),
+    cl::desc("Cache the inline costs of the call sites whose arguments "
+             "cannot be simplified"));
 
 namespace {
 
@@ -173,6 +180,7 @@ public:
         SROACostSavings(0), SROACostSavingsLost(0) {}
 
   bool analyzeCall(CallSite CS);
+  bool hasOnlyOpaqueArgs(CallSite CS, uint64_t &ConstantOffsetPtrArgs);
 
   int getThreshold() { return Threshold; }
   int getCost() { return Cost; }
@@ -1042,6 +1050,60 @@ ConstantInt *CallAnalyzer::stripAndComputeInBoundsConstantOffsets(Value *&V) {
   return cast<ConstantInt>(ConstantInt::get(IntPtrTy, Offset));
 }
 
+/// \brief Test whether the given function calls itself directly.
+static bool isRecursive(Function &F) {
+  for (User *U : F.users()) {
+    CallSite Site(U);
+    if (!Site)
+      continue;
+    Instruction *I = Site.getInstruction();
+    if (I->getParent()->getParent() == &F)
+      return true;
+  }
+  return false;
+}
+
+/// \brief Test whether the given call site is the only use of the local
+/// function F.
+static bool isOnlyCallToLocalFunction(Function &F, CallSite CS) {
+  return F.hasLocalLinkage() && F.hasOneUse() && &F == CS.getCalledFunction();
+}
+
+/// \brief Test whether the given call site is followed by an unreachable
+/// instruction, or is an invoke whose normal destination is unreachable.
+static bool isFollowedByUnreachable(CallSite CS) {
+  Instruction *Instr = CS.getInstruction();
+  if (InvokeInst *II = dyn_cast<InvokeInst>(Instr))
+    return isa<UnreachableInst>(II->getNormalDest()->begin());
+  return isa<UnreachableInst>(++BasicBlock::iterator(Instr));
+}
+
+/// \brief Test whether the arguments of the call site give the analysis
+/// nothing to simplify in the callee: no argument is a constant or is
+/// derived from an alloca, and no two arguments point into the same object.
+/// The analysis of such a call site does not depend on its arguments, except
+/// through the arguments which are pointers with a constant offset from their
+/// base, which are returned as a bit mask.
+bool CallAnalyzer::hasOnlyOpaqueArgs(CallSite CS,
+                                     uint64_t &ConstantOffsetPtrArgs) {
+  ConstantOffsetPtrArgs = 0;
+  SmallPtrSet<Value *, 4> Bases;
+  unsigned ArgNo = 0;
+  for (CallSite::arg_iterator CAI = CS.arg_begin(), CAE = CS.arg_end();
+       CAI != CAE; ++CAI, ++ArgNo) {
+    if (isa<Constant>(CAI))
+      return false;
+
+    Value *PtrArg = *CAI;
+    if (!stripAndComputeInBoundsConstantOffsets(PtrArg))
+      continue;
+    if (ArgNo >= 64 || isa<AllocaInst>(PtrArg) || !Bases.insert(PtrArg).second)
+      return false;
+    ConstantOffsetPtrArgs |= uint64_t(1) << ArgNo;
+  }
+  return true;
+}
+
 /// \brief Analyze a call site for potential inlining.
 ///
 /// Returns true if inlining this call is viable, and false if it is not
@@ -1109,8 +1171,7 @@ bool CallAnalyzer::analyzeCall(CallSite CS) {
 
   // If there is only one call of the function, and it has internal linkage,
   // the cost of inlining it drops dramatically.
-  bool OnlyOneCallAndLocalLinkage = F.hasLocalLinkage() && F.hasOneUse() &&
-    &F == CS.getCalledFunction();
+  bool OnlyOneCallAndLocalLinkage = isOnlyCallToLocalFunction(F, CS);
   if (OnlyOneCallAndLocalLinkage)
     Cost += InlineConstants::LastCallToStaticBonus;
 
@@ -1118,11 +1179,7 @@ bool CallAnalyzer::analyzeCall(CallSite CS) {
   // invoke is an unreachable instruction, the function is noreturn. As such,
   // there is little point in inlining this unless there is literally zero
   // cost.
-  Instruction *Instr = CS.getInstruction();
-  if (InvokeInst *II = dyn_cast<InvokeInst>(Instr)) {
-    if (isa<UnreachableInst>(II->getNormalDest()->begin()))
-      Threshold = 0;
-  } else if (isa<UnreachableInst>(++BasicBlock::iterator(Instr)))
+  if (isFollowedByUnreachable(CS))
     Threshold = 0;
 
   // If this function uses the coldcc calling convention, prefer not to inline
@@ -1137,18 +1194,8 @@ bool CallAnalyzer::analyzeCall(CallSite CS) {
   if (F.empty())
     return true;
 
-  Function *Caller = CS.getInstruction()->getParent()->getParent();
   // Check if the caller function is recursive itself.
-  for (User *U : Caller->users()) {
-    CallSite Site(U);
-    if (!Site)
-      continue;
-    Instruction *I = Site.getInstruction();
-    if (I->getParent()->getParent() == Caller) {
-      IsCallerRecursive = true;
-      break;
-    }
-  }
+  IsCallerRecursive = isRecursive(*CS.getCaller());
 
   // Populate our simplified values by mapping from function arguments to call
   // arguments with known important simplifications.
@@ -1324,12 +1371,43 @@ void InlineCostAnalysis::getAnalysisUsage(AnalysisUsage &AU) const {
   CallGraphSCCPass::getAnalysisUsage(AU);
 }
 
+bool InlineCostAnalysis::doInitialization(CallGraph &CG) {
+  CostCache.clear();
+  return false;
+}
+
 bool InlineCostAnalysis::runOnSCC(CallGraphSCC &SCC) {
   TTIWP = &getAnalysis<TargetTransformInfoWrapperPass>();
   ACT = &getAnalysis<AssumptionCacheTracker>();
+
+  // The functions of the SCC are about to be modified by the inliner and by
+  // the function passes, so their costs must not be cached until the walk
+  // has moved on to their callers.
+  SCCFunctions.clear();
+  for (CallGraphNode *CGN : SCC)
+    if (Function *F = CGN->getFunction()) {
+      SCCFunctions.insert(F);
+      auto I = CostCache.find_as(F);
+      if (I != CostCache.end())
+        CostCache.erase(I);
+    }
+  return false;
+}
+
+bool InlineCostAnalysis::doFinalization(CallGraph &CG) {
+  // The module may be modified before the next walk of the call graph.
+  CostCache.clear();
+  SCCFunctions.clear();
   return false;
 }
 
+void InlineCostAnalysis::FunctionCallbackVH::deleted() {
+  auto I = ICA->CostCache.find_as(cast<Function>(getValPtr()));
+  if (I != ICA->CostCache.end())
+    ICA->CostCache.erase(I);
+  // 'this' now dangles!
+}
+
 InlineCost InlineCostAnalysis::getInlineCost(CallSite CS, int Threshold) {
   return getInlineCost(CS, CS.getCalledFunction(), Threshold);
 }
@@ -1352,6 +1430,18 @@ static bool functionsHaveCompatibleAttributes(Function *Caller,
          attributeMatches(Caller, Callee, Attribute::SanitizeThread);
 }
 
+/// \brief Return the cost of a call site from the result of its analysis.
+static InlineCost getInlineCostOfAnalysis(bool ShouldInline,
+                                          CallAnalyzer &CA) {
+  // Check if there was a reason to force inlining or no inlining.
+  if (!ShouldInline && CA.getCost() < CA.getThreshold())
+    return InlineCost::getNever();
+  if (ShouldInline && CA.getCost() >= CA.getThreshold())
+    return InlineCost::getAlways();
+
+  return llvm::InlineCost::get(CA.getCost(), CA.getThreshold());
+}
+
 InlineCost InlineCostAnalysis::getInlineCost(CallSite CS, Function *Callee,
                                              int Threshold) {
   // Cannot inline indirect calls.
@@ -1386,17 +1476,40 @@ InlineCost InlineCostAnalysis::getInlineCost(CallSite CS, Function *Callee,
         << "...\n");
 
   CallAnalyzer CA(TTIWP->getTTI(*Callee), ACT, *Callee, Threshold, CS);
+
+  // Look for the cost of a call site of the callee with the same properties,
+  // if the arguments do not matter.
+  CallSiteKey Key;
+  CalleeCosts *Costs = nullptr;
+  if (EnableCostCache && !SCCFunctions.count(Callee) &&
+      CA.hasOnlyOpaqueArgs(CS, Key.ConstantOffsetPtrArgs)) {
+    Key.Threshold = Threshold;
+    Key.Attrs = CS.getAttributes();
+    Key.IsCallerRecursive = isRecursive(*CS.getCaller());
+    Key.OnlyOneCallAndLocalLinkage = isOnlyCallToLocalFunction(*Callee, CS);
+    Key.IsFollowedByUnreachable = isFollowedByUnreachable(CS);
+
+    auto I = CostCache.find_as(Callee);
+    if (I == CostCache.end())
+      I = CostCache.insert(std::make_pair(FunctionCallbackVH(Callee, this),
+                                          CalleeCosts())).first;
+    Costs = &I->second;
+    for (const auto &Entry : *Costs)
+      if (Entry.first == Key) {
+        DEBUG(llvm::dbgs() << "      Reusing the cached cost\n");
+        ++NumCallsCached;
+        return Entry.second;
+      }
+  }
+
   bool ShouldInline = CA.analyzeCall(CS);
 
   DEBUG(CA.dump());
 
-  // Check if there was a reason to force inlining or no inlining.
-  if (!ShouldInline && CA.getCost() < CA.getThreshold())
-    return InlineCost::getNever();
-  if (ShouldInline && CA.getCost() >= CA.getThreshold())
-    return InlineCost::getAlways();
-
-  return llvm::InlineCost::get(CA.getCost(), CA.getThreshold());
+  InlineCost Result = getInlineCostOfAnalysis(ShouldInline, CA);
+  if (Costs)
+    Costs->push_back(std::make_pair(Key, Result));
+  return Result;
 }
 
 bool InlineCostAnalysis::isInlineViable(Function &F) {
@@ -17,6 +17,7 @@
 #include "llvm/IR/IRPrintingPasses.h"
 #include "llvm/IR/LLVMContext.h"
 #include "llvm/Support/Debug.h"
+#include "llvm/Support/TimeTrace.h"
 #include "llvm/Support/Timer.h"
 #include "llvm/Support/raw_ostream.h"
 using namespace llvm;
@@ -247,6 +248,8 @@ bool LPPassManager::runOnFunction(Function &F) {
       {
         PassManagerPrettyStackEntry X(P, *CurrentLoop->getHeader());
         TimeRegion PassTimer(getPassTimer(P));
+        PassReportRegion ReportRegion(P, F);
+        TimeTraceScope TraceScope(P->getPassName(), F.getName());
 
         Changed |= P->runOnLoop(CurrentLoop, *this);
       }
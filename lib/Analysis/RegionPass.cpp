@@ -16,6 +16,7 @@
 #include "llvm/Analysis/RegionPass.h"
 #include "llvm/Analysis/RegionIterator.h"
 #include "llvm/Support/Debug.h"
+#include "llvm/Support/TimeTrace.h"
 #include "llvm/Support/Timer.h"
 #include "llvm/Support/raw_ostream.h"
 using namespace llvm;
@@ -96,6 +97,8 @@ bool RGPassManager::runOnFunction(Function &F) {
         PassManagerPrettyStackEntry X(P, *CurrentRegion->getEntry());
 
         TimeRegion PassTimer(getPassTimer(P));
+        PassReportRegion ReportRegion(P, F);
+        TimeTraceScope TraceScope(P->getPassName(), F.getName());
         Changed |= P->runOnRegion(CurrentRegion, *this);
       }
 
@@ -20,6 +20,7 @@
 #include "llvm/IR/DebugInfoMetadata.h"
 #include "llvm/IR/DerivedTypes.h"
 #include "llvm/IR/DiagnosticPrinter.h"
+#include "llvm/IR/FunctionInfo.h"
 #include "llvm/IR/GVMaterializer.h"
 #include "llvm/IR/InlineAsm.h"
 #include "llvm/IR/IntrinsicInst.h"
@@ -32,6 +33,7 @@
 #include "llvm/Support/ManagedStatic.h"
 #include "llvm/Support/MathExtras.h"
 #include "llvm/Support/MemoryBuffer.h"
+#include "llvm/Support/TimeTrace.h"
 #include "llvm/Support/raw_ostream.h"
 #include <deque>
 using namespace llvm;
@@ -95,15 +97,15 @@ public:
 
 class BitcodeReaderMDValueList {
   unsigned NumFwdRefs;
-  bool AnyFwdRefs;
-  unsigned MinFwdRef;
-  unsigned MaxFwdRef;
+  /// The IDs of the forward references created since cycles were last
+  /// resolved.
+  std::vector<unsigned> FwdRefIDs;
   std::vector<TrackingMDRef> MDValuePtrs;
 
   LLVMContext &Context;
 public:
   BitcodeReaderMDValueList(LLVMContext &C)
-      : NumFwdRefs(0), AnyFwdRefs(false), Context(C) {}
+      : NumFwdRefs(0), Context(C) {}
 
   // vector compatibility methods
   unsigned size() const       { return MDValuePtrs.size(); }
@@ -124,6 +126,13 @@ public:
     MDValuePtrs.resize(N);
   }
 
+  /// Return true if \p Idx is a placeholder for a forward reference.
+  bool isFwdRef(unsigned Idx) const {
+    auto *N = dyn_cast_or_null<MDNode>(MDValuePtrs[Idx].get());
+    return N && N->isTemporary();
+  }
+  ArrayRef<unsigned> getFwdRefIDs() const { return FwdRefIDs; }
+
   Metadata *getValueFwdRef(unsigned Idx);
   void assignValue(Metadata *MD, unsigned Idx);
   void tryToResolveCycles();
@@ -190,6 +199,17 @@ class BitcodeReader : public GVMaterializer {
   /// which Metadata blocks are deferred.
   std::vector<uint64_t> DeferredMetadataInfo;
 
+  /// True if module-level metadata should be loaded on demand through the
+  /// METADATA_INDEX, when the module has one.
+  bool UseMetadataIndex = false;
+
+  /// The bit position of each module-level metadata record, indexed by its ID.
+  /// When not empty, module-level metadata is loaded on demand through
+  /// MetadataCursor, which is positioned in the module-level METADATA_BLOCK
+  /// and knows its abbreviations.
+  std::vector<uint64_t> MetadataIndex;
+  BitstreamCursor MetadataCursor;
+
   /// These are basic blocks forward-referenced by block addresses.  They are
   /// inserted lazily into functions when they're loaded.  The basic block ID is
   /// its index into the vector.
@@ -243,7 +263,8 @@ public:
   /// \returns true if an error occurred.
   std::error_code parseBitcodeInto(std::unique_ptr<DataStreamer> Streamer,
                                    Module *M,
-                                   bool ShouldLazyLoadMetadata = false);
+                                   bool ShouldLazyLoadMetadata = false,
+                                   bool UseMetadataIndex = false);
 
   /// \brief Cheap mechanism to just extract module triple
   /// \returns true if an error occurred.
@@ -366,6 +387,13 @@ private:
   std::error_code globalCleanup();
   std::error_code resolveGlobalAndAliasInits();
   std::error_code parseMetadata();
+  std::error_code parseMetadataRecord(unsigned Code,
+                                      SmallVectorImpl<uint64_t> &Record,
+                                      unsigned &NextMDValueNo);
+  std::error_code parseMetadataIndex(ArrayRef<uint64_t> Record);
+  bool isLazyMetadataPending(unsigned ID) const;
+  std::error_code lazyLoadMetadata(unsigned ID);
+  std::error_code resolveLazyMetadata();
   std::error_code parseMetadataAttachment(Function &F);
   ErrorOr<std::string> parseModuleTriple();
   std::error_code parseUseLists();
@@ -480,6 +508,7 @@ void BitcodeReader::freeState() {
   std::vector<Function*>().swap(FunctionsWithBodies);
   DeferredFunctionInfo.clear();
   DeferredMetadataInfo.clear();
+  MetadataIndex.clear();
   MDKindMap.clear();
 
   assert(BasicBlockFwdRefs.empty() && "Unresolved blockaddress fwd references");
@@ -918,13 +947,7 @@ Metadata *BitcodeReaderMDValueList::getValueFwdRef(unsigned Idx) {
     return MD;
 
   // Track forward refs to be resolved later.
-  if (AnyFwdRefs) {
-    MinFwdRef = std::min(MinFwdRef, Idx);
-    MaxFwdRef = std::max(MaxFwdRef, Idx);
-  } else {
-    AnyFwdRefs = true;
-    MinFwdRef = MaxFwdRef = Idx;
-  }
+  FwdRefIDs.push_back(Idx);
   ++NumFwdRefs;
 
   // Create and return a placeholder, which will later be RAUW'd.
@@ -934,7 +957,7 @@ Metadata *BitcodeReaderMDValueList::getValueFwdRef(unsigned Idx) {
 }
 
 void BitcodeReaderMDValueList::tryToResolveCycles() {
-  if (!AnyFwdRefs)
+  if (FwdRefIDs.empty())
     // Nothing to do.
     return;
 
@@ -942,10 +965,13 @@ void BitcodeReaderMDValueList::tryToResolveCycles() {
     // Still forward references... can't resolve cycles.
     return;
 
-  // Resolve any cycles.
-  for (unsigned I = MinFwdRef, E = MaxFwdRef + 1; I != E; ++I) {
-    auto &MD = MDValuePtrs[I];
-    auto *N = dyn_cast_or_null<MDNode>(MD);
+  // Resolve any cycles.  Every cycle goes through a node that was forward
+  // referenced, which resolves the rest of the cycle.
+  for (unsigned I : FwdRefIDs) {
+    // Function-local metadata may have been dropped since.
+    if (I >= size())
+      continue;
+    auto *N = dyn_cast_or_null<MDNode>(MDValuePtrs[I]);
     if (!N)
       continue;
 
@@ -954,7 +980,7 @@ void BitcodeReaderMDValueList::tryToResolveCycles() {
   }
 
   // Make sure we return early again until there's another forward ref.
-  AnyFwdRefs = false;
+  FwdRefIDs.clear();
 }
 
 Type *BitcodeReader::getTypeByID(unsigned ID) {
@@ -1582,22 +1608,6 @@ std::error_code BitcodeReader::parseMetadata() {
 
   SmallVector<uint64_t, 64> Record;
 
-  auto getMD =
-      [&](unsigned ID) -> Metadata *{ return MDValueList.getValueFwdRef(ID); };
-  auto getMDOrNull = [&](unsigned ID) -> Metadata *{
-    if (ID)
-      return getMD(ID - 1);
-    return nullptr;
-  };
-  auto getMDString = [&](unsigned ID) -> MDString *{
-    // This requires that the ID is not really a forward reference.  In
-    // particular, the MDString must already have been resolved.
-    return cast_or_null<MDString>(getMDOrNull(ID));
-  };
-
-#define GET_OR_DISTINCT(CLASS, DISTINCT, ARGS)                                 \
-  (DISTINCT ? CLASS::getDistinct ARGS : CLASS::get ARGS)
-
   // Read all the records.
   while (1) {
     BitstreamEntry Entry = Stream.advanceSkippingSubblocks();
@@ -1607,6 +1617,8 @@ std::error_code BitcodeReader::parseMetadata() {
     case BitstreamEntry::Error:
       return error("Malformed block");
     case BitstreamEntry::EndBlock:
+      if (!MetadataIndex.empty())
+        return resolveLazyMetadata();
       MDValueList.tryToResolveCycles();
       return std::error_code();
     case BitstreamEntry::Record:
@@ -1617,413 +1629,535 @@ std::error_code BitcodeReader::parseMetadata() {
     // Read a record.
     Record.clear();
     unsigned Code = Stream.readRecord(Entry.ID, Record);
-    bool IsDistinct = false;
-    switch (Code) {
-    default:  // Default behavior: ignore.
-      break;
-    case bitc::METADATA_NAME: {
-      // Read name of the named metadata.
-      SmallString<8> Name(Record.begin(), Record.end());
-      Record.clear();
-      Code = Stream.ReadCode();
-
-      unsigned NextBitCode = Stream.readRecord(Code, Record);
-      if (NextBitCode != bitc::METADATA_NAMED_NODE)
-        return error("METADATA_NAME not followed by METADATA_NAMED_NODE");
-
-      // Read named metadata elements.
-      unsigned Size = Record.size();
-      NamedMDNode *NMD = TheModule->getOrInsertNamedMetadata(Name);
-      for (unsigned i = 0; i != Size; ++i) {
-        MDNode *MD = dyn_cast_or_null<MDNode>(MDValueList.getValueFwdRef(Record[i]));
-        if (!MD)
-          return error("Invalid record");
-        NMD->addOperand(MD);
-      }
-      break;
+    if (Code == bitc::METADATA_INDEX_OFFSET && UseMetadataIndex &&
+        MetadataIndex.empty() && NextMDValueNo == 0) {
+      // Skip over the metadata records to the index, and the named metadata
+      // after it. The records are loaded on demand.
+      if (std::error_code EC = parseMetadataIndex(Record))
+        return EC;
+      NextMDValueNo = MDValueList.size();
+      continue;
     }
-    case bitc::METADATA_OLD_FN_NODE: {
-      // FIXME: Remove in 4.0.
-      // This is a LocalAsMetadata record, the only type of function-local
-      // metadata.
-      if (Record.size() % 2 == 1)
-        return error("Invalid record");
+    if (std::error_code EC = parseMetadataRecord(Code, Record, NextMDValueNo))
+      return EC;
+  }
+}
 
-      // If this isn't a LocalAsMetadata record, we're dropping it.  This used
-      // to be legal, but there's no upgrade path.
-      auto dropRecord = [&] {
-        MDValueList.assignValue(MDNode::get(Context, None), NextMDValueNo++);
-      };
-      if (Record.size() != 2) {
-        dropRecord();
-        break;
-      }
+/// Parse a single record of a METADATA_BLOCK, assigning the metadata it
+/// defines, if any, to \p NextMDValueNo.
+std::error_code
+BitcodeReader::parseMetadataRecord(unsigned Code,
+                                   SmallVectorImpl<uint64_t> &Record,
+                                   unsigned &NextMDValueNo) {
+  auto getMD =
+      [&](unsigned ID) -> Metadata *{ return MDValueList.getValueFwdRef(ID); };
+  auto getMDOrNull = [&](unsigned ID) -> Metadata *{
+    if (ID)
+      return getMD(ID - 1);
+    return nullptr;
+  };
+  std::error_code LazyLoadEC;
+  auto getMDString = [&](unsigned ID) -> MDString *{
+    // This requires that the ID is not really a forward reference.  In
+    // particular, the MDString must already have been resolved, which is only
+    // guaranteed for the strings of the index once they are loaded.
+    if (ID && isLazyMetadataPending(ID - 1))
+      if ((LazyLoadEC = lazyLoadMetadata(ID - 1)))
+        return nullptr;
+    return cast_or_null<MDString>(getMDOrNull(ID));
+  };
 
-      Type *Ty = getTypeByID(Record[0]);
-      if (Ty->isMetadataTy() || Ty->isVoidTy()) {
-        dropRecord();
-        break;
-      }
+#define GET_OR_DISTINCT(CLASS, DISTINCT, ARGS)                                 \
+  (DISTINCT ? CLASS::getDistinct ARGS : CLASS::get ARGS)
 
-      MDValueList.assignValue(
-          LocalAsMetadata::get(ValueList.getValueFwdRef(Record[1], Ty)),
-          NextMDValueNo++);
-      break;
-    }
-    case bitc::METADATA_OLD_NODE: {
-      // FIXME: Remove in 4.0.
-      if (Record.size() % 2 == 1)
-        return error("Invalid record");
+  bool IsDistinct = false;
+  switch (Code) {
+  default:  // Default behavior: ignore.
+    break;
+  case bitc::METADATA_NAME: {
+    // Read name of the named metadata.
+    SmallString<8> Name(Record.begin(), Record.end());
+    Record.clear();
+    Code = Stream.ReadCode();
 
-      unsigned Size = Record.size();
-      SmallVector<Metadata *, 8> Elts;
-      for (unsigned i = 0; i != Size; i += 2) {
-        Type *Ty = getTypeByID(Record[i]);
-        if (!Ty)
-          return error("Invalid record");
-        if (Ty->isMetadataTy())
-          Elts.push_back(MDValueList.getValueFwdRef(Record[i+1]));
-        else if (!Ty->isVoidTy()) {
-          auto *MD =
-              ValueAsMetadata::get(ValueList.getValueFwdRef(Record[i + 1], Ty));
-          assert(isa<ConstantAsMetadata>(MD) &&
-                 "Expected non-function-local metadata");
-          Elts.push_back(MD);
-        } else
-          Elts.push_back(nullptr);
-      }
-      MDValueList.assignValue(MDNode::get(Context, Elts), NextMDValueNo++);
-      break;
-    }
-    case bitc::METADATA_VALUE: {
-      if (Record.size() != 2)
-        return error("Invalid record");
+    unsigned NextBitCode = Stream.readRecord(Code, Record);
+    if (NextBitCode != bitc::METADATA_NAMED_NODE)
+      return error("METADATA_NAME not followed by METADATA_NAMED_NODE");
 
-      Type *Ty = getTypeByID(Record[0]);
-      if (Ty->isMetadataTy() || Ty->isVoidTy())
+    // Read named metadata elements.
+    unsigned Size = Record.size();
+    NamedMDNode *NMD = TheModule->getOrInsertNamedMetadata(Name);
+    for (unsigned i = 0; i != Size; ++i) {
+      MDNode *MD = dyn_cast_or_null<MDNode>(MDValueList.getValueFwdRef(Record[i]));
+      if (!MD)
         return error("Invalid record");
-
-      MDValueList.assignValue(
-          ValueAsMetadata::get(ValueList.getValueFwdRef(Record[1], Ty)),
-          NextMDValueNo++);
-      break;
+      NMD->addOperand(MD);
     }
-    case bitc::METADATA_DISTINCT_NODE:
-      IsDistinct = true;
-      // fallthrough...
-    case bitc::METADATA_NODE: {
-      SmallVector<Metadata *, 8> Elts;
-      Elts.reserve(Record.size());
-      for (unsigned ID : Record)
-        Elts.push_back(ID ? MDValueList.getValueFwdRef(ID - 1) : nullptr);
-      MDValueList.assignValue(IsDistinct ? MDNode::getDistinct(Context, Elts)
-                                         : MDNode::get(Context, Elts),
-                              NextMDValueNo++);
+    break;
+  }
+  case bitc::METADATA_OLD_FN_NODE: {
+    // FIXME: Remove in 4.0.
+    // This is a LocalAsMetadata record, the only type of function-local
+    // metadata.
+    if (Record.size() % 2 == 1)
+      return error("Invalid record");
+
+    // If this isn't a LocalAsMetadata record, we're dropping it.  This used
+    // to be legal, but there's no upgrade path.
+    auto dropRecord = [&] {
+      MDValueList.assignValue(MDNode::get(Context, None), NextMDValueNo++);
+    };
+    if (Record.size() != 2) {
+      dropRecord();
       break;
     }
-    case bitc::METADATA_LOCATION: {
-      if (Record.size() != 5)
-        return error("Invalid record");
 
-      unsigned Line = Record[1];
-      unsigned Column = Record[2];
-      MDNode *Scope = cast<MDNode>(MDValueList.getValueFwdRef(Record[3]));
-      Metadata *InlinedAt =
-          Record[4] ? MDValueList.getValueFwdRef(Record[4] - 1) : nullptr;
-      MDValueList.assignValue(
-          GET_OR_DISTINCT(DILocation, Record[0],
-                          (Context, Line, Column, Scope, InlinedAt)),
-          NextMDValueNo++);
+    Type *Ty = getTypeByID(Record[0]);
+    if (Ty->isMetadataTy() || Ty->isVoidTy()) {
+      dropRecord();
       break;
     }
-    case bitc::METADATA_GENERIC_DEBUG: {
-      if (Record.size() < 4)
-        return error("Invalid record");
 
-      unsigned Tag = Record[1];
-      unsigned Version = Record[2];
+    MDValueList.assignValue(
+        LocalAsMetadata::get(ValueList.getValueFwdRef(Record[1], Ty)),
+        NextMDValueNo++);
+    break;
+  }
+  case bitc::METADATA_OLD_NODE: {
+    // FIXME: Remove in 4.0.
+    if (Record.size() % 2 == 1)
+      return error("Invalid record");
 
-      if (Tag >= 1u << 16 || Version != 0)
+    unsigned Size = Record.size();
+    SmallVector<Metadata *, 8> Elts;
+    for (unsigned i = 0; i != Size; i += 2) {
+      Type *Ty = getTypeByID(Record[i]);
+      if (!Ty)
         return error("Invalid record");
-
-      auto *Header = getMDString(Record[3]);
-      SmallVector<Metadata *, 8> DwarfOps;
-      for (unsigned I = 4, E = Record.size(); I != E; ++I)
-        DwarfOps.push_back(Record[I] ? MDValueList.getValueFwdRef(Record[I] - 1)
-                                     : nullptr);
-      MDValueList.assignValue(GET_OR_DISTINCT(GenericDINode, Record[0],
-                                              (Context, Tag, Header, DwarfOps)),
-                              NextMDValueNo++);
-      break;
+      if (Ty->isMetadataTy())
+        Elts.push_back(MDValueList.getValueFwdRef(Record[i+1]));
+      else if (!Ty->isVoidTy()) {
+        auto *MD =
+            ValueAsMetadata::get(ValueList.getValueFwdRef(Record[i + 1], Ty));
+        assert(isa<ConstantAsMetadata>(MD) &&
+               "Expected non-function-local metadata");
+        Elts.push_back(MD);
+      } else
+        Elts.push_back(nullptr);
     }
-    case bitc::METADATA_SUBRANGE: {
-      if (Record.size() != 3)
-        return error("Invalid record");
+    MDValueList.assignValue(MDNode::get(Context, Elts), NextMDValueNo++);
+    break;
+  }
+  case bitc::METADATA_VALUE: {
+    if (Record.size() != 2)
+      return error("Invalid record");
 
-      MDValueList.assignValue(
-          GET_OR_DISTINCT(DISubrange, Record[0],
-                          (Context, Record[1], unrotateSign(Record[2]))),
-          NextMDValueNo++);
-      break;
-    }
-    case bitc::METADATA_ENUMERATOR: {
-      if (Record.size() != 3)
-        return error("Invalid record");
+    Type *Ty = getTypeByID(Record[0]);
+    if (Ty->isMetadataTy() || Ty->isVoidTy())
+      return error("Invalid record");
 
-      MDValueList.assignValue(GET_OR_DISTINCT(DIEnumerator, Record[0],
-                                              (Context, unrotateSign(Record[1]),
-                                               getMDString(Record[2]))),
-                              NextMDValueNo++);
-      break;
-    }
-    case bitc::METADATA_BASIC_TYPE: {
-      if (Record.size() != 6)
-        return error("Invalid record");
+    MDValueList.assignValue(
+        ValueAsMetadata::get(ValueList.getValueFwdRef(Record[1], Ty)),
+        NextMDValueNo++);
+    break;
+  }
+  case bitc::METADATA_DISTINCT_NODE:
+    IsDistinct = true;
+    // fallthrough...
+  case bitc::METADATA_NODE: {
+    SmallVector<Metadata *, 8> Elts;
+    Elts.reserve(Record.size());
+    for (unsigned ID : Record)
+      Elts.push_back(ID ? MDValueList.getValueFwdRef(ID - 1) : nullptr);
+    MDValueList.assignValue(IsDistinct ? MDNode::getDistinct(Context, Elts)
+                                       : MDNode::get(Context, Elts),
+                            NextMDValueNo++);
+    break;
+  }
+  case bitc::METADATA_LOCATION: {
+    if (Record.size() != 5)
+      return error("Invalid record");
 
-      MDValueList.assignValue(
-          GET_OR_DISTINCT(DIBasicType, Record[0],
-                          (Context, Record[1], getMDString(Record[2]),
-                           Record[3], Record[4], Record[5])),
-          NextMDValueNo++);
-      break;
-    }
-    case bitc::METADATA_DERIVED_TYPE: {
-      if (Record.size() != 12)
-        return error("Invalid record");
+    unsigned Line = Record[1];
+    unsigned Column = Record[2];
+    MDNode *Scope = cast<MDNode>(MDValueList.getValueFwdRef(Record[3]));
+    Metadata *InlinedAt =
+        Record[4] ? MDValueList.getValueFwdRef(Record[4] - 1) : nullptr;
+    MDValueList.assignValue(
+        GET_OR_DISTINCT(DILocation, Record[0],
+                        (Context, Line, Column, Scope, InlinedAt)),
+        NextMDValueNo++);
+    break;
+  }
+  case bitc::METADATA_GENERIC_DEBUG: {
+    if (Record.size() < 4)
+      return error("Invalid record");
 
-      MDValueList.assignValue(
-          GET_OR_DISTINCT(DIDerivedType, Record[0],
-                          (Context, Record[1], getMDString(Record[2]),
-                           getMDOrNull(Record[3]), Record[4],
-                           getMDOrNull(Record[5]), getMDOrNull(Record[6]),
-                           Record[7], Record[8], Record[9], Record[10],
-                           getMDOrNull(Record[11]))),
-          NextMDValueNo++);
-      break;
-    }
-    case bitc::METADATA_COMPOSITE_TYPE: {
-      if (Record.size() != 16)
-        return error("Invalid record");
+    unsigned Tag = Record[1];
+    unsigned Version = Record[2];
 
-      MDValueList.assignValue(
-          GET_OR_DISTINCT(DICompositeType, Record[0],
-                          (Context, Record[1], getMDString(Record[2]),
-                           getMDOrNull(Record[3]), Record[4],
-                           getMDOrNull(Record[5]), getMDOrNull(Record[6]),
-                           Record[7], Record[8], Record[9], Record[10],
-                           getMDOrNull(Record[11]), Record[12],
-                           getMDOrNull(Record[13]), getMDOrNull(Record[14]),
-                           getMDString(Record[15]))),
-          NextMDValueNo++);
-      break;
-    }
-    case bitc::METADATA_SUBROUTINE_TYPE: {
-      if (Record.size() != 3)
-        return error("Invalid record");
+    if (Tag >= 1u << 16 || Version != 0)
+      return error("Invalid record");
 
-      MDValueList.assignValue(
-          GET_OR_DISTINCT(DISubroutineType, Record[0],
-                          (Context, Record[1], getMDOrNull(Record[2]))),
-          NextMDValueNo++);
-      break;
-    }
+    auto *Header = getMDString(Record[3]);
+    SmallVector<Metadata *, 8> DwarfOps;
+    for (unsigned I = 4, E = Record.size(); I != E; ++I)
+      DwarfOps.push_back(Record[I] ? MDValueList.getValueFwdRef(Record[I] - 1)
+                                   : nullptr);
+    MDValueList.assignValue(GET_OR_DISTINCT(GenericDINode, Record[0],
+                                            (Context, Tag, Header, DwarfOps)),
+                            NextMDValueNo++);
+    break;
+  }
+  case bitc::METADATA_SUBRANGE: {
+    if (Record.size() != 3)
+      return error("Invalid record");
 
-    case bitc::METADATA_MODULE: {
-      if (Record.size() != 6)
-        return error("Invalid record");
+    MDValueList.assignValue(
+        GET_OR_DISTINCT(DISubrange, Record[0],
+                        (Context, Record[1], unrotateSign(Record[2]))),
+        NextMDValueNo++);
+    break;
+  }
+  case bitc::METADATA_ENUMERATOR: {
+    if (Record.size() != 3)
+      return error("Invalid record");
 
-      MDValueList.assignValue(
-          GET_OR_DISTINCT(DIModule, Record[0],
-                          (Context, getMDOrNull(Record[1]),
-                          getMDString(Record[2]), getMDString(Record[3]),
-                          getMDString(Record[4]), getMDString(Record[5]))),
-          NextMDValueNo++);
-      break;
-    }
+    MDValueList.assignValue(GET_OR_DISTINCT(DIEnumerator, Record[0],
+                                            (Context, unrotateSign(Record[1]),
+                                             getMDString(Record[2]))),
+                            NextMDValueNo++);
+    break;
+  }
+  case bitc::METADATA_BASIC_TYPE: {
+    if (Record.size() != 6)
+      return error("Invalid record");
 
-    case bitc::METADATA_FILE: {
-      if (Record.size() != 3)
-        return error("Invalid record");
+    MDValueList.assignValue(
+        GET_OR_DISTINCT(DIBasicType, Record[0],
+                        (Context, Record[1], getMDString(Record[2]),
+                         Record[3], Record[4], Record[5])),
+        NextMDValueNo++);
+    break;
+  }
+  case bitc::METADATA_DERIVED_TYPE: {
+    if (Record.size() != 12)
+      return error("Invalid record");
 
-      MDValueList.assignValue(
-          GET_OR_DISTINCT(DIFile, Record[0], (Context, getMDString(Record[1]),
-                                              getMDString(Record[2]))),
-          NextMDValueNo++);
-      break;
-    }
-    case bitc::METADATA_COMPILE_UNIT: {
-      if (Record.size() < 14 || Record.size() > 15)
-        return error("Invalid record");
+    MDValueList.assignValue(
+        GET_OR_DISTINCT(DIDerivedType, Record[0],
+                        (Context, Record[1], getMDString(Record[2]),
+                         getMDOrNull(Record[3]), Record[4],
+                         getMDOrNull(Record[5]), getMDOrNull(Record[6]),
+                         Record[7], Record[8], Record[9], Record[10],
+                         getMDOrNull(Record[11]))),
+        NextMDValueNo++);
+    break;
+  }
+  case bitc::METADATA_COMPOSITE_TYPE: {
+    if (Record.size() != 16)
+      return error("Invalid record");
 
-      MDValueList.assignValue(
-          GET_OR_DISTINCT(
-              DICompileUnit, Record[0],
-              (Context, Record[1], getMDOrNull(Record[2]),
-               getMDString(Record[3]), Record[4], getMDString(Record[5]),
-               Record[6], getMDString(Record[7]), Record[8],
-               getMDOrNull(Record[9]), getMDOrNull(Record[10]),
-               getMDOrNull(Record[11]), getMDOrNull(Record[12]),
-               getMDOrNull(Record[13]), Record.size() == 14 ? 0 : Record[14])),
-          NextMDValueNo++);
-      break;
-    }
-    case bitc::METADATA_SUBPROGRAM: {
-      if (Record.size() != 19)
-        return error("Invalid record");
+    MDValueList.assignValue(
+        GET_OR_DISTINCT(DICompositeType, Record[0],
+                        (Context, Record[1], getMDString(Record[2]),
+                         getMDOrNull(Record[3]), Record[4],
+                         getMDOrNull(Record[5]), getMDOrNull(Record[6]),
+                         Record[7], Record[8], Record[9], Record[10],
+                         getMDOrNull(Record[11]), Record[12],
+                         getMDOrNull(Record[13]), getMDOrNull(Record[14]),
+                         getMDString(Record[15]))),
+        NextMDValueNo++);
+    break;
+  }
+  case bitc::METADATA_SUBROUTINE_TYPE: {
+    if (Record.size() != 3)
+      return error("Invalid record");
 
-      MDValueList.assignValue(
-          GET_OR_DISTINCT(
-              DISubprogram, Record[0],
-              (Context, getMDOrNull(Record[1]), getMDString(Record[2]),
-               getMDString(Record[3]), getMDOrNull(Record[4]), Record[5],
-               getMDOrNull(Record[6]), Record[7], Record[8], Record[9],
-               getMDOrNull(Record[10]), Record[11], Record[12], Record[13],
-               Record[14], getMDOrNull(Record[15]), getMDOrNull(Record[16]),
-               getMDOrNull(Record[17]), getMDOrNull(Record[18]))),
-          NextMDValueNo++);
-      break;
-    }
-    case bitc::METADATA_LEXICAL_BLOCK: {
-      if (Record.size() != 5)
-        return error("Invalid record");
+    MDValueList.assignValue(
+        GET_OR_DISTINCT(DISubroutineType, Record[0],
+                        (Context, Record[1], getMDOrNull(Record[2]))),
+        NextMDValueNo++);
+    break;
+  }
 
-      MDValueList.assignValue(
-          GET_OR_DISTINCT(DILexicalBlock, Record[0],
-                          (Context, getMDOrNull(Record[1]),
-                           getMDOrNull(Record[2]), Record[3], Record[4])),
-          NextMDValueNo++);
-      break;
-    }
-    case bitc::METADATA_LEXICAL_BLOCK_FILE: {
-      if (Record.size() != 4)
-        return error("Invalid record");
+  case bitc::METADATA_MODULE: {
+    if (Record.size() != 6)
+      return error("Invalid record");
 
-      MDValueList.assignValue(
-          GET_OR_DISTINCT(DILexicalBlockFile, Record[0],
-                          (Context, getMDOrNull(Record[1]),
-                           getMDOrNull(Record[2]), Record[3])),
-          NextMDValueNo++);
-      break;
-    }
-    case bitc::METADATA_NAMESPACE: {
-      if (Record.size() != 5)
-        return error("Invalid record");
+    MDValueList.assignValue(
+        GET_OR_DISTINCT(DIModule, Record[0],
+                        (Context, getMDOrNull(Record[1]),
+                        getMDString(Record[2]), getMDString(Record[3]),
+                        getMDString(Record[4]), getMDString(Record[5]))),
+        NextMDValueNo++);
+    break;
+  }
 
-      MDValueList.assignValue(
-          GET_OR_DISTINCT(DINamespace, Record[0],
-                          (Context, getMDOrNull(Record[1]),
-                           getMDOrNull(Record[2]), getMDString(Record[3]),
-                           Record[4])),
-          NextMDValueNo++);
-      break;
-    }
-    case bitc::METADATA_TEMPLATE_TYPE: {
-      if (Record.size() != 3)
-        return error("Invalid record");
+  case bitc::METADATA_FILE: {
+    if (Record.size() != 3)
+      return error("Invalid record");
 
-      MDValueList.assignValue(GET_OR_DISTINCT(DITemplateTypeParameter,
-                                              Record[0],
-                                              (Context, getMDString(Record[1]),
-                                               getMDOrNull(Record[2]))),
-                              NextMDValueNo++);
-      break;
-    }
-    case bitc::METADATA_TEMPLATE_VALUE: {
-      if (Record.size() != 5)
-        return error("Invalid record");
+    MDValueList.assignValue(
+        GET_OR_DISTINCT(DIFile, Record[0], (Context, getMDString(Record[1]),
+                                            getMDString(Record[2]))),
+        NextMDValueNo++);
+    break;
+  }
+  case bitc::METADATA_COMPILE_UNIT: {
+    if (Record.size() < 14 || Record.size() > 15)
+      return error("Invalid record");
 
-      MDValueList.assignValue(
-          GET_OR_DISTINCT(DITemplateValueParameter, Record[0],
-                          (Context, Record[1], getMDString(Record[2]),
-                           getMDOrNull(Record[3]), getMDOrNull(Record[4]))),
-          NextMDValueNo++);
-      break;
-    }
-    case bitc::METADATA_GLOBAL_VAR: {
-      if (Record.size() != 11)
-        return error("Invalid record");
+    MDValueList.assignValue(
+        GET_OR_DISTINCT(
+            DICompileUnit, Record[0],
+            (Context, Record[1], getMDOrNull(Record[2]),
+             getMDString(Record[3]), Record[4], getMDString(Record[5]),
+             Record[6], getMDString(Record[7]), Record[8],
+             getMDOrNull(Record[9]), getMDOrNull(Record[10]),
+             getMDOrNull(Record[11]), getMDOrNull(Record[12]),
+             getMDOrNull(Record[13]), Record.size() == 14 ? 0 : Record[14])),
+        NextMDValueNo++);
+    break;
+  }
+  case bitc::METADATA_SUBPROGRAM: {
+    if (Record.size() != 19)
+      return error("Invalid record");
 
-      MDValueList.assignValue(
-          GET_OR_DISTINCT(DIGlobalVariable, Record[0],
-                          (Context, getMDOrNull(Record[1]),
-                           getMDString(Record[2]), getMDString(Record[3]),
-                           getMDOrNull(Record[4]), Record[5],
-                           getMDOrNull(Record[6]), Record[7], Record[8],
-                           getMDOrNull(Record[9]), getMDOrNull(Record[10]))),
-          NextMDValueNo++);
-      break;
-    }
-    case bitc::METADATA_LOCAL_VAR: {
-      // 10th field is for the obseleted 'inlinedAt:' field.
-      if (Record.size() != 9 && Record.size() != 10)
-        return error("Invalid record");
+    MDValueList.assignValue(
+        GET_OR_DISTINCT(
+            DISubprogram, Record[0],
+            (Context, getMDOrNull(Record[1]), getMDString(Record[2]),
+             getMDString(Record[3]), getMDOrNull(Record[4]), Record[5],
+             getMDOrNull(Record[6]), Record[7], Record[8], Record[9],
+             getMDOrNull(Record[10]), Record[11], Record[12], Record[13],
+             Record[14], getMDOrNull(Record[15]), getMDOrNull(Record[16]),
+             getMDOrNull(Record[17]), getMDOrNull(Record[18]))),
+        NextMDValueNo++);
+    break;
+  }
+  case bitc::METADATA_LEXICAL_BLOCK: {
+    if (Record.size() != 5)
+      return error("Invalid record");
 
-      MDValueList.assignValue(
-          GET_OR_DISTINCT(DILocalVariable, Record[0],
-                          (Context, Record[1], getMDOrNull(Record[2]),
-                           getMDString(Record[3]), getMDOrNull(Record[4]),
-                           Record[5], getMDOrNull(Record[6]), Record[7],
-                           Record[8])),
-          NextMDValueNo++);
-      break;
-    }
-    case bitc::METADATA_EXPRESSION: {
-      if (Record.size() < 1)
-        return error("Invalid record");
+    MDValueList.assignValue(
+        GET_OR_DISTINCT(DILexicalBlock, Record[0],
+                        (Context, getMDOrNull(Record[1]),
+                         getMDOrNull(Record[2]), Record[3], Record[4])),
+        NextMDValueNo++);
+    break;
+  }
+  case bitc::METADATA_LEXICAL_BLOCK_FILE: {
+    if (Record.size() != 4)
+      return error("Invalid record");
 
-      MDValueList.assignValue(
-          GET_OR_DISTINCT(DIExpression, Record[0],
-                          (Context, makeArrayRef(Record).slice(1))),
-          NextMDValueNo++);
-      break;
-    }
-    case bitc::METADATA_OBJC_PROPERTY: {
-      if (Record.size() != 8)
-        return error("Invalid record");
+    MDValueList.assignValue(
+        GET_OR_DISTINCT(DILexicalBlockFile, Record[0],
+                        (Context, getMDOrNull(Record[1]),
+                         getMDOrNull(Record[2]), Record[3])),
+        NextMDValueNo++);
+    break;
+  }
+  case bitc::METADATA_NAMESPACE: {
+    if (Record.size() != 5)
+      return error("Invalid record");
 
-      MDValueList.assignValue(
-          GET_OR_DISTINCT(DIObjCProperty, Record[0],
-                          (Context, getMDString(Record[1]),
-                           getMDOrNull(Record[2]), Record[3],
-                           getMDString(Record[4]), getMDString(Record[5]),
-                           Record[6], getMDOrNull(Record[7]))),
-          NextMDValueNo++);
-      break;
-    }
-    case bitc::METADATA_IMPORTED_ENTITY: {
-      if (Record.size() != 6)
-        return error("Invalid record");
+    MDValueList.assignValue(
+        GET_OR_DISTINCT(DINamespace, Record[0],
+                        (Context, getMDOrNull(Record[1]),
+                         getMDOrNull(Record[2]), getMDString(Record[3]),
+                         Record[4])),
+        NextMDValueNo++);
+    break;
+  }
+  case bitc::METADATA_TEMPLATE_TYPE: {
+    if (Record.size() != 3)
+      return error("Invalid record");
 
-      MDValueList.assignValue(
-          GET_OR_DISTINCT(DIImportedEntity, Record[0],
-                          (Context, Record[1], getMDOrNull(Record[2]),
-                           getMDOrNull(Record[3]), Record[4],
-                           getMDString(Record[5]))),
-          NextMDValueNo++);
-      break;
-    }
-    case bitc::METADATA_STRING: {
-      std::string String(Record.begin(), Record.end());
-      llvm::UpgradeMDStringConstant(String);
-      Metadata *MD = MDString::get(Context, String);
-      MDValueList.assignValue(MD, NextMDValueNo++);
-      break;
-    }
-    case bitc::METADATA_KIND: {
-      if (Record.size() < 2)
-        return error("Invalid record");
+    MDValueList.assignValue(GET_OR_DISTINCT(DITemplateTypeParameter,
+                                            Record[0],
+                                            (Context, getMDString(Record[1]),
+                                             getMDOrNull(Record[2]))),
+                            NextMDValueNo++);
+    break;
+  }
+  case bitc::METADATA_TEMPLATE_VALUE: {
+    if (Record.size() != 5)
+      return error("Invalid record");
+
+    MDValueList.assignValue(
+        GET_OR_DISTINCT(DITemplateValueParameter, Record[0],
+                        (Context, Record[1], getMDString(Record[2]),
+                         getMDOrNull(Record[3]), getMDOrNull(Record[4]))),
+        NextMDValueNo++);
+    break;
+  }
+  case bitc::METADATA_GLOBAL_VAR: {
+    if (Record.size() != 11)
+      return error("Invalid record");
 
-      unsigned Kind = Record[0];
-      SmallString<8> Name(Record.begin()+1, Record.end());
+    MDValueList.assignValue(
+        GET_OR_DISTINCT(DIGlobalVariable, Record[0],
+                        (Context, getMDOrNull(Record[1]),
+                         getMDString(Record[2]), getMDString(Record[3]),
+                         getMDOrNull(Record[4]), Record[5],
+                         getMDOrNull(Record[6]), Record[7], Record[8],
+                         getMDOrNull(Record[9]), getMDOrNull(Record[10]))),
+        NextMDValueNo++);
+    break;
+  }
+  case bitc::METADATA_LOCAL_VAR: {
+    // 10th field is for the obseleted 'inlinedAt:' field.
+    if (Record.size() != 9 && Record.size() != 10)
+      return error("Invalid record");
 
-      unsigned NewKind = TheModule->getMDKindID(Name.str());
-      if (!MDKindMap.insert(std::make_pair(Kind, NewKind)).second)
-        return error("Conflicting METADATA_KIND records");
-      break;
-    }
-    }
+    MDValueList.assignValue(
+        GET_OR_DISTINCT(DILocalVariable, Record[0],
+                        (Context, Record[1], getMDOrNull(Record[2]),
+                         getMDString(Record[3]), getMDOrNull(Record[4]),
+                         Record[5], getMDOrNull(Record[6]), Record[7],
+                         Record[8])),
+        NextMDValueNo++);
+    break;
+  }
+  case bitc::METADATA_EXPRESSION: {
+    if (Record.size() < 1)
+      return error("Invalid record");
+
+    MDValueList.assignValue(
+        GET_OR_DISTINCT(DIExpression, Record[0],
+                        (Context, makeArrayRef(Record).slice(1))),
+        NextMDValueNo++);
+    break;
+  }
+  case bitc::METADATA_OBJC_PROPERTY: {
+    if (Record.size() != 8)
+      return error("Invalid record");
+
+    MDValueList.assignValue(
+        GET_OR_DISTINCT(DIObjCProperty, Record[0],
+                        (Context, getMDString(Record[1]),
+                         getMDOrNull(Record[2]), Record[3],
+                         getMDString(Record[4]), getMDString(Record[5]),
+                         Record[6], getMDOrNull(Record[7]))),
+        NextMDValueNo++);
+    break;
+  }
+  case bitc::METADATA_IMPORTED_ENTITY: {
+    if (Record.size() != 6)
+      return error("Invalid record");
+
+    MDValueList.assignValue(
+        GET_OR_DISTINCT(DIImportedEntity, Record[0],
+                        (Context, Record[1], getMDOrNull(Record[2]),
+                         getMDOrNull(Record[3]), Record[4],
+                         getMDString(Record[5]))),
+        NextMDValueNo++);
+    break;
+  }
+  case bitc::METADATA_STRING: {
+    std::string String(Record.begin(), Record.end());
+    llvm::UpgradeMDStringConstant(String);
+    Metadata *MD = MDString::get(Context, String);
+    MDValueList.assignValue(MD, NextMDValueNo++);
+    break;
+  }
+  case bitc::METADATA_KIND: {
+    if (Record.size() < 2)
+      return error("Invalid record");
+
+    unsigned Kind = Record[0];
+    SmallString<8> Name(Record.begin()+1, Record.end());
+
+    unsigned NewKind = TheModule->getMDKindID(Name.str());
+    if (!MDKindMap.insert(std::make_pair(Kind, NewKind)).second)
+      return error("Conflicting METADATA_KIND records");
+    break;
+  }
   }
 #undef GET_OR_DISTINCT
+  return LazyLoadEC;
+}
+
+/// Read the METADATA_INDEX that the METADATA_INDEX_OFFSET record in \p Record
+/// points to, and leave the stream right after it.
+std::error_code BitcodeReader::parseMetadataIndex(ArrayRef<uint64_t> Record) {
+  if (Record.size() != 2)
+    return error("Invalid record");
+
+  // The abbreviations of the block are all defined by now: keep a cursor to
+  // read the indexed records with.
+  MetadataCursor = Stream;
+
+  uint64_t Offset = Record[0] | (Record[1] << 32);
+  uint64_t BitPos = Stream.GetCurrentBitNo();
+  Stream.JumpToBit(BitPos + Offset);
+
+  BitstreamEntry Entry = Stream.advanceSkippingSubblocks();
+  if (Entry.Kind != BitstreamEntry::Record)
+    return error("Malformed block");
+
+  SmallVector<uint64_t, 64> Index;
+  if (Stream.readRecord(Entry.ID, Index) != bitc::METADATA_INDEX)
+    return error("METADATA_INDEX_OFFSET not pointing to a METADATA_INDEX");
+
+  // The first position is relative to the end of the METADATA_INDEX_OFFSET
+  // record, the next ones to the previous position.
+  MetadataIndex.reserve(Index.size());
+  for (uint64_t Delta : Index) {
+    BitPos += Delta;
+    MetadataIndex.push_back(BitPos);
+  }
+
+  // Function-local metadata is numbered after the module-level metadata.
+  MDValueList.resize(MetadataIndex.size());
+  return std::error_code();
+}
+
+/// Return true if the metadata with the given ID is in the index and has not
+/// been loaded yet.
+bool BitcodeReader::isLazyMetadataPending(unsigned ID) const {
+  return ID < MetadataIndex.size() &&
+         (!MDValueList[ID] || MDValueList.isFwdRef(ID));
+}
+
+/// Load the module-level metadata with the given ID from the index.
+std::error_code BitcodeReader::lazyLoadMetadata(unsigned ID) {
+  MetadataCursor.JumpToBit(MetadataIndex[ID]);
+  BitstreamEntry Entry = MetadataCursor.advanceSkippingSubblocks();
+  if (Entry.Kind != BitstreamEntry::Record)
+    return error("Malformed block");
+
+  SmallVector<uint64_t, 64> Record;
+  unsigned Code = MetadataCursor.readRecord(Entry.ID, Record);
+  // Named metadata is not indexed, and is the only record to read more than
+  // one record.
+  if (Code == bitc::METADATA_NAME)
+    return error("Invalid metadata index");
+
+  unsigned NextMDValueNo = ID;
+  if (std::error_code EC = parseMetadataRecord(Code, Record, NextMDValueNo))
+    return EC;
+  if (NextMDValueNo != ID + 1)
+    return error("Invalid metadata index");
+  return std::error_code();
+}
+
+/// Load the module-level metadata that is forward referenced, including the
+/// metadata that the loaded nodes reference in turn, and resolve the cycles.
+std::error_code BitcodeReader::resolveLazyMetadata() {
+  // Loading a node adds new forward references for its operands, so this is
+  // a worklist.
+  for (unsigned I = 0; I != MDValueList.getFwdRefIDs().size(); ++I) {
+    unsigned ID = MDValueList.getFwdRefIDs()[I];
+    if (!isLazyMetadataPending(ID))
+      continue;
+    if (std::error_code EC = lazyLoadMetadata(ID))
+      return EC;
+  }
+
+  MDValueList.tryToResolveCycles();
+  return std::error_code();
 }
 
 /// Decode a signed value stored with the sign bit in the LSB for dense VBR
@@ -2675,7 +2809,16 @@ std::error_code BitcodeReader::materializeMetadata() {
       return EC;
   }
   DeferredMetadataInfo.clear();
-  return std::error_code();
+
+  if (MetadataIndex.empty())
+    return std::error_code();
+
+  // Load the indexed metadata that was not needed so far.
+  for (unsigned ID = 0, E = MetadataIndex.size(); ID != E; ++ID)
+    if (isLazyMetadataPending(ID))
+      if (std::error_code EC = lazyLoadMetadata(ID))
+        return EC;
+  return resolveLazyMetadata();
 }
 
 void BitcodeReader::setStripDebugInfo() { StripDebugInfo = true; }
@@ -3107,8 +3250,11 @@ std::error_code BitcodeReader::parseModule(bool Resume,
 
 std::error_code
 BitcodeReader::parseBitcodeInto(std::unique_ptr<DataStreamer> Streamer,
-                                Module *M, bool ShouldLazyLoadMetadata) {
+                                Module *M, bool ShouldLazyLoadMetadata,
+                                bool UseMetadataIndex) {
   TheModule = M;
+  // Jumping around the index would defeat streaming.
+  this->UseMetadataIndex = UseMetadataIndex && !Streamer;
 
   if (std::error_code EC = initStream(std::move(Streamer)))
     return EC;
@@ -4430,14 +4576,18 @@ std::error_code BitcodeReader::findFunctionInStream(
 void BitcodeReader::releaseBuffer() { Buffer.release(); }
 
 std::error_code BitcodeReader::materialize(GlobalValue *GV) {
-  if (std::error_code EC = materializeMetadata())
-    return EC;
+  // With an index, only the metadata referenced by the function is loaded,
+  // after its body.
+  if (MetadataIndex.empty())
+    if (std::error_code EC = materializeMetadata())
+      return EC;
 
   Function *F = dyn_cast<Function>(GV);
   // If it's not a function or is already material, ignore the request.
   if (!F || !F->isMaterializable())
     return std::error_code();
 
+  TimeTraceScope TraceScope("Materialize function", F->getName());
   DenseMap<Function*, uint64_t>::iterator DFII = DeferredFunctionInfo.find(F);
   assert(DFII != DeferredFunctionInfo.end() && "Deferred function not found!");
   // If its position is recorded as 0, its body is somewhere in the stream
@@ -4453,6 +4603,10 @@ std::error_code BitcodeReader::materialize(GlobalValue *GV) {
     return EC;
   F->setIsMaterializable(false);
 
+  if (!MetadataIndex.empty())
+    if (std::error_code EC = resolveLazyMetadata())
+      return EC;
+
   if (StripDebugInfo)
     stripDebugInfo(*F);
 
@@ -4610,6 +4764,182 @@ BitcodeReader::initLazyStream(std::unique_ptr<DataStreamer> Streamer) {
   return std::error_code();
 }
 
+//===----------------------------------------------------------------------===//
+// Function summary reader
+//===----------------------------------------------------------------------===//
+
+namespace {
+/// Reader for the function summary block. It skips the module block entirely,
+/// and therefore needs neither an LLVMContext nor a Module.
+class FunctionIndexBitcodeReader {
+  DiagnosticHandlerFunction DiagnosticHandler;
+  MemoryBufferRef Buffer;
+  std::unique_ptr<BitstreamReader> StreamFile;
+  BitstreamCursor Stream;
+
+  std::error_code error(const Twine &Message);
+  std::error_code initStream();
+  std::error_code parseSummaryBlock(FunctionInfoIndex &Index);
+
+public:
+  FunctionIndexBitcodeReader(MemoryBufferRef Buffer,
+                             DiagnosticHandlerFunction DiagnosticHandler)
+      : DiagnosticHandler(DiagnosticHandler), Buffer(Buffer) {}
+
+  /// Look for the function summary block, and parse it into \p Index unless
+  /// \p Index is null. \p Found is set if the block was found.
+  std::error_code parse(FunctionInfoIndex *Index, bool &Found);
+};
+}
+
+std::error_code FunctionIndexBitcodeReader::error(const Twine &Message) {
+  std::error_code EC = make_error_code(BitcodeError::CorruptedBitcode);
+  if (!DiagnosticHandler)
+    return EC;
+  return ::error(DiagnosticHandler, EC, Message);
+}
+
+std::error_code FunctionIndexBitcodeReader::initStream() {
+  const unsigned char *BufPtr = (const unsigned char *)Buffer.getBufferStart();
+  const unsigned char *BufEnd = BufPtr + Buffer.getBufferSize();
+
+  if (Buffer.getBufferSize() & 3)
+    return error("Invalid bitcode signature");
+
+  // If we have a wrapper header, parse it and ignore the non-bc file contents.
+  if (isBitcodeWrapper(BufPtr, BufEnd))
+    if (SkipBitcodeWrapperHeader(BufPtr, BufEnd, true))
+      return error("Invalid bitcode wrapper header");
+
+  StreamFile.reset(new BitstreamReader(BufPtr, BufEnd));
+  Stream.init(&*StreamFile);
+
+  // Sniff for the signature.
+  if (Stream.Read(8) != 'B' ||
+      Stream.Read(8) != 'C' ||
+      Stream.Read(4) != 0x0 ||
+      Stream.Read(4) != 0xC ||
+      Stream.Read(4) != 0xE ||
+      Stream.Read(4) != 0xD)
+    return error("Invalid bitcode signature");
+
+  return std::error_code();
+}
+
+std::error_code
+FunctionIndexBitcodeReader::parseSummaryBlock(FunctionInfoIndex &Index) {
+  if (Stream.EnterSubBlock(bitc::FUNCTION_SUMMARY_BLOCK_ID))
+    return error("Invalid record");
+
+  std::vector<std::string> Symbols;
+  std::vector<StringRef> ModulePaths;
+  SmallVector<uint64_t, 64> Record;
+
+  while (1) {
+    BitstreamEntry Entry = Stream.advanceSkippingSubblocks();
+
+    switch (Entry.Kind) {
+    case BitstreamEntry::SubBlock: // Handled for us already.
+    case BitstreamEntry::Error:
+      return error("Malformed block");
+    case BitstreamEntry::EndBlock:
+      return std::error_code();
+    case BitstreamEntry::Record:
+      // The interesting case.
+      break;
+    }
+
+    // Read a record.
+    Record.clear();
+    switch (Stream.readRecord(Entry.ID, Record)) {
+    default: // Default behavior: ignore.
+      break;
+    case bitc::FS_CODE_SYMBOL: { // SYMBOL: [strchr x N]
+      std::string S;
+      if (convertToString(Record, 0, S))
+        return error("Invalid record");
+      Symbols.push_back(std::move(S));
+      break;
+    }
+    case bitc::FS_CODE_MODULE_PATH: { // MODULE_PATH: [strchr x N]
+      std::string S;
+      if (convertToString(Record, 0, S))
+        return error("Invalid record");
+      ModulePaths.push_back(Index.addModulePath(S));
+      break;
+    }
+    // ENTRY: [symbolid, modulepathid, linkage, instcount, flags,
+    //         n x (calleesymbolid, numcalls)]
+    case bitc::FS_CODE_ENTRY: {
+      if (Record.size() < 5 || (Record.size() - 5) % 2)
+        return error("Invalid record");
+      if (Record[0] >= Symbols.size())
+        return error("Invalid symbol id");
+
+      // The summaries of a module do not come with module paths: they belong
+      // to the module read from this buffer.
+      StringRef ModulePath;
+      if (ModulePaths.empty() && Record[1] == 0)
+        ModulePath = Buffer.getBufferIdentifier();
+      else if (Record[1] < ModulePaths.size())
+        ModulePath = ModulePaths[Record[1]];
+      else
+        return error("Invalid module path id");
+
+      auto Summary = llvm::make_unique<FunctionSummary>(
+          getDecodedLinkage(Record[2]), Record[3], Record[4] & 1);
+      for (unsigned I = 5, E = Record.size(); I != E; I += 2) {
+        if (Record[I] >= Symbols.size())
+          return error("Invalid symbol id");
+        Summary->addCall(Symbols[Record[I]], Record[I + 1]);
+      }
+      Index.addFunctionSummary(Symbols[Record[0]], ModulePath,
+                               std::move(Summary));
+      break;
+    }
+    }
+  }
+}
+
+std::error_code FunctionIndexBitcodeReader::parse(FunctionInfoIndex *Index,
+                                                  bool &Found) {
+  Found = false;
+  if (std::error_code EC = initStream())
+    return EC;
+
+  // The summary block is a top-level block, usually following the module.
+  while (!Stream.AtEndOfStream()) {
+    BitstreamEntry Entry =
+        Stream.advance(BitstreamCursor::AF_DontAutoprocessAbbrevs);
+
+    switch (Entry.Kind) {
+    case BitstreamEntry::Error:
+      return error("Malformed block");
+    case BitstreamEntry::EndBlock:
+      // Trailing padding.
+      return std::error_code();
+
+    case BitstreamEntry::SubBlock:
+      if (Entry.ID == bitc::FUNCTION_SUMMARY_BLOCK_ID) {
+        Found = true;
+        if (!Index)
+          return std::error_code();
+        return parseSummaryBlock(*Index);
+      }
+
+      // Ignore other sub-blocks.
+      if (Stream.SkipBlock())
+        return error("Malformed block");
+      continue;
+
+    case BitstreamEntry::Record:
+      Stream.skipRecord(Entry.ID);
+      continue;
+    }
+  }
+  return std::error_code();
+}
+
 namespace {
 class BitcodeErrorCategoryType : public std::error_category {
   const char *name() const LLVM_NOEXCEPT override {
@@ -4650,9 +4980,13 @@ getBitcodeModuleImpl(std::unique_ptr<DataStreamer> Streamer, StringRef Name,
     return EC;
   };
 
-  // Delay parsing Metadata if ShouldLazyLoadMetadata is true.
-  if (std::error_code EC = R->parseBitcodeInto(std::move(Streamer), M.get(),
-                                               ShouldLazyLoadMetadata))
+  // Delay parsing Metadata if ShouldLazyLoadMetadata is true. Otherwise, when
+  // functions are materialized one at a time, only load the metadata they
+  // need.
+  if (std::error_code EC =
+          R->parseBitcodeInto(std::move(Streamer), M.get(),
+                              ShouldLazyLoadMetadata,
+                              !MaterializeAll && !ShouldLazyLoadMetadata))
     return cleanupOnError(EC);
 
   if (MaterializeAll) {
@@ -4680,6 +5014,7 @@ getLazyBitcodeModuleImpl(std::unique_ptr<MemoryBuffer> &&Buffer,
                          LLVMContext &Context, bool MaterializeAll,
                          DiagnosticHandlerFunction DiagnosticHandler,
                          bool ShouldLazyLoadMetadata = false) {
+  TimeTraceScope TraceScope("Read bitcode", Buffer->getBufferIdentifier());
   BitcodeReader *R =
       new BitcodeReader(Buffer.get(), Context, DiagnosticHandler);
 
@@ -4731,3 +5066,29 @@ llvm::getBitcodeTargetTriple(MemoryBufferRef Buffer, LLVMContext &Context,
     return "";
   return Triple.get();
 }
+
+bool llvm::hasFunctionSummary(MemoryBufferRef Buffer,
+                              DiagnosticHandlerFunction DiagnosticHandler) {
+  FunctionIndexBitcodeReader R(Buffer, DiagnosticHandler);
+  bool Found;
+  if (R.parse(nullptr, Found))
+    return false;
+  return Found;
+}
+
+ErrorOr<std::unique_ptr<FunctionInfoIndex>>
+llvm::getFunctionInfoIndex(MemoryBufferRef Buffer,
+                           DiagnosticHandlerFunction DiagnosticHandler) {
+  FunctionIndexBitcodeReader R(Buffer, DiagnosticHandler);
+  auto Index = llvm::make_unique<FunctionInfoIndex>();
+  bool Found;
+  if (std::error_code EC = R.parse(Index.get(), Found))
+    return EC;
+  if (!Found) {
+    std::error_code EC = make_error_code(BitcodeError::CorruptedBitcode);
+    if (DiagnosticHandler)
+      return error(DiagnosticHandler, EC, "No function summary block");
+    return EC;
+  }
+  return std::move(Index);
+}
@@ -19,6 +19,7 @@
 #include "llvm/IR/Constants.h"
 #include "llvm/IR/DebugInfoMetadata.h"
 #include "llvm/IR/DerivedTypes.h"
+#include "llvm/IR/FunctionInfo.h"
 #include "llvm/IR/InlineAsm.h"
 #include "llvm/IR/Instructions.h"
 #include "llvm/IR/Module.h"
@@ -30,10 +31,16 @@
 #include "llvm/Support/MathExtras.h"
 #include "llvm/Support/Program.h"
 #include "llvm/Support/raw_ostream.h"
+#include <algorithm>
 #include <cctype>
 #include <map>
 using namespace llvm;
 
+static cl::opt<unsigned>
+    MDIndexThreshold("bitcode-mdindex-threshold", cl::Hidden, cl::init(25),
+                     cl::desc("Number of module-level metadata above which "
+                              "an index is emitted to allow lazy loading"));
+
 /// These are manifest constants used by the bitcode writer. They do not need to
 /// be kept in sync with the reader, but need to be consistent within this file.
 enum {
@@ -483,8 +490,8 @@ static void WriteTypeTable(const ValueEnumerator &VE, BitstreamWriter &Stream) {
   Stream.ExitBlock();
 }
 
-static unsigned getEncodedLinkage(const GlobalValue &GV) {
-  switch (GV.getLinkage()) {
+static unsigned getEncodedLinkage(GlobalValue::LinkageTypes Linkage) {
+  switch (Linkage) {
   case GlobalValue::ExternalLinkage:
     return 0;
   case GlobalValue::WeakAnyLinkage:
@@ -511,6 +518,10 @@ static unsigned getEncodedLinkage(const GlobalValue &GV) {
   llvm_unreachable("Invalid linkage");
 }
 
+static unsigned getEncodedLinkage(const GlobalValue &GV) {
+  return getEncodedLinkage(GV.getLinkage());
+}
+
 static unsigned getEncodedVisibility(const GlobalValue &GV) {
   switch (GV.getVisibility()) {
   case GlobalValue::DefaultVisibility:   return 0;
@@ -1165,7 +1176,9 @@ static void WriteModuleMetadata(const Module *M,
   if (MDs.empty() && M->named_metadata_empty())
     return;
 
-  Stream.EnterSubblock(bitc::METADATA_BLOCK_ID, 3);
+  // The index needs one more abbrev, which may not fit in 3 bits.
+  bool EmitIndex = MDs.size() >= MDIndexThreshold;
+  Stream.EnterSubblock(bitc::METADATA_BLOCK_ID, EmitIndex ? 4 : 3);
 
   unsigned MDSAbbrev = 0;
   if (VE.hasMDString()) {
@@ -1222,8 +1235,36 @@ static void WriteModuleMetadata(const Module *M,
     NameAbbrev = Stream.EmitAbbrev(Abbv);
   }
 
+  // METADATA_INDEX_OFFSET - [offset low 32 bits, offset high 32 bits]
+  //
+  // With enough metadata, emit the offset of the METADATA_INDEX record from
+  // the end of this record, so that a lazy reader can jump straight to the
+  // index. It is backpatched once the index is written. Both fields are fixed
+  // width, so that the placeholder has the size of the final value.
+  uint64_t IndexOffsetRecordBitPos = 0;
+  if (EmitIndex) {
+    BitCodeAbbrev *Abbv = new BitCodeAbbrev();
+    Abbv->Add(BitCodeAbbrevOp(bitc::METADATA_INDEX_OFFSET));
+    Abbv->Add(BitCodeAbbrevOp(BitCodeAbbrevOp::Fixed, 32));
+    Abbv->Add(BitCodeAbbrevOp(BitCodeAbbrevOp::Fixed, 32));
+    unsigned IndexOffsetAbbrev = Stream.EmitAbbrev(Abbv);
+
+    // All the abbrevs used by the records of the index are defined above, as
+    // a lazy reader does not see the records in between.
+    SmallVector<uint64_t, 2> Vals(2, uint64_t(0));
+    Stream.EmitRecord(bitc::METADATA_INDEX_OFFSET, Vals, IndexOffsetAbbrev);
+    IndexOffsetRecordBitPos = Stream.GetCurrentBitNo();
+  }
+
+  // The bit position of the record of each metadata, in ID order.
+  std::vector<uint64_t> IndexPos;
+  if (EmitIndex)
+    IndexPos.reserve(MDs.size());
+
   SmallVector<uint64_t, 64> Record;
   for (const Metadata *MD : MDs) {
+    if (EmitIndex)
+      IndexPos.push_back(Stream.GetCurrentBitNo());
     if (const MDNode *N = dyn_cast<MDNode>(MD)) {
       assert(N->isResolved() && "Expected forward references to be resolved");
 
@@ -1250,7 +1291,28 @@ static void WriteModuleMetadata(const Module *M,
     Record.clear();
   }
 
-  // Write named metadata.
+  if (EmitIndex) {
+    // METADATA_INDEX - [n x bitpos delta]
+    //
+    // The first position is relative to the end of the METADATA_INDEX_OFFSET
+    // record, the next ones to the previous position.
+    uint64_t PrevPos = IndexOffsetRecordBitPos;
+    for (uint64_t Pos : IndexPos) {
+      Record.push_back(Pos - PrevPos);
+      PrevPos = Pos;
+    }
+
+    uint64_t IndexPosBitNo = Stream.GetCurrentBitNo();
+    Stream.EmitRecord(bitc::METADATA_INDEX, Record);
+    Record.clear();
+
+    // Now that the index is written, patch its offset, which is held by the
+    // last 64 bits of the METADATA_INDEX_OFFSET record.
+    Stream.BackpatchWord64(IndexOffsetRecordBitPos - 64,
+                           IndexPosBitNo - IndexOffsetRecordBitPos);
+  }
+
+  // Write named metadata. A lazy reader reads them right after the index.
   for (const NamedMDNode &NMD : M->named_metadata()) {
     // Write name.
     StringRef Str = NMD.getName();
@@ -2397,6 +2459,82 @@ static void WriteModule(const Module *M, BitstreamWriter &Stream,
   Stream.ExitBlock();
 }
 
+/// WriteFunctionSummaryBlock - Emit the summaries of \p Index. Module paths are
+/// only emitted if \p WriteModulePaths is set: the summaries of a per-module
+/// index implicitly belong to the module they are emitted with.
+static void WriteFunctionSummaryBlock(const FunctionInfoIndex &Index,
+                                      bool WriteModulePaths,
+                                      BitstreamWriter &Stream) {
+  Stream.EnterSubblock(bitc::FUNCTION_SUMMARY_BLOCK_ID, 3);
+
+  // Abbrevs for the names made of char6 characters only. WriteStringRecord
+  // falls back to an unabbreviated record for the other ones.
+  BitCodeAbbrev *Abbv = new BitCodeAbbrev();
+  Abbv->Add(BitCodeAbbrevOp(bitc::FS_CODE_SYMBOL));
+  Abbv->Add(BitCodeAbbrevOp(BitCodeAbbrevOp::Array));
+  Abbv->Add(BitCodeAbbrevOp(BitCodeAbbrevOp::Char6));
+  unsigned SymbolAbbrev = Stream.EmitAbbrev(Abbv);
+
+  Abbv = new BitCodeAbbrev();
+  Abbv->Add(BitCodeAbbrevOp(bitc::FS_CODE_MODULE_PATH));
+  Abbv->Add(BitCodeAbbrevOp(BitCodeAbbrevOp::Array));
+  Abbv->Add(BitCodeAbbrevOp(BitCodeAbbrevOp::Char6));
+  unsigned ModulePathAbbrev = Stream.EmitAbbrev(Abbv);
+
+  // Emit the module paths in the order of their ids.
+  if (WriteModulePaths) {
+    std::vector<StringRef> Paths(Index.modulePaths().size());
+    for (auto &Entry : Index.modulePaths())
+      Paths[Entry.second] = Entry.first();
+    for (StringRef Path : Paths)
+      WriteStringRecord(bitc::FS_CODE_MODULE_PATH, Path, ModulePathAbbrev,
+                        Stream);
+  }
+
+  // Sort the functions by name to get a deterministic output.
+  std::vector<StringRef> Names;
+  for (auto &Entry : Index)
+    Names.push_back(Entry.first());
+  std::sort(Names.begin(), Names.end());
+
+  // Assign symbol ids lazily, emitting each symbol the first time it is used.
+  StringMap<unsigned> SymbolIds;
+  auto getSymbolId = [&](StringRef Name) {
+    auto Inserted = SymbolIds.insert(std::make_pair(Name, SymbolIds.size()));
+    if (Inserted.second)
+      WriteStringRecord(bitc::FS_CODE_SYMBOL, Name, SymbolAbbrev, Stream);
+    return Inserted.first->second;
+  };
+
+  SmallVector<uint64_t, 64> Vals;
+  for (StringRef Name : Names) {
+    for (auto &Summary : *Index.findFunctionSummaries(Name)) {
+      // Emit the symbols used by the entry before the entry itself.
+      for (auto &Call : Summary->calls())
+        getSymbolId(Call.Callee);
+
+      // ENTRY: [symbolid, modulepathid, linkage, instcount, flags,
+      //         n x (calleesymbolid, numcalls)]
+      Vals.push_back(getSymbolId(Name));
+      Vals.push_back(
+          WriteModulePaths
+              ? Index.modulePaths().lookup(Summary->modulePath())
+              : 0);
+      Vals.push_back(getEncodedLinkage(Summary->linkage()));
+      Vals.push_back(Summary->instCount());
+      Vals.push_back(Summary->isEligibleToImport() ? 1 : 0);
+      for (auto &Call : Summary->calls()) {
+        Vals.push_back(SymbolIds[Call.Callee]);
+        Vals.push_back(Call.NumCalls);
+      }
+      Stream.EmitRecord(bitc::FS_CODE_ENTRY, Vals);
+      Vals.clear();
+    }
+  }
+
+  Stream.ExitBlock();
+}
+
 /// EmitDarwinBCHeader - If generating a bc file on darwin, we have to emit a
 /// header and trailer to make it compatible with the system archiver.  To do
 /// this we emit the following header, and then emit a trailer that pads the
@@ -2470,7 +2608,8 @@ static void EmitDarwinBCHeaderAndTrailer(SmallVectorImpl<char> &Buffer,
 /// WriteBitcodeToFile - Write the specified module to the specified output
 /// stream.
 void llvm::WriteBitcodeToFile(const Module *M, raw_ostream &Out,
-                              bool ShouldPreserveUseListOrder) {
+                              bool ShouldPreserveUseListOrder,
+                              bool EmitFunctionSummary) {
   SmallVector<char, 0> Buffer;
   Buffer.reserve(256*1024);
 
@@ -2494,6 +2633,11 @@ void llvm::WriteBitcodeToFile(const Module *M, raw_ostream &Out,
 
     // Emit the module.
     WriteModule(M, Stream, ShouldPreserveUseListOrder);
+
+    // Emit the function summaries after the module, where they are skipped
+    // by readers only interested in the module.
+    if (EmitFunctionSummary)
+      WriteFunctionSummaryBlock(*buildFunctionInfoIndex(*M), false, Stream);
   }
 
   if (TT.isOSDarwin())
@@ -2502,3 +2646,27 @@ void llvm::WriteBitcodeToFile(const Module *M, raw_ostream &Out,
   // Write the generated bitstream to "Out".
   Out.write((char*)&Buffer.front(), Buffer.size());
 }
+
+/// WriteFunctionSummaryToFile - Write the specified index to the specified
+/// output stream.
+void llvm::WriteFunctionSummaryToFile(const FunctionInfoIndex &Index,
+                                      raw_ostream &Out) {
+  SmallVector<char, 0> Buffer;
+  Buffer.reserve(64*1024);
+
+  {
+    BitstreamWriter Stream(Buffer);
+
+    // Emit the file header.
+    Stream.Emit((unsigned)'B', 8);
+    Stream.Emit((unsigned)'C', 8);
+    Stream.Emit(0x0, 4);
+    Stream.Emit(0xC, 4);
+    Stream.Emit(0xE, 4);
+    Stream.Emit(0xD, 4);
+
+    WriteFunctionSummaryBlock(Index, true, Stream);
+  }
+
+  Out.write((char*)&Buffer.front(), Buffer.size());
+}
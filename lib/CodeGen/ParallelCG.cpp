@@ -0,0 +1,102 @@
+//===-- ParallelCG.cpp ----------------------------------------------------===//
+//
+//                     The LLVM Compiler Infrastructure
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+//
+// This file defines functions that can be used for parallel code generation.
+//
+//===----------------------------------------------------------------------===//
+
+#include "llvm/CodeGen/ParallelCG.h"
+#include "llvm/ADT/SmallString.h"
+#include "llvm/Bitcode/ReaderWriter.h"
+#include "llvm/IR/LLVMContext.h"
+#include "llvm/IR/LegacyPassManager.h"
+#include "llvm/IR/Module.h"
+#include "llvm/Support/ErrorHandling.h"
+#include "llvm/Support/MemoryBuffer.h"
+#include "llvm/Support/TargetRegistry.h"
+#include "llvm/Support/ThreadPool.h"
+#include "llvm/Support/TimeTrace.h"
+#include "llvm/Target/TargetMachine.h"
+#include "llvm/Transforms/Utils/SplitModule.h"
+#include <atomic>
+
+using namespace llvm;
+
+static bool codegen(Module &M, TargetMachine &TM, raw_pwrite_stream &OS,
+                    TargetMachine::CodeGenFileType FT) {
+  TimeTraceScope TraceScope("Code generation", M.getModuleIdentifier());
+  legacy::PassManager CodeGenPasses;
+  if (TM.addPassesToEmitFile(CodeGenPasses, OS, FT))
+    return false;
+  CodeGenPasses.run(M);
+  return true;
+}
+
+bool llvm::splitCodeGen(Module &M, ArrayRef<raw_pwrite_stream *> OSs,
+                        StringRef CPU, StringRef Features,
+                        const TargetOptions &Options, std::string &ErrMsg,
+                        Reloc::Model RM, CodeModel::Model CM,
+                        CodeGenOpt::Level OL,
+                        TargetMachine::CodeGenFileType FT) {
+  assert(!OSs.empty() && "Expected at least one output stream");
+  StringRef TripleStr = M.getTargetTriple();
+  const Target *TheTarget = TargetRegistry::lookupTarget(TripleStr, ErrMsg);
+  if (!TheTarget)
+    return false;
+
+  if (OSs.size() == 1) {
+    std::unique_ptr<TargetMachine> TM(TheTarget->createTargetMachine(
+        TripleStr, CPU, Features, Options, RM, CM, OL));
+    if (!codegen(M, *TM, *OSs[0], FT)) {
+      ErrMsg = "target file type not supported";
+      return false;
+    }
+    return true;
+  }
+
+  // Serialize each partition to bitcode: the partitions are read back into
+  // their own LLVMContext on the worker threads, since an LLVMContext cannot
+  // be shared between threads.
+  std::vector<SmallString<0>> Partitions;
+  Partitions.reserve(OSs.size());
+  {
+    TimeTraceScope TraceScope("Split module", M.getModuleIdentifier());
+    SplitModule(M, OSs.size(), [&](std::unique_ptr<Module> MPart) {
+      Partitions.emplace_back();
+      raw_svector_ostream BCOS(Partitions.back());
+      WriteBitcodeToFile(MPart.get(), BCOS);
+      BCOS.flush();
+    });
+  }
+
+  std::atomic<bool> Failed(false);
+  ThreadPool Pool(OSs.size());
+  for (unsigned I = 0, E = OSs.size(); I != E; ++I) {
+    Pool.async([&, I]() {
+      LLVMContext Ctx;
+      ErrorOr<std::unique_ptr<Module>> MOrErr = parseBitcodeFile(
+          MemoryBufferRef(Partitions[I], "<split-module>"), Ctx);
+      if (!MOrErr)
+        report_fatal_error("Failed to read bitcode");
+      std::unique_ptr<Module> MPartInCtx = std::move(MOrErr.get());
+
+      std::unique_ptr<TargetMachine> TM(TheTarget->createTargetMachine(
+          TripleStr, CPU, Features, Options, RM, CM, OL));
+      if (!codegen(*MPartInCtx, *TM, *OSs[I], FT))
+        Failed = true;
+    });
+  }
+  Pool.wait();
+
+  if (Failed) {
+    ErrMsg = "target file type not supported";
+    return false;
+  }
+  return true;
+}
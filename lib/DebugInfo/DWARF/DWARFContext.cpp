@@ -419,6 +419,46 @@ DILineInfo DWARFContext::getLineInfoForAddress(uint64_t Address,
   return Result;
 }
 
+std::vector<DILineInfo>
+DWARFContext::getLineInfoForAddresses(ArrayRef<uint64_t> Addresses,
+                                      DILineInfoSpecifier Spec) {
+  std::vector<DILineInfo> Result(Addresses.size());
+
+  // Visit the addresses in ascending order, so that the addresses of a
+  // compile unit are looked up together, and duplicates only once.
+  std::vector<uint32_t> Order(Addresses.size());
+  for (uint32_t I = 0, E = Addresses.size(); I != E; ++I)
+    Order[I] = I;
+  std::sort(Order.begin(), Order.end(), [&](uint32_t LHS, uint32_t RHS) {
+    return Addresses[LHS] < Addresses[RHS];
+  });
+
+  DWARFCompileUnit *PrevCU = nullptr;
+  const DWARFLineTable *LineTable = nullptr;
+  for (uint32_t I = 0, E = Order.size(); I != E; ++I) {
+    uint64_t Address = Addresses[Order[I]];
+    DILineInfo &Info = Result[Order[I]];
+    if (I && Addresses[Order[I - 1]] == Address) {
+      Info = Result[Order[I - 1]];
+      continue;
+    }
+    DWARFCompileUnit *CU = getCompileUnitForAddress(Address);
+    if (!CU)
+      continue;
+    if (CU != PrevCU) {
+      PrevCU = CU;
+      LineTable = Spec.FLIKind != FileLineInfoKind::None
+                      ? getLineTableForUnit(CU)
+                      : nullptr;
+    }
+    getFunctionNameForAddress(CU, Address, Spec.FNKind, Info.FunctionName);
+    if (LineTable)
+      LineTable->getFileLineInfoForAddress(Address, CU->getCompilationDir(),
+                                           Spec.FLIKind, Info);
+  }
+  return Result;
+}
+
 DILineInfoTable
 DWARFContext::getLineInfoForAddressRange(uint64_t Address, uint64_t Size,
                                          DILineInfoSpecifier Spec) {
@@ -55,6 +55,14 @@ void DWARFDebugAranges::generate(DWARFContext *CTX) {
       for (const auto &R : CURanges) {
         appendRange(CUOffset, R.first, R.second);
       }
+      // If the DIEs do not describe the code of the unit either, e.g. when
+      // they are in an unavailable .dwo file, fall back to the sequences of
+      // its line table.
+      if (CURanges.empty()) {
+        if (const auto *LineTable = CTX->getLineTableForUnit(CU.get()))
+          for (const auto &Seq : LineTable->Sequences)
+            appendRange(CUOffset, Seq.LowPC, Seq.HighPC);
+      }
     }
   }
 
@@ -12,7 +12,9 @@
 #include "llvm/DebugInfo/DWARF/DWARFFormValue.h"
 #include "llvm/Support/Dwarf.h"
 #include "llvm/Support/Path.h"
+#include <algorithm>
 #include <cstdio>
+#include <set>
 
 using namespace llvm;
 using namespace dwarf;
@@ -304,6 +306,8 @@ void DWARFUnit::clearDIEs(bool KeepCUDie) {
     if (KeepCUDie)
       DieArray.push_back(TmpArray.front());
   }
+  SubprogramRanges.clear();
+  SubprogramRangesBuilt = false;
 }
 
 void DWARFUnit::collectAddressRanges(DWARFAddressRangesVector &CURanges) {
@@ -339,16 +343,69 @@ void DWARFUnit::collectAddressRanges(DWARFAddressRangesVector &CURanges) {
     clearDIEs(true);
 }
 
+void DWARFUnit::buildSubprogramRanges() {
+  struct RangeEndpoint {
+    uint64_t Address;
+    uint32_t DIEIndex;
+    bool IsRangeStart;
+    bool operator<(const RangeEndpoint &Other) const {
+      return Address < Other.Address;
+    }
+  };
+  std::vector<RangeEndpoint> Endpoints;
+  for (uint32_t I = 0, E = DieArray.size(); I != E; ++I) {
+    const DWARFDebugInfoEntryMinimal &DIE = DieArray[I];
+    if (!DIE.isSubprogramDIE())
+      continue;
+    for (const auto &R : DIE.getAddressRanges(this)) {
+      if (R.first >= R.second)
+        continue;
+      Endpoints.push_back({R.first, I, true});
+      Endpoints.push_back({R.second, I, false});
+    }
+  }
+
+  // Like DWARFDebugAranges::construct(), split the overlapping ranges, and
+  // map each piece to the first subprogram in the DIE order, which is the one
+  // a linear scan of the DIEs would find.
+  std::sort(Endpoints.begin(), Endpoints.end());
+  std::multiset<uint32_t> ValidDIEs;
+  uint64_t PrevAddress = 0;
+  for (const auto &E : Endpoints) {
+    if (!ValidDIEs.empty() && PrevAddress < E.Address) {
+      uint32_t DIEIndex = *ValidDIEs.begin();
+      if (!SubprogramRanges.empty() &&
+          SubprogramRanges.back().HighPC == PrevAddress &&
+          SubprogramRanges.back().DIEIndex == DIEIndex)
+        SubprogramRanges.back().HighPC = E.Address;
+      else
+        SubprogramRanges.push_back({PrevAddress, E.Address, DIEIndex});
+    }
+    if (E.IsRangeStart)
+      ValidDIEs.insert(E.DIEIndex);
+    else
+      ValidDIEs.erase(ValidDIEs.find(E.DIEIndex));
+    PrevAddress = E.Address;
+  }
+  SubprogramRangesBuilt = true;
+}
+
 const DWARFDebugInfoEntryMinimal *
 DWARFUnit::getSubprogramForAddress(uint64_t Address) {
   extractDIEsIfNeeded(false);
-  for (const DWARFDebugInfoEntryMinimal &DIE : DieArray) {
-    if (DIE.isSubprogramDIE() &&
-        DIE.addressRangeContainsAddress(this, Address)) {
-      return &DIE;
-    }
-  }
-  return nullptr;
+  if (!SubprogramRangesBuilt)
+    buildSubprogramRanges();
+  auto It = std::upper_bound(
+      SubprogramRanges.begin(), SubprogramRanges.end(), Address,
+      [](uint64_t Address, const SubprogramRange &R) {
+        return Address < R.LowPC;
+      });
+  if (It == SubprogramRanges.begin())
+    return nullptr;
+  --It;
+  if (Address >= It->HighPC)
+    return nullptr;
+  return &DieArray[It->DIEIndex];
 }
 
 DWARFDebugInfoEntryInlinedChain
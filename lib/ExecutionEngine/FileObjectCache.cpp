@@ -0,0 +1,168 @@
+//===- FileObjectCache.cpp - Persistent object cache for the JIT ----------===//
+//
+//                     The LLVM Compiler Infrastructure
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+//
+// This file implements the file-backed object cache for MCJIT and Orc.
+//
+//===----------------------------------------------------------------------===//
+
+#include "llvm/ExecutionEngine/FileObjectCache.h"
+#include "llvm/ADT/SmallString.h"
+#include "llvm/ADT/StringExtras.h"
+#include "llvm/Bitcode/ReaderWriter.h"
+#include "llvm/Config/llvm-config.h"
+#include "llvm/IR/Module.h"
+#include "llvm/Support/FileSystem.h"
+#include "llvm/Support/MD5.h"
+#include "llvm/Support/MemoryBuffer.h"
+#include "llvm/Support/Path.h"
+#include "llvm/Support/Process.h"
+#include "llvm/Support/raw_ostream.h"
+#include "llvm/Target/TargetMachine.h"
+#include "llvm/Target/TargetOptions.h"
+
+using namespace llvm;
+
+/// Write the fields of \p Options that affect the generated code, each
+/// followed by a null character.
+static void writeTargetOptions(raw_ostream &OS, const TargetOptions &Options) {
+  OS << Options.PrintMachineCode << '\0' << Options.LessPreciseFPMADOption
+     << '\0' << Options.UnsafeFPMath << '\0' << Options.NoInfsFPMath << '\0'
+     << Options.NoNaNsFPMath << '\0'
+     << Options.HonorSignDependentRoundingFPMathOption << '\0'
+     << Options.NoZerosInBSS << '\0' << Options.GuaranteedTailCallOpt << '\0'
+     << Options.StackAlignmentOverride << '\0' << Options.EnableFastISel
+     << '\0' << Options.PositionIndependentExecutable << '\0'
+     << Options.UseInitArray << '\0' << Options.DisableIntegratedAS << '\0'
+     << Options.CompressDebugSections << '\0' << Options.FunctionSections
+     << '\0' << Options.DataSections << '\0' << Options.UniqueSectionNames
+     << '\0' << Options.TrapUnreachable << '\0' << Options.TrapFuncName
+     << '\0' << Options.FloatABIType << '\0' << Options.AllowFPOpFusion
+     << '\0' << Options.JTType << '\0' << Options.ThreadModel << '\0';
+  // Reciprocals can only be queried once the target sets their defaults,
+  // which most targets never do, so they are left out.
+
+  const MCTargetOptions &MCOptions = Options.MCOptions;
+  OS << MCOptions.SanitizeAddress << '\0' << MCOptions.MCRelaxAll << '\0'
+     << MCOptions.MCNoExecStack << '\0' << MCOptions.MCFatalWarnings << '\0'
+     << MCOptions.MCSaveTempLabels << '\0' << MCOptions.MCUseDwarfDirectory
+     << '\0' << MCOptions.ShowMCEncoding << '\0' << MCOptions.ShowMCInst
+     << '\0' << MCOptions.AsmVerbose << '\0' << MCOptions.DwarfVersion << '\0'
+     << MCOptions.ABIName << '\0';
+}
+
+FileObjectCache::FileObjectCache(StringRef Path, const TargetMachine &TM)
+    : Path(Path), Pruning(Path) {
+  // Separate the fields, so that consecutive ones cannot be confused.
+  raw_string_ostream OS(TargetKey);
+  OS << LLVM_VERSION_STRING << '\0' << TM.getTargetTriple().str() << '\0'
+     << TM.getTargetCPU() << '\0' << TM.getTargetFeatureString() << '\0'
+     << TM.getRelocationModel() << '\0' << TM.getCodeModel() << '\0'
+     << TM.getOptLevel() << '\0';
+  writeTargetOptions(OS, TM.Options);
+  OS.flush();
+}
+
+FileObjectCache::~FileObjectCache() {}
+
+std::string FileObjectCache::getKey(const Module &M) const {
+  // The functions of a lazily loaded module must be hashed too. The JIT
+  // materializes them to compile the module anyway.
+  if (const_cast<Module &>(M).materializeAll())
+    return "";
+
+  SmallString<0> Bitcode;
+  {
+    raw_svector_ostream OS(Bitcode);
+    WriteBitcodeToFile(&M, OS);
+  }
+
+  MD5 Hasher;
+  Hasher.update(TargetKey);
+  Hasher.update(Bitcode);
+  MD5::MD5Result Result;
+  Hasher.final(Result);
+  SmallString<32> Key;
+  MD5::stringifyResult(Result, Key);
+  return Key.str();
+}
+
+std::string FileObjectCache::getObjectPath(StringRef Key) const {
+  SmallString<128> ObjectPath(Path);
+  sys::path::append(ObjectPath, "llvmcache-" + Key + ".o");
+  return ObjectPath.str();
+}
+
+std::unique_ptr<MemoryBuffer> FileObjectCache::getObject(const Module *M) {
+  std::string Key = getKey(*M);
+  if (Key.empty())
+    return nullptr;
+  std::string ObjectPath = getObjectPath(Key);
+
+  int FD;
+  if (!sys::fs::openFileForRead(ObjectPath, FD)) {
+    ErrorOr<std::unique_ptr<MemoryBuffer>> BufferOrErr =
+        MemoryBuffer::getOpenFile(FD, ObjectPath, -1,
+                                  /*RequiresNullTerminator=*/false);
+    // Pruning removes the least recently modified objects first.
+    if (BufferOrErr)
+      sys::fs::setLastModificationAndAccessTime(FD, sys::TimeValue::now());
+    sys::Process::SafelyCloseFileDescriptor(FD);
+    if (BufferOrErr)
+      return std::move(*BufferOrErr);
+  }
+
+  // The JIT compiles the module next.
+  std::lock_guard<std::mutex> Lock(KeysMutex);
+  PendingKeys[M] = std::move(Key);
+  return nullptr;
+}
+
+void FileObjectCache::notifyObjectCompiled(const Module *M,
+                                           MemoryBufferRef Obj) {
+  std::string Key;
+  {
+    std::lock_guard<std::mutex> Lock(KeysMutex);
+    auto I = PendingKeys.find(M);
+    if (I != PendingKeys.end()) {
+      Key = std::move(I->second);
+      PendingKeys.erase(I);
+    }
+  }
+  // The module was compiled without being looked up first.
+  if (Key.empty())
+    Key = getKey(*M);
+  if (Key.empty())
+    return;
+
+  if (sys::fs::create_directories(Path))
+    return;
+
+  // Write to a temporary file first, and rename it into place so that a
+  // lookup never sees a partially written object. Concurrent stores of the
+  // same object write the same contents.
+  std::string ObjectPath = getObjectPath(Key);
+  SmallString<128> TempPath;
+  int FD;
+  if (sys::fs::createUniqueFile(ObjectPath + "-tmp-%%%%%%%%", FD, TempPath))
+    return;
+  raw_fd_ostream OS(FD, /*shouldClose=*/true);
+  OS << Obj.getBuffer();
+  OS.close();
+  if (OS.has_error()) {
+    OS.clear_error();
+    sys::fs::remove(TempPath);
+    return;
+  }
+  if (sys::fs::rename(TempPath, ObjectPath)) {
+    sys::fs::remove(TempPath);
+    return;
+  }
+
+  Pruning.prune();
+}
@@ -130,6 +130,8 @@ void MCJIT::addObjectFile(object::OwningBinary<object::ObjectFile> Obj) {
 }
 
 void MCJIT::addArchive(object::OwningBinary<object::Archive> A) {
+  // The archives are searched for each unresolved symbol.
+  A.getBinary()->buildSymbolIndex();
   Archives.push_back(std::move(A));
 }
 
@@ -183,6 +183,8 @@ public:
   }
 
   void addArchive(object::OwningBinary<object::Archive> A) override {
+    // The archives are searched for each unresolved symbol.
+    A.getBinary()->buildSymbolIndex();
     Archives.push_back(std::move(A));
   }
 
@@ -234,6 +236,8 @@ public:
     CompileLayer.setObjectCache(NewCache);
   }
 
+  TargetMachine *getTargetMachine() override { return TM.get(); }
+
 private:
 
   RuntimeDyld::SymbolInfo findMangledSymbol(StringRef Name) {
@@ -0,0 +1,270 @@
+//===- SlabMemoryManager.cpp - Slab-based memory manager for the JIT ------===//
+//
+//                     The LLVM Compiler Infrastructure
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+//
+// This file implements the slab-based memory manager for MCJIT and Orc.
+//
+//===----------------------------------------------------------------------===//
+
+#include "llvm/ExecutionEngine/SlabMemoryManager.h"
+#include "llvm/Support/MathExtras.h"
+#include "llvm/Support/Process.h"
+#include <algorithm>
+
+namespace llvm {
+
+static uintptr_t getPageSize() {
+  static const uintptr_t PageSize = sys::Process::getPageSize();
+  return PageSize;
+}
+
+SlabAllocator::SlabAllocator(size_t SlabSize)
+    : SlabSize(RoundUpToAlignment(std::max(SlabSize, size_t(1)),
+                                  getPageSize())) {}
+
+SlabAllocator::~SlabAllocator() {
+  for (auto &S : Slabs)
+    sys::Memory::releaseMappedMemory(S.second.Block);
+}
+
+sys::MemoryBlock SlabAllocator::allocatePages(size_t Size) {
+  Size = RoundUpToAlignment(std::max(Size, size_t(1)), getPageSize());
+  std::lock_guard<std::mutex> Lock(Mutex);
+
+  // Take the first free range that is large enough, to keep the slabs packed.
+  for (auto &SlabEntry : Slabs) {
+    Slab &S = SlabEntry.second;
+    if (S.FreeSize < Size)
+      continue;
+    for (auto I = S.FreeRanges.begin(), E = S.FreeRanges.end(); I != E; ++I) {
+      if (I->second < Size)
+        continue;
+      uintptr_t Addr = I->first;
+      size_t Remaining = I->second - Size;
+      S.FreeRanges.erase(I);
+      if (Remaining)
+        S.FreeRanges[Addr + Size] = Remaining;
+      S.FreeSize -= Size;
+      return sys::MemoryBlock(reinterpret_cast<void *>(Addr), Size);
+    }
+  }
+
+  // Map a new slab. The permissions are applied to the page ranges later.
+  std::error_code EC;
+  sys::MemoryBlock MB = sys::Memory::allocateMappedMemory(
+      std::max(SlabSize, Size), nullptr,
+      sys::Memory::MF_READ | sys::Memory::MF_WRITE, EC);
+  if (EC)
+    return sys::MemoryBlock();
+  uintptr_t Addr = reinterpret_cast<uintptr_t>(MB.base());
+  Slab &S = Slabs[Addr];
+  S.Block = MB;
+  S.FreeSize = MB.size() - Size;
+  if (S.FreeSize)
+    S.FreeRanges[Addr + Size] = S.FreeSize;
+  return sys::MemoryBlock(MB.base(), Size);
+}
+
+void SlabAllocator::releasePages(sys::MemoryBlock Block) {
+  if (!Block.base())
+    return;
+  // Reused pages start read-write, like new ones.
+  sys::Memory::protectMappedMemory(Block, sys::Memory::MF_READ |
+                                              sys::Memory::MF_WRITE);
+
+  uintptr_t Addr = reinterpret_cast<uintptr_t>(Block.base());
+  size_t Size = Block.size();
+  std::lock_guard<std::mutex> Lock(Mutex);
+  auto SlabI = Slabs.upper_bound(Addr);
+  assert(SlabI != Slabs.begin() && "Pages not allocated by this allocator");
+  --SlabI;
+  Slab &S = SlabI->second;
+  S.FreeSize += Size;
+
+  // Merge the range with the free ranges around it.
+  auto Next = S.FreeRanges.lower_bound(Addr);
+  if (Next != S.FreeRanges.end() && Addr + Size == Next->first) {
+    Size += Next->second;
+    Next = S.FreeRanges.erase(Next);
+  }
+  if (Next != S.FreeRanges.begin()) {
+    auto Prev = std::prev(Next);
+    if (Prev->first + Prev->second == Addr) {
+      Prev->second += Size;
+      Size = 0;
+    }
+  }
+  if (Size)
+    S.FreeRanges[Addr] = Size;
+
+  // Give the slabs that are entirely free back to the system, but keep the
+  // last one to avoid remapping memory when a JIT loads and frees a module
+  // repeatedly.
+  if (S.FreeSize == S.Block.size() && Slabs.size() > 1) {
+    sys::Memory::releaseMappedMemory(S.Block);
+    Slabs.erase(SlabI);
+  }
+}
+
+size_t SlabAllocator::getMappedSize() const {
+  std::lock_guard<std::mutex> Lock(Mutex);
+  size_t Size = 0;
+  for (const auto &S : Slabs)
+    Size += S.second.Block.size();
+  return Size;
+}
+
+SlabMemoryManager::SlabMemoryManager(std::shared_ptr<SlabAllocator> Allocator)
+    : Allocator(Allocator ? std::move(Allocator)
+                          : std::make_shared<SlabAllocator>()) {}
+
+SlabMemoryManager::~SlabMemoryManager() {
+  for (MemoryGroup *MemGroup : {&CodeMem, &RODataMem, &RWDataMem})
+    for (const sys::MemoryBlock &MB : MemGroup->Ranges)
+      Allocator->releasePages(MB);
+}
+
+bool SlabMemoryManager::reserve(MemoryGroup &MemGroup, uintptr_t Size) {
+  if (MemGroup.End - MemGroup.Next >= Size)
+    return true;
+  // The rest of the current range stays unused until the memory manager is
+  // destroyed.
+  sys::MemoryBlock MB = Allocator->allocatePages(Size);
+  if (!MB.base())
+    return false;
+  MemGroup.Ranges.push_back(MB);
+  MemGroup.Next = reinterpret_cast<uintptr_t>(MB.base());
+  MemGroup.End = MemGroup.Next + MB.size();
+  return true;
+}
+
+void SlabMemoryManager::reserveAllocationSpace(uintptr_t CodeSize,
+                                               uintptr_t DataSizeRO,
+                                               uintptr_t DataSizeRW) {
+  // If this fails, so will the allocations.
+  if (CodeSize)
+    reserve(CodeMem, CodeSize);
+  if (DataSizeRO)
+    reserve(RODataMem, DataSizeRO);
+  if (DataSizeRW)
+    reserve(RWDataMem, DataSizeRW);
+}
+
+uint8_t *SlabMemoryManager::allocateCodeSection(uintptr_t Size,
+                                                unsigned Alignment,
+                                                unsigned SectionID,
+                                                StringRef SectionName) {
+  return allocateSection(CodeMem, Size, Alignment);
+}
+
+uint8_t *SlabMemoryManager::allocateDataSection(uintptr_t Size,
+                                                unsigned Alignment,
+                                                unsigned SectionID,
+                                                StringRef SectionName,
+                                                bool IsReadOnly) {
+  if (IsReadOnly)
+    return allocateSection(RODataMem, Size, Alignment);
+  return allocateSection(RWDataMem, Size, Alignment);
+}
+
+uint8_t *SlabMemoryManager::allocateSection(MemoryGroup &MemGroup,
+                                            uintptr_t Size,
+                                            unsigned Alignment) {
+  if (!Alignment)
+    Alignment = 16;
+
+  assert(!(Alignment & (Alignment - 1)) && "Alignment must be a power of two.");
+
+  uintptr_t Addr = RoundUpToAlignment(MemGroup.Next, Alignment);
+  if (!MemGroup.Next || Addr > MemGroup.End || MemGroup.End - Addr < Size) {
+    // The section did not fit in the space reserved for the object.
+    // FIXME: Add error propagation to the interface.
+    MemGroup.End = MemGroup.Next;
+    if (!reserve(MemGroup, Size + Alignment))
+      return nullptr;
+    Addr = RoundUpToAlignment(MemGroup.Next, Alignment);
+  }
+
+  MemGroup.Pending.push_back(sys::MemoryBlock((void *)Addr, Size));
+  MemGroup.Next = Addr + Size;
+  return (uint8_t *)Addr;
+}
+
+bool SlabMemoryManager::finalizeMemory(std::string *ErrMsg) {
+  // FIXME: Should in-progress permissions be reverted if an error occurs?
+  std::error_code EC;
+
+  // Make code memory executable.
+  EC = applyMemoryGroupPermissions(CodeMem,
+                                   sys::Memory::MF_READ | sys::Memory::MF_EXEC);
+  if (!EC)
+    // Make read-only data memory read-only.
+    EC = applyMemoryGroupPermissions(RODataMem, sys::Memory::MF_READ |
+                                                    sys::Memory::MF_EXEC);
+  if (EC) {
+    if (ErrMsg)
+      *ErrMsg = EC.message();
+    return true;
+  }
+
+  // Read-write data memory already has the correct permissions.
+
+  // Some platforms with separate data cache and instruction cache require
+  // explicit cache flush, otherwise JIT code manipulations (like resolved
+  // relocations) will get to the data cache but not to the instruction cache.
+  invalidateInstructionCache();
+
+  // The pages that were just protected must not receive new sections.
+  for (MemoryGroup *MemGroup : {&CodeMem, &RODataMem}) {
+    if (!MemGroup->Pending.empty())
+      MemGroup->Next = std::min<uintptr_t>(
+          RoundUpToAlignment(MemGroup->Next, getPageSize()), MemGroup->End);
+    MemGroup->Pending.clear();
+  }
+  RWDataMem.Pending.clear();
+
+  return false;
+}
+
+std::error_code
+SlabMemoryManager::applyMemoryGroupPermissions(MemoryGroup &MemGroup,
+                                               unsigned Permissions) {
+  // Round the new sections to pages and merge the adjacent ones, so that the
+  // sections of the objects loaded since the last call, which are usually
+  // contiguous, are protected together.
+  uintptr_t PageSize = getPageSize();
+  SmallVector<std::pair<uintptr_t, uintptr_t>, 16> PageRanges;
+  for (const sys::MemoryBlock &MB : MemGroup.Pending) {
+    if (!MB.size())
+      continue;
+    uintptr_t Start = reinterpret_cast<uintptr_t>(MB.base());
+    PageRanges.push_back(
+        std::make_pair(Start & ~(PageSize - 1),
+                       RoundUpToAlignment(Start + MB.size(), PageSize)));
+  }
+  std::sort(PageRanges.begin(), PageRanges.end());
+
+  for (unsigned I = 0, E = PageRanges.size(); I != E;) {
+    uintptr_t Start = PageRanges[I].first;
+    uintptr_t End = PageRanges[I].second;
+    for (++I; I != E && PageRanges[I].first <= End; ++I)
+      End = std::max(End, PageRanges[I].second);
+    if (std::error_code EC = sys::Memory::protectMappedMemory(
+            sys::MemoryBlock((void *)Start, End - Start), Permissions))
+      return EC;
+  }
+
+  return std::error_code();
+}
+
+void SlabMemoryManager::invalidateInstructionCache() {
+  for (const sys::MemoryBlock &MB : CodeMem.Pending)
+    sys::Memory::InvalidateInstructionCache(MB.base(), MB.size());
+}
+
+} // namespace llvm
@@ -0,0 +1,146 @@
+//===-- FunctionInfo.cpp - Function Summary Index -------------------------===//
+//
+//                     The LLVM Compiler Infrastructure
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+//
+// This file implements the function summary index and the computation of the
+// summaries from the IR.
+//
+//===----------------------------------------------------------------------===//
+
+#include "llvm/IR/FunctionInfo.h"
+#include "llvm/ADT/MapVector.h"
+#include "llvm/ADT/STLExtras.h"
+#include "llvm/ADT/SmallPtrSet.h"
+#include "llvm/IR/CallSite.h"
+#include "llvm/IR/Constants.h"
+#include "llvm/IR/Function.h"
+#include "llvm/IR/GlobalVariable.h"
+#include "llvm/IR/InstIterator.h"
+#include "llvm/IR/IntrinsicInst.h"
+#include "llvm/IR/Module.h"
+using namespace llvm;
+
+StringRef FunctionInfoIndex::addModulePath(StringRef Path) {
+  uint64_t NextId = ModulePathStringTable.size();
+  return ModulePathStringTable.insert(std::make_pair(Path, NextId))
+      .first->first();
+}
+
+void FunctionInfoIndex::addFunctionSummary(
+    StringRef Name, StringRef ModulePath,
+    std::unique_ptr<FunctionSummary> Summary) {
+  Summary->setModulePath(addModulePath(ModulePath));
+  FunctionMap[Name].push_back(std::move(Summary));
+}
+
+const FunctionSummaryList *
+FunctionInfoIndex::findFunctionSummaries(StringRef Name) const {
+  auto I = FunctionMap.find(Name);
+  if (I == FunctionMap.end())
+    return nullptr;
+  return &I->second;
+}
+
+void FunctionInfoIndex::mergeFrom(std::unique_ptr<FunctionInfoIndex> Other) {
+  // Register the module paths in the order of their ids in Other, so that a
+  // combined index assigns ids in the order in which the modules were merged.
+  std::vector<StringRef> Paths(Other->ModulePathStringTable.size());
+  for (auto &Entry : Other->ModulePathStringTable)
+    Paths[Entry.second] = Entry.first();
+  for (StringRef Path : Paths)
+    addModulePath(Path);
+
+  for (auto &Entry : Other->FunctionMap)
+    for (auto &Summary : Entry.second) {
+      StringRef ModulePath = Summary->modulePath();
+      addFunctionSummary(Entry.first(), ModulePath, std::move(Summary));
+    }
+}
+
+bool llvm::isImportableLocalConstant(const GlobalValue &GV) {
+  auto *GVar = dyn_cast<GlobalVariable>(&GV);
+  return GVar && GVar->hasLocalLinkage() && GVar->isConstant() &&
+         GVar->hasUnnamedAddr() && GVar->hasInitializer();
+}
+
+/// Return true if \p C refers to a global value that is defined with a
+/// linkage that does not allow referencing it from another module.
+static bool
+refersToNonExternalDefinition(const Constant *C,
+                              SmallPtrSetImpl<const Constant *> &Visited) {
+  if (!Visited.insert(C).second)
+    return false;
+  if (isa<BlockAddress>(C))
+    return true;
+  if (auto *GV = dyn_cast<GlobalValue>(C)) {
+    // Local constants can be copied along with the function, as long as what
+    // they refer to can.
+    if (isImportableLocalConstant(*GV))
+      return refersToNonExternalDefinition(
+          cast<GlobalVariable>(GV)->getInitializer(), Visited);
+    return !GV->isDeclaration() && !GV->hasExternalLinkage();
+  }
+  for (const Use &Op : C->operands())
+    if (refersToNonExternalDefinition(cast<Constant>(Op.get()), Visited))
+      return true;
+  return false;
+}
+
+std::unique_ptr<FunctionSummary>
+llvm::computeFunctionSummary(const Function &F) {
+  assert(!F.isDeclaration() && "Cannot summarize a declaration");
+
+  // A copy of a local or overridable function would not be equivalent to the
+  // definition that ends up in the final link.
+  bool EligibleToImport = !F.hasLocalLinkage() && !F.mayBeOverridden();
+
+  unsigned InstCount = 0;
+  MapVector<const Function *, unsigned> CallCounts;
+  SmallPtrSet<const Constant *, 16> Visited;
+  for (const Instruction &I : inst_range(F)) {
+    if (isa<DbgInfoIntrinsic>(I))
+      continue;
+    ++InstCount;
+
+    if (EligibleToImport)
+      for (const Use &Op : I.operands())
+        if (auto *C = dyn_cast<Constant>(Op.get()))
+          if (refersToNonExternalDefinition(C, Visited)) {
+            EligibleToImport = false;
+            break;
+          }
+
+    ImmutableCallSite CS(&I);
+    if (!CS)
+      continue;
+    const Function *Callee =
+        dyn_cast<Function>(CS.getCalledValue()->stripPointerCasts());
+    if (Callee && Callee->hasName() && !Callee->isIntrinsic())
+      ++CallCounts[Callee];
+  }
+
+  auto Summary = llvm::make_unique<FunctionSummary>(F.getLinkage(), InstCount,
+                                                    EligibleToImport);
+  for (auto &Call : CallCounts)
+    Summary->addCall(Call.first->getName(), Call.second);
+  return Summary;
+}
+
+std::unique_ptr<FunctionInfoIndex>
+llvm::buildFunctionInfoIndex(const Module &M, StringRef ModulePath) {
+  if (ModulePath.empty())
+    ModulePath = M.getModuleIdentifier();
+
+  auto Index = llvm::make_unique<FunctionInfoIndex>();
+  Index->addModulePath(ModulePath);
+  for (const Function &F : M)
+    if (!F.isDeclaration() && F.hasName())
+      Index->addFunctionSummary(F.getName(), ModulePath,
+                                computeFunctionSummary(F));
+  return Index;
+}
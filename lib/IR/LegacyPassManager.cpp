@@ -12,6 +12,8 @@
 //===----------------------------------------------------------------------===//
 
 
+#include "llvm/ADT/Statistic.h"
+#include "llvm/ADT/StringMap.h"
 #include "llvm/IR/LLVMContext.h"
 #include "llvm/IR/IRPrintingPasses.h"
 #include "llvm/IR/LegacyPassManager.h"
@@ -21,8 +23,13 @@
 #include "llvm/Support/CommandLine.h"
 #include "llvm/Support/Debug.h"
 #include "llvm/Support/ErrorHandling.h"
+#include "llvm/Support/FileSystem.h"
+#include "llvm/Support/Format.h"
+#include "llvm/Support/JSON.h"
 #include "llvm/Support/ManagedStatic.h"
 #include "llvm/Support/Mutex.h"
+#include "llvm/Support/Process.h"
+#include "llvm/Support/TimeTrace.h"
 #include "llvm/Support/TimeValue.h"
 #include "llvm/Support/Timer.h"
 #include "llvm/Support/raw_ostream.h"
@@ -486,9 +493,67 @@ public:
   }
 };
 
+//===----------------------------------------------------------------------===//
+/// PassReport Class - This class records the executions of the passes for the
+/// JSON report of -pass-report, and writes the report when destroyed.  This
+/// only happens when -pass-report is enabled on the command line.
+///
+class PassReport {
+  struct PassSummary {
+    std::string Name;
+    std::string Arg;
+    unsigned Executions;
+    TimeRecord Time;
+    int64_t InstructionDelta;
+    uint64_t PeakRSSDelta;
+  };
+
+  struct Execution {
+    unsigned PassIndex;
+    const char *Kind;
+    std::string Unit;
+    TimeRecord Time;
+    uint64_t InstructionsBefore;
+    uint64_t InstructionsAfter;
+    uint64_t PeakRSSDelta;
+  };
+
+  sys::SmartMutex<true> Lock;
+  StringMap<unsigned> PassIndices;
+  std::vector<PassSummary> Passes;
+  std::vector<Execution> Executions;
+  bool Written;
+
+  void write(raw_ostream &OS);
+
+public:
+  PassReport() : Written(false) {}
+
+  // Write the report, unless nothing was recorded since writeToFile was last
+  // called.
+  ~PassReport() {
+    if (!Written)
+      writeToFile();
+  }
+
+  // createThePassReport - This method either initializes the ThePassReport
+  // pointer to a non-null value (if the -pass-report option is enabled) or it
+  // leaves it null.  It may be called multiple times.
+  static void createThePassReport();
+
+  void record(Pass *P, const char *Kind, StringRef Unit, const TimeRecord &Time,
+              size_t InstructionsBefore, size_t InstructionsAfter,
+              size_t PeakRSSDelta);
+
+  /// writeToFile - Write the report to the file given by -pass-report,
+  /// replacing the previous report.
+  void writeToFile();
+};
+
 } // End of anon namespace
 
 static TimingInfo *TheTimeInfo;
+static PassReport *ThePassReport;
 
 //===----------------------------------------------------------------------===//
 // PMTopLevelManager implementation
@@ -1463,6 +1528,7 @@ void FunctionPassManagerImpl::releaseMemoryOnTheFly() {
 bool FunctionPassManagerImpl::run(Function &F) {
   bool Changed = false;
   TimingInfo::createTheTimeInfo();
+  PassReport::createThePassReport();
 
   initializeAllAnalysisInfo();
   for (unsigned Index = 0; Index < getNumContainedManagers(); ++Index) {
@@ -1500,6 +1566,7 @@ bool FPPassManager::runOnFunction(Function &F) {
     return false;
 
   bool Changed = false;
+  TimeTraceScope FunctionScope("Function passes", F.getName());
 
   // Collect inherited analysis from Module level pass manager.
   populateInheritedAnalysis(TPM->activeStack);
@@ -1516,6 +1583,8 @@ bool FPPassManager::runOnFunction(Function &F) {
     {
       PassManagerPrettyStackEntry X(FP, F);
       TimeRegion PassTimer(getPassTimer(FP));
+      PassReportRegion ReportRegion(FP, F);
+      TimeTraceScope TraceScope(FP->getPassName(), F.getName());
 
       LocalChanged |= FP->runOnFunction(F);
     }
@@ -1592,6 +1661,8 @@ MPPassManager::runOnModule(Module &M) {
     {
       PassManagerPrettyStackEntry X(MP, M);
       TimeRegion PassTimer(getPassTimer(MP));
+      PassReportRegion ReportRegion(MP, M);
+      TimeTraceScope TraceScope(MP->getPassName(), M.getModuleIdentifier());
 
       LocalChanged |= MP->runOnModule(M);
     }
@@ -1686,6 +1757,7 @@ Pass* MPPassManager::getOnTheFlyPass(Pass *MP, AnalysisID PI, Function &F){
 bool PassManagerImpl::run(Module &M) {
   bool Changed = false;
   TimingInfo::createTheTimeInfo();
+  PassReport::createThePassReport();
 
   dumpArguments();
   dumpPasses();
@@ -1757,6 +1829,183 @@ Timer *llvm::getPassTimer(Pass *P) {
   return nullptr;
 }
 
+//===----------------------------------------------------------------------===//
+// PassReport implementation
+
+static cl::opt<std::string>
+PassReportFilename("pass-report", cl::value_desc("filename"),
+                   cl::desc("Write a JSON report of the time, the instruction "
+                            "counts and the peak memory of each pass "
+                            "execution, and of the statistics, to the file"));
+
+static cl::opt<bool>
+PassReportExecutions("pass-report-executions", cl::Hidden, cl::init(true),
+                     cl::desc("Report each execution of the passes with "
+                              "-pass-report, not only their totals"));
+
+void PassReport::createThePassReport() {
+  if (PassReportFilename.empty() || ThePassReport) return;
+
+  // Collect the statistics for the report. This also creates the statistics
+  // before the report, so that they are destroyed after it.
+  EnableStatistics(/*PrintOnExit=*/false);
+
+  // Constructed the first time this is called, iff -pass-report is enabled.
+  static ManagedStatic<PassReport> TPR;
+  ThePassReport = &*TPR;
+}
+
+void PassReport::record(Pass *P, const char *Kind, StringRef Unit,
+                        const TimeRecord &Time, size_t InstructionsBefore,
+                        size_t InstructionsAfter, size_t PeakRSSDelta) {
+  sys::SmartScopedLock<true> Guard(Lock);
+  Written = false;
+
+  StringRef Name = P->getPassName();
+  auto Inserted = PassIndices.insert(std::make_pair(Name, Passes.size()));
+  if (Inserted.second) {
+    const PassInfo *PI = Pass::lookupPassInfo(P->getPassID());
+    Passes.push_back({Name, PI ? PI->getPassArgument() : "", 0, TimeRecord(),
+                      0, 0});
+  }
+  unsigned PassIndex = Inserted.first->second;
+  PassSummary &Summary = Passes[PassIndex];
+  ++Summary.Executions;
+  Summary.Time += Time;
+  Summary.InstructionDelta +=
+      int64_t(InstructionsAfter) - int64_t(InstructionsBefore);
+  Summary.PeakRSSDelta += PeakRSSDelta;
+
+  if (PassReportExecutions)
+    Executions.push_back({PassIndex, Kind, Unit, Time, InstructionsBefore,
+                          InstructionsAfter, PeakRSSDelta});
+}
+
+static void printTimeRecord(raw_ostream &OS, const TimeRecord &Time) {
+  OS << format("\"wall\": %.6f, \"user\": %.6f, \"system\": %.6f",
+               Time.getWallTime(), Time.getUserTime(), Time.getSystemTime());
+}
+
+void PassReport::write(raw_ostream &OS) {
+  OS << "{\n\"passes\": [";
+  for (unsigned I = 0, E = Passes.size(); I != E; ++I) {
+    const PassSummary &Summary = Passes[I];
+    OS << (I ? ",\n  " : "\n  ") << "{ \"name\": ";
+    printJSONString(OS, Summary.Name);
+    OS << ", \"arg\": ";
+    printJSONString(OS, Summary.Arg);
+    OS << ", \"executions\": " << Summary.Executions << ", ";
+    printTimeRecord(OS, Summary.Time);
+    OS << ", \"instruction-delta\": " << Summary.InstructionDelta
+       << ", \"peak-rss-delta\": " << Summary.PeakRSSDelta << " }";
+  }
+  OS << (Passes.empty() ? "],\n" : "\n],\n");
+
+  OS << "\"executions\": [";
+  for (unsigned I = 0, E = Executions.size(); I != E; ++I) {
+    const Execution &Exec = Executions[I];
+    OS << (I ? ",\n  " : "\n  ") << "{ \"pass\": ";
+    printJSONString(OS, Passes[Exec.PassIndex].Name);
+    OS << ", \"" << Exec.Kind << "\": ";
+    printJSONString(OS, Exec.Unit);
+    OS << ", ";
+    printTimeRecord(OS, Exec.Time);
+    OS << ", \"instructions-before\": " << Exec.InstructionsBefore
+       << ", \"instructions-after\": " << Exec.InstructionsAfter
+       << ", \"peak-rss-delta\": " << Exec.PeakRSSDelta << " }";
+  }
+  OS << (Executions.empty() ? "],\n" : "\n],\n");
+
+  OS << "\"statistics\": ";
+  PrintStatisticsJSON(OS);
+  OS << "\n}\n";
+}
+
+void PassReport::writeToFile() {
+  sys::SmartScopedLock<true> Guard(Lock);
+  Written = true;
+
+  if (PassReportFilename == "-") {
+    write(outs());
+    outs().flush();
+    return;
+  }
+
+  std::error_code EC;
+  raw_fd_ostream OS(PassReportFilename, EC, sys::fs::F_Text);
+  if (EC) {
+    errs() << "Error opening pass report file '" << PassReportFilename
+           << "': " << EC.message() << '\n';
+    return;
+  }
+  write(OS);
+}
+
+void llvm::writePassReport() {
+  if (ThePassReport)
+    ThePassReport->writeToFile();
+}
+
+//===----------------------------------------------------------------------===//
+// PassReportRegion implementation
+
+PassReportRegion::PassReportRegion(Pass *P, Function &F)
+    : P(P), Kind("function"), M(nullptr), Functions(1, &F) {
+  start();
+}
+
+PassReportRegion::PassReportRegion(Pass *P, Module &M)
+    : P(P), Kind("module"), M(&M) {
+  start();
+}
+
+PassReportRegion::PassReportRegion(Pass *P, ArrayRef<Function *> SCC)
+    : P(P), Kind("scc"), M(nullptr), Functions(SCC.begin(), SCC.end()) {
+  start();
+}
+
+bool PassReportRegion::isEnabled() {
+  return ThePassReport != nullptr;
+}
+
+void PassReportRegion::start() {
+  if (!ThePassReport || P->getAsPMDataManager()) {
+    P = nullptr;
+    return;
+  }
+  if (M)
+    Unit = M->getModuleIdentifier();
+  else if (!Functions.empty())
+    Unit = Functions.front()->getName();
+  StartInstructions = countInstructions();
+  StartPeakRSS = sys::Process::GetPeakResidentSetSize();
+  StartTime = TimeRecord::getCurrentTime(true);
+}
+
+size_t PassReportRegion::countInstructions() const {
+  size_t Count = 0;
+  if (M) {
+    for (const Function &F : *M)
+      for (const BasicBlock &BB : F)
+        Count += BB.size();
+    return Count;
+  }
+  for (const Function *F : Functions)
+    for (const BasicBlock &BB : *F)
+      Count += BB.size();
+  return Count;
+}
+
+PassReportRegion::~PassReportRegion() {
+  if (!P)
+    return;
+  TimeRecord Time = TimeRecord::getCurrentTime(false);
+  Time -= StartTime;
+  size_t PeakRSSDelta = sys::Process::GetPeakResidentSetSize() - StartPeakRSS;
+  ThePassReport->record(P, Kind, Unit, Time, StartInstructions,
+                        countInstructions(), PeakRSSDelta);
+}
+
 //===----------------------------------------------------------------------===//
 // PMStack implementation
 //
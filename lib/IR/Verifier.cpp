@@ -73,6 +73,7 @@
 #include "llvm/Support/CommandLine.h"
 #include "llvm/Support/Debug.h"
 #include "llvm/Support/ErrorHandling.h"
+#include "llvm/Support/ThreadPool.h"
 #include "llvm/Support/raw_ostream.h"
 #include <algorithm>
 #include <cstdarg>
@@ -80,6 +81,20 @@ using namespace llvm;
 
 static cl::opt<bool> VerifyDebugInfo("verify-debug-info", cl::init(true));
 
+static cl::opt<unsigned>
+VerifyThreads("verify-threads",
+              cl::desc("Number of threads verifying the function bodies in "
+                       "verifyModule (0 = number of hardware threads)"),
+              cl::init(1));
+
+// The functions are verified in chunks that do not depend on the number of
+// threads, so the diagnostics do not either.
+static cl::opt<unsigned>
+VerifyChunkSize("verify-chunk-size", cl::Hidden,
+                cl::desc("Number of instructions of the consecutive functions "
+                         "verified together with -verify-threads"),
+                cl::init(4096));
+
 namespace {
 struct VerifierSupport {
   raw_ostream &OS;
@@ -276,6 +291,24 @@ public:
     return !Broken;
   }
 
+  /// \brief Take over what \p FV recorded while verifying functions, to be
+  /// checked by verify(const Module &).
+  ///
+  /// This lets several verifiers check the functions of a module, one after
+  /// the other or at the same time, before this one checks the module.
+  void mergeFunctionState(const Verifier &FV) {
+    for (const auto &Info : FV.FrameEscapeInfo) {
+      auto &Entry = FrameEscapeInfo[Info.first];
+      Entry.first = std::max(Entry.first, Info.second.first);
+      Entry.second = std::max(Entry.second, Info.second.second);
+    }
+    UnresolvedTypeRefs.insert(FV.UnresolvedTypeRefs.begin(),
+                              FV.UnresolvedTypeRefs.end());
+    // The metadata checked with the functions is not checked, nor reported,
+    // again with the module.
+    MDNodes.insert(FV.MDNodes.begin(), FV.MDNodes.end());
+  }
+
 private:
   // Verification methods...
   void visitGlobalValue(const GlobalValue &GV);
@@ -1353,12 +1386,24 @@ void Verifier::VerifyParameterAttrs(AttributeSet Attrs, unsigned Idx, Type *Ty,
          "'noinline and alwaysinline' are incompatible!",
          V);
 
-  Assert(!AttrBuilder(Attrs, Idx)
-              .overlaps(AttributeFuncs::typeIncompatible(Ty)),
-         "Wrong types for attribute: " +
-         AttributeSet::get(*Context, Idx,
-                        AttributeFuncs::typeIncompatible(Ty)).getAsString(Idx),
-         V);
+  AttrBuilder Incompatible = AttributeFuncs::typeIncompatible(Ty);
+  if (AttrBuilder(Attrs, Idx).overlaps(Incompatible)) {
+    // Print the attributes of V that are incompatible, which already exist:
+    // the functions may be verified concurrently, so the attributes of the
+    // message must not be created in the context.
+    std::string Incompatibles;
+    for (unsigned Kind = Attribute::None + 1; Kind != Attribute::EndAttrKinds;
+         ++Kind) {
+      auto AK = static_cast<Attribute::AttrKind>(Kind);
+      if (!Incompatible.contains(AK) || !Attrs.hasAttribute(Idx, AK))
+        continue;
+      if (!Incompatibles.empty())
+        Incompatibles += ' ';
+      Incompatibles += Attrs.getAttribute(Idx, AK).getAsString();
+    }
+    CheckFailed("Wrong types for attribute: " + Incompatibles, V);
+    return;
+  }
 
   if (PointerType *PTy = dyn_cast<PointerType>(Ty)) {
     SmallPtrSet<const Type*, 4> Visited;
@@ -2975,6 +3020,25 @@ void Verifier::visitInstruction(Instruction &I) {
   InstsInThisBlock.insert(&I);
 }
 
+/// Return true if Ty is like RefTy, an integer or a vector of integers, but
+/// with elements Mul / Div times as wide. This compares the types instead of
+/// building the expected one, so that verifying a function never creates types
+/// in the LLVMContext.
+static bool hasScaledIntElements(Type *Ty, Type *RefTy, unsigned Mul,
+                                 unsigned Div) {
+  if (VectorType *RefVTy = dyn_cast<VectorType>(RefTy)) {
+    VectorType *VTy = dyn_cast<VectorType>(Ty);
+    if (!VTy || VTy->getNumElements() != RefVTy->getNumElements())
+      return false;
+    Ty = VTy->getElementType();
+    RefTy = RefVTy->getElementType();
+  }
+  IntegerType *ITy = dyn_cast<IntegerType>(Ty);
+  IntegerType *RefITy = dyn_cast<IntegerType>(RefTy);
+  return ITy && RefITy &&
+         ITy->getBitWidth() * Div == RefITy->getBitWidth() * Mul;
+}
+
 /// VerifyIntrinsicType - Verify that the specified type (which comes from an
 /// intrinsic argument or return value) matches the type constraints specified
 /// by the .td file (e.g. an "any integer" argument really is an integer).
@@ -3046,37 +3110,27 @@ bool Verifier::VerifyIntrinsicType(Type *Ty,
     if (D.getArgumentNumber() >= ArgTys.size())
       return true;
 
-    Type *NewTy = ArgTys[D.getArgumentNumber()];
-    if (VectorType *VTy = dyn_cast<VectorType>(NewTy))
-      NewTy = VectorType::getExtendedElementVectorType(VTy);
-    else if (IntegerType *ITy = dyn_cast<IntegerType>(NewTy))
-      NewTy = IntegerType::get(ITy->getContext(), 2 * ITy->getBitWidth());
-    else
-      return true;
-
-    return Ty != NewTy;
+    return !hasScaledIntElements(Ty, ArgTys[D.getArgumentNumber()], 2, 1);
   }
   case IITDescriptor::TruncArgument: {
     // This may only be used when referring to a previous vector argument.
     if (D.getArgumentNumber() >= ArgTys.size())
       return true;
 
-    Type *NewTy = ArgTys[D.getArgumentNumber()];
-    if (VectorType *VTy = dyn_cast<VectorType>(NewTy))
-      NewTy = VectorType::getTruncatedElementVectorType(VTy);
-    else if (IntegerType *ITy = dyn_cast<IntegerType>(NewTy))
-      NewTy = IntegerType::get(ITy->getContext(), ITy->getBitWidth() / 2);
-    else
-      return true;
-
-    return Ty != NewTy;
+    return !hasScaledIntElements(Ty, ArgTys[D.getArgumentNumber()], 1, 2);
   }
-  case IITDescriptor::HalfVecArgument:
+  case IITDescriptor::HalfVecArgument: {
     // This may only be used when referring to a previous vector argument.
-    return D.getArgumentNumber() >= ArgTys.size() ||
-           !isa<VectorType>(ArgTys[D.getArgumentNumber()]) ||
-           VectorType::getHalfElementsVectorType(
-                         cast<VectorType>(ArgTys[D.getArgumentNumber()])) != Ty;
+    if (D.getArgumentNumber() >= ArgTys.size())
+      return true;
+    VectorType *ReferenceType =
+      dyn_cast<VectorType>(ArgTys[D.getArgumentNumber()]);
+    VectorType *ThisArgType = dyn_cast<VectorType>(Ty);
+    return !ThisArgType || !ReferenceType ||
+           ThisArgType->getElementType() != ReferenceType->getElementType() ||
+           2 * ThisArgType->getNumElements() !=
+             ReferenceType->getNumElements();
+  }
   case IITDescriptor::SameVecWidthArgument: {
     if (D.getArgumentNumber() >= ArgTys.size())
       return true;
@@ -3645,13 +3699,82 @@ bool llvm::verifyFunction(const Function &f, raw_ostream *OS) {
 }
 
 bool llvm::verifyModule(const Module &M, raw_ostream *OS) {
+  return verifyModule(M, OS, VerifyThreads);
+}
+
+/// verifyFunctionsInParallel - Verify the function bodies of \p Functions on
+/// \p NumThreads threads, write their diagnostics to \p OS in the order of the
+/// functions and record what the module checks need in \p V. Return true if
+/// a function is broken.
+static bool verifyFunctionsInParallel(ArrayRef<const Function *> Functions,
+                                      unsigned NumThreads, raw_ostream *OS,
+                                      Verifier &V) {
+  // Split the functions into chunks of consecutive functions, each checked
+  // by its own verifier. The metadata shared between the functions is
+  // checked once per chunk, so unlike with a single thread, a broken node
+  // used by several chunks is reported by each of them.
+  SmallVector<ArrayRef<const Function *>, 16> Chunks;
+  size_t Begin = 0, Size = 0;
+  for (size_t I = 0, E = Functions.size(); I != E; ++I) {
+    for (const BasicBlock &BB : *Functions[I])
+      Size += BB.size();
+    if (Size >= VerifyChunkSize || I + 1 == E) {
+      Chunks.push_back(Functions.slice(Begin, I + 1 - Begin));
+      Begin = I + 1;
+      Size = 0;
+    }
+  }
+
+  std::vector<std::unique_ptr<Verifier>> Verifiers(Chunks.size());
+  std::vector<std::string> Diagnostics(Chunks.size());
+  std::vector<char> ChunkBroken(Chunks.size(), false);
+  {
+    ThreadPool Pool(std::min<size_t>(NumThreads, Chunks.size()));
+    for (unsigned I = 0, E = Chunks.size(); I != E; ++I)
+      Pool.async([&, I]() {
+        raw_null_ostream NullStr;
+        raw_string_ostream DiagStr(Diagnostics[I]);
+        Verifiers[I].reset(
+            new Verifier(OS ? static_cast<raw_ostream &>(DiagStr) : NullStr));
+        for (const Function *F : Chunks[I])
+          ChunkBroken[I] |= !Verifiers[I]->verify(*F);
+        DiagStr.flush();
+      });
+    Pool.wait();
+  }
+
+  bool Broken = false;
+  for (unsigned I = 0, E = Chunks.size(); I != E; ++I) {
+    if (OS)
+      *OS << Diagnostics[I];
+    V.mergeFunctionState(*Verifiers[I]);
+    Broken |= ChunkBroken[I];
+  }
+  return Broken;
+}
+
+bool llvm::verifyModule(const Module &M, raw_ostream *OS,
+                        unsigned NumThreads) {
   raw_null_ostream NullStr;
   Verifier V(OS ? *OS : NullStr);
 
-  bool Broken = false;
+  std::vector<const Function *> Functions;
   for (Module::const_iterator I = M.begin(), E = M.end(); I != E; ++I)
     if (!I->isDeclaration() && !I->isMaterializable())
-      Broken |= !V.verify(*I);
+      Functions.push_back(&*I);
+
+  if (!NumThreads)
+    NumThreads = ThreadPool::getDefaultThreadCount();
+
+  // The function bodies are checked first, possibly in parallel, then the
+  // module-level checks run serially.
+  bool Broken = false;
+  if (NumThreads > 1 && Functions.size() > 1) {
+    Broken = verifyFunctionsInParallel(Functions, NumThreads, OS, V);
+  } else {
+    for (const Function *F : Functions)
+      Broken |= !V.verify(*F);
+  }
 
   // Note that this function's return value is inverted from what you would
   // expect of a function called "verify".
@@ -18,6 +18,7 @@
 #include "llvm/Analysis/TargetLibraryInfo.h"
 #include "llvm/Analysis/TargetTransformInfo.h"
 #include "llvm/Bitcode/ReaderWriter.h"
+#include "llvm/CodeGen/ParallelCG.h"
 #include "llvm/CodeGen/RuntimeLibcalls.h"
 #include "llvm/Config/config.h"
 #include "llvm/IR/Constants.h"
@@ -32,10 +33,12 @@
 #include "llvm/IR/Verifier.h"
 #include "llvm/InitializePasses.h"
 #include "llvm/LTO/LTOModule.h"
+#include "llvm/LTO/NativeObjectCache.h"
 #include "llvm/Linker/Linker.h"
 #include "llvm/MC/MCAsmInfo.h"
 #include "llvm/MC/MCContext.h"
 #include "llvm/MC/SubtargetFeature.h"
+#include "llvm/Support/CachePruning.h"
 #include "llvm/Support/CommandLine.h"
 #include "llvm/Support/FileSystem.h"
 #include "llvm/Support/Host.h"
@@ -43,6 +46,7 @@
 #include "llvm/Support/Signals.h"
 #include "llvm/Support/TargetRegistry.h"
 #include "llvm/Support/TargetSelect.h"
+#include "llvm/Support/TimeTrace.h"
 #include "llvm/Support/ToolOutputFile.h"
 #include "llvm/Support/raw_ostream.h"
 #include "llvm/Target/TargetLowering.h"
@@ -231,7 +235,8 @@ bool LTOCodeGenerator::compileOptimizedToFile(const char **name,
   // generate object file
   tool_output_file objFile(Filename.c_str(), FD);
 
-  bool genResult = compileOptimized(objFile.os(), errMsg);
+  raw_pwrite_stream *OS = &objFile.os();
+  bool genResult = compileOptimized(OS, errMsg);
   objFile.os().close();
   if (objFile.os().has_error()) {
     objFile.os().clear_error();
@@ -250,6 +255,52 @@ bool LTOCodeGenerator::compileOptimizedToFile(const char **name,
   return true;
 }
 
+bool LTOCodeGenerator::compileOptimizedToFiles(std::vector<const char *> &names,
+                                               std::string &errMsg) {
+  NativeObjectPaths.clear();
+
+  // make unique temp .o files to put the generated object files
+  std::vector<std::unique_ptr<tool_output_file>> ObjFiles;
+  std::vector<raw_pwrite_stream *> OSs;
+  std::vector<std::string> Filenames;
+  for (unsigned I = 0; I != Parallelism; ++I) {
+    SmallString<128> Filename;
+    int FD;
+    std::error_code EC =
+        sys::fs::createTemporaryFile("lto-llvm", "o", FD, Filename);
+    if (EC) {
+      errMsg = EC.message();
+      return false;
+    }
+    // The tool_output_file removes the file unless it is kept.
+    ObjFiles.emplace_back(new tool_output_file(Filename.c_str(), FD));
+    OSs.push_back(&ObjFiles.back()->os());
+    Filenames.push_back(Filename.str());
+  }
+
+  // generate object files
+  bool genResult = compileOptimized(OSs, errMsg);
+  bool hasError = false;
+  for (auto &ObjFile : ObjFiles) {
+    ObjFile->os().close();
+    if (ObjFile->os().has_error()) {
+      ObjFile->os().clear_error();
+      hasError = true;
+    }
+  }
+  if (!genResult || hasError)
+    return false;
+
+  for (auto &ObjFile : ObjFiles)
+    ObjFile->keep();
+
+  NativeObjectPaths = std::move(Filenames);
+  names.clear();
+  for (const std::string &Path : NativeObjectPaths)
+    names.push_back(Path.c_str());
+  return true;
+}
+
 std::unique_ptr<MemoryBuffer>
 LTOCodeGenerator::compileOptimized(std::string &errMsg) {
   const char *name;
@@ -272,26 +323,206 @@ LTOCodeGenerator::compileOptimized(std::string &errMsg) {
 }
 
 
+/// Write \p Objects to new temporary object files, whose paths are appended to
+/// \p Paths.
+static bool
+writeTemporaryObjectFiles(ArrayRef<std::unique_ptr<MemoryBuffer>> Objects,
+                          std::vector<std::string> &Paths,
+                          std::string &errMsg) {
+  for (const std::unique_ptr<MemoryBuffer> &Object : Objects) {
+    SmallString<128> Filename;
+    int FD;
+    std::error_code EC =
+        sys::fs::createTemporaryFile("lto-llvm", "o", FD, Filename);
+    if (EC) {
+      errMsg = EC.message();
+      return false;
+    }
+
+    tool_output_file objFile(Filename.c_str(), FD);
+    objFile.os() << Object->getBuffer();
+    objFile.os().close();
+    if (objFile.os().has_error()) {
+      objFile.os().clear_error();
+      errMsg = "could not write object file: ";
+      errMsg += Filename.str();
+      return false;
+    }
+    objFile.keep();
+    Paths.push_back(Filename.str());
+  }
+  return true;
+}
+
 bool LTOCodeGenerator::compile_to_file(const char **name,
                                        bool disableInline,
                                        bool disableGVNLoadPRE,
                                        bool disableVectorization,
                                        std::string &errMsg) {
+  std::string CacheKey;
+  std::vector<std::unique_ptr<MemoryBuffer>> CachedObjects =
+      lookupCachedObjects(1, disableInline, disableGVNLoadPRE,
+                          disableVectorization, CacheKey);
+  if (!CachedObjects.empty()) {
+    std::vector<std::string> Paths;
+    if (!writeTemporaryObjectFiles(CachedObjects, Paths, errMsg))
+      return false;
+    NativeObjectPath = Paths[0];
+    *name = NativeObjectPath.c_str();
+    pruneCache();
+    return true;
+  }
+
+  if (!optimize(disableInline, disableGVNLoadPRE,
+                disableVectorization, errMsg))
+    return false;
+
+  if (!compileOptimizedToFile(name, errMsg))
+    return false;
+
+  storeCachedObjectFiles(CacheKey, NativeObjectPath);
+  return true;
+}
+
+bool LTOCodeGenerator::compile_to_files(std::vector<const char *> &names,
+                                        bool disableInline,
+                                        bool disableGVNLoadPRE,
+                                        bool disableVectorization,
+                                        std::string &errMsg) {
+  std::string CacheKey;
+  std::vector<std::unique_ptr<MemoryBuffer>> CachedObjects =
+      lookupCachedObjects(Parallelism, disableInline, disableGVNLoadPRE,
+                          disableVectorization, CacheKey);
+  if (!CachedObjects.empty()) {
+    std::vector<std::string> Paths;
+    if (!writeTemporaryObjectFiles(CachedObjects, Paths, errMsg))
+      return false;
+    NativeObjectPaths = std::move(Paths);
+    names.clear();
+    for (const std::string &Path : NativeObjectPaths)
+      names.push_back(Path.c_str());
+    pruneCache();
+    return true;
+  }
+
   if (!optimize(disableInline, disableGVNLoadPRE,
                 disableVectorization, errMsg))
     return false;
 
-  return compileOptimizedToFile(name, errMsg);
+  if (!compileOptimizedToFiles(names, errMsg))
+    return false;
+
+  storeCachedObjectFiles(CacheKey, NativeObjectPaths);
+  return true;
 }
 
 std::unique_ptr<MemoryBuffer>
 LTOCodeGenerator::compile(bool disableInline, bool disableGVNLoadPRE,
                           bool disableVectorization, std::string &errMsg) {
+  std::string CacheKey;
+  std::vector<std::unique_ptr<MemoryBuffer>> CachedObjects =
+      lookupCachedObjects(1, disableInline, disableGVNLoadPRE,
+                          disableVectorization, CacheKey);
+  if (!CachedObjects.empty()) {
+    pruneCache();
+    return std::move(CachedObjects[0]);
+  }
+
   if (!optimize(disableInline, disableGVNLoadPRE,
                 disableVectorization, errMsg))
     return nullptr;
 
-  return compileOptimized(errMsg);
+  std::unique_ptr<MemoryBuffer> Object = compileOptimized(errMsg);
+  if (Object)
+    storeCachedObjects(CacheKey, Object->getBuffer());
+  return Object;
+}
+
+/// Compute the cache key of the objects that compiling the merged module into
+/// \p NumObjects objects would produce, and return the objects if they are in
+/// the cache. \p CacheKey is left empty when the cache is disabled.
+std::vector<std::unique_ptr<MemoryBuffer>>
+LTOCodeGenerator::lookupCachedObjects(unsigned NumObjects, bool DisableInline,
+                                      bool DisableGVNLoadPRE,
+                                      bool DisableVectorization,
+                                      std::string &CacheKey) {
+  if (CacheDir.empty())
+    return {};
+
+  // The compilation reports the error, if any.
+  std::string ErrMsg;
+  if (!determineTarget(ErrMsg))
+    return {};
+
+  NativeObjectCacheKey Key;
+  Key.add(*IRLinker.getModule());
+  Key.add(Options);
+  Key.add(MCpu);
+  Key.add(FeatureStr);
+  Key.add(RelocModel);
+  Key.add(CGOptLevel);
+  Key.add(OptLevel);
+  Key.add(DisableInline);
+  Key.add(DisableGVNLoadPRE);
+  Key.add(DisableVectorization);
+  Key.add(NumObjects);
+  Key.add(ShouldInternalize && !ScopeRestrictionsDone);
+
+  // The symbols that restrict internalization, in a deterministic order.
+  for (const StringSet *Symbols : {&MustPreserveSymbols, &AsmUndefinedRefs}) {
+    std::vector<StringRef> Names;
+    for (const auto &Entry : *Symbols)
+      Names.push_back(Entry.getKey());
+    std::sort(Names.begin(), Names.end());
+    Key.add(Names.size());
+    for (StringRef Name : Names)
+      Key.add(Name);
+  }
+
+  // The options given to the driver and the passes.
+  Key.add(CodegenOptions.size());
+  for (const char *Option : CodegenOptions)
+    Key.add(Option);
+
+  CacheKey = Key.str();
+  return NativeObjectCache(CacheDir).lookup(CacheKey, NumObjects);
+}
+
+/// Store the objects just produced in the cache under \p CacheKey, unless it
+/// is empty, and prune the cache.
+void LTOCodeGenerator::storeCachedObjects(StringRef CacheKey,
+                                          ArrayRef<StringRef> Objects) {
+  if (CacheKey.empty())
+    return;
+
+  NativeObjectCache(CacheDir).store(CacheKey, Objects);
+  pruneCache();
+}
+
+void LTOCodeGenerator::pruneCache() {
+  CachePruning(CacheDir)
+      .setPruningInterval(CachePruningInterval)
+      .setEntryExpiration(CacheEntryExpiration)
+      .setMaxSize(MaxCacheSize)
+      .prune();
+}
+
+void LTOCodeGenerator::storeCachedObjectFiles(StringRef CacheKey,
+                                              ArrayRef<std::string> Paths) {
+  if (CacheKey.empty())
+    return;
+
+  std::vector<std::unique_ptr<MemoryBuffer>> Buffers;
+  std::vector<StringRef> Objects;
+  for (const std::string &Path : Paths) {
+    ErrorOr<std::unique_ptr<MemoryBuffer>> BufferOrErr =
+        MemoryBuffer::getFile(Path, -1, false);
+    if (!BufferOrErr)
+      return;
+    Objects.push_back((*BufferOrErr)->getBuffer());
+    Buffers.push_back(std::move(*BufferOrErr));
+  }
+  storeCachedObjects(CacheKey, Objects);
 }
 
 bool LTOCodeGenerator::determineTarget(std::string &errMsg) {
@@ -310,7 +541,7 @@ bool LTOCodeGenerator::determineTarget(std::string &errMsg) {
 
   // The relocation model is actually a static member of TargetMachine and
   // needs to be set before the TargetMachine is instantiated.
-  Reloc::Model RelocModel = Reloc::Default;
+  RelocModel = Reloc::Default;
   switch (CodeModel) {
   case LTO_CODEGEN_PIC_MODEL_STATIC:
     RelocModel = Reloc::Static;
@@ -330,7 +561,7 @@ bool LTOCodeGenerator::determineTarget(std::string &errMsg) {
   // the default set of features.
   SubtargetFeatures Features(MAttr);
   Features.getDefaultSubtargetFeatures(Triple);
-  std::string FeatureStr = Features.getString();
+  FeatureStr = Features.getString();
   // Set a default CPU for Darwin triples.
   if (MCpu.empty() && Triple.isOSDarwin()) {
     if (Triple.getArch() == llvm::Triple::x86_64)
@@ -341,7 +572,6 @@ bool LTOCodeGenerator::determineTarget(std::string &errMsg) {
       MCpu = "cyclone";
   }
 
-  CodeGenOpt::Level CGOptLevel;
   switch (OptLevel) {
   case 0:
     CGOptLevel = CodeGenOpt::None;
@@ -517,6 +747,9 @@ bool LTOCodeGenerator::optimize(bool DisableInline,
   // Mark which symbols can not be internalized
   this->applyScopeRestrictions();
 
+  TimeTraceScope TraceScope("LTO optimize",
+                            mergedModule->getModuleIdentifier());
+
   // Instantiate the pass manager to organize the passes.
   legacy::PassManager passes;
 
@@ -546,20 +779,41 @@ bool LTOCodeGenerator::optimize(bool DisableInline,
   return true;
 }
 
-bool LTOCodeGenerator::compileOptimized(raw_pwrite_stream &out,
+bool LTOCodeGenerator::compileOptimized(ArrayRef<raw_pwrite_stream *> Out,
                                         std::string &errMsg) {
   if (!this->determineTarget(errMsg))
     return false;
 
   Module *mergedModule = IRLinker.getModule();
 
+  if (Out.size() > 1) {
+    // If the bitcode files contain ARC code and were compiled with
+    // optimization, the ObjCARCContractPass must be run, so do it
+    // unconditionally here, before splitting the module.
+    legacy::PassManager preCodeGenPasses;
+    preCodeGenPasses.add(createObjCARCContractPass());
+    preCodeGenPasses.run(*mergedModule);
+
+    // Each partition gets its own TargetMachine, created with the same
+    // parameters as TargetMach, for the triple recorded in the module.
+    if (mergedModule->getTargetTriple().empty())
+      mergedModule->setTargetTriple(TargetMach->getTargetTriple().str());
+    bool Result =
+        splitCodeGen(*mergedModule, Out, MCpu, FeatureStr, Options, errMsg,
+                     RelocModel, CodeModel::Default, CGOptLevel);
+    // The clients of libLTO do not necessarily call llvm_shutdown.
+    writePassReport();
+    writeTimeTrace();
+    return Result;
+  }
+
   legacy::PassManager codeGenPasses;
 
   // If the bitcode files contain ARC code and were compiled with optimization,
   // the ObjCARCContractPass must be run, so do it unconditionally here.
   codeGenPasses.add(createObjCARCContractPass());
 
-  if (TargetMach->addPassesToEmitFile(codeGenPasses, out,
+  if (TargetMach->addPassesToEmitFile(codeGenPasses, *Out[0],
                                       TargetMachine::CGFT_ObjectFile)) {
     errMsg = "target file type not supported";
     return false;
@@ -568,6 +822,9 @@ bool LTOCodeGenerator::compileOptimized(raw_pwrite_stream &out,
   // Run the code generator, and write assembly file
   codeGenPasses.run(*mergedModule);
 
+  // The clients of libLTO do not necessarily call llvm_shutdown.
+  writePassReport();
+  writeTimeTrace();
   return true;
 }
 
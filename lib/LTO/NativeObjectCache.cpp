@@ -0,0 +1,162 @@
+//===-NativeObjectCache.cpp - Cache of the native objects produced by LTO -===//
+//
+//                     The LLVM Compiler Infrastructure
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+//
+// This file implements the on-disk cache of the native objects produced by LTO
+// code generation.
+//
+//===----------------------------------------------------------------------===//
+
+#include "llvm/LTO/NativeObjectCache.h"
+#include "llvm/ADT/SmallString.h"
+#include "llvm/ADT/StringExtras.h"
+#include "llvm/Bitcode/ReaderWriter.h"
+#include "llvm/Config/llvm-config.h"
+#include "llvm/Support/FileSystem.h"
+#include "llvm/Support/LockFileManager.h"
+#include "llvm/Support/MemoryBuffer.h"
+#include "llvm/Support/Path.h"
+#include "llvm/Support/Process.h"
+#include "llvm/Support/raw_ostream.h"
+#include "llvm/Target/TargetOptions.h"
+
+using namespace llvm;
+
+NativeObjectCacheKey::NativeObjectCacheKey() { add(LLVM_VERSION_STRING); }
+
+void NativeObjectCacheKey::add(const Module &M) {
+  SmallString<0> Bitcode;
+  {
+    raw_svector_ostream OS(Bitcode);
+    WriteBitcodeToFile(&M, OS);
+  }
+  add(Bitcode);
+}
+
+void NativeObjectCacheKey::add(const TargetOptions &Options) {
+  add(Options.PrintMachineCode);
+  add(Options.LessPreciseFPMADOption);
+  add(Options.UnsafeFPMath);
+  add(Options.NoInfsFPMath);
+  add(Options.NoNaNsFPMath);
+  add(Options.HonorSignDependentRoundingFPMathOption);
+  add(Options.NoZerosInBSS);
+  add(Options.GuaranteedTailCallOpt);
+  add(Options.StackAlignmentOverride);
+  add(Options.EnableFastISel);
+  add(Options.PositionIndependentExecutable);
+  add(Options.UseInitArray);
+  add(Options.DisableIntegratedAS);
+  add(Options.CompressDebugSections);
+  add(Options.FunctionSections);
+  add(Options.DataSections);
+  add(Options.UniqueSectionNames);
+  add(Options.TrapUnreachable);
+  add(Options.TrapFuncName);
+  add(Options.FloatABIType);
+  add(Options.AllowFPOpFusion);
+  // Reciprocals cannot be queried before the target sets its defaults. It only
+  // differs from them with -mrecip, which is part of the code generator
+  // options that the clients add to the key.
+  add(Options.JTType);
+  add(Options.ThreadModel);
+
+  const MCTargetOptions &MCOptions = Options.MCOptions;
+  add(MCOptions.SanitizeAddress);
+  add(MCOptions.MCRelaxAll);
+  add(MCOptions.MCNoExecStack);
+  add(MCOptions.MCFatalWarnings);
+  add(MCOptions.MCSaveTempLabels);
+  add(MCOptions.MCUseDwarfDirectory);
+  add(MCOptions.ShowMCEncoding);
+  add(MCOptions.ShowMCInst);
+  add(MCOptions.AsmVerbose);
+  add(MCOptions.DwarfVersion);
+  add(MCOptions.ABIName);
+}
+
+void NativeObjectCacheKey::add(StringRef Str) {
+  // Prefix with the size, so that consecutive strings cannot be confused.
+  add(Str.size());
+  Hasher.update(Str);
+}
+
+void NativeObjectCacheKey::add(uint64_t Value) {
+  uint8_t Data[8];
+  for (unsigned I = 0; I != 8; ++I)
+    Data[I] = uint8_t(Value >> (I * 8));
+  Hasher.update(Data);
+}
+
+std::string NativeObjectCacheKey::str() {
+  MD5::MD5Result Result;
+  Hasher.final(Result);
+  SmallString<32> Str;
+  MD5::stringifyResult(Result, Str);
+  return Str.str();
+}
+
+std::string NativeObjectCache::getObjectPath(StringRef Key, unsigned I) const {
+  SmallString<128> ObjectPath(Path);
+  sys::path::append(ObjectPath, "llvmcache-" + Key + "-" + utostr(I));
+  return ObjectPath.str();
+}
+
+std::vector<std::unique_ptr<MemoryBuffer>>
+NativeObjectCache::lookup(StringRef Key, unsigned NumObjects) {
+  std::vector<std::unique_ptr<MemoryBuffer>> Objects;
+  for (unsigned I = 0; I != NumObjects; ++I) {
+    std::string ObjectPath = getObjectPath(Key, I);
+    int FD;
+    if (sys::fs::openFileForRead(ObjectPath, FD))
+      return {};
+    ErrorOr<std::unique_ptr<MemoryBuffer>> BufferOrErr =
+        MemoryBuffer::getOpenFile(FD, ObjectPath, -1,
+                                  /*RequiresNullTerminator=*/false);
+    // Pruning removes the least recently modified entries first.
+    if (BufferOrErr)
+      sys::fs::setLastModificationAndAccessTime(FD, sys::TimeValue::now());
+    sys::Process::SafelyCloseFileDescriptor(FD);
+    if (!BufferOrErr)
+      return {};
+    Objects.push_back(std::move(*BufferOrErr));
+  }
+  return Objects;
+}
+
+void NativeObjectCache::store(StringRef Key, ArrayRef<StringRef> Objects) {
+  if (sys::fs::create_directories(Path))
+    return;
+
+  SmallString<128> EntryPath(Path);
+  sys::path::append(EntryPath, "llvmcache-" + Key);
+  LockFileManager Lock(EntryPath);
+  if (Lock != LockFileManager::LFS_Owned)
+    return;
+
+  for (unsigned I = 0, E = Objects.size(); I != E; ++I) {
+    // Write to a temporary file first, and rename it into place so that a
+    // lookup never sees a partially written object.
+    SmallString<128> TempPath;
+    int FD;
+    if (sys::fs::createUniqueFile(EntryPath + "-tmp-%%%%%%%%", FD, TempPath))
+      return;
+    raw_fd_ostream OS(FD, /*shouldClose=*/true);
+    OS << Objects[I];
+    OS.close();
+    if (OS.has_error()) {
+      OS.clear_error();
+      sys::fs::remove(TempPath);
+      return;
+    }
+    if (sys::fs::rename(TempPath, getObjectPath(Key, I))) {
+      sys::fs::remove(TempPath);
+      return;
+    }
+  }
+}
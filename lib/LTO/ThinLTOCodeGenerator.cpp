@@ -0,0 +1,253 @@
+//===-ThinLTOCodeGenerator.cpp - LLVM Link Time Optimizer -----------------===//
+//
+//                     The LLVM Compiler Infrastructure
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+//
+// This file implements the Thin Link Time Optimization library. This library
+// is intended to be used by linker to optimize code at link time.
+//
+//===----------------------------------------------------------------------===//
+
+#include "llvm/LTO/ThinLTOCodeGenerator.h"
+#include "llvm/ADT/STLExtras.h"
+#include "llvm/ADT/SmallString.h"
+#include "llvm/ADT/StringMap.h"
+#include "llvm/ADT/Triple.h"
+#include "llvm/Analysis/TargetLibraryInfo.h"
+#include "llvm/Analysis/TargetTransformInfo.h"
+#include "llvm/Bitcode/ReaderWriter.h"
+#include "llvm/IR/FunctionInfo.h"
+#include "llvm/IR/LLVMContext.h"
+#include "llvm/IR/LegacyPassManager.h"
+#include "llvm/IR/Module.h"
+#include "llvm/LTO/NativeObjectCache.h"
+#include "llvm/MC/SubtargetFeature.h"
+#include "llvm/Support/CachePruning.h"
+#include "llvm/Support/Host.h"
+#include "llvm/Support/TargetRegistry.h"
+#include "llvm/Support/ThreadPool.h"
+#include "llvm/Support/raw_ostream.h"
+#include "llvm/Target/TargetMachine.h"
+#include "llvm/Transforms/IPO.h"
+#include "llvm/Transforms/IPO/FunctionImport.h"
+#include "llvm/Transforms/IPO/PassManagerBuilder.h"
+#include "llvm/Transforms/ObjCARC.h"
+#include <mutex>
+
+using namespace llvm;
+
+void ThinLTOCodeGenerator::addModule(StringRef Identifier, StringRef Data) {
+  Modules.push_back(MemoryBufferRef(Data, Identifier));
+}
+
+std::unique_ptr<FunctionInfoIndex>
+ThinLTOCodeGenerator::linkCombinedIndex(std::string &ErrMsg) {
+  auto CombinedIndex = llvm::make_unique<FunctionInfoIndex>();
+  for (MemoryBufferRef ModBuffer : Modules) {
+    if (hasFunctionSummary(ModBuffer, nullptr)) {
+      ErrorOr<std::unique_ptr<FunctionInfoIndex>> IndexOrErr =
+          getFunctionInfoIndex(ModBuffer, nullptr);
+      if (std::error_code EC = IndexOrErr.getError()) {
+        ErrMsg = "error reading the function summary of '" +
+                 ModBuffer.getBufferIdentifier().str() + "': " + EC.message();
+        return nullptr;
+      }
+      CombinedIndex->mergeFrom(std::move(*IndexOrErr));
+      continue;
+    }
+
+    // Compute the summaries of a module emitted without them. Only this
+    // module is alive while doing so.
+    LLVMContext Context;
+    ErrorOr<std::unique_ptr<Module>> ModuleOrErr =
+        parseBitcodeFile(ModBuffer, Context);
+    if (std::error_code EC = ModuleOrErr.getError()) {
+      ErrMsg = "error loading '" + ModBuffer.getBufferIdentifier().str() +
+               "': " + EC.message();
+      return nullptr;
+    }
+    CombinedIndex->mergeFrom(buildFunctionInfoIndex(
+        **ModuleOrErr, ModBuffer.getBufferIdentifier()));
+  }
+  return CombinedIndex;
+}
+
+bool ThinLTOCodeGenerator::crossModuleImport(Module &TheModule,
+                                             const FunctionInfoIndex &Index) {
+  StringMap<MemoryBufferRef> ModuleMap;
+  for (MemoryBufferRef ModBuffer : Modules)
+    ModuleMap[ModBuffer.getBufferIdentifier()] = ModBuffer;
+
+  // Source modules are loaded lazily, in the context of the destination
+  // module: only the imported function bodies are materialized.
+  auto ModuleLoader = [&](StringRef Identifier,
+                          LLVMContext &Context) -> std::unique_ptr<Module> {
+    auto I = ModuleMap.find(Identifier);
+    if (I == ModuleMap.end())
+      return nullptr;
+    ErrorOr<std::unique_ptr<Module>> ModuleOrErr = getLazyBitcodeModule(
+        MemoryBuffer::getMemBuffer(I->second, /*RequiresNullTerminator=*/false),
+        Context);
+    if (ModuleOrErr.getError())
+      return nullptr;
+    return std::move(*ModuleOrErr);
+  };
+
+  FunctionImporter Importer(Index, ModuleLoader);
+  return Importer.importFunctions(TheModule);
+}
+
+std::unique_ptr<MemoryBuffer>
+ThinLTOCodeGenerator::optimizeAndCodegen(Module &TheModule,
+                                         std::string &ErrMsg) {
+  std::string TripleStr = TheModule.getTargetTriple();
+  if (TripleStr.empty())
+    TripleStr = sys::getDefaultTargetTriple();
+  Triple TheTriple(TripleStr);
+
+  const Target *TheTarget = TargetRegistry::lookupTarget(TripleStr, ErrMsg);
+  if (!TheTarget)
+    return nullptr;
+
+  SubtargetFeatures Features(MAttr);
+  Features.getDefaultSubtargetFeatures(TheTriple);
+
+  CodeGenOpt::Level CGOptLevel;
+  switch (OptLevel) {
+  case 0:
+    CGOptLevel = CodeGenOpt::None;
+    break;
+  case 1:
+    CGOptLevel = CodeGenOpt::Less;
+    break;
+  case 3:
+    CGOptLevel = CodeGenOpt::Aggressive;
+    break;
+  default:
+    CGOptLevel = CodeGenOpt::Default;
+    break;
+  }
+
+  std::unique_ptr<TargetMachine> TM(TheTarget->createTargetMachine(
+      TripleStr, MCpu, Features.getString(), Options, RelocModel,
+      CodeModel::Default, CGOptLevel));
+  TheModule.setDataLayout(*TM->getDataLayout());
+
+  // The regular per-module pipeline: the module is not the whole program, so
+  // nothing can be internalized, but the imported definitions can be inlined.
+  legacy::PassManager Passes;
+  Passes.add(createTargetTransformInfoWrapperPass(TM->getTargetIRAnalysis()));
+
+  PassManagerBuilder PMB;
+  PMB.LibraryInfo = new TargetLibraryInfoImpl(TheTriple);
+  PMB.Inliner = createFunctionInliningPass();
+  PMB.OptLevel = OptLevel;
+  PMB.LoopVectorize = true;
+  PMB.SLPVectorize = true;
+  PMB.VerifyInput = true;
+  PMB.VerifyOutput = false;
+  PMB.populateModulePassManager(Passes);
+
+  // The imported definitions that were not inlined are not code generated.
+  Passes.run(TheModule);
+
+  SmallString<0> OutputBuffer;
+  {
+    raw_svector_ostream OS(OutputBuffer);
+    legacy::PassManager CodeGenPasses;
+    // If the bitcode files contain ARC code and were compiled with
+    // optimization, the ObjCARCContractPass must be run.
+    CodeGenPasses.add(createObjCARCContractPass());
+    if (TM->addPassesToEmitFile(CodeGenPasses, OS,
+                                TargetMachine::CGFT_ObjectFile)) {
+      ErrMsg = "target file type not supported";
+      return nullptr;
+    }
+    CodeGenPasses.run(TheModule);
+  }
+  return MemoryBuffer::getMemBufferCopy(OutputBuffer,
+                                        TheModule.getModuleIdentifier());
+}
+
+bool ThinLTOCodeGenerator::run(std::string &ErrMsg) {
+  std::unique_ptr<FunctionInfoIndex> Index = linkCombinedIndex(ErrMsg);
+  if (!Index)
+    return false;
+
+  ProducedBinaries.clear();
+  ProducedBinaries.resize(Modules.size());
+
+  std::mutex ErrorLock;
+  std::string FirstError;
+  {
+    ThreadPool Pool(ThreadCount ? ThreadCount
+                                : ThreadPool::getDefaultThreadCount());
+    for (unsigned I = 0, E = Modules.size(); I != E; ++I) {
+      Pool.async([&, I]() {
+        std::string TaskErrMsg;
+        MemoryBufferRef ModBuffer = Modules[I];
+
+        // Each module gets its own context, so that the modules can be
+        // processed concurrently and freed as soon as they are done.
+        LLVMContext Context;
+        ErrorOr<std::unique_ptr<Module>> ModuleOrErr =
+            parseBitcodeFile(ModBuffer, Context);
+        if (std::error_code EC = ModuleOrErr.getError()) {
+          TaskErrMsg = "error loading '" +
+                       ModBuffer.getBufferIdentifier().str() +
+                       "': " + EC.message();
+        } else {
+          Module &TheModule = **ModuleOrErr;
+          crossModuleImport(TheModule, *Index);
+
+          std::string CacheKey;
+          if (!CacheDir.empty()) {
+            NativeObjectCacheKey Key;
+            Key.add(TheModule);
+            Key.add(Options);
+            Key.add(MCpu);
+            Key.add(MAttr);
+            Key.add(RelocModel);
+            Key.add(OptLevel);
+            CacheKey = Key.str();
+            std::vector<std::unique_ptr<MemoryBuffer>> CachedObjects =
+                NativeObjectCache(CacheDir).lookup(CacheKey, 1);
+            if (!CachedObjects.empty())
+              ProducedBinaries[I] = std::move(CachedObjects[0]);
+          }
+
+          if (!ProducedBinaries[I]) {
+            ProducedBinaries[I] = optimizeAndCodegen(TheModule, TaskErrMsg);
+            if (ProducedBinaries[I] && !CacheKey.empty())
+              NativeObjectCache(CacheDir).store(
+                  CacheKey, ProducedBinaries[I]->getBuffer());
+          }
+        }
+
+        if (!ProducedBinaries[I]) {
+          std::lock_guard<std::mutex> Lock(ErrorLock);
+          if (FirstError.empty())
+            FirstError = TaskErrMsg;
+        }
+      });
+    }
+  }
+
+  if (!CacheDir.empty())
+    CachePruning(CacheDir)
+        .setPruningInterval(CachePruningInterval)
+        .setEntryExpiration(CacheEntryExpiration)
+        .setMaxSize(MaxCacheSize)
+        .prune();
+
+  if (!FirstError.empty()) {
+    ErrMsg = FirstError;
+    ProducedBinaries.clear();
+    return false;
+  }
+  return true;
+}
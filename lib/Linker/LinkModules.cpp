@@ -28,6 +28,7 @@
 #include "llvm/IR/TypeFinder.h"
 #include "llvm/Support/CommandLine.h"
 #include "llvm/Support/Debug.h"
+#include "llvm/Support/TimeTrace.h"
 #include "llvm/Support/raw_ostream.h"
 #include "llvm/Transforms/Utils/Cloning.h"
 #include <cctype>
@@ -1760,6 +1761,7 @@ void Linker::deleteModule() {
 }
 
 bool Linker::linkInModule(Module *Src, bool OverrideSymbols) {
+  TimeTraceScope TraceScope("Link module", Src->getModuleIdentifier());
   ModuleLinker TheLinker(Composite, IdentifiedStructTypes, Src,
                          DiagnosticHandler, OverrideSymbols);
   bool RetCode = TheLinker.run();
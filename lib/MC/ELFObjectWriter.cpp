@@ -28,17 +28,34 @@
 #include "llvm/MC/MCSymbolELF.h"
 #include "llvm/MC/MCValue.h"
 #include "llvm/MC/StringTableBuilder.h"
+#include "llvm/Support/CommandLine.h"
 #include "llvm/Support/Compression.h"
 #include "llvm/Support/Debug.h"
 #include "llvm/Support/ELF.h"
 #include "llvm/Support/Endian.h"
 #include "llvm/Support/ErrorHandling.h"
+#include "llvm/Support/ThreadPool.h"
 #include <vector>
 using namespace llvm;
 
 #undef  DEBUG_TYPE
 #define DEBUG_TYPE "reloc-info"
 
+static cl::opt<unsigned>
+ELFWriterThreads("elf-writer-threads", cl::Hidden,
+                 cl::desc("Number of threads writing the section contents and "
+                          "the relocations of ELF objects, and sorting their "
+                          "string table (0 = number of hardware threads)"),
+                 cl::init(1));
+
+// The contents are written in batches, to bound the memory holding the
+// sections that were written but are not in the output yet.
+static cl::opt<unsigned>
+ELFWriterBatchSize("elf-writer-batch-size", cl::Hidden,
+                   cl::desc("Number of bytes of the sections written at the "
+                            "same time with -elf-writer-threads"),
+                   cl::init(16 << 20));
+
 namespace {
 
 typedef DenseMap<const MCSectionELF *, uint32_t> SectionIndexMapTy;
@@ -68,6 +85,26 @@ public:
   ArrayRef<uint32_t> getShndxIndexes() const { return ShndxIndexes; }
 };
 
+/// An object writer that only writes the contents of a section to its own
+/// stream, so that sections can be written concurrently.
+class SectionContentsWriter : public MCObjectWriter {
+public:
+  SectionContentsWriter(raw_pwrite_stream &OS, bool IsLittleEndian)
+      : MCObjectWriter(OS, IsLittleEndian) {}
+
+  void executePostLayoutBinding(MCAssembler &, const MCAsmLayout &) override {
+    llvm_unreachable("not an object writer");
+  }
+  void recordRelocation(MCAssembler &, const MCAsmLayout &,
+                        const MCFragment *, const MCFixup &, MCValue, bool &,
+                        uint64_t &) override {
+    llvm_unreachable("not an object writer");
+  }
+  void writeObject(MCAssembler &, const MCAsmLayout &) override {
+    llvm_unreachable("not an object writer");
+  }
+};
+
 class ELFObjectWriter : public MCObjectWriter {
     static bool isFixupKindPCRel(const MCAssembler &Asm, unsigned Kind);
     static uint64_t SymbolValue(const MCSymbol &Sym, const MCAsmLayout &Layout);
@@ -158,11 +195,13 @@ class ELFObjectWriter : public MCObjectWriter {
         write32(W);
     }
 
-    template <typename T> void write(T Val) {
+    template <typename T> void write(T Val) { write(OS, Val); }
+
+    template <typename T> void write(raw_ostream &Out, T Val) {
       if (IsLittleEndian)
-        support::endian::Writer<support::little>(OS).write(Val);
+        support::endian::Writer<support::little>(Out).write(Val);
       else
-        support::endian::Writer<support::big>(OS).write(Val);
+        support::endian::Writer<support::big>(Out).write(Val);
     }
 
     void writeHeader(const MCAssembler &Asm);
@@ -217,7 +256,21 @@ class ELFObjectWriter : public MCObjectWriter {
                           uint32_t Link, uint32_t Info, uint64_t Alignment,
                           uint64_t EntrySize);
 
-    void writeRelocations(const MCAssembler &Asm, const MCSectionELF &Sec);
+    void writeRelocations(const MCAssembler &Asm, const MCSectionELF &Sec,
+                          raw_ostream &Out);
+
+    /// Write the sections of \p Sections, whose sizes are \p Sizes, one
+    /// after the other at the current offset, and record their offsets.
+    ///
+    /// The offsets are computed first. The contents are then written by
+    /// \p WriteContents on \p NumThreads threads, each section to its own
+    /// buffer, and the buffers are written to the output in order.
+    void writeSectionsInParallel(
+        ArrayRef<const MCSectionELF *> Sections, ArrayRef<uint64_t> Sizes,
+        unsigned NumThreads,
+        std::function<void(const MCSectionELF &, raw_pwrite_stream &)>
+            WriteContents,
+        SectionOffsetsTy &SectionOffsets);
 
     bool isSymbolRefDifferenceFullyResolvedImpl(const MCAssembler &Asm,
                                                 const MCSymbol &SymA,
@@ -878,7 +931,7 @@ void ELFObjectWriter::computeSymbolTable(
   for (const std::string &Name : FileNames)
     StrTabBuilder.add(Name);
 
-  StrTabBuilder.finalize(StringTableBuilder::ELF);
+  StrTabBuilder.finalize(StringTableBuilder::ELF, ELFWriterThreads);
 
   for (const std::string &Name : FileNames)
     Writer.writeSymbol(StrTabBuilder.getOffset(Name),
@@ -1058,8 +1111,9 @@ void ELFObjectWriter::WriteSecHdrEntry(uint32_t Name, uint32_t Type,
 }
 
 void ELFObjectWriter::writeRelocations(const MCAssembler &Asm,
-                                       const MCSectionELF &Sec) {
-  std::vector<ELFRelocationEntry> &Relocs = Relocations[&Sec];
+                                       const MCSectionELF &Sec,
+                                       raw_ostream &Out) {
+  std::vector<ELFRelocationEntry> &Relocs = Relocations.find(&Sec)->second;
 
   // Sort the relocation entries. Most targets just sort by Offset, but some
   // (e.g., MIPS) have additional constraints.
@@ -1070,30 +1124,30 @@ void ELFObjectWriter::writeRelocations(const MCAssembler &Asm,
     unsigned Index = Entry.Symbol ? Entry.Symbol->getIndex() : 0;
 
     if (is64Bit()) {
-      write(Entry.Offset);
+      write(Out, Entry.Offset);
       if (TargetObjectWriter->isN64()) {
-        write(uint32_t(Index));
+        write(Out, uint32_t(Index));
 
-        write(TargetObjectWriter->getRSsym(Entry.Type));
-        write(TargetObjectWriter->getRType3(Entry.Type));
-        write(TargetObjectWriter->getRType2(Entry.Type));
-        write(TargetObjectWriter->getRType(Entry.Type));
+        write(Out, TargetObjectWriter->getRSsym(Entry.Type));
+        write(Out, TargetObjectWriter->getRType3(Entry.Type));
+        write(Out, TargetObjectWriter->getRType2(Entry.Type));
+        write(Out, TargetObjectWriter->getRType(Entry.Type));
       } else {
         struct ELF::Elf64_Rela ERE64;
         ERE64.setSymbolAndType(Index, Entry.Type);
-        write(ERE64.r_info);
+        write(Out, ERE64.r_info);
       }
       if (hasRelocationAddend())
-        write(Entry.Addend);
+        write(Out, Entry.Addend);
     } else {
-      write(uint32_t(Entry.Offset));
+      write(Out, uint32_t(Entry.Offset));
 
       struct ELF::Elf32_Rela ERE32;
       ERE32.setSymbolAndType(Index, Entry.Type);
-      write(ERE32.r_info);
+      write(Out, ERE32.r_info);
 
       if (hasRelocationAddend())
-        write(uint32_t(Entry.Addend));
+        write(Out, uint32_t(Entry.Addend));
     }
   }
 }
@@ -1184,6 +1238,58 @@ void ELFObjectWriter::writeSectionHeader(
   }
 }
 
+void ELFObjectWriter::writeSectionsInParallel(
+    ArrayRef<const MCSectionELF *> Sections, ArrayRef<uint64_t> Sizes,
+    unsigned NumThreads,
+    std::function<void(const MCSectionELF &, raw_pwrite_stream &)>
+        WriteContents,
+    SectionOffsetsTy &SectionOffsets) {
+  // Lay out the sections first.
+  uint64_t Offset = OS.tell();
+  for (unsigned I = 0, E = Sections.size(); I != E; ++I) {
+    Offset = RoundUpToAlignment(Offset, Sections[I]->getAlignment());
+    SectionOffsets[Sections[I]] = std::make_pair(Offset, Offset + Sizes[I]);
+    Offset += Sizes[I];
+  }
+
+  // Then write them in batches of about ELFWriterBatchSize bytes. Each task
+  // writes a run of small consecutive sections, or a large one.
+  const uint64_t TaskSize = 64 * 1024;
+  ThreadPool Pool(NumThreads);
+  std::vector<SmallVector<char, 0>> Buffers;
+  for (unsigned Begin = 0, E = Sections.size(); Begin != E;) {
+    unsigned End = Begin;
+    uint64_t BatchSize = 0;
+    while (End != E && (End == Begin || BatchSize < ELFWriterBatchSize))
+      BatchSize += Sizes[End++];
+
+    Buffers.clear();
+    Buffers.resize(End - Begin);
+    for (unsigned TaskBegin = Begin; TaskBegin != End;) {
+      unsigned TaskEnd = TaskBegin;
+      for (uint64_t Size = 0; TaskEnd != End && Size < TaskSize; ++TaskEnd)
+        Size += Sizes[TaskEnd];
+      Pool.async([&, Begin, TaskBegin, TaskEnd]() {
+        for (unsigned I = TaskBegin; I != TaskEnd; ++I) {
+          raw_svector_ostream Out(Buffers[I - Begin]);
+          WriteContents(*Sections[I], Out);
+        }
+      });
+      TaskBegin = TaskEnd;
+    }
+    Pool.wait();
+
+    for (unsigned I = Begin; I != End; ++I) {
+      align(Sections[I]->getAlignment());
+      const SmallVector<char, 0> &Buffer = Buffers[I - Begin];
+      assert(OS.tell() == SectionOffsets[Sections[I]].first &&
+             Buffer.size() == Sizes[I] && "Section written out of place");
+      OS.write(Buffer.data(), Buffer.size());
+    }
+    Begin = End;
+  }
+}
+
 void ELFObjectWriter::writeObject(MCAssembler &Asm,
                                   const MCAsmLayout &Layout) {
   MCContext &Ctx = Asm.getContext();
@@ -1196,27 +1302,55 @@ void ELFObjectWriter::writeObject(MCAssembler &Asm,
 
   std::map<const MCSymbol *, std::vector<const MCSectionELF *>> GroupMembers;
 
+  // The section contents and the relocations can be written on several
+  // threads, unless the debug sections are compressed, since their sizes are
+  // only known once they are.
+  unsigned NumThreads = ELFWriterThreads;
+  if (!NumThreads)
+    NumThreads = ThreadPool::getDefaultThreadCount();
+  if (Ctx.getAsmInfo()->compressDebugSections())
+    NumThreads = 1;
+
   // Write out the ELF header ...
   writeHeader(Asm);
 
   // ... then the sections ...
   SectionOffsetsTy SectionOffsets;
-  std::vector<MCSectionELF *> Groups;
-  std::vector<MCSectionELF *> Relocations;
-  for (MCSection &Sec : Asm) {
-    MCSectionELF &Section = static_cast<MCSectionELF &>(Sec);
+  if (NumThreads > 1) {
+    std::vector<const MCSectionELF *> Sections;
+    std::vector<uint64_t> Sizes;
+    for (MCSection &Sec : Asm) {
+      Sections.push_back(&static_cast<MCSectionELF &>(Sec));
+      Sizes.push_back(Layout.getSectionFileSize(&Sec));
+    }
+    writeSectionsInParallel(
+        Sections, Sizes, NumThreads,
+        [&](const MCSectionELF &Section, raw_pwrite_stream &Out) {
+          SectionContentsWriter Writer(Out, IsLittleEndian);
+          Asm.writeSectionData(&Section, Layout, Writer);
+        },
+        SectionOffsets);
+  } else {
+    for (MCSection &Sec : Asm) {
+      MCSectionELF &Section = static_cast<MCSectionELF &>(Sec);
 
-    align(Section.getAlignment());
+      align(Section.getAlignment());
 
-    // Remember the offset into the file for this section.
-    uint64_t SecStart = OS.tell();
+      // Remember the offset into the file for this section.
+      uint64_t SecStart = OS.tell();
 
-    const MCSymbolELF *SignatureSymbol = Section.getGroup();
-    writeSectionData(Asm, Section, Layout);
+      writeSectionData(Asm, Section, Layout);
 
-    uint64_t SecEnd = OS.tell();
-    SectionOffsets[&Section] = std::make_pair(SecStart, SecEnd);
+      uint64_t SecEnd = OS.tell();
+      SectionOffsets[&Section] = std::make_pair(SecStart, SecEnd);
+    }
+  }
 
+  std::vector<MCSectionELF *> Groups;
+  std::vector<MCSectionELF *> Relocations;
+  for (MCSection &Sec : Asm) {
+    MCSectionELF &Section = static_cast<MCSectionELF &>(Sec);
+    const MCSymbolELF *SignatureSymbol = Section.getGroup();
     MCSectionELF *RelSection = createRelocationSection(Ctx, Section);
 
     if (SignatureSymbol) {
@@ -1263,16 +1397,32 @@ void ELFObjectWriter::writeObject(MCAssembler &Asm,
   // Compute symbol table information.
   computeSymbolTable(Asm, Layout, SectionIndexMap, RevGroupMap, SectionOffsets);
 
-  for (MCSectionELF *RelSection : Relocations) {
-    align(RelSection->getAlignment());
+  if (NumThreads > 1) {
+    std::vector<const MCSectionELF *> Sections(Relocations.begin(),
+                                               Relocations.end());
+    std::vector<uint64_t> Sizes;
+    for (const MCSectionELF *RelSection : Sections)
+      Sizes.push_back(RelSection->getEntrySize() *
+                      this->Relocations[RelSection->getAssociatedSection()]
+                          .size());
+    writeSectionsInParallel(
+        Sections, Sizes, NumThreads,
+        [&](const MCSectionELF &RelSection, raw_pwrite_stream &Out) {
+          writeRelocations(Asm, *RelSection.getAssociatedSection(), Out);
+        },
+        SectionOffsets);
+  } else {
+    for (MCSectionELF *RelSection : Relocations) {
+      align(RelSection->getAlignment());
 
-    // Remember the offset into the file for this section.
-    uint64_t SecStart = OS.tell();
+      // Remember the offset into the file for this section.
+      uint64_t SecStart = OS.tell();
 
-    writeRelocations(Asm, *RelSection->getAssociatedSection());
+      writeRelocations(Asm, *RelSection->getAssociatedSection(), OS);
 
-    uint64_t SecEnd = OS.tell();
-    SectionOffsets[RelSection] = std::make_pair(SecStart, SecEnd);
+      uint64_t SecEnd = OS.tell();
+      SectionOffsets[RelSection] = std::make_pair(SecStart, SecEnd);
+    }
   }
 
   {
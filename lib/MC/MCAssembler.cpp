@@ -28,6 +28,7 @@
 #include "llvm/Support/ErrorHandling.h"
 #include "llvm/Support/LEB128.h"
 #include "llvm/Support/TargetRegistry.h"
+#include "llvm/Support/TimeTrace.h"
 #include "llvm/Support/raw_ostream.h"
 #include <tuple>
 using namespace llvm;
@@ -54,6 +55,9 @@ STATISTIC(FragmentLayouts, "Number of fragment layouts");
 STATISTIC(ObjectBytes, "Number of emitted object file bytes");
 STATISTIC(RelaxationSteps, "Number of assembler layout and relaxation steps");
 STATISTIC(RelaxedInstructions, "Number of relaxed instructions");
+STATISTIC(SectionRelaxationSteps,
+          "Number of relaxation iterations over the sections");
+STATISTIC(RelaxationChecks, "Number of fragments checked for relaxation");
 }
 }
 
@@ -650,10 +654,9 @@ void MCAssembler::writeFragmentPadding(const MCFragment &F, uint64_t FSize,
   }
 }
 
-/// \brief Write the fragment \p F to the output file.
+/// \brief Write the fragment \p F with the object writer \p OW.
 static void writeFragment(const MCAssembler &Asm, const MCAsmLayout &Layout,
-                          const MCFragment &F) {
-  MCObjectWriter *OW = &Asm.getWriter();
+                          const MCFragment &F, MCObjectWriter *OW) {
 
   // FIXME: Embed in fragments instead?
   uint64_t FragmentSize = Asm.computeFragmentSize(Layout, F);
@@ -781,6 +784,12 @@ static void writeFragment(const MCAssembler &Asm, const MCAsmLayout &Layout,
 
 void MCAssembler::writeSectionData(const MCSection *Sec,
                                    const MCAsmLayout &Layout) const {
+  writeSectionData(Sec, Layout, getWriter());
+}
+
+void MCAssembler::writeSectionData(const MCSection *Sec,
+                                   const MCAsmLayout &Layout,
+                                   MCObjectWriter &OW) const {
   // Ignore virtual sections.
   if (Sec->isVirtualSection()) {
     assert(Layout.getSectionFileSize(Sec) == 0 && "Invalid size for section!");
@@ -825,14 +834,14 @@ void MCAssembler::writeSectionData(const MCSection *Sec,
     return;
   }
 
-  uint64_t Start = getWriter().getStream().tell();
+  uint64_t Start = OW.getStream().tell();
   (void)Start;
 
   for (MCSection::const_iterator it = Sec->begin(), ie = Sec->end(); it != ie;
        ++it)
-    writeFragment(*this, Layout, *it);
+    writeFragment(*this, Layout, *it, &OW);
 
-  assert(getWriter().getStream().tell() - Start ==
+  assert(OW.getStream().tell() - Start ==
          Layout.getSectionAddressSize(Sec));
 }
 
@@ -855,6 +864,7 @@ std::pair<uint64_t, bool> MCAssembler::handleFixup(const MCAsmLayout &Layout,
 }
 
 void MCAssembler::Finish() {
+  TimeTraceScope FinishScope("Emit object");
   DEBUG_WITH_TYPE("mc-dump", {
       llvm::errs() << "assembler backend - pre-layout\n--\n";
       dump(); });
@@ -884,16 +894,20 @@ void MCAssembler::Finish() {
       iFrag->setLayoutOrder(FragmentIndex++);
   }
 
-  // Layout until everything fits.
-  while (layoutOnce(Layout))
-    continue;
+  {
+    TimeTraceScope LayoutScope("Layout object");
 
-  DEBUG_WITH_TYPE("mc-dump", {
-      llvm::errs() << "assembler backend - post-relaxation\n--\n";
-      dump(); });
+    // Layout until everything fits.
+    while (layoutOnce(Layout))
+      continue;
 
-  // Finalize the layout, including fragment lowering.
-  finishLayout(Layout);
+    DEBUG_WITH_TYPE("mc-dump", {
+        llvm::errs() << "assembler backend - post-relaxation\n--\n";
+        dump(); });
+
+    // Finalize the layout, including fragment lowering.
+    finishLayout(Layout);
+  }
 
   DEBUG_WITH_TYPE("mc-dump", {
       llvm::errs() << "assembler backend - final-layout\n--\n";
@@ -937,7 +951,10 @@ void MCAssembler::Finish() {
   }
 
   // Write the object file.
-  getWriter().writeObject(*this, Layout);
+  {
+    TimeTraceScope WriteScope("Write object");
+    getWriter().writeObject(*this, Layout);
+  }
 
   stats::ObjectBytes += OS.tell() - StartOffset;
 }
@@ -1052,46 +1069,149 @@ bool MCAssembler::relaxDwarfCallFrameFragment(MCAsmLayout &Layout,
   return OldSize != Data.size();
 }
 
-bool MCAssembler::layoutSectionOnce(MCAsmLayout &Layout, MCSection &Sec) {
-  // Holds the first fragment which needed relaxing during this layout. It will
-  // remain NULL if none were relaxed.
-  // When a fragment is relaxed, all the fragments following it should get
-  // invalidated because their offset is going to change.
-  MCFragment *FirstRelaxedFragment = nullptr;
-
-  // Attempt to relax all the fragments in the section.
-  for (MCSection::iterator I = Sec.begin(), IE = Sec.end(); I != IE; ++I) {
-    // Check if this is a fragment that needs relaxation.
-    bool RelaxedFrag = false;
-    switch(I->getKind()) {
-    default:
+bool MCAssembler::relaxFragment(MCAsmLayout &Layout, MCFragment &F) {
+  switch(F.getKind()) {
+  default:
+    return false;
+  case MCFragment::FT_Relaxable:
+    assert(!getRelaxAll() &&
+           "Did not expect a MCRelaxableFragment in RelaxAll mode");
+    return relaxInstruction(Layout, cast<MCRelaxableFragment>(F));
+  case MCFragment::FT_Dwarf:
+    return relaxDwarfLineAddr(Layout, cast<MCDwarfLineAddrFragment>(F));
+  case MCFragment::FT_DwarfFrame:
+    return relaxDwarfCallFrameFragment(Layout,
+                                       cast<MCDwarfCallFrameFragment>(F));
+  case MCFragment::FT_LEB:
+    return relaxLEB(Layout, cast<MCLEBFragment>(F));
+  }
+}
+
+std::pair<unsigned, unsigned>
+MCAssembler::getRelaxationSpan(MCFragment &F) const {
+  const std::pair<unsigned, unsigned> Unknown(0, ~0U);
+  // The values of the dwarf and LEB fragments are arbitrary expressions.
+  auto *RF = dyn_cast<MCRelaxableFragment>(&F);
+  if (!RF)
+    return Unknown;
+
+  // An instruction depends on the fragments between it and the labels its
+  // fixups refer to in the same section.
+  unsigned First = F.getLayoutOrder(), Last = First;
+  for (const MCFixup &Fixup : RF->getFixups()) {
+    MCValue Target;
+    if (!Fixup.getValue()->evaluateAsRelocatable(Target, nullptr, &Fixup) ||
+        Target.getSymB() || !Target.getSymA())
+      return Unknown;
+    const MCSymbol &Sym = Target.getSymA()->getSymbol();
+    if (Sym.isVariable() || !Sym.getFragment() ||
+        Sym.getFragment()->getParent() != F.getParent())
+      return Unknown;
+    unsigned Order = Sym.getFragment()->getLayoutOrder();
+    First = std::min(First, Order);
+    Last = std::max(Last, Order);
+  }
+  return std::make_pair(First, Last);
+}
+
+namespace {
+/// A fragment that may change size during the relaxation of its section.
+struct RelaxCandidate {
+  MCFragment *F;
+  /// The layout orders of the first and last fragments whose sizes the
+  /// relaxation of F depends on.
+  unsigned First, Last;
+  /// Whether a fragment whose size depends on its offset, such as an
+  /// alignment, is between First and Last.
+  bool SpansPadding;
+  /// Whether F must be checked in the current iteration.
+  bool Active;
+};
+}
+
+bool MCAssembler::layoutSection(MCAsmLayout &Layout, MCSection &Sec) {
+  // Number the fragments whose size depends on their offset, so that we can
+  // tell whether a span contains one. With bundling, any fragment may be
+  // padded.
+  SmallVector<unsigned, 64> PaddingBefore;
+  std::vector<RelaxCandidate> Candidates;
+  unsigned NumPadding = 0;
+  for (MCFragment &F : Sec) {
+    PaddingBefore.push_back(NumPadding);
+    switch (F.getKind()) {
+    case MCFragment::FT_Align:
+    case MCFragment::FT_Org:
+      ++NumPadding;
       break;
     case MCFragment::FT_Relaxable:
-      assert(!getRelaxAll() &&
-             "Did not expect a MCRelaxableFragment in RelaxAll mode");
-      RelaxedFrag = relaxInstruction(Layout, *cast<MCRelaxableFragment>(I));
-      break;
     case MCFragment::FT_Dwarf:
-      RelaxedFrag = relaxDwarfLineAddr(Layout,
-                                       *cast<MCDwarfLineAddrFragment>(I));
-      break;
     case MCFragment::FT_DwarfFrame:
-      RelaxedFrag =
-        relaxDwarfCallFrameFragment(Layout,
-                                    *cast<MCDwarfCallFrameFragment>(I));
-      break;
     case MCFragment::FT_LEB:
-      RelaxedFrag = relaxLEB(Layout, *cast<MCLEBFragment>(I));
+      Candidates.push_back({&F, 0, 0, false, true});
+      break;
+    default:
       break;
     }
-    if (RelaxedFrag && !FirstRelaxedFragment)
-      FirstRelaxedFragment = I;
   }
-  if (FirstRelaxedFragment) {
+  PaddingBefore.push_back(NumPadding);
+  if (Candidates.empty())
+    return false;
+
+  auto ComputeSpan = [&](RelaxCandidate &C) {
+    std::tie(C.First, C.Last) = getRelaxationSpan(*C.F);
+    unsigned End = std::min<unsigned>(C.Last, PaddingBefore.size() - 2) + 1;
+    C.SpansPadding = isBundlingEnabled() ||
+                     PaddingBefore[End] != PaddingBefore[C.First];
+  };
+  for (RelaxCandidate &C : Candidates)
+    ComputeSpan(C);
+
+  // Check the active fragments, in layout order, until none of them changes
+  // size. After the first iteration, a fragment is only checked again if a
+  // fragment that grew may have moved the labels its fixups refer to.
+  bool WasRelaxed = false;
+  unsigned Iterations = 0, Checks = 0;
+  SmallVector<unsigned, 16> Grown;
+  for (;;) {
+    ++Iterations;
+    ++stats::SectionRelaxationSteps;
+    MCFragment *FirstRelaxedFragment = nullptr;
+    Grown.clear();
+    for (RelaxCandidate &C : Candidates) {
+      if (!C.Active)
+        continue;
+      ++Checks;
+      ++stats::RelaxationChecks;
+      if (!relaxFragment(Layout, *C.F))
+        continue;
+      Grown.push_back(C.F->getLayoutOrder());
+      if (!FirstRelaxedFragment)
+        FirstRelaxedFragment = C.F;
+      // The relaxed instruction has new fixups.
+      ComputeSpan(C);
+    }
+    if (!FirstRelaxedFragment)
+      break;
+
+    // When a fragment is relaxed, all the fragments following it should get
+    // invalidated because their offset is going to change.
+    WasRelaxed = true;
     Layout.invalidateFragmentsFrom(FirstRelaxedFragment);
-    return true;
+
+    // Only the fragments whose span contains a fragment that grew, or a
+    // padding that a fragment before it may have changed, need another look.
+    for (RelaxCandidate &C : Candidates) {
+      auto I = std::lower_bound(Grown.begin(), Grown.end(), C.First);
+      C.Active = (I != Grown.end() && *I <= C.Last) ||
+                 (C.SpansPadding && Grown.front() <= C.Last);
+    }
   }
-  return false;
+
+  DEBUG(dbgs() << "assembler: relaxed section #" << Sec.getLayoutOrder()
+               << " in " << Iterations << " iterations, " << Checks
+               << " fragment checks for " << Candidates.size()
+               << " fragments\n");
+  return WasRelaxed;
 }
 
 bool MCAssembler::layoutOnce(MCAsmLayout &Layout) {
@@ -1100,8 +1220,7 @@ bool MCAssembler::layoutOnce(MCAsmLayout &Layout) {
   bool WasRelaxed = false;
   for (iterator it = begin(), ie = end(); it != ie; ++it) {
     MCSection &Sec = *it;
-    while (layoutSectionOnce(Layout, Sec))
-      WasRelaxed = true;
+    WasRelaxed |= layoutSection(Layout, Sec);
   }
 
   return WasRelaxed;
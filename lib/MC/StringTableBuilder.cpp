@@ -8,33 +8,125 @@
 //===----------------------------------------------------------------------===//
 
 #include "llvm/MC/StringTableBuilder.h"
-#include "llvm/ADT/SmallVector.h"
+#include "llvm/ADT/ArrayRef.h"
 #include "llvm/Support/COFF.h"
 #include "llvm/Support/Endian.h"
+#include "llvm/Support/ThreadPool.h"
+#include "llvm/Support/TimeTrace.h"
+#include <vector>
 
 using namespace llvm;
 
-static bool compareBySuffix(StringRef a, StringRef b) {
-  size_t sizeA = a.size();
-  size_t sizeB = b.size();
-  size_t len = std::min(sizeA, sizeB);
-  for (size_t i = 0; i < len; ++i) {
-    char ca = a[sizeA - i - 1];
-    char cb = b[sizeB - i - 1];
-    if (ca != cb)
-      return ca > cb;
+typedef StringMapEntry<size_t> StringEntry;
+
+// The character at \p Pos from the end of the string, or -1 past its start.
+static int charTailAt(const StringEntry *E, size_t Pos) {
+  StringRef S = E->getKey();
+  if (Pos >= S.size())
+    return -1;
+  return (unsigned char)S[S.size() - Pos - 1];
+}
+
+// Sort the strings by their reversed characters in descending order, from
+// the character at \p Pos from the end, so that a string comes right after
+// the strings it is a suffix of. This is a three-way radix quicksort, which
+// unlike a comparison sort does not compare again the characters that are
+// known to be the same.
+static void multikeySort(MutableArrayRef<StringEntry *> Vec, size_t Pos) {
+tailcall:
+  if (Vec.size() <= 1)
+    return;
+
+  // Partition the strings so that those in [0, I) are greater than the
+  // pivot, those in [I, J) are the same and those in [J, Vec.size()) are
+  // less.
+  int Pivot = charTailAt(Vec[0], Pos);
+  size_t I = 0;
+  size_t J = Vec.size();
+  for (size_t K = 1; K < J;) {
+    int C = charTailAt(Vec[K], Pos);
+    if (C > Pivot)
+      std::swap(Vec[I++], Vec[K++]);
+    else if (C < Pivot)
+      std::swap(Vec[--J], Vec[K]);
+    else
+      K++;
+  }
+
+  multikeySort(Vec.slice(0, I), Pos);
+  multikeySort(Vec.slice(J), Pos);
+
+  // The strings that end at Pos are all equal, and there is at most one of
+  // them. Sort the others by the next character, without recursing.
+  if (Pivot != -1) {
+    Vec = Vec.slice(I, J - I);
+    ++Pos;
+    goto tailcall;
   }
-  return sizeA > sizeB;
 }
 
-void StringTableBuilder::finalize(Kind kind) {
-  SmallVector<StringRef, 8> Strings;
+// Sort like multikeySort, on \p NumThreads threads. The strings are first
+// distributed by their last two characters, then the buckets are sorted
+// concurrently from the third one.
+static void multikeySortInParallel(MutableArrayRef<StringEntry *> Vec,
+                                   unsigned NumThreads) {
+  // Bucket 0 holds the strings with the greatest last two characters, and
+  // the last one the empty string.
+  const unsigned NumKeys = 257;
+  auto getBucket = [&](const StringEntry *E) {
+    return (NumKeys - 1 - (charTailAt(E, 0) + 1)) * NumKeys +
+           (NumKeys - 1 - (charTailAt(E, 1) + 1));
+  };
+
+  std::vector<size_t> BucketBegin(NumKeys * NumKeys + 1);
+  for (const StringEntry *E : Vec)
+    ++BucketBegin[getBucket(E) + 1];
+  for (unsigned B = 1, BE = BucketBegin.size(); B != BE; ++B)
+    BucketBegin[B] += BucketBegin[B - 1];
+
+  std::vector<StringEntry *> Sorted(Vec.size());
+  std::vector<size_t> Next(BucketBegin.begin(), BucketBegin.end() - 1);
+  for (StringEntry *E : Vec)
+    Sorted[Next[getBucket(E)]++] = E;
+  std::copy(Sorted.begin(), Sorted.end(), Vec.begin());
+
+  // Each task sorts consecutive buckets, so that there are several tasks per
+  // thread to balance their sizes.
+  size_t TaskSize = Vec.size() / (NumThreads * 8) + 1;
+  ThreadPool Pool(NumThreads);
+  for (unsigned B = 0, BE = NumKeys * NumKeys; B != BE;) {
+    unsigned TaskEnd = B + 1;
+    while (TaskEnd != BE &&
+           BucketBegin[TaskEnd] - BucketBegin[B] < TaskSize)
+      ++TaskEnd;
+    Pool.async([&, B, TaskEnd]() {
+      for (unsigned Bucket = B; Bucket != TaskEnd; ++Bucket)
+        multikeySort(Vec.slice(BucketBegin[Bucket],
+                               BucketBegin[Bucket + 1] - BucketBegin[Bucket]),
+                     2);
+    });
+    B = TaskEnd;
+  }
+  Pool.wait();
+}
+
+void StringTableBuilder::finalize(Kind kind, unsigned NumThreads) {
+  TimeTraceScope TraceScope("Build string table");
+
+  // Sort the entries of the map, so that the offsets can be set without
+  // looking the strings up again.
+  std::vector<StringEntry *> Strings;
   Strings.reserve(StringIndexMap.size());
 
   for (auto i = StringIndexMap.begin(), e = StringIndexMap.end(); i != e; ++i)
-    Strings.push_back(i->getKey());
+    Strings.push_back(&*i);
 
-  std::sort(Strings.begin(), Strings.end(), compareBySuffix);
+  if (!NumThreads)
+    NumThreads = ThreadPool::getDefaultThreadCount();
+  if (NumThreads > 1 && Strings.size() >= ParallelSortThreshold)
+    multikeySortInParallel(Strings, NumThreads);
+  else
+    multikeySort(Strings, 0);
 
   switch (kind) {
   case ELF:
@@ -49,16 +141,17 @@ void StringTableBuilder::finalize(Kind kind) {
   }
 
   StringRef Previous;
-  for (StringRef s : Strings) {
+  for (StringEntry *Entry : Strings) {
+    StringRef s = Entry->getKey();
     if (kind == WinCOFF)
       assert(s.size() > COFF::NameSize && "Short string in COFF string table!");
 
     if (Previous.endswith(s)) {
-      StringIndexMap[s] = StringTable.size() - 1 - s.size();
+      Entry->setValue(StringTable.size() - 1 - s.size());
       continue;
     }
 
-    StringIndexMap[s] = StringTable.size();
+    Entry->setValue(StringTable.size());
     StringTable += s;
     StringTable += '\x00';
     Previous = s;
@@ -207,7 +207,8 @@ ErrorOr<std::unique_ptr<Archive>> Archive::create(MemoryBufferRef Source) {
 }
 
 Archive::Archive(MemoryBufferRef Source, std::error_code &ec)
-    : Binary(Binary::ID_Archive, Source), SymbolTable(child_end()) {
+    : Binary(Binary::ID_Archive, Source), SymbolTable(child_end()),
+      HasSymbolIndex(false) {
   StringRef Buffer = Data.getBuffer();
   // Check for sufficient magic.
   if (Buffer.startswith(ThinMagic)) {
@@ -504,23 +505,77 @@ uint32_t Archive::getNumberOfSymbols() const {
   return read32le(buf);
 }
 
+void Archive::buildSymbolIndex() {
+  if (HasSymbolIndex)
+    return;
+  HasSymbolIndex = true;
+  if (!hasSymbolTable())
+    return;
+
+  // Size the table for all the symbols, so that it does not grow while they
+  // are inserted.
+  SymbolIndex.resize(getNumberOfSymbols() * 4 / 3 + 1);
+  // Keep the first symbol of each name, which is the one a scan of the symbol
+  // table finds.
+  for (symbol_iterator I = symbol_begin(), E = symbol_end(); I != E; ++I)
+    SymbolIndex.insert(std::make_pair(I->getName(), *I));
+}
+
+Archive::child_iterator Archive::getSymbolMember(const Symbol &Sym) const {
+  ErrorOr<Archive::child_iterator> ResultOrErr = Sym.getMember();
+  // FIXME: Should we really eat the error?
+  if (ResultOrErr.getError())
+    return child_end();
+  return ResultOrErr.get();
+}
+
 Archive::child_iterator Archive::findSym(StringRef name) const {
+  if (HasSymbolIndex) {
+    auto I = SymbolIndex.find(name);
+    if (I == SymbolIndex.end())
+      return child_end();
+    return getSymbolMember(I->second);
+  }
+
   Archive::symbol_iterator bs = symbol_begin();
   Archive::symbol_iterator es = symbol_end();
 
   for (; bs != es; ++bs) {
     StringRef SymName = bs->getName();
-    if (SymName == name) {
-      ErrorOr<Archive::child_iterator> ResultOrErr = bs->getMember();
-      // FIXME: Should we really eat the error?
-      if (ResultOrErr.getError())
-        return child_end();
-      return ResultOrErr.get();
-    }
+    if (SymName == name)
+      return getSymbolMember(*bs);
   }
   return child_end();
 }
 
+void Archive::findSyms(ArrayRef<StringRef> Names,
+                       SmallVectorImpl<child_iterator> &Members) const {
+  Members.reserve(Members.size() + Names.size());
+  if (HasSymbolIndex) {
+    for (StringRef Name : Names)
+      Members.push_back(findSym(Name));
+    return;
+  }
+
+  // Scan the symbol table once, and resolve each name on its first symbol.
+  // Pending maps the names not found yet to their positions in Names.
+  size_t Begin = Members.size();
+  Members.append(Names.size(), child_end());
+  DenseMap<StringRef, SmallVector<unsigned, 1>> Pending;
+  for (unsigned I = 0, E = Names.size(); I != E; ++I)
+    Pending[Names[I]].push_back(I);
+  for (symbol_iterator I = symbol_begin(), E = symbol_end();
+       I != E && !Pending.empty(); ++I) {
+    auto P = Pending.find(I->getName());
+    if (P == Pending.end())
+      continue;
+    child_iterator Member = getSymbolMember(*I);
+    for (unsigned Index : P->second)
+      Members[Begin + Index] = Member;
+    Pending.erase(P);
+  }
+}
+
 bool Archive::hasSymbolTable() const {
   return SymbolTable != child_end();
 }
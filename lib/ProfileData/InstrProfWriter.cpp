@@ -106,6 +106,31 @@ InstrProfWriter::addFunctionCounts(StringRef FunctionName,
   return instrprof_error::success;
 }
 
+void InstrProfWriter::mergeRecordsFromWriter(
+    InstrProfWriter &&IPW,
+    function_ref<void(StringRef FunctionName, std::error_code EC)> Warn) {
+  for (auto &I : IPW.FunctionData) {
+    StringRef FunctionName = I.getKey();
+    auto Inserted =
+        FunctionData.insert(std::make_pair(FunctionName, CounterData()));
+    if (Inserted.second) {
+      // We've never seen a function with this name, take all its counts.
+      Inserted.first->getValue() = std::move(I.getValue());
+      for (const auto &Func : Inserted.first->getValue())
+        if (Func.second[0] > MaxFunctionCount)
+          MaxFunctionCount = Func.second[0];
+      continue;
+    }
+
+    for (const auto &Func : I.getValue())
+      if (std::error_code EC =
+              addFunctionCounts(FunctionName, Func.first, Func.second))
+        Warn(FunctionName, EC);
+  }
+  IPW.FunctionData.clear();
+  IPW.MaxFunctionCount = 0;
+}
+
 std::pair<uint64_t, uint64_t> InstrProfWriter::writeImpl(raw_ostream &OS) {
   OnDiskChainedHashTableGenerator<InstrProfRecordTrait> Generator;
 
@@ -0,0 +1,161 @@
+//===-CachePruning.cpp - LLVM Cache Directory Pruning ---------------------===//
+//
+//                     The LLVM Compiler Infrastructure
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+//
+// This file implements the pruning of a directory based on least recently used.
+//
+//===----------------------------------------------------------------------===//
+
+#include "llvm/Support/CachePruning.h"
+#include "llvm/Support/Debug.h"
+#include "llvm/Support/Errc.h"
+#include "llvm/Support/FileSystem.h"
+#include "llvm/Support/Path.h"
+#include "llvm/Support/raw_ostream.h"
+#include <algorithm>
+#include <tuple>
+#include <vector>
+
+#define DEBUG_TYPE "cache-pruning"
+
+using namespace llvm;
+
+/// Write a new timestamp file with the given path. This is used for the
+/// pruning interval option.
+static void writeTimestampFile(StringRef TimestampFile) {
+  std::error_code EC;
+  raw_fd_ostream Out(TimestampFile.str(), EC, sys::fs::F_None);
+}
+
+/// Whether \p Name is the name of a lock file or of the temporary file of an
+/// entry being written. They must not be removed under the process writing
+/// the entry, unless it has not touched them for long enough to be presumed
+/// dead.
+static bool isPartialEntry(StringRef Name) {
+  return Name.find(".lock") != StringRef::npos ||
+         Name.find("-tmp-") != StringRef::npos;
+}
+
+/// Prune the cache of files that haven't been accessed in a long time.
+bool CachePruning::prune() {
+  if (Path.empty() || Interval < 0)
+    return false;
+
+  bool isPathDir;
+  if (sys::fs::is_directory(Path, isPathDir))
+    return false;
+
+  if (!isPathDir)
+    return false;
+
+  if (Expiration == 0 && MaxSize == 0) {
+    DEBUG(dbgs() << "No pruning settings set, exit early\n");
+    // Nothing will be pruned, early exit
+    return false;
+  }
+
+  // Try to stat() the timestamp file.
+  SmallString<128> TimestampFile(Path);
+  sys::path::append(TimestampFile, "llvmcache.timestamp");
+  sys::fs::file_status FileStatus;
+  sys::TimeValue CurrentTime = sys::TimeValue::now();
+  if (std::error_code EC = sys::fs::status(TimestampFile, FileStatus)) {
+    if (EC == errc::no_such_file_or_directory) {
+      // If the timestamp file wasn't there, create one now.
+      writeTimestampFile(TimestampFile);
+    } else {
+      // Unknown error?
+      return false;
+    }
+  } else {
+    if (Interval) {
+      // Check whether the time stamp is older than our pruning interval.
+      // If not, do nothing.
+      sys::TimeValue TimeStampModTime = FileStatus.getLastModificationTime();
+      auto TimeInterval = sys::TimeValue(sys::TimeValue::SecondsType(Interval));
+      auto TimeStampAge = CurrentTime - TimeStampModTime;
+      if (TimeStampAge <= TimeInterval) {
+        DEBUG(dbgs() << "Timestamp file too recent (" << TimeStampAge.seconds()
+                     << "s old), do not prune.\n");
+        return false;
+      }
+    }
+    // Write a new timestamp file so that nobody else attempts to prune.
+    // There is a benign race condition here, if two processes happen to
+    // notice at the same time that the timestamp is out-of-date.
+    writeTimestampFile(TimestampFile);
+  }
+
+  // Keep track of space, as (last use, size, path) of each file.
+  std::vector<std::tuple<sys::TimeValue, uint64_t, std::string>> FileInfos;
+  uint64_t TotalSize = 0;
+
+  // Walk the entire directory cache, looking for unused files.
+  std::error_code EC;
+  SmallString<128> CachePathNative;
+  sys::path::native(Path, CachePathNative);
+  auto TimeExpiration = sys::TimeValue(sys::TimeValue::SecondsType(Expiration));
+  auto TimeStale = sys::TimeValue(sys::TimeValue::SecondsType(StaleExpiration));
+  // Walk all of the files within this directory.
+  for (sys::fs::directory_iterator File(CachePathNative, EC), FileEnd;
+       File != FileEnd && !EC; File.increment(EC)) {
+    // Do not touch the timestamp, nor anything that does not belong to the
+    // cache.
+    StringRef Name = sys::path::filename(File->path());
+    if (!Name.startswith("llvmcache-"))
+      continue;
+
+    // Look at this file. If we can't stat it, there's nothing interesting
+    // there.
+    if (File->status(FileStatus)) {
+      DEBUG(dbgs() << "Ignore " << File->path() << " (can't stat)\n");
+      continue;
+    }
+
+    // If the file hasn't been used recently enough, delete it
+    sys::TimeValue FileModTime = FileStatus.getLastModificationTime();
+    auto FileAge = CurrentTime - FileModTime;
+
+    // The files of the entries being written are left out of the size of the
+    // cache. Remove them only once the process that wrote them is presumed
+    // to have crashed.
+    if (isPartialEntry(Name)) {
+      if (FileAge > TimeStale) {
+        DEBUG(dbgs() << "Remove stale " << File->path() << " ("
+                     << FileAge.seconds() << "s old)\n");
+        sys::fs::remove(File->path());
+      }
+      continue;
+    }
+
+    if (Expiration && FileAge > TimeExpiration) {
+      DEBUG(dbgs() << "Remove " << File->path() << " (" << FileAge.seconds()
+                   << "s old)\n");
+      sys::fs::remove(File->path());
+      continue;
+    }
+
+    // Leave it here for now, but add it to the list of size-based pruning.
+    TotalSize += FileStatus.getSize();
+    FileInfos.emplace_back(FileModTime, FileStatus.getSize(), File->path());
+  }
+
+  // Prune for size now if needed, least recently used first.
+  if (MaxSize && TotalSize > MaxSize) {
+    std::sort(FileInfos.begin(), FileInfos.end());
+    for (auto &FileInfo : FileInfos) {
+      if (TotalSize <= MaxSize)
+        break;
+      DEBUG(dbgs() << "Remove " << std::get<2>(FileInfo)
+                   << " (cache size: " << TotalSize << ")\n");
+      sys::fs::remove(std::get<2>(FileInfo));
+      TotalSize -= std::get<1>(FileInfo);
+    }
+  }
+  return true;
+}
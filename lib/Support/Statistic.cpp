@@ -26,6 +26,7 @@
 #include "llvm/Support/CommandLine.h"
 #include "llvm/Support/Debug.h"
 #include "llvm/Support/Format.h"
+#include "llvm/Support/JSON.h"
 #include "llvm/Support/ManagedStatic.h"
 #include "llvm/Support/Mutex.h"
 #include "llvm/Support/raw_ostream.h"
@@ -44,6 +45,10 @@ Enabled(
     "stats",
     cl::desc("Enable statistics output from program (available with Asserts)"));
 
+/// Set by EnableStatistics to collect the statistics without printing them on
+/// exit.
+static bool Collected = false;
+
 
 namespace {
 /// StatisticInfo - This class is used in a ManagedStatic so that it is created
@@ -53,12 +58,15 @@ class StatisticInfo {
   std::vector<const Statistic*> Stats;
   friend void llvm::PrintStatistics();
   friend void llvm::PrintStatistics(raw_ostream &OS);
+  friend void llvm::PrintStatisticsJSON(raw_ostream &OS);
 public:
   ~StatisticInfo();
 
   void addStatistic(const Statistic *S) {
     Stats.push_back(S);
   }
+
+  void sortStatistics();
 };
 }
 
@@ -72,7 +80,7 @@ void Statistic::RegisterStatistic() {
   // printed.
   sys::SmartScopedLock<true> Writer(*StatLock);
   if (!Initialized) {
-    if (Enabled)
+    if (Enabled || Collected)
       StatInfo->addStatistic(this);
 
     TsanHappensBefore(this);
@@ -86,11 +94,31 @@ void Statistic::RegisterStatistic() {
 
 // Print information when destroyed, iff command line option is specified.
 StatisticInfo::~StatisticInfo() {
-  llvm::PrintStatistics();
+  if (Enabled)
+    llvm::PrintStatistics();
+}
+
+void StatisticInfo::sortStatistics() {
+  // Sort the fields by name.
+  std::stable_sort(Stats.begin(), Stats.end(),
+                   [](const Statistic *LHS, const Statistic *RHS) {
+    if (int Cmp = std::strcmp(LHS->getName(), RHS->getName()))
+      return Cmp < 0;
+
+    // Secondary key is the description.
+    return std::strcmp(LHS->getDesc(), RHS->getDesc()) < 0;
+  });
 }
 
-void llvm::EnableStatistics() {
-  Enabled.setValue(true);
+void llvm::EnableStatistics(bool PrintOnExit) {
+  if (PrintOnExit) {
+    Enabled.setValue(true);
+    return;
+  }
+  Collected = true;
+  // Create StatInfo now, so that the ManagedStatics created afterwards, which
+  // may print the statistics when they are destroyed, are destroyed first.
+  (void)*StatInfo;
 }
 
 bool llvm::AreStatisticsEnabled() {
@@ -109,15 +137,7 @@ void llvm::PrintStatistics(raw_ostream &OS) {
                           (unsigned)std::strlen(Stats.Stats[i]->getName()));
   }
 
-  // Sort the fields by name.
-  std::stable_sort(Stats.Stats.begin(), Stats.Stats.end(),
-                   [](const Statistic *LHS, const Statistic *RHS) {
-    if (int Cmp = std::strcmp(LHS->getName(), RHS->getName()))
-      return Cmp < 0;
-
-    // Secondary key is the description.
-    return std::strcmp(LHS->getDesc(), RHS->getDesc()) < 0;
-  });
+  Stats.sortStatistics();
 
   // Print out the statistics header...
   OS << "===" << std::string(73, '-') << "===\n"
@@ -136,6 +156,23 @@ void llvm::PrintStatistics(raw_ostream &OS) {
 
 }
 
+void llvm::PrintStatisticsJSON(raw_ostream &OS) {
+  StatisticInfo &Stats = *StatInfo;
+  sys::SmartScopedLock<true> Reader(*StatLock);
+  Stats.sortStatistics();
+
+  OS << '[';
+  for (size_t i = 0, e = Stats.Stats.size(); i != e; ++i) {
+    const Statistic *S = Stats.Stats[i];
+    OS << (i ? ",\n  " : "\n  ") << "{ \"name\": ";
+    printJSONString(OS, S->getName());
+    OS << ", \"desc\": ";
+    printJSONString(OS, S->getDesc());
+    OS << ", \"value\": " << S->getValue() << " }";
+  }
+  OS << (Stats.Stats.empty() ? "]" : "\n]");
+}
+
 void llvm::PrintStatistics() {
 #if !defined(NDEBUG) || defined(LLVM_ENABLE_STATS)
   StatisticInfo &Stats = *StatInfo;
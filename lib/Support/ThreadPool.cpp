@@ -0,0 +1,179 @@
+//==-- llvm/Support/ThreadPool.cpp - A ThreadPool implementation -*- C++ -*-==//
+//
+//                     The LLVM Compiler Infrastructure
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+//
+// This file implements a crude C++11 based thread pool.
+//
+//===----------------------------------------------------------------------===//
+
+#include "llvm/Support/ThreadPool.h"
+
+#include "llvm/Config/llvm-config.h"
+#include <algorithm>
+#include <cassert>
+
+using namespace llvm;
+
+unsigned ThreadPool::getDefaultThreadCount() {
+#if LLVM_ENABLE_THREADS
+  unsigned Count = std::thread::hardware_concurrency();
+  return Count ? Count : 1;
+#else
+  return 1;
+#endif
+}
+
+bool ThreadPool::runQueuedTask(std::unique_lock<std::mutex> &LockGuard,
+                               ThreadPoolTaskGroup *Group) {
+  auto It = Tasks.begin();
+  if (Group)
+    It = std::find_if(Tasks.begin(), Tasks.end(),
+                      [&](const std::pair<PackagedTaskTy,
+                                          ThreadPoolTaskGroup *> &Entry) {
+                        return Entry.second == Group;
+                      });
+  if (It == Tasks.end())
+    return false;
+
+  PackagedTaskTy Task = std::move(It->first);
+  ThreadPoolTaskGroup *TaskGroup = It->second;
+  Tasks.erase(It);
+  ++ActiveTasks;
+
+  // Run the task without holding the lock so that other threads can make
+  // progress, and so that the task can itself submit work to the pool.
+  LockGuard.unlock();
+  Task();
+  LockGuard.lock();
+
+  --ActiveTasks;
+  if (TaskGroup) {
+    auto GroupIt = PendingGroupTasks.find(TaskGroup);
+    assert(GroupIt != PendingGroupTasks.end() && "Unbalanced group count");
+    if (--GroupIt->second == 0)
+      PendingGroupTasks.erase(GroupIt);
+  }
+  CompletionCondition.notify_all();
+  return true;
+}
+
+void ThreadPool::wait(ThreadPoolTaskGroup &Group) {
+  assert(&Group.getPool() == this && "Group belongs to another pool");
+  std::unique_lock<std::mutex> LockGuard(QueueLock);
+  while (true) {
+    // Help with the queued tasks of the group instead of blocking: if this is
+    // called from a worker thread, the group may otherwise never make
+    // progress.
+    if (runQueuedTask(LockGuard, &Group))
+      continue;
+    if (!PendingGroupTasks.count(&Group))
+      return;
+    // The remaining tasks of the group are running on other threads.
+    CompletionCondition.wait(LockGuard);
+  }
+}
+
+#if LLVM_ENABLE_THREADS
+
+ThreadPool::ThreadPool() : ThreadPool(getDefaultThreadCount()) {}
+
+ThreadPool::ThreadPool(unsigned ThreadCount)
+    : ThreadCount(ThreadCount ? ThreadCount : 1), ActiveTasks(0),
+      EnableFlag(true) {
+  // Create ThreadCount threads that will loop forever, wait on QueueCondition
+  // for tasks to be queued or the Pool to be destroyed.
+  Threads.reserve(this->ThreadCount);
+  for (unsigned ThreadID = 0; ThreadID < this->ThreadCount; ++ThreadID) {
+    Threads.emplace_back([&] {
+      std::unique_lock<std::mutex> LockGuard(QueueLock);
+      while (true) {
+        // Wait for tasks to be pushed in the queue.
+        QueueCondition.wait(LockGuard,
+                            [&] { return !EnableFlag || !Tasks.empty(); });
+        // Exit condition: the pool is being destroyed and the queue is
+        // drained.
+        if (!runQueuedTask(LockGuard, nullptr) && !EnableFlag)
+          return;
+      }
+    });
+  }
+}
+
+void ThreadPool::wait() {
+  // Wait for all threads to complete and the queue to be empty.
+  std::unique_lock<std::mutex> LockGuard(QueueLock);
+  CompletionCondition.wait(LockGuard,
+                           [&] { return Tasks.empty() && !ActiveTasks; });
+}
+
+std::shared_future<void> ThreadPool::asyncImpl(TaskTy Task,
+                                               ThreadPoolTaskGroup *Group) {
+  // Wrap the Task in a packaged_task to return a future object.
+  PackagedTaskTy PackagedTask(std::move(Task));
+  auto Future = PackagedTask.get_future();
+  {
+    // Lock the queue and push the new task.
+    std::unique_lock<std::mutex> LockGuard(QueueLock);
+
+    // Don't allow enqueueing after disabling the pool.
+    assert(EnableFlag && "Queuing a thread during ThreadPool destruction");
+
+    Tasks.emplace_back(std::move(PackagedTask), Group);
+    if (Group)
+      ++PendingGroupTasks[Group];
+  }
+  QueueCondition.notify_one();
+  return Future.share();
+}
+
+// The destructor joins all threads, waiting for completion.
+ThreadPool::~ThreadPool() {
+  {
+    std::unique_lock<std::mutex> LockGuard(QueueLock);
+    EnableFlag = false;
+  }
+  QueueCondition.notify_all();
+  for (auto &Worker : Threads)
+    Worker.join();
+}
+
+#else // LLVM_ENABLE_THREADS Disabled
+
+ThreadPool::ThreadPool() : ThreadPool(0) {}
+
+// No threads are launched: tasks run on the thread calling wait().
+ThreadPool::ThreadPool(unsigned ThreadCount) : ThreadCount(1), ActiveTasks(0) {
+  (void)ThreadCount;
+}
+
+void ThreadPool::wait() {
+  // Sequential implementation running the tasks on the calling thread.
+  std::unique_lock<std::mutex> LockGuard(QueueLock);
+  while (runQueuedTask(LockGuard, nullptr))
+    ;
+}
+
+std::shared_future<void> ThreadPool::asyncImpl(TaskTy Task,
+                                               ThreadPoolTaskGroup *Group) {
+  // Get a Future with launch::deferred execution using std::async
+  auto Future = std::async(std::launch::deferred, std::move(Task)).share();
+  // Wrap the future so that both ThreadPool::wait() can operate and the
+  // returned future can be sync'ed on.
+  PackagedTaskTy PackagedTask([Future]() { Future.get(); });
+  std::unique_lock<std::mutex> LockGuard(QueueLock);
+  Tasks.emplace_back(std::move(PackagedTask), Group);
+  if (Group)
+    ++PendingGroupTasks[Group];
+  return Future;
+}
+
+ThreadPool::~ThreadPool() {
+  wait();
+}
+
+#endif
@@ -0,0 +1,158 @@
+//===-- TimeTrace.cpp - Timeline of the compilation -----------------------===//
+//
+//                     The LLVM Compiler Infrastructure
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+//
+// This file implements the -time-trace timeline, in the Chrome trace event
+// format.
+//
+//===----------------------------------------------------------------------===//
+
+#include "llvm/Support/TimeTrace.h"
+#include "llvm/Config/llvm-config.h"
+#include "llvm/Support/CommandLine.h"
+#include "llvm/Support/FileSystem.h"
+#include "llvm/Support/JSON.h"
+#include "llvm/Support/ManagedStatic.h"
+#include "llvm/Support/Mutex.h"
+#include "llvm/Support/Process.h"
+#include "llvm/Support/raw_ostream.h"
+#include <map>
+#include <vector>
+#if LLVM_ENABLE_THREADS
+#include <thread>
+#endif
+
+using namespace llvm;
+
+static cl::opt<std::string>
+TimeTraceFilename("time-trace", cl::value_desc("filename"),
+                  cl::desc("Write a timeline of the passes and of the phases "
+                           "of the compilation to the file, in the Chrome "
+                           "trace event format"));
+
+namespace llvm {
+
+/// TimeTrace - The events recorded for -time-trace, which are written when it
+/// is destroyed.
+class TimeTrace {
+  struct Event {
+    std::string Name;
+    std::string Detail;
+    unsigned Thread;
+    // In microseconds since the trace started.
+    uint64_t Start;
+    uint64_t Duration;
+  };
+
+  sys::SmartMutex<true> Lock;
+  std::chrono::steady_clock::time_point Start;
+  std::vector<Event> Events;
+#if LLVM_ENABLE_THREADS
+  // The threads are numbered in the order of their first event.
+  std::map<std::thread::id, unsigned> Threads;
+#endif
+  bool Written;
+
+  void write(raw_ostream &OS);
+
+public:
+  TimeTrace() : Start(std::chrono::steady_clock::now()), Written(false) {}
+
+  // Write the trace, unless nothing was recorded since writeToFile was last
+  // called.
+  ~TimeTrace() {
+    if (!Written)
+      writeToFile();
+  }
+
+  void record(std::string Name, std::string Detail,
+              std::chrono::steady_clock::time_point EventStart);
+
+  /// writeToFile - Write the trace to the file given by -time-trace,
+  /// replacing the previous trace.
+  void writeToFile();
+};
+
+} // end namespace llvm
+
+static ManagedStatic<TimeTrace> TheTimeTrace;
+
+TimeTrace *llvm::getTimeTrace() {
+  if (TimeTraceFilename.empty())
+    return nullptr;
+  return &*TheTimeTrace;
+}
+
+void llvm::writeTimeTrace() {
+  if (TimeTrace *Trace = getTimeTrace())
+    Trace->writeToFile();
+}
+
+void TimeTraceScope::end() {
+  Trace->record(std::move(Name), std::move(Detail), Start);
+}
+
+void TimeTrace::record(std::string Name, std::string Detail,
+                       std::chrono::steady_clock::time_point EventStart) {
+  using namespace std::chrono;
+  steady_clock::time_point End = steady_clock::now();
+
+  sys::SmartScopedLock<true> Guard(Lock);
+  Written = false;
+
+  unsigned Thread = 0;
+#if LLVM_ENABLE_THREADS
+  Thread = Threads.insert(std::make_pair(std::this_thread::get_id(),
+                                         Threads.size())).first->second;
+#endif
+  Events.push_back(
+      {std::move(Name), std::move(Detail), Thread,
+       uint64_t(duration_cast<microseconds>(EventStart - Start).count()),
+       uint64_t(duration_cast<microseconds>(End - EventStart).count())});
+}
+
+void TimeTrace::write(raw_ostream &OS) {
+  // Each scope is a complete event, which has both the beginning and the end
+  // of the scope.
+  unsigned Pid = sys::Process::getProcessId();
+  OS << "{\"traceEvents\": [";
+  for (unsigned I = 0, E = Events.size(); I != E; ++I) {
+    const Event &Ev = Events[I];
+    OS << (I ? ",\n" : "\n") << "{ \"ph\": \"X\", \"pid\": " << Pid
+       << ", \"tid\": " << Ev.Thread << ", \"ts\": " << Ev.Start
+       << ", \"dur\": " << Ev.Duration << ", \"name\": ";
+    printJSONString(OS, Ev.Name);
+    if (!Ev.Detail.empty()) {
+      OS << ", \"args\": { \"detail\": ";
+      printJSONString(OS, Ev.Detail);
+      OS << " }";
+    }
+    OS << " }";
+  }
+  OS << (Events.empty() ? "]" : "\n]") << ",\n\"displayTimeUnit\": \"ms\"}\n";
+}
+
+void TimeTrace::writeToFile() {
+  sys::SmartScopedLock<true> Guard(Lock);
+  Written = true;
+
+  if (TimeTraceFilename == "-") {
+    write(outs());
+    outs().flush();
+    return;
+  }
+
+  std::error_code EC;
+  raw_fd_ostream OS(TimeTraceFilename, EC, sys::fs::F_Text);
+  if (EC) {
+    errs() << "Error opening time trace file '" << TimeTraceFilename
+           << "': " << EC.message() << '\n';
+    return;
+  }
+  write(OS);
+}
@@ -0,0 +1,314 @@
+//===- FunctionImport.cpp - ThinLTO Summary-based Function Import ---------===//
+//
+//                     The LLVM Compiler Infrastructure
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+//
+// This file implements Function import based on summaries.
+//
+// The importer walks the call graph of the summary index, starting from the
+// functions that are called but not defined in the module, and selects the
+// definitions that are small enough to be worth copying. The selected
+// definitions are then cloned out of their (lazily loaded) source module and
+// linked in the destination module.
+//
+//===----------------------------------------------------------------------===//
+
+#include "llvm/Transforms/IPO/FunctionImport.h"
+#include "llvm/ADT/SmallPtrSet.h"
+#include "llvm/ADT/SmallVector.h"
+#include "llvm/ADT/Statistic.h"
+#include "llvm/ADT/StringSet.h"
+#include "llvm/Bitcode/ReaderWriter.h"
+#include "llvm/IR/CallSite.h"
+#include "llvm/IR/Constants.h"
+#include "llvm/IR/DebugInfo.h"
+#include "llvm/IR/FunctionInfo.h"
+#include "llvm/IR/InstIterator.h"
+#include "llvm/IR/Module.h"
+#include "llvm/IRReader/IRReader.h"
+#include "llvm/Linker/Linker.h"
+#include "llvm/Pass.h"
+#include "llvm/Support/CommandLine.h"
+#include "llvm/Support/Debug.h"
+#include "llvm/Support/SourceMgr.h"
+#include "llvm/Support/raw_ostream.h"
+#include "llvm/Transforms/IPO.h"
+#include "llvm/Transforms/Utils/Cloning.h"
+#include "llvm/Transforms/Utils/ValueMapper.h"
+#include <map>
+using namespace llvm;
+
+#define DEBUG_TYPE "function-import"
+
+STATISTIC(NumImported, "Number of functions imported");
+STATISTIC(NumImportedModules, "Number of modules imported from");
+
+/// Limit on instruction count of imported functions.
+static cl::opt<unsigned> ImportInstrLimit(
+    "import-instr-limit", cl::init(100), cl::Hidden, cl::value_desc("N"),
+    cl::desc("Only import functions with less than N instructions"));
+
+/// Callees called from at least that many call sites are considered hot.
+static cl::opt<unsigned> ImportHotCallSites(
+    "import-hot-callsites", cl::init(4), cl::Hidden, cl::value_desc("N"),
+    cl::desc("Consider functions called from N call sites or more as hot"));
+
+/// Hot callees are imported with a larger instruction count limit.
+static cl::opt<unsigned> ImportHotMultiplier(
+    "import-hot-multiplier", cl::init(3), cl::Hidden, cl::value_desc("N"),
+    cl::desc("Multiply the import instruction limit by N for hot functions"));
+
+FunctionImporter::FunctionImporter(const FunctionInfoIndex &Index,
+                                   ModuleLoaderTy ModuleLoader,
+                                   DiagnosticHandlerFunction DiagnosticHandler)
+    : Index(Index), ModuleLoader(std::move(ModuleLoader)),
+      DiagnosticHandler(DiagnosticHandler) {}
+
+/// Return the summary of the definition of \p Name to import, or null if
+/// there is no definition worth importing.
+static const FunctionSummary *selectCallee(const FunctionInfoIndex &Index,
+                                           StringRef Name, unsigned NumCalls,
+                                           StringRef DestModulePath) {
+  const FunctionSummaryList *Summaries = Index.findFunctionSummaries(Name);
+  if (!Summaries)
+    return nullptr;
+
+  unsigned Threshold = ImportInstrLimit;
+  if (NumCalls >= ImportHotCallSites)
+    Threshold *= ImportHotMultiplier;
+
+  for (auto &Summary : *Summaries) {
+    if (Summary->modulePath() == DestModulePath)
+      continue;
+    if (!Summary->isEligibleToImport() || Summary->instCount() > Threshold)
+      continue;
+    return Summary.get();
+  }
+  return nullptr;
+}
+
+/// Add to \p Constants the local constants \p C refers to, directly or
+/// through other local constants.
+static void
+collectLocalConstants(const Constant *C,
+                      SmallPtrSetImpl<const GlobalValue *> &Constants,
+                      SmallPtrSetImpl<const Constant *> &Visited) {
+  if (!Visited.insert(C).second)
+    return;
+  if (auto *GV = dyn_cast<GlobalValue>(C)) {
+    if (isImportableLocalConstant(*GV) && Constants.insert(GV).second)
+      collectLocalConstants(cast<GlobalVariable>(GV)->getInitializer(),
+                            Constants, Visited);
+    return;
+  }
+  for (const Use &Op : C->operands())
+    collectLocalConstants(cast<Constant>(Op.get()), Constants, Visited);
+}
+
+/// Prepare the definitions cloned in \p Imports to be linked in the
+/// destination module, and remove what is not needed to link them. The names
+/// of the definitions that must become available_externally once linked are
+/// added to \p AvailableExternally: the linker would not link them from an
+/// available_externally source.
+static void prepareImportedModule(Module &Imports,
+                                  std::vector<std::string> &AvailableExternally) {
+  for (Function &F : Imports) {
+    if (F.isDeclaration())
+      continue;
+    // A linkonce_odr definition may be dropped by its source module, so it
+    // has to stay a definition here. Other definitions are guaranteed to be
+    // emitted by their source module.
+    if (!F.hasLinkOnceODRLinkage()) {
+      AvailableExternally.push_back(F.getName());
+      F.setComdat(nullptr);
+    }
+    ++NumImported;
+  }
+
+  // The module level inline asm is emitted by the source module.
+  Imports.setModuleInlineAsm("");
+  StripDebugInfo(Imports);
+
+  // Declarations of the values not referenced by the imported definitions,
+  // including special globals like llvm.global_ctors, must not reach the
+  // destination module.
+  for (auto I = Imports.global_begin(), E = Imports.global_end(); I != E;) {
+    GlobalVariable &GV = *I++;
+    if (GV.isDeclaration() && GV.use_empty())
+      GV.eraseFromParent();
+  }
+  for (auto I = Imports.begin(), E = Imports.end(); I != E;) {
+    Function &F = *I++;
+    if (F.isDeclaration() && F.use_empty())
+      F.eraseFromParent();
+  }
+}
+
+// Automatically import functions in Module \p DestModule based on the
+// summaries index.
+bool FunctionImporter::importFunctions(Module &DestModule) {
+  StringRef DestModulePath = DestModule.getModuleIdentifier();
+
+  // Seed the worklist with the functions called but not defined in the
+  // module, along with their number of call sites.
+  SmallVector<std::pair<std::string, unsigned>, 64> Worklist;
+  for (Function &F : DestModule) {
+    if (!F.isDeclaration() || F.isIntrinsic() || !F.hasName())
+      continue;
+    unsigned NumCalls = 0;
+    for (User *U : F.users()) {
+      ImmutableCallSite CS(U);
+      if (CS && CS.getCalledValue() == &F)
+        ++NumCalls;
+    }
+    if (NumCalls)
+      Worklist.push_back(std::make_pair(F.getName().str(), NumCalls));
+  }
+
+  // Select the functions to import, grouped by source module. Follow the
+  // call edges of the imported functions, as their callees become candidates
+  // for inlining once the imported functions are inlined.
+  std::map<std::string, StringSet<>> ImportsPerModule;
+  StringSet<> Visited;
+  while (!Worklist.empty()) {
+    auto Entry = Worklist.pop_back_val();
+    StringRef Name = Entry.first;
+    if (!Visited.insert(Name).second)
+      continue;
+
+    // Never replace a definition, even a local one with the same name.
+    Function *Existing = DestModule.getFunction(Name);
+    if (Existing && !Existing->isDeclaration())
+      continue;
+
+    const FunctionSummary *Summary =
+        selectCallee(Index, Name, Entry.second, DestModulePath);
+    if (!Summary) {
+      DEBUG(dbgs() << "Not importing " << Name << "\n");
+      continue;
+    }
+    DEBUG(dbgs() << "Importing " << Name << " from " << Summary->modulePath()
+                 << "\n");
+    ImportsPerModule[Summary->modulePath().str()].insert(Name);
+    for (auto &Call : Summary->calls())
+      Worklist.push_back(std::make_pair(Call.Callee, Call.NumCalls));
+  }
+
+  bool Changed = false;
+  for (auto &Entry : ImportsPerModule) {
+    // The loader is responsible for reporting the modules it fails to load.
+    std::unique_ptr<Module> SrcModule =
+        ModuleLoader(Entry.first, DestModule.getContext());
+    if (!SrcModule)
+      continue;
+
+    // Materialize the definitions to import, and find the local constants
+    // they refer to.
+    SmallPtrSet<const GlobalValue *, 16> ToClone;
+    SmallPtrSet<const Constant *, 16> VisitedConstants;
+    for (auto &Name : Entry.second) {
+      Function *F = SrcModule->getFunction(Name.getKey());
+      // The index may be out of date.
+      if (!F || F->materialize() || F->isDeclaration())
+        continue;
+      ToClone.insert(F);
+      for (const Instruction &I : inst_range(F))
+        for (const Use &Op : I.operands())
+          if (auto *C = dyn_cast<Constant>(Op.get()))
+            collectLocalConstants(C, ToClone, VisitedConstants);
+    }
+    if (ToClone.empty())
+      continue;
+
+    ValueToValueMapTy VMap;
+    std::unique_ptr<Module> Imports(
+        CloneModule(SrcModule.get(), VMap, [&](const GlobalValue *GV) {
+          return ToClone.count(GV) != 0;
+        }));
+    std::vector<std::string> AvailableExternally;
+    prepareImportedModule(*Imports, AvailableExternally);
+
+    bool LinkFailed =
+        DiagnosticHandler
+            ? Linker::LinkModules(&DestModule, Imports.get(), DiagnosticHandler)
+            : Linker::LinkModules(&DestModule, Imports.get());
+    if (LinkFailed)
+      report_fatal_error("Function Import: link error");
+    for (const std::string &Name : AvailableExternally)
+      if (Function *F = DestModule.getFunction(Name))
+        F->setLinkage(GlobalValue::AvailableExternallyLinkage);
+    ++NumImportedModules;
+    Changed = true;
+  }
+  return Changed;
+}
+
+/// Summary file to use for function importing when running as a pass.
+static cl::opt<std::string>
+    SummaryFile("summary-file",
+                cl::desc("The summary file to use for function importing."));
+
+namespace {
+/// Pass that performs cross-module function import provided a summary file.
+class FunctionImportPass : public ModulePass {
+  /// Optional summary index, owned by the client. If not provided, the
+  /// summary file given on the command line is loaded.
+  const FunctionInfoIndex *Index;
+
+public:
+  /// Pass identification, replacement for typeid
+  static char ID;
+
+  explicit FunctionImportPass(const FunctionInfoIndex *Index = nullptr)
+      : ModulePass(ID), Index(Index) {
+    initializeFunctionImportPassPass(*PassRegistry::getPassRegistry());
+  }
+
+  /// Specify pass name for debug output
+  const char *getPassName() const override {
+    return "Summary Based Function Import";
+  }
+
+  bool runOnModule(Module &M) override {
+    std::unique_ptr<FunctionInfoIndex> IndexPtr;
+    if (!Index) {
+      if (SummaryFile.empty())
+        report_fatal_error("error: -function-import requires -summary-file\n");
+      ErrorOr<std::unique_ptr<MemoryBuffer>> BufferOrErr =
+          MemoryBuffer::getFile(SummaryFile);
+      if (std::error_code EC = BufferOrErr.getError())
+        report_fatal_error("error: cannot open " + SummaryFile + ": " +
+                           EC.message() + "\n");
+      ErrorOr<std::unique_ptr<FunctionInfoIndex>> IndexOrErr =
+          getFunctionInfoIndex((*BufferOrErr)->getMemBufferRef(), nullptr);
+      if (std::error_code EC = IndexOrErr.getError())
+        report_fatal_error("error: cannot load summary index from " +
+                           SummaryFile + ": " + EC.message() + "\n");
+      IndexPtr = std::move(*IndexOrErr);
+    }
+
+    auto ModuleLoader = [](StringRef Path, LLVMContext &Context) {
+      SMDiagnostic Err;
+      std::unique_ptr<Module> M = getLazyIRFileModule(Path, Err, Context);
+      if (!M)
+        Err.print("function-import", errs());
+      return M;
+    };
+
+    FunctionImporter Importer(Index ? *Index : *IndexPtr, ModuleLoader);
+    return Importer.importFunctions(M);
+  }
+};
+} // anonymous namespace
+
+char FunctionImportPass::ID = 0;
+INITIALIZE_PASS(FunctionImportPass, "function-import",
+                "Summary Based Function Import", false, false)
+
+ModulePass *llvm::createFunctionImportPass(const FunctionInfoIndex *Index) {
+  return new FunctionImportPass(Index);
+}
@@ -414,6 +414,13 @@ bool Inliner::shouldInline(CallSite CS) {
   return true;
 }
 
+/// Return the call graph node that the call edge of CS points to.
+static CallGraphNode *getCalleeNode(CallGraph &CG, CallSite CS) {
+  if (Function *Callee = CS.getCalledFunction())
+    return CG.getOrInsertFunction(Callee);
+  return CG.getCallsExternalNode();
+}
+
 /// Return true if the specified inline history ID
 /// indicates an inline history that includes the specified function.
 static bool InlineHistoryIncludes(Function *F, int InlineHistoryID,
@@ -518,6 +525,7 @@ bool Inliner::runOnSCC(CallGraphSCC &SCC) {
                      << *CS.getInstruction() << "\n");
         // Update the call graph by deleting the edge from Callee to Caller.
         CG[Caller]->removeCallEdgeFor(CS);
+        SCC.reportCallEdgeRemoved(CG[Caller], getCalleeNode(CG, CS));
         CS.getInstruction()->eraseFromParent();
         ++NumCallsDeleted;
       } else {
@@ -560,6 +568,14 @@ bool Inliner::runOnSCC(CallGraphSCC &SCC) {
         }
         ++NumInlined;
 
+        // InlineFunction replaced the edge to Callee with the edges of the
+        // inlined call sites.
+        CallGraphNode *CallerNode = CG[Caller];
+        SCC.reportCallEdgeRemoved(CallerNode, CG[Callee]);
+        for (Value *Ptr : InlineInfo.InlinedCalls)
+          SCC.reportCallEdgeAdded(CallerNode,
+                                  getCalleeNode(CG, CallSite(Ptr)));
+
         // Report the inline decision.
         emitOptimizationRemark(
             CallerCtx, DEBUG_TYPE, *Caller, DLoc,
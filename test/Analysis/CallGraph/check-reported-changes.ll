@@ -0,0 +1,31 @@
+; RUN: opt < %s -inline -disable-output -stats 2>&1 | FileCheck %s
+; REQUIRES: asserts
+
+; The inliner reports the call edges it changes, so only @f, into which @leaf
+; is inlined, is checked against the call graph after the inliner ran on the
+; SCC of @f and @g.
+
+; CHECK: 1 cgscc-passmgr - Number of functions rescanned to check the call graph
+
+define internal i32 @leaf(i32 %x) {
+  %r = add i32 %x, 1
+  ret i32 %r
+}
+
+define i32 @f(i32 %x) noinline {
+  %a = call i32 @leaf(i32 %x)
+  %r = call i32 @g(i32 %a)
+  ret i32 %r
+}
+
+define i32 @g(i32 %x) noinline {
+  %c = icmp eq i32 %x, 0
+  br i1 %c, label %done, label %rec
+
+rec:
+  %r = call i32 @f(i32 %x)
+  ret i32 %r
+
+done:
+  ret i32 0
+}
@@ -0,0 +1,32 @@
+; RUN: opt < %s -functionattrs -instcombine -functionattrs -disable-output \
+; RUN:     -stats 2>&1 | FileCheck %s
+; REQUIRES: asserts
+
+; Only the functions that instcombine modified are rescanned to update the
+; call graph before the second functionattrs runs: @f, but neither @g, which
+; is in the same SCC, nor @h.
+
+; CHECK: 1 cgscc-passmgr - Number of functions rescanned to refresh the call graph
+
+define i32 @f(i32 %x) {
+  %a = add i32 %x, 0
+  %r = call i32 @g(i32 %a)
+  ret i32 %r
+}
+
+define i32 @g(i32 %x) {
+  %c = icmp eq i32 %x, 0
+  br i1 %c, label %done, label %rec
+
+rec:
+  %r = call i32 @f(i32 %x)
+  ret i32 %r
+
+done:
+  ret i32 0
+}
+
+define i32 @h(i32 %x) {
+  %r = call i32 @f(i32 %x)
+  ret i32 %r
+}
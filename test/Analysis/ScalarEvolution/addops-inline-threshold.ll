@@ -0,0 +1,21 @@
+; RUN: opt < %s -analyze -scalar-evolution | FileCheck %s
+; RUN: opt < %s -analyze -scalar-evolution \
+; RUN:   -scev-addops-inline-threshold=1 | FileCheck %s --check-prefix=LIMIT
+
+; Past the threshold, the operands of a nested add are no longer inlined into
+; the outer add, so the common operands do not cancel out.
+
+define i32 @f(i32 %x, i32 %y, i32 %z) {
+; CHECK-LABEL: Classifying expressions for: @f
+; LIMIT-LABEL: Classifying expressions for: @f
+  %a = add i32 %x, %y
+; CHECK:  -->  (%x + %y)
+; LIMIT:  -->  (%x + %y)
+  %b = add i32 %a, %z
+; CHECK:  -->  (%x + %y + %z)
+; LIMIT:  -->  (%x + %y + %z)
+  %c = sub i32 %b, %a
+; CHECK:  -->  %z
+; LIMIT:  -->  ((%x + %y + %z) + (-1 * (%x + %y)))
+  ret i32 %c
+}
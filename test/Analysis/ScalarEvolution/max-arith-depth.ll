@@ -0,0 +1,18 @@
+; RUN: opt < %s -analyze -scalar-evolution | FileCheck %s
+; RUN: opt < %s -analyze -scalar-evolution \
+; RUN:   -scalar-evolution-max-arith-depth=0 | FileCheck %s --check-prefix=LIMIT
+
+; Past the depth limit, the operands of the add are no longer simplified, but
+; the expression is still built.
+
+define i32 @f(i32 %x, i32 %y) {
+; CHECK-LABEL: Classifying expressions for: @f
+; LIMIT-LABEL: Classifying expressions for: @f
+  %a = add i32 %x, %y
+; CHECK:  -->  (%x + %y)
+; LIMIT:  -->  (%x + %y)
+  %b = sub i32 %a, %x
+; CHECK:  -->  %y
+; LIMIT:  -->  ((-1 * %x) + %x + %y)
+  ret i32 %b
+}
@@ -0,0 +1,26 @@
+; RUN: opt < %s -analyze -scalar-evolution | FileCheck %s
+; RUN: opt < %s -analyze -scalar-evolution \
+; RUN:   -scalar-evolution-max-constant-evolving-depth=0 \
+; RUN:   | FileCheck %s --check-prefix=LIMIT
+
+; The exit condition is not an affine recurrence, so the trip count is found
+; by evaluating the loop. Past the depth limit, the exit condition is not
+; found to evolve from the phi, and the trip count is unknown.
+
+; CHECK: Loop %loop: backedge-taken count is 9
+; LIMIT: Loop %loop: Unpredictable backedge-taken count.
+
+define i32 @f() {
+entry:
+  br label %loop
+
+loop:
+  %i = phi i32 [ 0, %entry ], [ %i.next, %loop ]
+  %i.next = add i32 %i, 1
+  %sh = shl i32 1, %i.next
+  %c = icmp ult i32 %sh, 1000
+  br i1 %c, label %loop, label %exit
+
+exit:
+  ret i32 %i
+}
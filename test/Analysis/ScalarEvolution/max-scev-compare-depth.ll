@@ -0,0 +1,24 @@
+; RUN: opt < %s -analyze -scalar-evolution | FileCheck %s
+; RUN: opt < %s -analyze -scalar-evolution \
+; RUN:   -scalar-evolution-max-scev-compare-depth=0 \
+; RUN:   | FileCheck %s --check-prefix=LIMIT
+
+; Past the depth limit, the operands of the same type compare equal, so their
+; order in an add is no longer canonical, but their difference still folds.
+
+define i64 @f(i32 %x, i32 %y) {
+; CHECK-LABEL: Classifying expressions for: @f
+; LIMIT-LABEL: Classifying expressions for: @f
+  %zx = zext i32 %x to i64
+  %zy = zext i32 %y to i64
+  %a = add i64 %zx, %zy
+; CHECK:  -->  ((zext i32 %x to i64) + (zext i32 %y to i64))
+; LIMIT:  -->  ((zext i32 %y to i64) + (zext i32 %x to i64))
+  %b = add i64 %zy, %zx
+; CHECK:  -->  ((zext i32 %x to i64) + (zext i32 %y to i64))
+; LIMIT:  -->  ((zext i32 %x to i64) + (zext i32 %y to i64))
+  %c = sub i64 %a, %b
+; CHECK:  -->  0
+; LIMIT:  -->  0
+  ret i64 %c
+}
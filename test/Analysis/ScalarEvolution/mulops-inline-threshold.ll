@@ -0,0 +1,24 @@
+; RUN: opt < %s -analyze -scalar-evolution | FileCheck %s
+; RUN: opt < %s -analyze -scalar-evolution \
+; RUN:   -scev-mulops-inline-threshold=1 | FileCheck %s --check-prefix=LIMIT
+
+; Past the threshold, the operands of a nested mul are no longer inlined into
+; the outer mul, so the common factors are not pulled out.
+
+define i32 @f(i32 %x, i32 %y, i32 %z) {
+; CHECK-LABEL: Classifying expressions for: @f
+; LIMIT-LABEL: Classifying expressions for: @f
+  %a = mul i32 %x, %y
+; CHECK:  -->  (%x * %y)
+; LIMIT:  -->  (%x * %y)
+  %b = mul i32 %a, %z
+; CHECK:  -->  (%x * %y * %z)
+; LIMIT:  -->  (%x * %y * %z)
+  %c = sub i32 %b, %a
+; CHECK:  -->  ((-1 + %z) * %x * %y)
+; LIMIT:  -->  ((-1 * (%x * %y)) + (%x * %y * %z))
+  %d = mul i32 %c, %a
+; CHECK:  -->  ((-1 + %z) * %x * %x * %y * %y)
+; LIMIT:  -->  (((-1 * (%x * %y)) + (%x * %y * %z)) * (%x * %y))
+  ret i32 %d
+}
@@ -0,0 +1,61 @@
+; Check that an index is emitted for the module-level metadata past a
+; threshold, and that the records are correctly loaded on demand through it
+; when materializing functions one at a time.
+
+; RUN: llvm-as -bitcode-mdindex-threshold=1 < %s | llvm-bcanalyzer -dump | FileCheck %s -check-prefix=BC
+; RUN: llvm-as -bitcode-mdindex-threshold=1000 < %s | llvm-bcanalyzer -dump | FileCheck %s -check-prefix=NOINDEX
+
+; BC: <METADATA_BLOCK
+; BC: <INDEX_OFFSET
+; BC: <INDEX op0=0
+; BC: <NAME
+; BC: </METADATA_BLOCK>
+
+; NOINDEX-NOT: INDEX
+
+; RUN: llvm-as -bitcode-mdindex-threshold=1 < %s | llvm-dis | FileCheck %s
+; RUN: llvm-as -bitcode-mdindex-threshold=1 < %s | llvm-extract -func=g -S | FileCheck %s -check-prefix=EXTRACT-G
+; RUN: llvm-as -bitcode-mdindex-threshold=1 < %s | llvm-extract -func=f -S | FileCheck %s -check-prefix=EXTRACT-F
+
+; CHECK: define void @f() !attach ![[F:[0-9]+]]
+; CHECK:   ret void, !tag ![[FTAG:[0-9]+]]
+; CHECK: define void @g()
+; CHECK:   ret void, !tag ![[GTAG:[0-9]+]]
+; CHECK: !named = !{![[NAMED:[0-9]+]]}
+; CHECK-DAG: ![[NAMED]] = !{!"named", ![[SHARED:[0-9]+]]}
+; CHECK-DAG: ![[SHARED]] = !{!"shared"}
+; CHECK-DAG: ![[F]] = !{!"f attachment"}
+; CHECK-DAG: ![[FTAG]] = !{!"f tag", ![[SHARED]], ![[CYCLE:[0-9]+]]}
+; CHECK-DAG: ![[CYCLE]] = distinct !{![[CYCLE]], !"cycle"}
+; CHECK-DAG: ![[GTAG]] = !{!"g tag", ![[SHARED]]}
+
+; EXTRACT-G: define void @g()
+; EXTRACT-G:   ret void, !tag ![[GTAG:[0-9]+]]
+; EXTRACT-G-NOT: f attachment
+; EXTRACT-G-NOT: f tag
+; EXTRACT-G-DAG: ![[GTAG]] = !{!"g tag", ![[SHARED:[0-9]+]]}
+; EXTRACT-G-DAG: ![[SHARED]] = !{!"shared"}
+
+; EXTRACT-F: define void @f() !attach ![[F:[0-9]+]]
+; EXTRACT-F:   ret void, !tag ![[FTAG:[0-9]+]]
+; EXTRACT-F-DAG: ![[F]] = !{!"f attachment"}
+; EXTRACT-F-DAG: ![[FTAG]] = !{!"f tag", ![[SHARED:[0-9]+]], ![[CYCLE:[0-9]+]]}
+; EXTRACT-F-DAG: ![[SHARED]] = !{!"shared"}
+; EXTRACT-F-DAG: ![[CYCLE]] = distinct !{![[CYCLE]], !"cycle"}
+
+define void @f() !attach !1 {
+  ret void, !tag !2
+}
+
+define void @g() {
+  ret void, !tag !4
+}
+
+!named = !{!0}
+
+!0 = !{!"named", !5}
+!1 = !{!"f attachment"}
+!2 = !{!"f tag", !5, !3}
+!3 = distinct !{!3, !"cycle"}
+!4 = !{!"g tag", !5}
+!5 = !{!"shared"}
@@ -0,0 +1,35 @@
+; RUN: llvm-as -function-summary < %s | llvm-bcanalyzer -dump | FileCheck %s -check-prefix=BC
+; RUN: llvm-as < %s | llvm-bcanalyzer -dump | FileCheck %s -check-prefix=NOSUMMARY
+; Check that the module can still be read back when it has a summary block.
+; RUN: llvm-as -function-summary < %s | llvm-dis | FileCheck %s -check-prefix=DIS
+
+; The summary block follows the module block.
+; BC: </MODULE_BLOCK>
+; BC-NEXT: <FUNCTION_SUMMARY_BLOCK
+; Symbols are emitted before their first use: 'foo' is first used as the
+; callee of 'bar'.
+; BC-NEXT: <SYMBOL {{.*}}op0=102 op1=111 op2=111/>
+; BC-NEXT: <SYMBOL {{.*}}op0=98 op1=97 op2=114/>
+; bar: external linkage, 3 instructions, 2 calls to foo (symbol 0). It is not
+; importable, as it refers to the internal function foo.
+; BC-NEXT: <ENTRY {{.*}}op0=1 op1=0 op2=0 op3=3 op4=0 op5=0 op6=2/>
+; foo: internal linkage (3), 1 instruction, not importable.
+; BC-NEXT: <ENTRY {{.*}}op0=0 op1=0 op2=3 op3=1 op4=0/>
+; BC-NEXT: </FUNCTION_SUMMARY_BLOCK>
+
+; NOSUMMARY-NOT: FUNCTION_SUMMARY_BLOCK
+
+; DIS: define i32 @bar()
+; DIS: define internal void @foo()
+
+define i32 @bar() {
+entry:
+  call void @foo()
+  call void @foo()
+  ret i32 0
+}
+
+define internal void @foo() {
+entry:
+  ret void
+}
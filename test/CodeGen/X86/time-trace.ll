@@ -0,0 +1,15 @@
+; RUN: llc < %s -mtriple=x86_64-unknown-linux -filetype=obj -o %t.o \
+; RUN:     -time-trace=%t.json
+; RUN: FileCheck %s < %t.json
+
+; CHECK-DAG: "name": "Function passes", "args": { "detail": "f" }
+; CHECK-DAG: "name": "X86 DAG->DAG Instruction Selection", "args": { "detail": "f" }
+; CHECK-DAG: "name": "X86 Assembly / Object Emitter", "args": { "detail": "f" }
+; CHECK-DAG: "name": "Layout object" }
+; CHECK-DAG: "name": "Write object" }
+; CHECK-DAG: "name": "Emit object" }
+
+define i32 @f(i32 %x) {
+  %y = add i32 %x, 1
+  ret i32 %y
+}
@@ -0,0 +1,54 @@
+# Check that the code of a compile unit is found from its line table when the
+# object has no .debug_aranges section and the DIE of the unit has no address
+# attributes, as with a skeleton unit whose .dwo file is missing.
+#
+# RUN: llvm-mc -triple=x86_64-pc-linux -filetype=obj -o %t.o %s
+# RUN: llvm-readobj -sections %t.o | FileCheck %s --check-prefix=SECTIONS
+# RUN: echo "0x0" > %t.input
+# RUN: echo "0x5" >> %t.input
+# RUN: echo "0x20" >> %t.input
+# RUN: llvm-symbolizer -obj=%t.o -functions=none < %t.input | FileCheck %s
+#
+# SECTIONS-NOT: .debug_aranges
+#
+# CHECK:      noaranges.c:3:0
+# CHECK:      noaranges.c:4:0
+# CHECK:      ??:0:0
+
+  .text
+  .file 1 "noaranges.c"
+  .loc 1 3 0
+  nop
+  nop
+  nop
+  nop
+  .loc 1 4 0
+  nop
+  nop
+  nop
+  nop
+  ret
+
+  .section .debug_abbrev,"",@progbits
+.Labbrev:
+  .byte 1                       # Abbreviation code
+  .byte 0x11                    # DW_TAG_compile_unit
+  .byte 0                       # DW_CHILDREN_no
+  .byte 0x03, 0x08              # DW_AT_name, DW_FORM_string
+  .byte 0x10, 0x17              # DW_AT_stmt_list, DW_FORM_sec_offset
+  .byte 0, 0
+  .byte 0
+
+  .section .debug_info,"",@progbits
+  .long .Linfo_end - .Linfo_begin # Length of Unit
+.Linfo_begin:
+  .short 4                      # DWARF version number
+  .long .Labbrev                # Offset Into Abbrev. Section
+  .byte 8                       # Address Size
+  .byte 1                       # DW_TAG_compile_unit
+  .asciz "noaranges.c"
+  .long .Lline_table_start
+.Linfo_end:
+
+  .section .debug_line,"",@progbits
+.Lline_table_start:
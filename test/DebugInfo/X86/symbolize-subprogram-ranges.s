@@ -0,0 +1,198 @@
+# Check the lookup of the subprogram that contains an address, which goes
+# through an index of the address ranges of the subprogram DIEs of the unit.
+#
+# RUN: llvm-mc -triple=x86_64-pc-linux -filetype=obj -o %t.o %s
+# RUN: echo "0x0" > %t.input
+# RUN: echo "0xa" >> %t.input
+# RUN: echo "0x18" >> %t.input
+# RUN: echo "0x10" >> %t.input
+# RUN: echo "0x14" >> %t.input
+# RUN: echo "0xc" >> %t.input
+# RUN: echo "0x0" >> %t.input
+# RUN: echo "0xa" >> %t.input
+# RUN: echo "0x1d" >> %t.input
+# RUN: llvm-symbolizer -obj=%t.o -inlining=false < %t.input \
+# RUN:   | FileCheck %s --check-prefix=NOINLINE
+# RUN: llvm-symbolizer -obj=%t.o -inlining=true < %t.input \
+# RUN:   | FileCheck %s --check-prefix=INLINE
+#
+# The batched lookups of several threads give the same results, whether the
+# addresses are sorted, unsorted or repeated.
+# RUN: llvm-symbolizer -obj=%t.o -inlining=false -num-threads=2 \
+# RUN:   -batch-size=5 < %t.input | FileCheck %s --check-prefix=NOINLINE
+# RUN: llvm-symbolizer -obj=%t.o -inlining=true -num-threads=2 \
+# RUN:   -batch-size=5 < %t.input | FileCheck %s --check-prefix=INLINE
+#
+# The input looks up:
+#  0x0: outer.
+#  0xa: the code of inlined, inlined in outer.
+#  0x18: nested, a subprogram nested in the DIE of outer.
+#  0x10: second, also covered by a later subprogram DIE, aliased.
+#  0x14: the code between the subprograms.
+#  0xc, 0x0, 0xa: outer and inlined again, out of order and repeated.
+#  0x1d: after the end of the unit.
+#
+# NOINLINE:      outer
+# NOINLINE-NEXT: ranges.c:10:0
+# NOINLINE:      inlined
+# NOINLINE-NEXT: ranges.c:20:0
+# NOINLINE:      nested
+# NOINLINE-NEXT: ranges.c:15:0
+# NOINLINE:      second
+# NOINLINE-NEXT: ranges.c:30:0
+# NOINLINE:      ??
+# NOINLINE-NEXT: ranges.c:40:0
+# NOINLINE:      outer
+# NOINLINE-NEXT: ranges.c:12:0
+# NOINLINE:      outer
+# NOINLINE-NEXT: ranges.c:10:0
+# NOINLINE:      inlined
+# NOINLINE-NEXT: ranges.c:20:0
+# NOINLINE:      ??
+# NOINLINE-NEXT: ??:0:0
+#
+# INLINE:      outer
+# INLINE-NEXT: ranges.c:10:0
+# INLINE:      inlined
+# INLINE-NEXT: ranges.c:20:0
+# INLINE-NEXT: outer
+# INLINE-NEXT: ranges.c:11:0
+# INLINE:      nested
+# INLINE-NEXT: ranges.c:15:0
+# INLINE:      second
+# INLINE-NEXT: ranges.c:30:0
+# INLINE:      ??
+# INLINE-NEXT: ranges.c:40:0
+# INLINE:      outer
+# INLINE-NEXT: ranges.c:12:0
+# INLINE:      outer
+# INLINE-NEXT: ranges.c:10:0
+# INLINE:      inlined
+# INLINE-NEXT: ranges.c:20:0
+# INLINE-NEXT: outer
+# INLINE-NEXT: ranges.c:11:0
+# INLINE:      ??
+# INLINE-NEXT: ??:0:0
+
+  .text
+  .file 1 "ranges.c"
+.Lbegin:
+.Louter:
+  .loc 1 10 0
+  nop
+  nop
+  nop
+  nop
+  .loc 1 11 0
+  nop
+  nop
+  nop
+  nop
+.Linlined:
+  .loc 1 20 0
+  nop
+  nop
+  nop
+  nop
+.Linlined_end:
+  .loc 1 12 0
+  nop
+  nop
+  nop
+  nop
+.Louter_end:
+.Lsecond:
+  .loc 1 30 0
+  nop
+  nop
+  nop
+  nop
+.Lsecond_end:
+  .loc 1 40 0
+  nop
+  nop
+  nop
+  nop
+.Lnested:
+  .loc 1 15 0
+  nop
+  nop
+  nop
+  nop
+  ret
+.Lend:
+
+  .section .debug_abbrev,"",@progbits
+.Labbrev:
+  .byte 1                       # Abbreviation code
+  .byte 0x11                    # DW_TAG_compile_unit
+  .byte 1                       # DW_CHILDREN_yes
+  .byte 0x03, 0x08              # DW_AT_name, DW_FORM_string
+  .byte 0x10, 0x17              # DW_AT_stmt_list, DW_FORM_sec_offset
+  .byte 0x11, 0x01              # DW_AT_low_pc, DW_FORM_addr
+  .byte 0x12, 0x06              # DW_AT_high_pc, DW_FORM_data4
+  .byte 0, 0
+  .byte 2                       # Abbreviation code
+  .byte 0x2e                    # DW_TAG_subprogram
+  .byte 1                       # DW_CHILDREN_yes
+  .byte 0x03, 0x08              # DW_AT_name, DW_FORM_string
+  .byte 0x11, 0x01              # DW_AT_low_pc, DW_FORM_addr
+  .byte 0x12, 0x06              # DW_AT_high_pc, DW_FORM_data4
+  .byte 0, 0
+  .byte 3                       # Abbreviation code
+  .byte 0x2e                    # DW_TAG_subprogram
+  .byte 0                       # DW_CHILDREN_no
+  .byte 0x03, 0x08              # DW_AT_name, DW_FORM_string
+  .byte 0x11, 0x01              # DW_AT_low_pc, DW_FORM_addr
+  .byte 0x12, 0x06              # DW_AT_high_pc, DW_FORM_data4
+  .byte 0, 0
+  .byte 4                       # Abbreviation code
+  .byte 0x1d                    # DW_TAG_inlined_subroutine
+  .byte 0                       # DW_CHILDREN_no
+  .byte 0x03, 0x08              # DW_AT_name, DW_FORM_string
+  .byte 0x11, 0x01              # DW_AT_low_pc, DW_FORM_addr
+  .byte 0x12, 0x06              # DW_AT_high_pc, DW_FORM_data4
+  .byte 0x58, 0x0b              # DW_AT_call_file, DW_FORM_data1
+  .byte 0x59, 0x0b              # DW_AT_call_line, DW_FORM_data1
+  .byte 0, 0
+  .byte 0
+
+  .section .debug_info,"",@progbits
+  .long .Linfo_end - .Linfo_begin # Length of Unit
+.Linfo_begin:
+  .short 4                      # DWARF version number
+  .long .Labbrev                # Offset Into Abbrev. Section
+  .byte 8                       # Address Size
+  .byte 1                       # DW_TAG_compile_unit
+  .asciz "ranges.c"
+  .long .Lline_table_start
+  .quad .Lbegin
+  .long .Lend - .Lbegin
+  .byte 2                       # DW_TAG_subprogram
+  .asciz "outer"
+  .quad .Louter
+  .long .Louter_end - .Louter
+  .byte 4                       # DW_TAG_inlined_subroutine
+  .asciz "inlined"
+  .quad .Linlined
+  .long .Linlined_end - .Linlined
+  .byte 1                       # DW_AT_call_file
+  .byte 11                      # DW_AT_call_line
+  .byte 3                       # DW_TAG_subprogram
+  .asciz "nested"
+  .quad .Lnested
+  .long .Lend - .Lnested
+  .byte 0                       # End of the children of outer
+  .byte 3                       # DW_TAG_subprogram
+  .asciz "second"
+  .quad .Lsecond
+  .long .Lsecond_end - .Lsecond
+  .byte 3                       # DW_TAG_subprogram
+  .asciz "aliased"
+  .quad .Lsecond
+  .long .Lsecond_end - .Lsecond
+  .byte 0                       # End of the children of the unit
+.Linfo_end:
+
+  .section .debug_line,"",@progbits
+.Lline_table_start:
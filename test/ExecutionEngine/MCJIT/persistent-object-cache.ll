@@ -0,0 +1,27 @@
+; The first run compiles the modules and stores their objects, the next ones
+; load them from the cache.
+; RUN: rm -rf %t.cachedir
+; RUN: %lli -extra-module=%p/Inputs/multi-module-b.ll -extra-module=%p/Inputs/multi-module-c.ll -persistent-object-cache=%t.cachedir %s
+; RUN: ls %t.cachedir | FileCheck %s
+; RUN: %lli -extra-module=%p/Inputs/multi-module-b.ll -extra-module=%p/Inputs/multi-module-c.ll -persistent-object-cache=%t.cachedir %s
+; RUN: ls %t.cachedir | FileCheck %s
+
+; Other target options give other objects.
+; RUN: %lli -float-abi=soft -extra-module=%p/Inputs/multi-module-b.ll -extra-module=%p/Inputs/multi-module-c.ll -persistent-object-cache=%t.cachedir %s
+; RUN: ls %t.cachedir | count 6
+
+; The cache manager of lli cannot be used at the same time.
+; RUN: not %lli -enable-cache-manager -persistent-object-cache=%t.cachedir %s 2>&1 | FileCheck %s --check-prefix=ERROR
+; ERROR: -persistent-object-cache cannot be used with -enable-cache-manager
+
+; CHECK: llvmcache-{{[0-9a-f]+}}.o
+; CHECK-NEXT: llvmcache-{{[0-9a-f]+}}.o
+; CHECK-NEXT: llvmcache-{{[0-9a-f]+}}.o
+; CHECK-NOT: llvmcache
+
+declare i32 @FB()
+
+define i32 @main() {
+  %r = call i32 @FB( )   ; <i32> [#uses=1]
+  ret i32 %r
+}
@@ -0,0 +1,107 @@
+; RUN: lli -jit-kind=orc-lazy -orc-lazy-background-compile %s | FileCheck %s
+;
+; CHECK: Hello
+; CHECK: Goodbye
+;
+; Check that the callees of main are queued when main is compiled, and that
+; @report, which is never called, is compiled in the background.
+; RUN: lli -jit-kind=orc-lazy -orc-lazy-background-compile \
+; RUN:   -debug-only=orc-cod %s 2> %t.err > /dev/null
+; RUN: FileCheck %s --check-prefix=DEBUG < %t.err
+; REQUIRES: asserts
+;
+; DEBUG-DAG: Compiling @init on demand
+; DEBUG-DAG: Compiling @main on demand
+; DEBUG-DAG: Queued @hello for background compilation
+; DEBUG-DAG: Queued @fib for background compilation
+; DEBUG-DAG: Queued @goodbye for background compilation
+; DEBUG-DAG: Queued @report for background compilation
+; DEBUG-DAG: Compiling @report in the background
+
+@str = private unnamed_addr constant [6 x i8] c"Hello\00"
+@str2 = private unnamed_addr constant [8 x i8] c"Goodbye\00"
+@str3 = private unnamed_addr constant [7 x i8] c"Failed\00"
+
+@llvm.global_ctors = appending global [1 x { i32, void ()*, i8* }] [{ i32, void ()*, i8* } { i32 65535, void ()* @init, i8* null }]
+
+; The body pointer of the stub of @report, and its value before main runs,
+; which is the address of the compile callback of @report.
+@"report$orc_addr" = external global void ()*
+@report_callback = global void ()* null
+
+define void @init() {
+entry:
+  %0 = load volatile void ()*, void ()** @"report$orc_addr"
+  store void ()* %0, void ()** @report_callback
+  ret void
+}
+
+define i32 @fib(i32 %n) {
+entry:
+  %cmp = icmp slt i32 %n, 2
+  br i1 %cmp, label %done, label %recurse
+
+recurse:
+  %n1 = sub i32 %n, 1
+  %f1 = call i32 @fib(i32 %n1)
+  %n2 = sub i32 %n, 2
+  %f2 = call i32 @fib(i32 %n2)
+  %sum = add i32 %f1, %f2
+  ret i32 %sum
+
+done:
+  ret i32 %n
+}
+
+define void @hello() {
+entry:
+  %0 = call i32 @puts(i8* getelementptr inbounds ([6 x i8], [6 x i8]* @str, i64 0, i64 0))
+  ret void
+}
+
+define void @goodbye() {
+entry:
+  %0 = call i32 @puts(i8* getelementptr inbounds ([8 x i8], [8 x i8]* @str2, i64 0, i64 0))
+  ret void
+}
+
+define void @report() {
+entry:
+  %0 = call i32 @puts(i8* getelementptr inbounds ([7 x i8], [7 x i8]* @str3, i64 0, i64 0))
+  ret void
+}
+
+define i32 @main(i32 %argc, i8** nocapture readnone %argv) {
+entry:
+  call void @hello()
+  %f = call i32 @fib(i32 20)
+  %cmp = icmp eq i32 %f, 6765
+  br i1 %cmp, label %ok, label %fail
+
+ok:
+  call void @goodbye()
+  br label %wait
+
+; Wait for the background thread to point the stub of @report at its body,
+; but not forever.
+wait:
+  %i = phi i64 [ 0, %ok ], [ %next, %poll ]
+  %callback = load void ()*, void ()** @report_callback
+  %current = load volatile void ()*, void ()** @"report$orc_addr"
+  %compiled = icmp ne void ()* %current, %callback
+  br i1 %compiled, label %exit, label %poll
+
+poll:
+  %next = add i64 %i, 1
+  %timeout = icmp eq i64 %next, 10000000000
+  br i1 %timeout, label %fail, label %wait
+
+exit:
+  ret i32 0
+
+fail:
+  call void @report()
+  ret i32 1
+}
+
+declare i32 @puts(i8* nocapture readonly)
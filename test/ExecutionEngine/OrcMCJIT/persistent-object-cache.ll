@@ -0,0 +1,19 @@
+; The first run compiles the modules and stores their objects, the next ones
+; load them from the cache.
+; RUN: rm -rf %t.cachedir
+; RUN: %lli -jit-kind=orc-mcjit -extra-module=%p/Inputs/multi-module-b.ll -extra-module=%p/Inputs/multi-module-c.ll -persistent-object-cache=%t.cachedir %s
+; RUN: ls %t.cachedir | FileCheck %s
+; RUN: %lli -jit-kind=orc-mcjit -extra-module=%p/Inputs/multi-module-b.ll -extra-module=%p/Inputs/multi-module-c.ll -persistent-object-cache=%t.cachedir %s
+; RUN: ls %t.cachedir | FileCheck %s
+
+; CHECK: llvmcache-{{[0-9a-f]+}}.o
+; CHECK-NEXT: llvmcache-{{[0-9a-f]+}}.o
+; CHECK-NEXT: llvmcache-{{[0-9a-f]+}}.o
+; CHECK-NOT: llvmcache
+
+declare i32 @FB()
+
+define i32 @main() {
+  %r = call i32 @FB( )   ; <i32> [#uses=1]
+  ret i32 %r
+}
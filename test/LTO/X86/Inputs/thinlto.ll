@@ -0,0 +1,12 @@
+target triple = "x86_64-unknown-linux-gnu"
+
+define i32 @callee(i32 %x) {
+entry:
+  %r = add i32 %x, 1
+  ret i32 %r
+}
+
+define i32 @bar() {
+entry:
+  ret i32 7
+}
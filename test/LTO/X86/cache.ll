@@ -0,0 +1,35 @@
+; RUN: llvm-as -o %t.bc %s
+; RUN: rm -rf %t.cache
+
+; The first link stores the object in the cache, the second one takes it from
+; there, along with a timestamp file for the pruning.
+; RUN: llvm-lto -exported-symbol=foo -cache-dir=%t.cache -o %t.o %t.bc
+; RUN: ls %t.cache | count 2
+; RUN: llvm-lto -exported-symbol=foo -cache-dir=%t.cache -o %t2.o %t.bc
+; RUN: ls %t.cache | count 2
+; RUN: cmp %t.o %t2.o
+; RUN: llvm-nm %t2.o | FileCheck %s
+
+; Different options produce a different entry, and so does another number of
+; partitions.
+; RUN: llvm-lto -exported-symbol=foo -cache-dir=%t.cache -O1 -o %t3.o %t.bc
+; RUN: ls %t.cache | count 3
+; RUN: llvm-lto -exported-symbol=foo -exported-symbol=bar -cache-dir=%t.cache -j2 -o %t5.o %t.bc
+; RUN: ls %t.cache | count 5
+
+; Pruning to a tiny size, even on a cache hit, leaves only the timestamp file.
+; RUN: llvm-lto -exported-symbol=foo -cache-dir=%t.cache -cache-pruning-interval=0 -cache-max-size=1 -o %t4.o %t.bc
+; RUN: ls %t.cache | count 1
+; RUN: cmp %t.o %t4.o
+
+target triple = "x86_64-unknown-linux-gnu"
+
+; CHECK: T foo
+define void @foo() {
+  call void @bar()
+  ret void
+}
+
+define void @bar() {
+  ret void
+}
@@ -0,0 +1,50 @@
+; RUN: llvm-as -function-summary %s -o %t.bc
+; RUN: llvm-as %p/Inputs/thinlto.ll -o %t2.bc
+
+; Each module is compiled into its own object file, after importing and
+; inlining @callee. The summary of the second module, emitted without one, is
+; computed on the fly.
+; RUN: llvm-lto -thinlto-action=run -j2 -o %t.o %t.bc %t2.bc
+; RUN: llvm-nm %t.o.0 | FileCheck %s -check-prefix=NM0
+; RUN: llvm-nm %t.o.1 | FileCheck %s -check-prefix=NM1
+
+; With a cache, the object file of each module is stored then reused.
+; RUN: rm -rf %t.cache
+; RUN: llvm-lto -thinlto-action=run -j2 -cache-dir=%t.cache -o %t4.o %t.bc %t2.bc
+; RUN: llvm-lto -thinlto-action=run -j2 -cache-dir=%t.cache -o %t5.o %t.bc %t2.bc
+; RUN: ls %t.cache | count 3
+; RUN: cmp %t.o.0 %t5.o.0
+; RUN: cmp %t.o.1 %t5.o.1
+
+; The combined index lists the functions of both modules.
+; RUN: llvm-lto -thinlto-action=thinlink -o %t3.bc %t.bc %t2.bc
+; RUN: llvm-bcanalyzer -dump %t3.bc | FileCheck %s -check-prefix=COMBINED
+
+; @callee was imported and inlined: no reference to it remains.
+; NM0-NOT: callee
+; NM0: T foo
+; NM0-NOT: callee
+
+; The imported definitions stay defined in their own module.
+; NM1-DAG: T bar
+; NM1-DAG: T callee
+; NM1-NOT: foo
+
+; COMBINED: <FUNCTION_SUMMARY_BLOCK
+; COMBINED-NEXT: <MODULE_PATH
+; COMBINED-NEXT: <MODULE_PATH
+; COMBINED: <ENTRY
+; COMBINED: <ENTRY
+; COMBINED: <ENTRY
+; COMBINED-NOT: <ENTRY
+; COMBINED: </FUNCTION_SUMMARY_BLOCK>
+
+target triple = "x86_64-unknown-linux-gnu"
+
+define i32 @foo(i32 %x) {
+entry:
+  %r = call i32 @callee(i32 %x)
+  ret i32 %r
+}
+
+declare i32 @callee(i32)
@@ -0,0 +1,41 @@
+// RUN: llvm-mc -filetype=obj -triple x86_64-pc-linux %s -o %t
+// RUN: llvm-mc -filetype=obj -triple x86_64-pc-linux %s -o %t.parallel \
+// RUN:   -elf-writer-threads=4 -elf-writer-batch-size=1
+// RUN: cmp %t %t.parallel
+// RUN: llvm-mc -filetype=obj -triple i386-pc-linux %s -o %t.32
+// RUN: llvm-mc -filetype=obj -triple i386-pc-linux %s -o %t.32.parallel \
+// RUN:   -elf-writer-threads=4 -elf-writer-batch-size=1
+// RUN: cmp %t.32 %t.32.parallel
+
+// The sections and the relocations are written at the same offsets with
+// several threads, including the virtual sections and the aligned ones.
+
+	.text
+	call	f
+	.p2align 4
+	.byte	1
+
+	.section	.text.f,"axG",@progbits,f,comdat
+	.globl	f
+f:
+	call	g
+	movl	data, %eax
+	ret
+
+	.section	.text.g,"ax",@progbits
+	.p2align 5
+g:
+	jmp	f
+
+	.data
+	.p2align 3
+data:
+	.long	f
+	.long	g
+
+	.bss
+	.zero	16
+
+	.section	.rodata,"a",@progbits
+	.p2align 4
+	.long	data
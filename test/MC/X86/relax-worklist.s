@@ -0,0 +1,25 @@
+// RUN: llvm-mc -triple x86_64-unknown-unknown -filetype=obj -stats %s \
+// RUN:   -o %t 2>&1 | FileCheck %s --check-prefix=STATS
+// RUN: llvm-objdump -d %t | FileCheck %s
+// REQUIRES: asserts
+
+// Only the jumps whose target may have moved are checked again after an
+// iteration of the relaxation: the second jump is after the one that grows
+// and is only checked once. The second layout of the section, which finds
+// nothing to relax, checks both jumps again.
+
+// STATS: 5 assembler - Number of fragments checked for relaxation
+// STATS: 3 assembler - Number of relaxation iterations over the sections
+// STATS: 1 assembler - Number of relaxed instructions
+
+// CHECK: 0: e9 c8 00 00 00 jmp 200
+// CHECK: cd: eb 01 jmp 1
+
+	.text
+	jmp	a
+	.fill	200, 1, 0x90
+a:
+	jmp	b
+	nop
+b:
+	ret
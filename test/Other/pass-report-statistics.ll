@@ -0,0 +1,14 @@
+; REQUIRES: asserts
+; RUN: opt < %s -instcombine -disable-output -pass-report=- | FileCheck %s
+
+; The statistics are in the report, and are not printed as with -stats.
+; RUN: opt < %s -instcombine -disable-output -pass-report=%t.json 2>&1 \
+; RUN:     | count 0
+
+; CHECK: "statistics": [
+; CHECK: { "name": "instcombine", "desc": "Number of insts combined", "value": 1 }
+
+define i32 @f(i32 %x) {
+  %y = add i32 %x, 0
+  ret i32 %y
+}
@@ -0,0 +1,50 @@
+; RUN: opt < %s -inline -instcombine -loop-rotate -disable-output \
+; RUN:     -pass-report=%t.json
+; RUN: FileCheck %s < %t.json
+; RUN: opt < %s -instcombine -disable-output -pass-report=- \
+; RUN:     -pass-report-executions=false | FileCheck --check-prefix=TOTALS %s
+
+; CHECK: "passes": [
+; CHECK-DAG: { "name": "Function Integration/Inlining", "arg": "inline", "executions": 4, "wall": {{[0-9.]+}}, "user": {{[0-9.]+}}, "system": {{[0-9.]+}}, "instruction-delta": 0, "peak-rss-delta": {{[0-9]+}} }
+; CHECK-DAG: { "name": "Combine redundant instructions", "arg": "instcombine", "executions": 3, {{.*}}, "instruction-delta": -2,
+; CHECK-DAG: { "name": "Rotate Loops", "arg": "loop-rotate", "executions": 1,
+; CHECK: "executions": [
+; CHECK-DAG: { "pass": "CallGraph Construction", "module": "<stdin>", {{.*}}, "instructions-before": 12, "instructions-after": 12,
+; CHECK-DAG: { "pass": "Function Integration/Inlining", "scc": "callee", {{.*}}, "instructions-before": 2, "instructions-after": 2,
+; CHECK-DAG: { "pass": "Function Integration/Inlining", "scc": "caller", {{.*}}, "instructions-before": 4, "instructions-after": 4,
+; CHECK-DAG: { "pass": "Combine redundant instructions", "function": "caller", {{.*}}, "instructions-before": 4, "instructions-after": 2,
+; CHECK-DAG: { "pass": "Rotate Loops", "function": "loop", {{.*}}, "instructions-before": 6, "instructions-after": 6,
+; CHECK: ],
+; CHECK-NEXT: "statistics": [
+
+; TOTALS: "passes": [
+; TOTALS: { "name": "Combine redundant instructions", "arg": "instcombine", "executions": 3,
+; TOTALS: ],
+; TOTALS-NEXT: "executions": [],
+; TOTALS-NEXT: "statistics": [
+
+define internal i32 @callee(i32 %x) {
+  %y = add i32 %x, 1
+  ret i32 %y
+}
+
+define i32 @caller(i32 %a) {
+  %b = add i32 %a, 0
+  %c = call i32 @callee(i32 %b)
+  %d = add i32 %c, 0
+  ret i32 %d
+}
+
+define void @loop(i32 %n) {
+entry:
+  br label %header
+
+header:
+  %i = phi i32 [ 0, %entry ], [ %next, %header ]
+  %next = add i32 %i, 1
+  %done = icmp eq i32 %next, %n
+  br i1 %done, label %exit, label %header
+
+exit:
+  ret void
+}
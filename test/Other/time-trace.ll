@@ -0,0 +1,25 @@
+; RUN: opt < %s -instcombine -disable-output -time-trace=%t.json
+; RUN: FileCheck %s < %t.json
+; RUN: llvm-as < %s > %t.bc
+; RUN: opt %t.bc -instcombine -disable-output -time-trace=- \
+; RUN:     | FileCheck --check-prefix=BITCODE %s
+
+; CHECK: {"traceEvents": [
+; CHECK-DAG: { "ph": "X", "pid": {{[0-9]+}}, "tid": 0, "ts": {{[0-9]+}}, "dur": {{[0-9]+}}, "name": "Combine redundant instructions", "args": { "detail": "f" } }
+; CHECK-DAG: { "ph": "X", {{.*}}, "name": "Function passes", "args": { "detail": "f" } }
+; CHECK-DAG: { "ph": "X", {{.*}}, "name": "Combine redundant instructions", "args": { "detail": "g\"quoted\"" } }
+; CHECK-DAG: { "ph": "X", {{.*}}, "name": "Parse IR", "args": { "detail": "<stdin>" } }
+; CHECK: ],
+; CHECK-NEXT: "displayTimeUnit": "ms"}
+
+; BITCODE-DAG: "name": "Read bitcode", "args": { "detail": "{{.*}}time-trace.ll.tmp.bc" }
+; BITCODE-DAG: "name": "Combine redundant instructions", "args": { "detail": "f" }
+
+define i32 @f(i32 %x) {
+  %y = add i32 %x, 0
+  ret i32 %y
+}
+
+define void @"g\22quoted\22"() {
+  ret void
+}
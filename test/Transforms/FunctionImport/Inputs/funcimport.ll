@@ -0,0 +1,57 @@
+@global = global i32 0
+@localconst = private unnamed_addr constant [6 x i8] c"hello\00"
+@localvar = internal global i32 0
+
+declare i32 @puts(i8*)
+
+define i32 @small() {
+entry:
+  ret i32 42
+}
+
+define void @calls_small_callee() {
+entry:
+  call void @small_callee()
+  ret void
+}
+
+define void @small_callee() {
+entry:
+  store i32 1, i32* @global
+  ret void
+}
+
+define i32 @uses_localconst() {
+entry:
+  %r = call i32 @puts(i8* getelementptr inbounds ([6 x i8], [6 x i8]* @localconst, i64 0, i64 0))
+  ret i32 %r
+}
+
+define i32 @uses_localvar() {
+entry:
+  %v = load i32, i32* @localvar
+  ret i32 %v
+}
+
+define linkonce_odr i32 @linkonceodr() {
+entry:
+  ret i32 1
+}
+
+define weak i32 @weakfunc() {
+entry:
+  ret i32 2
+}
+
+define void @big() {
+entry:
+  store i32 1, i32* @global
+  store i32 2, i32* @global
+  store i32 3, i32* @global
+  store i32 4, i32* @global
+  store i32 5, i32* @global
+  store i32 6, i32* @global
+  store i32 7, i32* @global
+  store i32 8, i32* @global
+  ret void
+}
@@ -0,0 +1,55 @@
+; Do setup work for all below tests: generate bitcode and combined index
+; RUN: llvm-as -function-summary %s -o %t.bc
+; RUN: llvm-as -function-summary %p/Inputs/funcimport.ll -o %t2.bc
+; RUN: llvm-lto -thinlto-action=thinlink -o %t3.thinlto.bc %t.bc %t2.bc
+
+; Do the import now
+; RUN: opt -function-import -summary-file %t3.thinlto.bc -import-instr-limit=5 %t.bc -S | FileCheck %s
+
+; Lower the instruction limit: only the functions with a single instruction
+; are imported.
+; RUN: opt -function-import -summary-file %t3.thinlto.bc -import-instr-limit=1 %t.bc -S | FileCheck %s --check-prefix=LIMIT
+
+define i32 @main() {
+entry:
+  %a = call i32 @small()
+  call void @calls_small_callee()
+  %b = call i32 @uses_localconst()
+  %c = call i32 @uses_localvar()
+  %d = call i32 @linkonceodr()
+  %e = call i32 @weakfunc()
+  call void @big()
+  ret i32 0
+}
+
+declare i32 @small()
+declare void @calls_small_callee()
+declare i32 @uses_localconst()
+declare i32 @uses_localvar()
+declare i32 @linkonceodr()
+declare i32 @weakfunc()
+declare void @big()
+
+; Local constants are imported along with the functions using them.
+; CHECK-DAG: @localconst{{.*}} = private unnamed_addr constant [6 x i8] c"hello\00"
+; CHECK-DAG: define available_externally i32 @small()
+; Callees of imported functions are imported too.
+; CHECK-DAG: define available_externally void @calls_small_callee()
+; CHECK-DAG: define available_externally void @small_callee()
+; CHECK-DAG: define available_externally i32 @uses_localconst()
+; A linkonce_odr definition may not be emitted by its own module.
+; CHECK-DAG: define linkonce_odr i32 @linkonceodr()
+; A function referring to a local variable cannot be imported.
+; CHECK-DAG: declare i32 @uses_localvar()
+; Weak definitions may be overridden at link time.
+; CHECK-DAG: declare i32 @weakfunc()
+; CHECK-DAG: declare void @big()
+
+; Hot functions are imported with a larger limit.
+; RUN: opt -function-import -summary-file %t3.thinlto.bc -import-instr-limit=5 -import-hot-callsites=1 %t.bc -S | FileCheck %s --check-prefix=HOT
+; HOT: define available_externally void @big()
+
+; LIMIT-DAG: define available_externally i32 @small()
+; LIMIT-DAG: define linkonce_odr i32 @linkonceodr()
+; LIMIT-DAG: declare void @calls_small_callee()
+; LIMIT-DAG: declare i32 @uses_localconst()
@@ -0,0 +1,61 @@
+; RUN: opt < %s -inline -inline-threshold=20 -S | FileCheck %s
+; RUN: opt < %s -inline -inline-threshold=20 -disable-output -stats 2>&1 \
+; RUN:     | FileCheck %s --check-prefix=STATS
+; REQUIRES: asserts
+
+; The calls of @big whose argument is not a constant have the same cost, which
+; is only computed once. The call with a constant argument is analyzed on its
+; own, and found cheap enough to be inlined.
+
+; STATS-DAG: 2 inline-cost - Number of call sites analyzed
+; STATS-DAG: 2 inline-cost - Number of call sites whose cached cost was reused
+
+define i32 @big(i32 %x) {
+entry:
+  %c = icmp eq i32 %x, 0
+  br i1 %c, label %zero, label %other
+
+zero:
+  ret i32 1
+
+other:
+  %m1 = mul i32 %x, %x
+  %m2 = mul i32 %m1, %x
+  %m3 = mul i32 %m2, %x
+  %m4 = mul i32 %m3, %x
+  %m5 = mul i32 %m4, %x
+  %m6 = mul i32 %m5, %x
+  %m7 = mul i32 %m6, %x
+  %m8 = mul i32 %m7, %x
+  %m9 = mul i32 %m8, %x
+  ret i32 %m9
+}
+
+; CHECK-LABEL: define i32 @a(
+; CHECK: call i32 @big(i32 %x)
+define i32 @a(i32 %x) {
+  %r = call i32 @big(i32 %x)
+  ret i32 %r
+}
+
+; CHECK-LABEL: define i32 @b(
+; CHECK: call i32 @big(i32 %y)
+define i32 @b(i32 %y) {
+  %r = call i32 @big(i32 %y)
+  ret i32 %r
+}
+
+; CHECK-LABEL: define i32 @c(
+; CHECK: call i32 @big(i32 %z)
+define i32 @c(i32 %z) {
+  %r = call i32 @big(i32 %z)
+  ret i32 %r
+}
+
+; CHECK-LABEL: define i32 @d(
+; CHECK-NOT: call
+; CHECK: ret i32 1
+define i32 @d() {
+  %r = call i32 @big(i32 0)
+  ret i32 %r
+}
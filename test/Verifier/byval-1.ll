@@ -1,2 +1,5 @@
-; RUN: not llvm-as < %s >& /dev/null
-declare void @h(i32 byval %num)
+; RUN: not llvm-as < %s -o /dev/null 2>&1 | FileCheck %s
+
+; Only the attributes that do not fit the type are printed.
+; CHECK: Wrong types for attribute: byval{{$}}
+declare void @h(i32 signext byval %num)
@@ -1,4 +1,13 @@
 ; RUN: not llvm-as %s -o /dev/null 2>&1 | FileCheck %s
+; RUN: not llvm-as %s -o /dev/null -verify-threads=4 -verify-chunk-size=1 2>&1 \
+; RUN:   | FileCheck %s
+
+; The index check of llvm.framerecover runs once all the functions have been
+; verified, which the -verify pass only does after the first broken function.
+; RUN: sed -e '/^define internal void @f(/,/^; CHECK[:] llvm.frameescape only/d' \
+; RUN:   %s > %t.ll
+; RUN: not opt -disable-verify -verify -disable-output %t.ll 2>&1 \
+; RUN:   | FileCheck %s --check-prefix=RECOVER
 
 declare void @llvm.frameescape(...)
 declare i8* @llvm.framerecover(i8*, i8*, i32)
@@ -67,3 +76,4 @@ define internal void @n(i8* %fp) {
   ret void
 }
 ; CHECK: all indices passed to llvm.framerecover must be less than the number of arguments passed ot llvm.frameescape in the parent function
+; RECOVER: all indices passed to llvm.framerecover must be less than the number of arguments passed ot llvm.frameescape in the parent function
@@ -0,0 +1,39 @@
+; RUN: not llvm-as %s -o /dev/null 2>&1 | FileCheck %s
+; RUN: not llvm-as %s -o /dev/null -verify-threads=4 -verify-chunk-size=1 2>&1 \
+; RUN:   | FileCheck %s --check-prefix=PARALLEL
+
+; A broken node is reported once, with the first function using it. The
+; metadata checked with the functions is not checked again with the named
+; metadata, even when the functions are verified in parallel.
+; CHECK: invalid tag
+; CHECK-NEXT: name: "a"
+; CHECK: invalid tag
+; CHECK-NEXT: name: "b"
+; CHECK-NOT: invalid tag
+
+; Each chunk of functions verified in parallel has its own verifier, so a
+; node used by several chunks is reported by each of them.
+; PARALLEL: invalid tag
+; PARALLEL-NEXT: name: "a"
+; PARALLEL: invalid tag
+; PARALLEL-NEXT: name: "b"
+; PARALLEL: invalid tag
+; PARALLEL-NEXT: name: "b"
+; PARALLEL-NOT: invalid tag
+
+define void @f() !attach !0 {
+  ret void
+}
+
+define void @g() !attach !1 {
+  ret void
+}
+
+define void @h() !attach !1 {
+  ret void
+}
+
+!named = !{!0, !1}
+
+!0 = !DIBasicType(tag: DW_TAG_pointer_type, name: "a")
+!1 = !DIBasicType(tag: DW_TAG_pointer_type, name: "b")
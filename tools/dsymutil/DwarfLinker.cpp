@@ -32,8 +32,11 @@
 #include "llvm/Support/Dwarf.h"
 #include "llvm/Support/LEB128.h"
 #include "llvm/Support/TargetRegistry.h"
+#include "llvm/Support/ThreadPool.h"
 #include "llvm/Target/TargetMachine.h"
 #include "llvm/Target/TargetOptions.h"
+#include <condition_variable>
+#include <mutex>
 #include <string>
 #include <tuple>
 
@@ -42,9 +45,10 @@ namespace dsymutil {
 
 namespace {
 
-void warn(const Twine &Warning, const Twine &Context) {
-  errs() << Twine("while processing ") + Context + ":\n";
-  errs() << Twine("warning: ") + Warning + "\n";
+void warn(const Twine &Warning, const Twine &Context,
+          raw_ostream &OS = errs()) {
+  OS << Twine("while processing ") + Context + ":\n";
+  OS << Twine("warning: ") + Warning + "\n";
 }
 
 bool error(const Twine &Error, const Twine &Context) {
@@ -112,6 +116,7 @@ public:
   DWARFUnit &getOrigUnit() const { return OrigUnit; }
 
   unsigned getUniqueID() const { return ID; }
+  void setUniqueID(unsigned NewID) { ID = NewID; }
 
   DIE *getOutputUnitDIE() const { return CUDie; }
   void setOutputUnitDIE(DIE *Die) { CUDie = Die; }
@@ -1044,6 +1049,25 @@ public:
   bool link(const DebugMap &);
 
 private:
+  /// \brief Create a linker that only analyzes a single debug map
+  /// object on a worker thread, for the main linker to take over
+  /// with takeAnalyzedObject().
+  explicit DwarfLinker(const LinkOptions &Options)
+      : Options(Options), BinHolder(Options.Verbose), LastCIEOffset(0) {}
+
+  /// \brief Load the debug information of \p Obj, find its valid
+  /// relocations and mark the DIEs to keep.
+  /// \returns false if there is nothing to link in \p Obj.
+  bool analyzeObject(DebugMapObject &Obj);
+
+  /// \brief Take over the state of the debug map object that
+  /// \p Analyzer analyzed, and report its warnings.
+  void takeAnalyzedObject(DwarfLinker &Analyzer);
+
+  /// \brief Clone and emit the DIEs kept in the current debug map
+  /// object, then clean-up.
+  void linkAnalyzedObject(uint64_t &OutputDebugInfoSize);
+
   /// \brief Called at the start of a debug object link.
   void startDebugObject(DWARFContext &, DebugMapObject &);
 
@@ -1274,6 +1298,19 @@ private:
   /// The debug map object curently under consideration.
   DebugMapObject *CurrentDebugObject;
 
+  /// The debug information of the current debug map object.
+  std::unique_ptr<DWARFContextInMemory> DwarfContext;
+
+  /// A unique ID that identifies each compile unit.
+  unsigned NextUnitID = 0;
+
+  /// \brief Whether warnings are buffered in DeferredWarnings rather
+  /// than reported right away. Objects analyzed on worker threads
+  /// report their warnings when they are linked, in the order of the
+  /// debug map.
+  bool DeferWarnings = false;
+  mutable std::string DeferredWarnings;
+
   /// \brief The Dwarf string pool
   NonRelocatableStringpool StringPool;
 
@@ -1350,6 +1387,11 @@ void DwarfLinker::reportWarning(const Twine &Warning, const DWARFUnit *Unit,
   StringRef Context = "<debug map>";
   if (CurrentDebugObject)
     Context = CurrentDebugObject->getObjectFilename();
+  if (DeferWarnings) {
+    raw_string_ostream OS(DeferredWarnings);
+    warn(Warning, Context, OS);
+    return;
+  }
   warn(Warning, Context);
 
   if (!Options.Verbose || !DIE)
@@ -1426,6 +1468,7 @@ void DwarfLinker::endDebugObject() {
   Units.clear();
   ValidRelocs.clear();
   Ranges.clear();
+  DwarfContext.reset();
 
   for (auto I = DIEBlocks.begin(), E = DIEBlocks.end(); I != E; ++I)
     (*I)->~DIEBlock();
@@ -2583,6 +2626,111 @@ void DwarfLinker::patchFrameInfoForObject(const DebugMapObject &DMO,
   }
 }
 
+bool DwarfLinker::analyzeObject(DebugMapObject &Obj) {
+  CurrentDebugObject = &Obj;
+
+  auto ErrOrObj = BinHolder.GetObjectFile(Obj.getObjectFilename());
+  if (std::error_code EC = ErrOrObj.getError()) {
+    reportWarning(Twine(Obj.getObjectFilename()) + ": " + EC.message());
+    return false;
+  }
+
+  // Look for relocations that correspond to debug map entries.
+  if (!findValidRelocsInDebugInfo(*ErrOrObj, Obj)) {
+    if (Options.Verbose)
+      outs() << "No valid relocations found. Skipping.\n";
+    return false;
+  }
+
+  // Setup access to the debug info.
+  DwarfContext = llvm::make_unique<DWARFContextInMemory>(*ErrOrObj);
+  startDebugObject(*DwarfContext, Obj);
+
+  // In a first phase, just read in the debug info and store the DIE
+  // parent links that we will use during the next phase.
+  for (const auto &CU : DwarfContext->compile_units()) {
+    auto *CUDie = CU->getUnitDIE(false);
+    if (Options.Verbose) {
+      outs() << "Input compilation unit:";
+      CUDie->dump(outs(), CU.get(), 0);
+    }
+    Units.emplace_back(*CU, NextUnitID++);
+    gatherDIEParents(CUDie, 0, Units.back());
+  }
+
+  // Then mark all the DIEs that need to be present in the linked
+  // output and collect some information about them. Note that this
+  // loop can not be merged with the previous one becaue cross-cu
+  // references require the ParentIdx to be setup for every CU in
+  // the object file before calling this.
+  for (auto &CurrentUnit : Units)
+    lookForDIEsToKeep(*CurrentUnit.getOrigUnit().getUnitDIE(), Obj,
+                      CurrentUnit, 0);
+  return true;
+}
+
+void DwarfLinker::takeAnalyzedObject(DwarfLinker &Analyzer) {
+  CurrentDebugObject = Analyzer.CurrentDebugObject;
+  DwarfContext = std::move(Analyzer.DwarfContext);
+  // Moving the vector keeps the CompileUnits, which cannot be moved, in
+  // place.
+  Units = std::move(Analyzer.Units);
+  ValidRelocs = std::move(Analyzer.ValidRelocs);
+  Ranges = std::move(Analyzer.Ranges);
+  for (auto &CurrentUnit : Units)
+    CurrentUnit.setUniqueID(NextUnitID++);
+  errs() << Analyzer.DeferredWarnings;
+}
+
+void DwarfLinker::linkAnalyzedObject(uint64_t &OutputDebugInfoSize) {
+  // The calls to applyValidRelocs inside cloneDIE will walk the
+  // reloc array again (in the same way findValidRelocsInDebugInfo()
+  // did). We need to reset the NextValidReloc index to the beginning.
+  NextValidReloc = 0;
+
+  // Construct the output DIE tree by cloning the DIEs we chose to
+  // keep above. If there are no valid relocs, then there's nothing
+  // to clone/emit.
+  if (!ValidRelocs.empty())
+    for (auto &CurrentUnit : Units) {
+      const auto *InputDIE = CurrentUnit.getOrigUnit().getUnitDIE();
+      CurrentUnit.setStartOffset(OutputDebugInfoSize);
+      DIE *OutputDIE = cloneDIE(*InputDIE, CurrentUnit, 0 /* PCOffset */,
+                                11 /* Unit Header size */);
+      CurrentUnit.setOutputUnitDIE(OutputDIE);
+      OutputDebugInfoSize = CurrentUnit.computeNextUnitOffset();
+      if (Options.NoOutput)
+        continue;
+      // FIXME: for compatibility with the classic dsymutil, we emit
+      // an empty line table for the unit, even if the unit doesn't
+      // actually exist in the DIE tree.
+      patchLineTableForUnit(CurrentUnit, *DwarfContext);
+      if (!OutputDIE)
+        continue;
+      patchRangesForUnit(CurrentUnit, *DwarfContext);
+      Streamer->emitLocationsForUnit(CurrentUnit, *DwarfContext);
+      emitAcceleratorEntriesForUnit(CurrentUnit);
+    }
+
+  // Emit all the compile unit's debug information.
+  if (!ValidRelocs.empty() && !Options.NoOutput)
+    for (auto &CurrentUnit : Units) {
+      generateUnitRanges(CurrentUnit);
+      CurrentUnit.fixupForwardReferences();
+      Streamer->emitCompileUnitHeader(CurrentUnit);
+      if (!CurrentUnit.getOutputUnitDIE())
+        continue;
+      Streamer->emitDIE(*CurrentUnit.getOutputUnitDIE());
+    }
+
+  if (!ValidRelocs.empty() && !Options.NoOutput && !Units.empty())
+    patchFrameInfoForObject(*CurrentDebugObject, *DwarfContext,
+                            Units[0].getOrigUnit().getAddressByteSize());
+
+  // Clean-up before starting working on the next object.
+  endDebugObject();
+}
+
 bool DwarfLinker::link(const DebugMap &Map) {
 
   if (Map.begin() == Map.end()) {
@@ -2595,97 +2743,67 @@ bool DwarfLinker::link(const DebugMap &Map) {
 
   // Size of the DIEs (and headers) generated for the linked output.
   uint64_t OutputDebugInfoSize = 0;
-  // A unique ID that identifies each compile unit.
-  unsigned UnitID = 0;
-  for (const auto &Obj : Map.objects()) {
-    CurrentDebugObject = Obj.get();
 
-    if (Options.Verbose)
-      outs() << "DEBUG MAP OBJECT: " << Obj->getObjectFilename() << "\n";
-    auto ErrOrObj = BinHolder.GetObjectFile(Obj->getObjectFilename());
-    if (std::error_code EC = ErrOrObj.getError()) {
-      reportWarning(Twine(Obj->getObjectFilename()) + ": " + EC.message());
-      continue;
-    }
-
-    // Look for relocations that correspond to debug map entries.
-    if (!findValidRelocsInDebugInfo(*ErrOrObj, *Obj)) {
+  if (Options.NumThreads <= 1) {
+    for (const auto &Obj : Map.objects()) {
       if (Options.Verbose)
-        outs() << "No valid relocations found. Skipping.\n";
-      continue;
-    }
+        outs() << "DEBUG MAP OBJECT: " << Obj->getObjectFilename() << "\n";
 
-    // Setup access to the debug info.
-    DWARFContextInMemory DwarfContext(*ErrOrObj);
-    startDebugObject(DwarfContext, *Obj);
-
-    // In a first phase, just read in the debug info and store the DIE
-    // parent links that we will use during the next phase.
-    for (const auto &CU : DwarfContext.compile_units()) {
-      auto *CUDie = CU->getUnitDIE(false);
-      if (Options.Verbose) {
-        outs() << "Input compilation unit:";
-        CUDie->dump(outs(), CU.get(), 0);
-      }
-      Units.emplace_back(*CU, UnitID++);
-      gatherDIEParents(CUDie, 0, Units.back());
+      if (!analyzeObject(*Obj))
+        continue;
+      linkAnalyzedObject(OutputDebugInfoSize);
     }
-
-    // Then mark all the DIEs that need to be present in the linked
-    // output and collect some information about them. Note that this
-    // loop can not be merged with the previous one becaue cross-cu
-    // references require the ParentIdx to be setup for every CU in
-    // the object file before calling this.
-    for (auto &CurrentUnit : Units)
-      lookForDIEsToKeep(*CurrentUnit.getOrigUnit().getUnitDIE(), *Obj,
-                        CurrentUnit, 0);
-
-    // The calls to applyValidRelocs inside cloneDIE will walk the
-    // reloc array again (in the same way findValidRelocsInDebugInfo()
-    // did). We need to reset the NextValidReloc index to the beginning.
-    NextValidReloc = 0;
-
-    // Construct the output DIE tree by cloning the DIEs we chose to
-    // keep above. If there are no valid relocs, then there's nothing
-    // to clone/emit.
-    if (!ValidRelocs.empty())
-      for (auto &CurrentUnit : Units) {
-        const auto *InputDIE = CurrentUnit.getOrigUnit().getUnitDIE();
-        CurrentUnit.setStartOffset(OutputDebugInfoSize);
-        DIE *OutputDIE = cloneDIE(*InputDIE, CurrentUnit, 0 /* PCOffset */,
-                                  11 /* Unit Header size */);
-        CurrentUnit.setOutputUnitDIE(OutputDIE);
-        OutputDebugInfoSize = CurrentUnit.computeNextUnitOffset();
-        if (Options.NoOutput)
-          continue;
-        // FIXME: for compatibility with the classic dsymutil, we emit
-        // an empty line table for the unit, even if the unit doesn't
-        // actually exist in the DIE tree.
-        patchLineTableForUnit(CurrentUnit, DwarfContext);
-        if (!OutputDIE)
-          continue;
-        patchRangesForUnit(CurrentUnit, DwarfContext);
-        Streamer->emitLocationsForUnit(CurrentUnit, DwarfContext);
-        emitAcceleratorEntriesForUnit(CurrentUnit);
+  } else {
+    // The objects are loaded and analyzed on the worker threads, while
+    // the current thread clones and emits them in the order of the
+    // debug map. To bound the memory use, at most NumThreads objects
+    // are analyzed ahead of the one being linked.
+    std::vector<DebugMapObject *> Objects;
+    for (const auto &Obj : Map.objects())
+      Objects.push_back(Obj.get());
+
+    enum AnalysisState { AS_Pending, AS_Linkable, AS_Skipped };
+    std::vector<std::unique_ptr<DwarfLinker>> Analyzers(Objects.size());
+    std::vector<AnalysisState> States(Objects.size(), AS_Pending);
+    std::mutex StatesMutex;
+    std::condition_variable StatesChanged;
+
+    ThreadPool Pool(Options.NumThreads);
+    auto AnalyzeObject = [&](unsigned I) {
+      Pool.async([&, I]() {
+        auto Analyzer = std::unique_ptr<DwarfLinker>(new DwarfLinker(Options));
+        Analyzer->DeferWarnings = true;
+        bool Linkable = Analyzer->analyzeObject(*Objects[I]);
+        std::lock_guard<std::mutex> LockGuard(StatesMutex);
+        Analyzers[I] = std::move(Analyzer);
+        States[I] = Linkable ? AS_Linkable : AS_Skipped;
+        StatesChanged.notify_all();
+      });
+    };
+
+    unsigned NumObjects = Objects.size();
+    for (unsigned I = 0; I != std::min(Options.NumThreads, NumObjects); ++I)
+      AnalyzeObject(I);
+
+    for (unsigned I = 0; I != NumObjects; ++I) {
+      std::unique_ptr<DwarfLinker> Analyzer;
+      AnalysisState State;
+      {
+        std::unique_lock<std::mutex> LockGuard(StatesMutex);
+        StatesChanged.wait(LockGuard, [&]() { return States[I] != AS_Pending; });
+        Analyzer = std::move(Analyzers[I]);
+        State = States[I];
       }
+      if (I + Options.NumThreads < NumObjects)
+        AnalyzeObject(I + Options.NumThreads);
 
-    // Emit all the compile unit's debug information.
-    if (!ValidRelocs.empty() && !Options.NoOutput)
-      for (auto &CurrentUnit : Units) {
-        generateUnitRanges(CurrentUnit);
-        CurrentUnit.fixupForwardReferences();
-        Streamer->emitCompileUnitHeader(CurrentUnit);
-        if (!CurrentUnit.getOutputUnitDIE())
-          continue;
-        Streamer->emitDIE(*CurrentUnit.getOutputUnitDIE());
+      if (State == AS_Skipped) {
+        errs() << Analyzer->DeferredWarnings;
+        continue;
       }
-
-    if (!ValidRelocs.empty() && !Options.NoOutput && !Units.empty())
-      patchFrameInfoForObject(*Obj, DwarfContext,
-                              Units[0].getOrigUnit().getAddressByteSize());
-
-    // Clean-up before starting working on the next object.
-    endDebugObject();
+      takeAnalyzedObject(*Analyzer);
+      linkAnalyzedObject(OutputDebugInfoSize);
+    }
   }
 
   // Emit everything that's global.
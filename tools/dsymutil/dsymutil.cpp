@@ -20,6 +20,7 @@
 #include "llvm/Support/Signals.h"
 #include "llvm/Support/raw_ostream.h"
 #include "llvm/Support/TargetSelect.h"
+#include "llvm/Support/ThreadPool.h"
 #include <string>
 
 using namespace llvm::dsymutil;
@@ -47,6 +48,15 @@ static opt<bool>
              desc("Do the link in memory, but do not emit the result file."),
              init(false));
 
+static opt<unsigned> NumThreads(
+    "num-threads",
+    desc("Specifies the maximum number of objects to analyze in parallel "
+         "with the linking of the current object (default = number of "
+         "hardware threads). Verbose output forces a single thread."),
+    init(0));
+static alias NumThreadsA("j", desc("Alias for --num-threads"),
+                         aliasopt(NumThreads));
+
 static opt<bool> DumpDebugMap(
     "dump-debug-map",
     desc("Parse and dump the debug map to standard output. Not DWARF link "
@@ -71,6 +81,12 @@ int main(int argc, char **argv) {
 
   Options.Verbose = Verbose;
   Options.NoOutput = NoOutput;
+  Options.NumThreads = NumThreads;
+  if (Options.NumThreads == 0)
+    Options.NumThreads = llvm::ThreadPool::getDefaultThreadCount();
+  // The verbose output of the objects must not interleave.
+  if (Verbose)
+    Options.NumThreads = 1;
 
   llvm::InitializeAllTargetInfos();
   llvm::InitializeAllTargetMCs();
@@ -25,10 +25,11 @@ namespace llvm {
 namespace dsymutil {
 
 struct LinkOptions {
-  bool Verbose;  ///< Verbosity
-  bool NoOutput; ///< Skip emitting output
+  bool Verbose;        ///< Verbosity
+  bool NoOutput;       ///< Skip emitting output
+  unsigned NumThreads; ///< Number of threads analyzing the objects
 
-  LinkOptions() : Verbose(false), NoOutput(false) {}
+  LinkOptions() : Verbose(false), NoOutput(false), NumThreads(1) {}
 };
 
 /// \brief Extract the DebugMap from the given file.
@@ -14,12 +14,14 @@
 
 #include "llvm/Config/config.h" // plugin-api.h requires HAVE_STDINT_H
 #include "llvm/ADT/DenseSet.h"
+#include "llvm/ADT/StringExtras.h"
 #include "llvm/ADT/StringSet.h"
 #include "llvm/Analysis/TargetLibraryInfo.h"
 #include "llvm/Analysis/TargetTransformInfo.h"
 #include "llvm/Bitcode/ReaderWriter.h"
 #include "llvm/CodeGen/Analysis.h"
 #include "llvm/CodeGen/CommandFlags.h"
+#include "llvm/CodeGen/ParallelCG.h"
 #include "llvm/IR/AutoUpgrade.h"
 #include "llvm/IR/Constants.h"
 #include "llvm/IR/DiagnosticInfo.h"
@@ -28,15 +30,18 @@
 #include "llvm/IR/LegacyPassManager.h"
 #include "llvm/IR/Module.h"
 #include "llvm/IR/Verifier.h"
+#include "llvm/LTO/NativeObjectCache.h"
 #include "llvm/Linker/Linker.h"
 #include "llvm/MC/SubtargetFeature.h"
 #include "llvm/Object/IRObjectFile.h"
+#include "llvm/Support/CachePruning.h"
 #include "llvm/Support/raw_ostream.h"
 #include "llvm/Support/Host.h"
 #include "llvm/Support/ManagedStatic.h"
 #include "llvm/Support/MemoryBuffer.h"
 #include "llvm/Support/TargetRegistry.h"
 #include "llvm/Support/TargetSelect.h"
+#include "llvm/Support/TimeTrace.h"
 #include "llvm/Transforms/IPO.h"
 #include "llvm/Transforms/IPO/PassManagerBuilder.h"
 #include "llvm/Transforms/Utils/GlobalStatus.h"
@@ -92,10 +97,20 @@ namespace options {
   static bool generate_api_file = false;
   static OutputType TheOutputType = OT_NORMAL;
   static unsigned OptLevel = 2;
+  // Number of partitions the combined module is split into for code
+  // generation. Each partition is code generated on its own thread into its
+  // own object file.
+  static unsigned Parallelism = 1;
   static std::string obj_path;
   static std::string extra_library_path;
   static std::string triple;
   static std::string mcpu;
+  // Directory in which the object files are cached, and the pruning policy
+  // of the cache. See LTOCodeGenerator::setCacheDir.
+  static std::string cache_dir;
+  static int cache_pruning_interval = 20 * 60;
+  static unsigned cache_entry_expiration = 7 * 24 * 60 * 60;
+  static uint64_t cache_max_size = 0;
   // Additional options to pass into the code generator.
   // Note: This array will contain all plugin options which are not claimed
   // as plugin exclusive to pass to the code generator.
@@ -129,6 +144,28 @@ namespace options {
       if (opt[1] < '0' || opt[1] > '3')
         report_fatal_error("Optimization level must be between 0 and 3");
       OptLevel = opt[1] - '0';
+    } else if (opt.startswith("cache-dir=")) {
+      cache_dir = opt.substr(strlen("cache-dir="));
+    } else if (opt.startswith("cache-pruning-interval=")) {
+      if (opt.substr(strlen("cache-pruning-interval="))
+              .getAsInteger(10, cache_pruning_interval))
+        report_fatal_error("Invalid cache pruning interval: " +
+                           opt.substr(strlen("cache-pruning-interval=")));
+    } else if (opt.startswith("cache-entry-expiration=")) {
+      if (opt.substr(strlen("cache-entry-expiration="))
+              .getAsInteger(10, cache_entry_expiration))
+        report_fatal_error("Invalid cache entry expiration: " +
+                           opt.substr(strlen("cache-entry-expiration=")));
+    } else if (opt.startswith("cache-max-size=")) {
+      if (opt.substr(strlen("cache-max-size="))
+              .getAsInteger(10, cache_max_size))
+        report_fatal_error("Invalid cache size: " +
+                           opt.substr(strlen("cache-max-size=")));
+    } else if (opt.startswith("jobs=")) {
+      if (opt.substr(strlen("jobs=")).getAsInteger(10, Parallelism) ||
+          !Parallelism)
+        report_fatal_error("Invalid parallelism level: " +
+                           opt.substr(strlen("jobs=")));
     } else {
       // Save this option to pass to the code generator.
       // ParseCommandLineOptions() expects argv[0] to be program name. Lazily
@@ -716,6 +753,7 @@ getModuleForFile(LLVMContext &Context, claimed_file &F,
 }
 
 static void runLTOPasses(Module &M, TargetMachine &TM) {
+  TimeTraceScope TraceScope("LTO optimize", M.getModuleIdentifier());
   if (const DataLayout *DL = TM.getDataLayout())
     M.setDataLayout(*DL);
 
@@ -751,9 +789,6 @@ static void codegen(Module &M) {
   if (!TheTarget)
     message(LDPL_FATAL, "Target not found: %s", ErrMsg.c_str());
 
-  if (unsigned NumOpts = options::extra.size())
-    cl::ParseCommandLineOptions(NumOpts, &options::extra[0]);
-
   SubtargetFeatures Features;
   Features.getDefaultSubtargetFeatures(TheTriple);
   for (const std::string &A : MAttrs)
@@ -779,50 +814,114 @@ static void codegen(Module &M) {
       TripleStr, options::mcpu, Features.getString(), Options, RelocationModel,
       CodeModel::Default, CGOptLevel));
 
-  runLTOPasses(M, *TM);
+  // The objects produced from the module before optimization are cached,
+  // unless the optimized module must be saved.
+  std::string CacheKey;
+  std::vector<std::unique_ptr<MemoryBuffer>> CachedObjects;
+  if (!options::cache_dir.empty() &&
+      options::TheOutputType != options::OT_SAVE_TEMPS) {
+    NativeObjectCacheKey Key;
+    Key.add(M);
+    Key.add(Options);
+    Key.add(options::mcpu);
+    Key.add(Features.getString());
+    Key.add(RelocationModel);
+    Key.add(CGOptLevel);
+    Key.add(options::OptLevel);
+    Key.add(options::Parallelism);
+    for (const char *Opt : options::extra)
+      Key.add(Opt);
+    CacheKey = Key.str();
+    CachedObjects = NativeObjectCache(options::cache_dir)
+                        .lookup(CacheKey, options::Parallelism);
+  }
 
-  if (options::TheOutputType == options::OT_SAVE_TEMPS)
-    saveBCFile(output_name + ".opt.bc", M);
+  if (CachedObjects.empty()) {
+    runLTOPasses(M, *TM);
 
-  legacy::PassManager CodeGenPasses;
+    if (options::TheOutputType == options::OT_SAVE_TEMPS)
+      saveBCFile(output_name + ".opt.bc", M);
+  }
 
   SmallString<128> Filename;
   if (!options::obj_path.empty())
     Filename = options::obj_path;
   else if (options::TheOutputType == options::OT_SAVE_TEMPS)
     Filename = output_name + ".o";
-
-  int FD;
   bool TempOutFile = Filename.empty();
-  if (TempOutFile) {
-    std::error_code EC =
-        sys::fs::createTemporaryFile("lto-llvm", "o", FD, Filename);
-    if (EC)
-      message(LDPL_FATAL, "Could not create temporary file: %s",
-              EC.message().c_str());
-  } else {
-    std::error_code EC =
-        sys::fs::openFileForWrite(Filename.c_str(), FD, sys::fs::F_None);
-    if (EC)
-      message(LDPL_FATAL, "Could not open file: %s", EC.message().c_str());
-  }
-
-  {
-    raw_fd_ostream OS(FD, true);
 
-    if (TM->addPassesToEmitFile(CodeGenPasses, OS,
-                                TargetMachine::CGFT_ObjectFile))
-      message(LDPL_FATAL, "Failed to setup codegen");
-    CodeGenPasses.run(M);
+  // Open one output file per partition. When splitting, a named output file
+  // gets the partition number appended.
+  std::vector<SmallString<128>> Filenames(options::Parallelism);
+  std::list<raw_fd_ostream> OSs;
+  std::vector<raw_pwrite_stream *> OSPtrs;
+  for (unsigned I = 0; I != options::Parallelism; ++I) {
+    int FD;
+    if (TempOutFile) {
+      std::error_code EC =
+          sys::fs::createTemporaryFile("lto-llvm", "o", FD, Filenames[I]);
+      if (EC)
+        message(LDPL_FATAL, "Could not create temporary file: %s",
+                EC.message().c_str());
+    } else {
+      Filenames[I] = Filename;
+      if (options::Parallelism != 1) {
+        Filenames[I] += ".";
+        Filenames[I] += utostr(I);
+      }
+      std::error_code EC = sys::fs::openFileForWrite(Filenames[I].c_str(), FD,
+                                                     sys::fs::F_None);
+      if (EC)
+        message(LDPL_FATAL, "Could not open file: %s", EC.message().c_str());
+    }
+    OSs.emplace_back(FD, true);
+    OSPtrs.push_back(&OSs.back());
   }
 
-  if (add_input_file(Filename.c_str()) != LDPS_OK)
-    message(LDPL_FATAL,
-            "Unable to add .o file to the link. File left behind in: %s",
-            Filename.c_str());
+  if (!CachedObjects.empty()) {
+    for (unsigned I = 0; I != options::Parallelism; ++I)
+      *OSPtrs[I] << CachedObjects[I]->getBuffer();
+    OSs.clear();
+  } else {
+    // The optimized module is code generated in parallel, each partition with
+    // its own TargetMachine created with the same parameters as TM.
+    if (!splitCodeGen(M, OSPtrs, options::mcpu, Features.getString(), Options,
+                      ErrMsg, RelocationModel, CodeModel::Default, CGOptLevel))
+      message(LDPL_FATAL, "Failed to setup codegen: %s", ErrMsg.c_str());
+    OSs.clear();
+
+    if (!CacheKey.empty()) {
+      std::vector<std::unique_ptr<MemoryBuffer>> Buffers;
+      std::vector<StringRef> Objects;
+      for (const SmallString<128> &Name : Filenames) {
+        ErrorOr<std::unique_ptr<MemoryBuffer>> BufferOrErr =
+            MemoryBuffer::getFile(Name, -1, false);
+        if (!BufferOrErr)
+          break;
+        Objects.push_back((*BufferOrErr)->getBuffer());
+        Buffers.push_back(std::move(*BufferOrErr));
+      }
+      if (Objects.size() == Filenames.size())
+        NativeObjectCache(options::cache_dir).store(CacheKey, Objects);
+    }
+  }
 
-  if (TempOutFile)
-    Cleanup.push_back(Filename.c_str());
+  if (!CacheKey.empty())
+    CachePruning(options::cache_dir)
+        .setPruningInterval(options::cache_pruning_interval)
+        .setEntryExpiration(options::cache_entry_expiration)
+        .setMaxSize(options::cache_max_size)
+        .prune();
+
+  for (const SmallString<128> &Name : Filenames) {
+    if (add_input_file(Name.c_str()) != LDPS_OK)
+      message(LDPL_FATAL,
+              "Unable to add .o file to the link. File left behind in: %s",
+              Name.c_str());
+
+    if (TempOutFile)
+      Cleanup.push_back(Name.c_str());
+  }
 }
 
 /// gold informs us that all symbols have been read. At this point, we use
@@ -832,6 +931,11 @@ static ld_plugin_status allSymbolsReadHook(raw_fd_ostream *ApiFile) {
   if (Modules.empty())
     return LDPS_OK;
 
+  // Parse the options before reading the modules, so that -time-trace also
+  // records the reading and the linking of the modules.
+  if (unsigned NumOpts = options::extra.size())
+    cl::ParseCommandLineOptions(NumOpts, &options::extra[0]);
+
   LLVMContext Context;
   Context.setDiagnosticHandler(diagnosticHandler, nullptr, true);
 
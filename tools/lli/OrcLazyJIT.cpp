@@ -39,6 +39,13 @@ namespace {
                                              "working directory. (WARNING: "
                                              "will overwrite existing files)."),
                                   clEnumValEnd));
+
+  cl::opt<bool> OrcBackgroundCompile("orc-lazy-background-compile",
+                                     cl::desc("Speculatively compile the "
+                                              "callees of the compiled "
+                                              "functions on a background "
+                                              "thread."),
+                                     cl::init(false));
 }
 
 OrcLazyJIT::CallbackManagerBuilder
@@ -136,7 +143,8 @@ int llvm::runOrcLazyJIT(std::unique_ptr<Module> M, int ArgC, char* ArgV[]) {
   }
 
   // Everything looks good. Build the JIT.
-  OrcLazyJIT J(std::move(TM), Context, CallbackMgrBuilder);
+  OrcLazyJIT J(std::move(TM), Context, CallbackMgrBuilder,
+               OrcBackgroundCompile);
 
   // Add the module, look up main and run it.
   auto MainHandle = J.addModule(std::move(M));
@@ -48,13 +48,14 @@ public:
   static CallbackManagerBuilder createCallbackManagerBuilder(Triple T);
 
   OrcLazyJIT(std::unique_ptr<TargetMachine> TM, LLVMContext &Context,
-             CallbackManagerBuilder &BuildCallbackMgr)
+             CallbackManagerBuilder &BuildCallbackMgr,
+             bool CompileInBackground = false)
     : TM(std::move(TM)),
       ObjectLayer(),
       CompileLayer(ObjectLayer, orc::SimpleCompiler(*this->TM)),
       IRDumpLayer(CompileLayer, createDebugDumper()),
       CCMgr(BuildCallbackMgr(IRDumpLayer, CCMgrMemMgr, Context)),
-      CODLayer(IRDumpLayer, *CCMgr, false),
+      CODLayer(IRDumpLayer, *CCMgr, false, CompileInBackground),
       CXXRuntimeOverrides([this](const std::string &S) { return mangle(S); }) {}
 
   ~OrcLazyJIT() {
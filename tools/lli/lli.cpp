@@ -21,6 +21,7 @@
 #include "llvm/ADT/Triple.h"
 #include "llvm/Bitcode/ReaderWriter.h"
 #include "llvm/CodeGen/LinkAllCodegenComponents.h"
+#include "llvm/ExecutionEngine/FileObjectCache.h"
 #include "llvm/ExecutionEngine/GenericValue.h"
 #include "llvm/ExecutionEngine/Interpreter.h"
 #include "llvm/ExecutionEngine/JITEventListener.h"
@@ -173,6 +174,18 @@ namespace {
                            "(must be user writable)"),
                   cl::init(""));
 
+  cl::opt<std::string>
+  PersistentObjectCache("persistent-object-cache",
+        cl::desc("Cache the compiled objects in this directory, keyed by a "
+                 "hash of their module and of the target"),
+        cl::value_desc("directory"), cl::init(""));
+
+  cl::opt<unsigned long long>
+  PersistentObjectCacheMaxSize("persistent-object-cache-max-size",
+        cl::desc("Maximum size of the persistent object cache, in bytes "
+                 "(0 for no limit)"),
+        cl::init(0));
+
   cl::opt<std::string>
   FakeArgv0("fake-argv0",
             cl::desc("Override the 'argv[0]' value passed into the executing"
@@ -314,7 +327,7 @@ private:
 };
 
 static ExecutionEngine *EE = nullptr;
-static LLIObjectCache *CacheManager = nullptr;
+static ObjectCache *CacheManager = nullptr;
 
 static void do_shutdown() {
   // Cygwin-1.5 invokes DLL's dtors before atexit handler.
@@ -398,6 +411,12 @@ int main(int argc, char **argv, char * const *envp) {
   cl::ParseCommandLineOptions(argc, argv,
                               "llvm interpreter & dynamic compiler\n");
 
+  if (EnableCacheManager && !PersistentObjectCache.empty()) {
+    errs() << argv[0] << ": -persistent-object-cache cannot be used with "
+           << "-enable-cache-manager\n";
+    return 1;
+  }
+
   // If the user doesn't want core files, disable them.
   if (DisableCoreFiles)
     sys::Process::PreventCoreFiles();
@@ -484,6 +503,17 @@ int main(int argc, char **argv, char * const *envp) {
   if (EnableCacheManager) {
     CacheManager = new LLIObjectCache(ObjectCacheDir);
     EE->setObjectCache(CacheManager);
+  } else if (!PersistentObjectCache.empty()) {
+    TargetMachine *TM = EE->getTargetMachine();
+    if (!TM) {
+      errs() << argv[0] << ": -persistent-object-cache requires MCJIT or "
+             << "orc-mcjit\n";
+      exit(1);
+    }
+    auto *Cache = new FileObjectCache(PersistentObjectCache, *TM);
+    Cache->setMaxSize(PersistentObjectCacheMaxSize);
+    CacheManager = Cache;
+    EE->setObjectCache(CacheManager);
   }
 
   // Load any additional modules specified on the command line.
@@ -114,6 +114,7 @@ static const char *GetBlockName(unsigned BlockID,
   case bitc::METADATA_BLOCK_ID:        return "METADATA_BLOCK";
   case bitc::METADATA_ATTACHMENT_ID:   return "METADATA_ATTACHMENT_BLOCK";
   case bitc::USELIST_BLOCK_ID:         return "USELIST_BLOCK_ID";
+  case bitc::FUNCTION_SUMMARY_BLOCK_ID: return "FUNCTION_SUMMARY_BLOCK";
   }
 }
 
@@ -300,6 +301,8 @@ static const char *GetCodeName(unsigned CodeID, unsigned BlockID,
       STRINGIFY_CODE(METADATA, OBJC_PROPERTY)
       STRINGIFY_CODE(METADATA, IMPORTED_ENTITY)
       STRINGIFY_CODE(METADATA, MODULE)
+      STRINGIFY_CODE(METADATA, INDEX_OFFSET)
+      STRINGIFY_CODE(METADATA, INDEX)
     }
   case bitc::USELIST_BLOCK_ID:
     switch(CodeID) {
@@ -307,6 +310,13 @@ static const char *GetCodeName(unsigned CodeID, unsigned BlockID,
     case bitc::USELIST_CODE_DEFAULT: return "USELIST_CODE_DEFAULT";
     case bitc::USELIST_CODE_BB:      return "USELIST_CODE_BB";
     }
+  case bitc::FUNCTION_SUMMARY_BLOCK_ID:
+    switch(CodeID) {
+    default:return nullptr;
+    case bitc::FS_CODE_SYMBOL:      return "SYMBOL";
+    case bitc::FS_CODE_MODULE_PATH: return "MODULE_PATH";
+    case bitc::FS_CODE_ENTRY:       return "ENTRY";
+    }
   }
 #undef STRINGIFY_CODE
 }
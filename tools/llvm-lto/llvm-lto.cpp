@@ -12,16 +12,21 @@
 //
 //===----------------------------------------------------------------------===//
 
+#include "llvm/ADT/StringExtras.h"
 #include "llvm/ADT/StringSet.h"
+#include "llvm/Bitcode/ReaderWriter.h"
 #include "llvm/CodeGen/CommandFlags.h"
+#include "llvm/IR/FunctionInfo.h"
 #include "llvm/LTO/LTOCodeGenerator.h"
 #include "llvm/LTO/LTOModule.h"
+#include "llvm/LTO/ThinLTOCodeGenerator.h"
 #include "llvm/Support/CommandLine.h"
 #include "llvm/Support/FileSystem.h"
 #include "llvm/Support/ManagedStatic.h"
 #include "llvm/Support/PrettyStackTrace.h"
 #include "llvm/Support/Signals.h"
 #include "llvm/Support/TargetSelect.h"
+#include "llvm/Support/ToolOutputFile.h"
 #include "llvm/Support/raw_ostream.h"
 
 using namespace llvm;
@@ -46,6 +51,45 @@ static cl::opt<bool>
 DisableLTOVectorization("disable-lto-vectorization", cl::init(false),
   cl::desc("Do not run loop or slp vectorization during LTO"));
 
+static cl::opt<unsigned>
+Parallelism("j", cl::Prefix, cl::init(1),
+  cl::desc("Number of partitions to code generate in parallel; with -o, "
+           "partition N is written to <filename>.N"));
+
+static cl::opt<std::string>
+CacheDir("cache-dir", cl::init(""),
+  cl::desc("Cache the native objects in the given directory"),
+  cl::value_desc("directory"));
+
+static cl::opt<int>
+CachePruningInterval("cache-pruning-interval", cl::init(20 * 60),
+  cl::desc("Minimum interval in seconds between two prunings of the cache, "
+           "or -1 to disable pruning"));
+
+static cl::opt<unsigned>
+CacheEntryExpiration("cache-entry-expiration", cl::init(7 * 24 * 60 * 60),
+  cl::desc("Time in seconds after which an unused cached object is pruned, "
+           "or 0 to keep it"));
+
+static cl::opt<unsigned long long>
+CacheMaxSize("cache-max-size", cl::init(0),
+  cl::desc("Maximum size in bytes of the cache, or 0 for no limit"));
+
+namespace {
+enum ThinLTOModes { THINLINK, THINALL };
+}
+
+static cl::opt<ThinLTOModes> ThinLTOMode(
+    "thinlto-action", cl::desc("Perform a summary-based \"thin\" LTO action:"),
+    cl::values(clEnumValN(THINLINK, "thinlink",
+                          "Write the combined function summary index of the "
+                          "inputs to the output file"),
+               clEnumValN(THINALL, "run",
+                          "Import, optimize and code generate each input "
+                          "independently; the object file of input N is "
+                          "written to <filename>.N"),
+               clEnumValEnd));
+
 static cl::opt<bool>
 UseDiagnosticHandler("use-diagnostic-handler", cl::init(false),
   cl::desc("Use a diagnostic handler to test the handler interface"));
@@ -142,6 +186,94 @@ static int listSymbols(StringRef Command, const TargetOptions &Options) {
   return 0;
 }
 
+/// Return the target attributes given on the command line as a string.
+static std::string getAttrsString() {
+  std::string Attrs;
+  for (unsigned i = 0; i < MAttrs.size(); ++i) {
+    if (i > 0)
+      Attrs.append(",");
+    Attrs.append(MAttrs[i]);
+  }
+  return Attrs;
+}
+
+/// \brief Perform the ThinLTO action selected with -thinlto-action.
+static int thinLTOMain(StringRef Command, const TargetOptions &Options) {
+  if (OutputFilename.empty()) {
+    errs() << Command << ": -thinlto-action requires an output file (-o)\n";
+    return 1;
+  }
+
+  ThinLTOCodeGenerator ThinGenerator;
+  std::vector<std::unique_ptr<MemoryBuffer>> InputBuffers;
+  for (auto &Filename : InputFilenames) {
+    ErrorOr<std::unique_ptr<MemoryBuffer>> BufferOrErr =
+        MemoryBuffer::getFile(Filename);
+    if (std::error_code EC = BufferOrErr.getError()) {
+      errs() << Command << ": error loading file '" << Filename
+             << "': " << EC.message() << "\n";
+      return 1;
+    }
+    InputBuffers.push_back(std::move(BufferOrErr.get()));
+    ThinGenerator.addModule(Filename, InputBuffers.back()->getBuffer());
+  }
+
+  ThinGenerator.setTargetOptions(Options);
+  ThinGenerator.setCpu(MCPU);
+  ThinGenerator.setAttr(getAttrsString());
+  ThinGenerator.setCodePICModel(RelocModel);
+  ThinGenerator.setOptLevel(OptLevel - '0');
+  if (Parallelism.getNumOccurrences())
+    ThinGenerator.setThreadCount(Parallelism);
+  ThinGenerator.setCacheDir(CacheDir);
+  ThinGenerator.setCachePruningInterval(CachePruningInterval);
+  ThinGenerator.setCacheEntryExpiration(CacheEntryExpiration);
+  ThinGenerator.setMaxCacheSize(CacheMaxSize);
+
+  std::string ErrorInfo;
+  switch (ThinLTOMode) {
+  case THINLINK: {
+    std::unique_ptr<FunctionInfoIndex> Index =
+        ThinGenerator.linkCombinedIndex(ErrorInfo);
+    if (!Index) {
+      errs() << Command << ": error linking the summaries: " << ErrorInfo
+             << "\n";
+      return 1;
+    }
+    std::error_code EC;
+    raw_fd_ostream OS(OutputFilename, EC, sys::fs::F_None);
+    if (EC) {
+      errs() << Command << ": error opening the file '" << OutputFilename
+             << "': " << EC.message() << "\n";
+      return 1;
+    }
+    WriteFunctionSummaryToFile(*Index, OS);
+    return 0;
+  }
+  case THINALL: {
+    if (!ThinGenerator.run(ErrorInfo)) {
+      errs() << Command << ": error compiling the code: " << ErrorInfo
+             << "\n";
+      return 1;
+    }
+    auto &Binaries = ThinGenerator.getProducedBinaries();
+    for (unsigned I = 0, E = Binaries.size(); I != E; ++I) {
+      std::string PartFilename = OutputFilename + "." + utostr(I);
+      std::error_code EC;
+      raw_fd_ostream OS(PartFilename, EC, sys::fs::F_None);
+      if (EC) {
+        errs() << Command << ": error opening the file '" << PartFilename
+               << "': " << EC.message() << "\n";
+        return 1;
+      }
+      OS << Binaries[I]->getBuffer();
+    }
+    return 0;
+  }
+  }
+  llvm_unreachable("Unknown ThinLTO action");
+}
+
 int main(int argc, char **argv) {
   // Print a stack trace if we signal out.
   sys::PrintStackTraceOnErrorSignal();
@@ -167,6 +299,9 @@ int main(int argc, char **argv) {
   if (ListSymbolsOnly)
     return listSymbols(argv[0], Options);
 
+  if (ThinLTOMode.getNumOccurrences())
+    return thinLTOMain(argv[0], Options);
+
   unsigned BaseArg = 0;
 
   LTOCodeGenerator CodeGen;
@@ -242,17 +377,39 @@ int main(int argc, char **argv) {
 
   CodeGen.setOptLevel(OptLevel - '0');
 
-  std::string attrs;
-  for (unsigned i = 0; i < MAttrs.size(); ++i) {
-    if (i > 0)
-      attrs.append(",");
-    attrs.append(MAttrs[i]);
-  }
-
+  std::string attrs = getAttrsString();
   if (!attrs.empty())
     CodeGen.setAttr(attrs.c_str());
 
-  if (!OutputFilename.empty()) {
+  CodeGen.setParallelism(Parallelism);
+  CodeGen.setCacheDir(CacheDir);
+  CodeGen.setCachePruningInterval(CachePruningInterval);
+  CodeGen.setCacheEntryExpiration(CacheEntryExpiration);
+  CodeGen.setMaxCacheSize(CacheMaxSize);
+
+  if (!OutputFilename.empty() && Parallelism > 1) {
+    std::string ErrorInfo;
+    std::vector<const char *> PartNames;
+    if (!CodeGen.compile_to_files(PartNames, DisableInline, DisableGVNLoadPRE,
+                                  DisableLTOVectorization, ErrorInfo)) {
+      errs() << argv[0] << ": error compiling the code: " << ErrorInfo
+             << "\n";
+      return 1;
+    }
+
+    // The objects are written to temporary files, which may be on another
+    // file system: copy them.
+    for (unsigned I = 0; I != Parallelism; ++I) {
+      std::string PartFilename = OutputFilename + "." + utostr(I);
+      std::error_code EC = sys::fs::copy_file(PartNames[I], PartFilename);
+      sys::fs::remove(PartNames[I]);
+      if (EC) {
+        errs() << argv[0] << ": error writing the file '" << PartFilename
+               << "': " << EC.message() << "\n";
+        return 1;
+      }
+    }
+  } else if (!OutputFilename.empty()) {
     std::string ErrorInfo;
     std::unique_ptr<MemoryBuffer> Code = CodeGen.compile(
         DisableInline, DisableGVNLoadPRE, DisableLTOVectorization, ErrorInfo);
@@ -271,6 +428,20 @@ int main(int argc, char **argv) {
     }
 
     FileStream.write(Code->getBufferStart(), Code->getBufferSize());
+  } else if (Parallelism > 1) {
+    std::string ErrorInfo;
+    std::vector<const char *> OutputNames;
+    if (!CodeGen.compile_to_files(OutputNames, DisableInline,
+                                  DisableGVNLoadPRE, DisableLTOVectorization,
+                                  ErrorInfo)) {
+      errs() << argv[0]
+             << ": error compiling the code: " << ErrorInfo
+             << "\n";
+      return 1;
+    }
+
+    for (const char *OutputName : OutputNames)
+      outs() << "Wrote native object file '" << OutputName << "'\n";
   } else {
     std::string ErrorInfo;
     const char *OutputName = nullptr;
@@ -11,6 +11,7 @@
 //
 //===----------------------------------------------------------------------===//
 
+#include "llvm/ADT/STLExtras.h"
 #include "llvm/ADT/StringRef.h"
 #include "llvm/IR/LLVMContext.h"
 #include "llvm/ProfileData/InstrProfReader.h"
@@ -25,7 +26,13 @@
 #include "llvm/Support/Path.h"
 #include "llvm/Support/PrettyStackTrace.h"
 #include "llvm/Support/Signals.h"
+#include "llvm/Support/ThreadPool.h"
 #include "llvm/Support/raw_ostream.h"
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <mutex>
 
 using namespace llvm;
 
@@ -41,8 +48,219 @@ namespace {
 enum ProfileKinds { instr, sample };
 }
 
+/// Serializes the warnings of the merge threads.
+static std::mutex WarnLock;
+
+static void warnFunction(StringRef Whence, StringRef FunctionName,
+                         std::error_code EC) {
+  std::lock_guard<std::mutex> Lock(WarnLock);
+  if (!Whence.empty())
+    errs() << Whence << ": ";
+  errs() << FunctionName << ": " << EC.message() << "\n";
+}
+
+namespace {
+/// The state of a merge thread: the profile it accumulates, and the first
+/// error that stopped it.
+struct WriterContext {
+  InstrProfWriter Writer;
+  std::error_code Err;
+  std::string ErrWhence;
+};
+}
+
+/// Add the function counts of the input \p Filename to \p WC.
+static void loadInput(StringRef Filename, WriterContext &WC) {
+  auto ReaderOrErr = InstrProfReader::create(Filename);
+  if ((WC.Err = ReaderOrErr.getError())) {
+    WC.ErrWhence = Filename;
+    return;
+  }
+
+  auto Reader = std::move(ReaderOrErr.get());
+  for (const auto &I : *Reader)
+    if (std::error_code EC = WC.Writer.addFunctionCounts(I.Name, I.Hash,
+                                                         I.Counts))
+      warnFunction(Filename, I.Name, EC);
+  if (Reader->hasError()) {
+    WC.Err = Reader->getError();
+    WC.ErrWhence = Filename;
+  }
+}
+
+/// Merge the profile accumulated in \p Src into \p Dst.
+static void mergeWriterContexts(WriterContext &Dst, WriterContext &Src) {
+  Dst.Writer.mergeRecordsFromWriter(
+      std::move(Src.Writer), [](StringRef FunctionName, std::error_code EC) {
+        warnFunction("", FunctionName, EC);
+      });
+}
+
+/// Merge the inputs with \p NumThreads threads, each accumulating its share of
+/// the inputs into its own profile. The profiles are then merged pairwise.
+/// Memory grows with the number of threads.
+static void mergeInstrProfileInParallel(const cl::list<std::string> &Inputs,
+                                        InstrProfWriter &Writer,
+                                        unsigned NumThreads) {
+  std::vector<std::unique_ptr<WriterContext>> Contexts;
+  for (unsigned I = 0; I != NumThreads; ++I)
+    Contexts.push_back(llvm::make_unique<WriterContext>());
+
+  ThreadPool Pool(NumThreads);
+  // The inputs are handed out one at a time, so that the threads stay busy
+  // whatever the sizes of the inputs.
+  std::atomic<unsigned> NextInput(0);
+  for (unsigned I = 0; I != NumThreads; ++I) {
+    Pool.async([&, I]() {
+      WriterContext &WC = *Contexts[I];
+      for (unsigned Input = NextInput++; Input < Inputs.size() && !WC.Err;
+           Input = NextInput++)
+        loadInput(Inputs[Input], WC);
+    });
+  }
+  Pool.wait();
+
+  for (const auto &WC : Contexts)
+    if (WC->Err)
+      exitWithError(WC->Err.message(), WC->ErrWhence);
+
+  // Merge the profiles pairwise, halving their number at each round.
+  for (unsigned End = NumThreads; End > 1;) {
+    unsigned Mid = (End + 1) / 2;
+    for (unsigned I = Mid; I != End; ++I)
+      Pool.async([&, I, Mid]() {
+        mergeWriterContexts(*Contexts[I - Mid], *Contexts[I]);
+      });
+    Pool.wait();
+    End = Mid;
+  }
+
+  Writer = std::move(Contexts[0]->Writer);
+}
+
+namespace {
+/// Records read from an input. They are copied since the input is released
+/// once read.
+struct RecordBatch {
+  StringRef Filename;
+  std::vector<std::string> Names;
+  std::vector<uint64_t> Hashes;
+  std::vector<std::vector<uint64_t>> Counts;
+};
+
+/// A queue of record batches holding at most Capacity batches, through which
+/// the reader threads of the streaming merge feed the single profile.
+class RecordBatchQueue {
+  std::mutex QueueLock;
+  std::condition_variable NotFull;
+  std::condition_variable NotEmpty;
+  std::deque<RecordBatch> Batches;
+  const unsigned Capacity;
+  unsigned ActiveProducers;
+
+public:
+  RecordBatchQueue(unsigned Capacity, unsigned Producers)
+      : Capacity(Capacity), ActiveProducers(Producers) {}
+
+  /// Add \p Batch, waiting for room if the queue is full.
+  void push(RecordBatch Batch) {
+    std::unique_lock<std::mutex> LockGuard(QueueLock);
+    NotFull.wait(LockGuard, [&] { return Batches.size() < Capacity; });
+    Batches.push_back(std::move(Batch));
+    NotEmpty.notify_one();
+  }
+
+  /// Signal that a producer will not push any more batch.
+  void producerDone() {
+    std::lock_guard<std::mutex> LockGuard(QueueLock);
+    --ActiveProducers;
+    NotEmpty.notify_all();
+  }
+
+  /// Take the next batch, waiting for one. Return false once all the
+  /// producers are done and the queue is empty.
+  bool pop(RecordBatch &Batch) {
+    std::unique_lock<std::mutex> LockGuard(QueueLock);
+    NotEmpty.wait(LockGuard,
+                  [&] { return !Batches.empty() || !ActiveProducers; });
+    if (Batches.empty())
+      return false;
+    Batch = std::move(Batches.front());
+    Batches.pop_front();
+    NotFull.notify_one();
+    return true;
+  }
+};
+}
+
+/// Number of records read from an input before they are queued for merging.
+static const unsigned RecordBatchSize = 1024;
+
+/// Merge the inputs with bounded memory: \p NumThreads threads read the
+/// inputs, and the current thread merges their records into \p Writer as
+/// they come. Beyond the merged profile, only a bounded number of records is
+/// held at any time, whatever the number of threads.
+static void mergeInstrProfileStreaming(const cl::list<std::string> &Inputs,
+                                       InstrProfWriter &Writer,
+                                       unsigned NumThreads) {
+  RecordBatchQueue Queue(2 * NumThreads, NumThreads);
+  std::vector<WriterContext> Errors(NumThreads);
+
+  ThreadPool Pool(NumThreads);
+  std::atomic<unsigned> NextInput(0);
+  for (unsigned I = 0; I != NumThreads; ++I) {
+    Pool.async([&, I]() {
+      std::error_code &Err = Errors[I].Err;
+      for (unsigned Input = NextInput++; Input < Inputs.size() && !Err;
+           Input = NextInput++) {
+        StringRef Filename = Inputs[Input];
+        auto ReaderOrErr = InstrProfReader::create(Filename);
+        if ((Err = ReaderOrErr.getError())) {
+          Errors[I].ErrWhence = Filename;
+          break;
+        }
+
+        auto Reader = std::move(ReaderOrErr.get());
+        RecordBatch Batch;
+        Batch.Filename = Filename;
+        for (const auto &Record : *Reader) {
+          Batch.Names.push_back(Record.Name);
+          Batch.Hashes.push_back(Record.Hash);
+          Batch.Counts.push_back(Record.Counts);
+          if (Batch.Names.size() == RecordBatchSize) {
+            Queue.push(std::move(Batch));
+            Batch = RecordBatch();
+            Batch.Filename = Filename;
+          }
+        }
+        if (!Batch.Names.empty())
+          Queue.push(std::move(Batch));
+        if (Reader->hasError()) {
+          Err = Reader->getError();
+          Errors[I].ErrWhence = Filename;
+        }
+      }
+      Queue.producerDone();
+    });
+  }
+
+  RecordBatch Batch;
+  while (Queue.pop(Batch)) {
+    for (unsigned I = 0, E = Batch.Names.size(); I != E; ++I)
+      if (std::error_code EC = Writer.addFunctionCounts(
+              Batch.Names[I], Batch.Hashes[I], Batch.Counts[I]))
+        warnFunction(Batch.Filename, Batch.Names[I], EC);
+  }
+  Pool.wait();
+
+  for (const WriterContext &Error : Errors)
+    if (Error.Err)
+      exitWithError(Error.Err.message(), Error.ErrWhence);
+}
+
 static void mergeInstrProfile(const cl::list<std::string> &Inputs,
-                              StringRef OutputFilename) {
+                              StringRef OutputFilename, unsigned NumThreads,
+                              bool Stream) {
   if (OutputFilename.compare("-") == 0)
     exitWithError("Cannot write indexed profdata format to stdout.");
 
@@ -51,19 +269,26 @@ static void mergeInstrProfile(const cl::list<std::string> &Inputs,
   if (EC)
     exitWithError(EC.message(), OutputFilename);
 
-  InstrProfWriter Writer;
-  for (const auto &Filename : Inputs) {
-    auto ReaderOrErr = InstrProfReader::create(Filename);
-    if (std::error_code ec = ReaderOrErr.getError())
-      exitWithError(ec.message(), Filename);
+  if (NumThreads == 0)
+    NumThreads = ThreadPool::getDefaultThreadCount();
+  // Without streaming, each thread merges its own profile: give it at least
+  // two inputs, for that to pay off.
+  NumThreads = std::min<unsigned>(
+      NumThreads, Stream ? Inputs.size() : (Inputs.size() + 1) / 2);
 
-    auto Reader = std::move(ReaderOrErr.get());
-    for (const auto &I : *Reader)
-      if (std::error_code EC =
-              Writer.addFunctionCounts(I.Name, I.Hash, I.Counts))
-        errs() << Filename << ": " << I.Name << ": " << EC.message() << "\n";
-    if (Reader->hasError())
-      exitWithError(Reader->getError().message(), Filename);
+  InstrProfWriter Writer;
+  if (Stream && NumThreads > 1) {
+    mergeInstrProfileStreaming(Inputs, Writer, NumThreads);
+  } else if (NumThreads > 1) {
+    mergeInstrProfileInParallel(Inputs, Writer, NumThreads);
+  } else {
+    WriterContext WC;
+    for (const auto &Filename : Inputs) {
+      loadInput(Filename, WC);
+      if (WC.Err)
+        exitWithError(WC.Err.message(), WC.ErrWhence);
+    }
+    Writer = std::move(WC.Writer);
   }
   Writer.write(Output);
 }
@@ -123,10 +348,22 @@ static int merge_main(int argc, const char *argv[]) {
                  clEnumValN(sampleprof::SPF_GCC, "gcc", "GCC encoding"),
                  clEnumValEnd));
 
+  cl::opt<unsigned> NumThreads(
+      "num-threads", cl::init(0),
+      cl::desc("Number of threads merging instrumentation profiles "
+               "(default: one per hardware thread)"));
+  cl::alias NumThreadsA("j", cl::desc("Alias for --num-threads"),
+                        cl::aliasopt(NumThreads));
+  cl::opt<bool> Stream(
+      "stream", cl::init(false),
+      cl::desc("Merge instrumentation profiles with bounded memory: the "
+               "threads read the inputs, but their records are merged into a "
+               "single profile as they come"));
+
   cl::ParseCommandLineOptions(argc, argv, "LLVM profile data merger\n");
 
   if (ProfileKind == instr)
-    mergeInstrProfile(Inputs, OutputFilename);
+    mergeInstrProfile(Inputs, OutputFilename, NumThreads, Stream);
   else
     mergeSampleProfile(Inputs, OutputFilename, OutputFormat);
 
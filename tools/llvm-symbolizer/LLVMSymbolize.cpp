@@ -27,6 +27,7 @@
 #include "llvm/Support/FileSystem.h"
 #include "llvm/Support/MemoryBuffer.h"
 #include "llvm/Support/Path.h"
+#include <algorithm>
 #include <sstream>
 #include <stdlib.h>
 
@@ -52,8 +53,9 @@ getDILineInfoSpecifier(const LLVMSymbolizer::Options &Opts) {
       Opts.PrintFunctions);
 }
 
-ModuleInfo::ModuleInfo(ObjectFile *Obj, DIContext *DICtx)
-    : Module(Obj), DebugInfoContext(DICtx) {
+ModuleInfo::ModuleInfo(ObjectFile *Obj, DIContext *DICtx,
+                       ModuleBinaries Binaries)
+    : Binaries(std::move(Binaries)), Module(Obj), DebugInfoContext(DICtx) {
   std::unique_ptr<DataExtractor> OpdExtractor;
   uint64_t OpdAddress = 0;
   // Find the .opd (function descriptor) section if any, for big-endian
@@ -76,6 +78,23 @@ ModuleInfo::ModuleInfo(ObjectFile *Obj, DIContext *DICtx)
       computeSymbolSizes(*Module);
   for (auto &P : Symbols)
     addSymbol(P.first, P.second, OpdExtractor.get(), OpdAddress);
+
+  // Sort the symbol tables for binary search, keeping the first symbol added
+  // at each address.
+  for (SymbolTable *Table : {&Functions, &Objects}) {
+    std::stable_sort(Table->begin(), Table->end(),
+                     [](const SymbolTable::value_type &LHS,
+                        const SymbolTable::value_type &RHS) {
+                       return LHS.first < RHS.first;
+                     });
+    Table->erase(std::unique(Table->begin(), Table->end(),
+                             [](const SymbolTable::value_type &LHS,
+                                const SymbolTable::value_type &RHS) {
+                               return LHS.first.Addr == RHS.first.Addr;
+                             }),
+                 Table->end());
+    Table->shrink_to_fit();
+  }
 }
 
 void ModuleInfo::addSymbol(const SymbolRef &Symbol, uint64_t SymbolSize,
@@ -109,7 +128,7 @@ void ModuleInfo::addSymbol(const SymbolRef &Symbol, uint64_t SymbolSize,
   // with same address size. Make sure we choose the correct one.
   auto &M = SymbolType == SymbolRef::ST_Function ? Functions : Objects;
   SymbolDesc SD = { SymbolAddress, SymbolSize };
-  M.insert(std::make_pair(SD, SymbolName));
+  M.push_back(std::make_pair(SD, SymbolName));
 }
 
 bool ModuleInfo::getNameFromSymbolTable(SymbolRef::Type Type, uint64_t Address,
@@ -119,7 +138,11 @@ bool ModuleInfo::getNameFromSymbolTable(SymbolRef::Type Type, uint64_t Address,
   if (SymbolMap.empty())
     return false;
   SymbolDesc SD = { Address, Address };
-  auto SymbolIterator = SymbolMap.upper_bound(SD);
+  auto SymbolIterator = std::upper_bound(
+      SymbolMap.begin(), SymbolMap.end(), SD,
+      [](const SymbolDesc &SD, const SymbolTable::value_type &Entry) {
+        return SD < Entry.first;
+      });
   if (SymbolIterator == SymbolMap.begin())
     return false;
   --SymbolIterator;
@@ -136,9 +159,31 @@ DILineInfo ModuleInfo::symbolizeCode(
     uint64_t ModuleOffset, const LLVMSymbolizer::Options &Opts) const {
   DILineInfo LineInfo;
   if (DebugInfoContext) {
+    std::lock_guard<std::mutex> Lock(DebugInfoMutex);
     LineInfo = DebugInfoContext->getLineInfoForAddress(
         ModuleOffset, getDILineInfoSpecifier(Opts));
   }
+  patchFunctionName(ModuleOffset, Opts, LineInfo);
+  return LineInfo;
+}
+
+std::vector<DILineInfo>
+ModuleInfo::symbolizeCode(ArrayRef<uint64_t> ModuleOffsets,
+                          const LLVMSymbolizer::Options &Opts) const {
+  std::vector<DILineInfo> LineInfos(ModuleOffsets.size());
+  if (DebugInfoContext) {
+    std::lock_guard<std::mutex> Lock(DebugInfoMutex);
+    LineInfos = DebugInfoContext->getLineInfoForAddresses(
+        ModuleOffsets, getDILineInfoSpecifier(Opts));
+  }
+  for (size_t I = 0, E = ModuleOffsets.size(); I != E; ++I)
+    patchFunctionName(ModuleOffsets[I], Opts, LineInfos[I]);
+  return LineInfos;
+}
+
+void ModuleInfo::patchFunctionName(uint64_t ModuleOffset,
+                                   const LLVMSymbolizer::Options &Opts,
+                                   DILineInfo &LineInfo) const {
   // Override function name from symbol table if necessary.
   if (Opts.PrintFunctions != FunctionNameKind::None && Opts.UseSymbolTable) {
     std::string FunctionName;
@@ -148,7 +193,6 @@ DILineInfo ModuleInfo::symbolizeCode(
       LineInfo.FunctionName = FunctionName;
     }
   }
-  return LineInfo;
 }
 
 DIInliningInfo ModuleInfo::symbolizeInlinedCode(
@@ -156,6 +200,7 @@ DIInliningInfo ModuleInfo::symbolizeInlinedCode(
   DIInliningInfo InlinedContext;
 
   if (DebugInfoContext) {
+    std::lock_guard<std::mutex> Lock(DebugInfoMutex);
     InlinedContext = DebugInfoContext->getInliningInfoForAddress(
         ModuleOffset, getDILineInfoSpecifier(Opts));
   }
@@ -193,7 +238,7 @@ const char LLVMSymbolizer::kBadString[] = "??";
 
 std::string LLVMSymbolizer::symbolizeCode(const std::string &ModuleName,
                                           uint64_t ModuleOffset) {
-  ModuleInfo *Info = getOrCreateModuleInfo(ModuleName);
+  std::shared_ptr<ModuleInfo> Info = getOrCreateModuleInfo(ModuleName);
   if (!Info)
     return printDILineInfo(DILineInfo());
   if (Opts.PrintInlining) {
@@ -212,13 +257,30 @@ std::string LLVMSymbolizer::symbolizeCode(const std::string &ModuleName,
   return printDILineInfo(LineInfo);
 }
 
+std::vector<std::string>
+LLVMSymbolizer::symbolizeCodeBatch(const std::string &ModuleName,
+                                   ArrayRef<uint64_t> ModuleOffsets) {
+  std::vector<std::string> Results;
+  Results.reserve(ModuleOffsets.size());
+  std::shared_ptr<ModuleInfo> Info = getOrCreateModuleInfo(ModuleName);
+  // The inlined frames are only looked up one address at a time.
+  if (!Info || Opts.PrintInlining) {
+    for (uint64_t ModuleOffset : ModuleOffsets)
+      Results.push_back(symbolizeCode(ModuleName, ModuleOffset));
+    return Results;
+  }
+  for (const DILineInfo &LineInfo : Info->symbolizeCode(ModuleOffsets, Opts))
+    Results.push_back(printDILineInfo(LineInfo));
+  return Results;
+}
+
 std::string LLVMSymbolizer::symbolizeData(const std::string &ModuleName,
                                           uint64_t ModuleOffset) {
   std::string Name = kBadString;
   uint64_t Start = 0;
   uint64_t Size = 0;
   if (Opts.UseSymbolTable) {
-    if (ModuleInfo *Info = getOrCreateModuleInfo(ModuleName)) {
+    if (std::shared_ptr<ModuleInfo> Info = getOrCreateModuleInfo(ModuleName)) {
       if (Info->symbolizeData(ModuleOffset, Name, Start, Size) && Opts.Demangle)
         Name = DemangleName(Name);
     }
@@ -229,9 +291,9 @@ std::string LLVMSymbolizer::symbolizeData(const std::string &ModuleName,
 }
 
 void LLVMSymbolizer::flush() {
-  DeleteContainerSeconds(Modules);
-  ObjectPairForPathArch.clear();
-  ObjectFileForArch.clear();
+  std::lock_guard<std::mutex> Lock(ModulesMutex);
+  Modules.clear();
+  ModulesLRU.clear();
 }
 
 // For Path="/path/to/foo" and Basename="foo" assume that debug info is in
@@ -295,30 +357,45 @@ static bool findDebugBinary(const std::string &OrigPath,
   return false;
 }
 
+static bool getGNUDebuglinkContents(const SectionRef &Section,
+                                    bool IsLittleEndian,
+                                    std::string &DebugName,
+                                    uint32_t &CRCHash) {
+  StringRef Data;
+  Section.getContents(Data);
+  DataExtractor DE(Data, IsLittleEndian, 0);
+  uint32_t Offset = 0;
+  if (const char *DebugNameStr = DE.getCStr(&Offset)) {
+    // 4-byte align the offset.
+    Offset = (Offset + 3) & ~0x3;
+    if (DE.isValidOffsetForDataOfSize(Offset, 4)) {
+      DebugName = DebugNameStr;
+      CRCHash = DE.getU32(&Offset);
+      return true;
+    }
+  }
+  return false;
+}
+
 static bool getGNUDebuglinkContents(const ObjectFile *Obj, std::string &DebugName,
                                     uint32_t &CRCHash) {
   if (!Obj)
     return false;
+  // ELF objects index their sections by name.
+  if (auto *ELFObj = dyn_cast<ELFObjectFileBase>(Obj)) {
+    section_iterator Section = ELFObj->findSection(".gnu_debuglink");
+    if (Section == ELFObj->section_end())
+      return false;
+    return getGNUDebuglinkContents(*Section, Obj->isLittleEndian(), DebugName,
+                                   CRCHash);
+  }
   for (const SectionRef &Section : Obj->sections()) {
     StringRef Name;
     Section.getName(Name);
     Name = Name.substr(Name.find_first_not_of("._"));
-    if (Name == "gnu_debuglink") {
-      StringRef Data;
-      Section.getContents(Data);
-      DataExtractor DE(Data, Obj->isLittleEndian(), 0);
-      uint32_t Offset = 0;
-      if (const char *DebugNameStr = DE.getCStr(&Offset)) {
-        // 4-byte align the offset.
-        Offset = (Offset + 3) & ~0x3;
-        if (DE.isValidOffsetForDataOfSize(Offset, 4)) {
-          DebugName = DebugNameStr;
-          CRCHash = DE.getU32(&Offset);
-          return true;
-        }
-      }
-      break;
-    }
+    if (Name == "gnu_debuglink")
+      return getGNUDebuglinkContents(Section, Obj->isLittleEndian(),
+                                     DebugName, CRCHash);
   }
   return false;
 }
@@ -334,7 +411,8 @@ bool darwinDsymMatchesBinary(const MachOObjectFile *DbgObj,
 }
 
 ObjectFile *LLVMSymbolizer::lookUpDsymFile(const std::string &ExePath,
-    const MachOObjectFile *MachExeObj, const std::string &ArchName) {
+    const MachOObjectFile *MachExeObj, const std::string &ArchName,
+    ModuleBinaries &Binaries) {
   // On Darwin we may find DWARF in separate object file in
   // resource directory.
   std::vector<std::string> DsymPaths;
@@ -349,12 +427,12 @@ ObjectFile *LLVMSymbolizer::lookUpDsymFile(const std::string &ExePath,
     if (EC != errc::no_such_file_or_directory && !error(EC)) {
       OwningBinary<Binary> B = std::move(BinaryOrErr.get());
       ObjectFile *DbgObj =
-          getObjectFileFromBinary(B.getBinary(), ArchName);
+          getObjectFileFromBinary(B.getBinary(), ArchName, Binaries);
       const MachOObjectFile *MachDbgObj =
           dyn_cast<const MachOObjectFile>(DbgObj);
       if (!MachDbgObj) continue;
       if (darwinDsymMatchesBinary(MachDbgObj, MachExeObj)) {
-        addOwningBinary(std::move(B));
+        Binaries.addOwningBinary(std::move(B));
         return DbgObj; 
       }
     }
@@ -363,25 +441,20 @@ ObjectFile *LLVMSymbolizer::lookUpDsymFile(const std::string &ExePath,
 }
 
 LLVMSymbolizer::ObjectPair
-LLVMSymbolizer::getOrCreateObjects(const std::string &Path,
-                                   const std::string &ArchName) {
-  const auto &I = ObjectPairForPathArch.find(std::make_pair(Path, ArchName));
-  if (I != ObjectPairForPathArch.end())
-    return I->second;
+LLVMSymbolizer::createObjects(const std::string &Path,
+                              const std::string &ArchName,
+                              ModuleBinaries &Binaries) {
   ObjectFile *Obj = nullptr;
   ObjectFile *DbgObj = nullptr;
   ErrorOr<OwningBinary<Binary>> BinaryOrErr = createBinary(Path);
   if (!error(BinaryOrErr.getError())) {
     OwningBinary<Binary> &B = BinaryOrErr.get();
-    Obj = getObjectFileFromBinary(B.getBinary(), ArchName);
-    if (!Obj) {
-      ObjectPair Res = std::make_pair(nullptr, nullptr);
-      ObjectPairForPathArch[std::make_pair(Path, ArchName)] = Res;
-      return Res;
-    }
-    addOwningBinary(std::move(B));
+    Obj = getObjectFileFromBinary(B.getBinary(), ArchName, Binaries);
+    if (!Obj)
+      return std::make_pair(nullptr, nullptr);
+    Binaries.addOwningBinary(std::move(B));
     if (auto MachObj = dyn_cast<const MachOObjectFile>(Obj))
-      DbgObj = lookUpDsymFile(Path, MachObj, ArchName);
+      DbgObj = lookUpDsymFile(Path, MachObj, ArchName, Binaries);
     // Try to locate the debug binary using .gnu_debuglink section.
     if (!DbgObj) {
       std::string DebuglinkName;
@@ -392,48 +465,78 @@ LLVMSymbolizer::getOrCreateObjects(const std::string &Path,
         BinaryOrErr = createBinary(DebugBinaryPath);
         if (!error(BinaryOrErr.getError())) {
           OwningBinary<Binary> B = std::move(BinaryOrErr.get());
-          DbgObj = getObjectFileFromBinary(B.getBinary(), ArchName);
-          addOwningBinary(std::move(B));
+          DbgObj = getObjectFileFromBinary(B.getBinary(), ArchName, Binaries);
+          Binaries.addOwningBinary(std::move(B));
         }
       }
     }
   }
   if (!DbgObj)
     DbgObj = Obj;
-  ObjectPair Res = std::make_pair(Obj, DbgObj);
-  ObjectPairForPathArch[std::make_pair(Path, ArchName)] = Res;
-  return Res;
+  return std::make_pair(Obj, DbgObj);
 }
 
 ObjectFile *
 LLVMSymbolizer::getObjectFileFromBinary(Binary *Bin,
-                                        const std::string &ArchName) {
+                                        const std::string &ArchName,
+                                        ModuleBinaries &Binaries) {
   if (!Bin)
     return nullptr;
   ObjectFile *Res = nullptr;
   if (MachOUniversalBinary *UB = dyn_cast<MachOUniversalBinary>(Bin)) {
-    const auto &I = ObjectFileForArch.find(
-        std::make_pair(UB, ArchName));
-    if (I != ObjectFileForArch.end())
-      return I->second;
     ErrorOr<std::unique_ptr<ObjectFile>> ParsedObj =
         UB->getObjectForArch(ArchName);
     if (ParsedObj) {
       Res = ParsedObj.get().get();
-      ParsedBinariesAndObjects.push_back(std::move(ParsedObj.get()));
+      Binaries.ParsedBinariesAndObjects.push_back(std::move(ParsedObj.get()));
     }
-    ObjectFileForArch[std::make_pair(UB, ArchName)] = Res;
   } else if (Bin->isObject()) {
     Res = cast<ObjectFile>(Bin);
   }
   return Res;
 }
 
-ModuleInfo *
+std::shared_ptr<ModuleInfo>
 LLVMSymbolizer::getOrCreateModuleInfo(const std::string &ModuleName) {
-  const auto &I = Modules.find(ModuleName);
-  if (I != Modules.end())
-    return I->second;
+  std::shared_future<std::shared_ptr<ModuleInfo>> Loading;
+  std::promise<std::shared_ptr<ModuleInfo>> Promise;
+  {
+    std::lock_guard<std::mutex> Lock(ModulesMutex);
+    auto I = Modules.find(ModuleName);
+    if (I != Modules.end()) {
+      ModulesLRU.splice(ModulesLRU.begin(), ModulesLRU,
+                        I->second.LRUPosition);
+      Loading = I->second.Info;
+    } else {
+      // Unload the least recently used modules to make room for this one.
+      // They are freed once no other thread is using them.
+      if (Opts.MaxLoadedModules) {
+        while (ModulesLRU.size() >= Opts.MaxLoadedModules) {
+          Modules.erase(ModulesLRU.back());
+          ModulesLRU.pop_back();
+        }
+      }
+
+      // Other threads asking for this module wait for this one to load it.
+      ModulesLRU.push_front(ModuleName);
+      LoadedModule &Loaded = Modules[ModuleName];
+      Loaded.Info = Promise.get_future().share();
+      Loaded.LRUPosition = ModulesLRU.begin();
+    }
+  }
+  // The module is loaded, or being loaded, by another thread.
+  if (Loading.valid())
+    return Loading.get();
+
+  // Opening and parsing the binaries is the expensive part, so it is done
+  // without the lock, and several modules can be loaded at once.
+  std::shared_ptr<ModuleInfo> Info = createModuleInfo(ModuleName);
+  Promise.set_value(Info);
+  return Info;
+}
+
+std::shared_ptr<ModuleInfo>
+LLVMSymbolizer::createModuleInfo(const std::string &ModuleName) {
   std::string BinaryName = ModuleName;
   std::string ArchName = Opts.DefaultArch;
   size_t ColonPos = ModuleName.find_last_of(':');
@@ -445,11 +548,11 @@ LLVMSymbolizer::getOrCreateModuleInfo(const std::string &ModuleName) {
       ArchName = ArchStr;
     }
   }
-  ObjectPair Objects = getOrCreateObjects(BinaryName, ArchName);
+  ModuleBinaries Binaries;
+  ObjectPair Objects = createObjects(BinaryName, ArchName, Binaries);
 
   if (!Objects.first) {
     // Failed to find valid object file.
-    Modules.insert(make_pair(ModuleName, (ModuleInfo *)nullptr));
     return nullptr;
   }
   DIContext *Context = nullptr;
@@ -467,9 +570,8 @@ LLVMSymbolizer::getOrCreateModuleInfo(const std::string &ModuleName) {
   if (!Context)
     Context = new DWARFContextInMemory(*Objects.second);
   assert(Context);
-  ModuleInfo *Info = new ModuleInfo(Objects.first, Context);
-  Modules.insert(make_pair(ModuleName, Info));
-  return Info;
+  return std::make_shared<ModuleInfo>(Objects.first, Context,
+                                      std::move(Binaries));
 }
 
 std::string LLVMSymbolizer::printDILineInfo(DILineInfo LineInfo) const {
@@ -19,9 +19,13 @@
 #include "llvm/Object/ObjectFile.h"
 #include "llvm/Support/DataExtractor.h"
 #include "llvm/Support/MemoryBuffer.h"
+#include <list>
 #include <map>
 #include <memory>
+#include <future>
+#include <mutex>
 #include <string>
+#include <vector>
 
 namespace llvm {
 
@@ -32,6 +36,19 @@ namespace symbolize {
 
 class ModuleInfo;
 
+// Owns the parsed binaries and object files of a module.
+struct ModuleBinaries {
+  SmallVector<std::unique_ptr<Binary>, 2> ParsedBinariesAndObjects;
+  SmallVector<std::unique_ptr<MemoryBuffer>, 2> MemoryBuffers;
+  void addOwningBinary(OwningBinary<Binary> OwningBin) {
+    std::unique_ptr<Binary> Bin;
+    std::unique_ptr<MemoryBuffer> MemBuf;
+    std::tie(Bin, MemBuf) = OwningBin.takeBinary();
+    ParsedBinariesAndObjects.push_back(std::move(Bin));
+    MemoryBuffers.push_back(std::move(MemBuf));
+  }
+};
+
 class LLVMSymbolizer {
 public:
   struct Options {
@@ -42,13 +59,17 @@ public:
     bool RelativeAddresses : 1;
     std::string DefaultArch;
     std::vector<std::string> DsymHints;
+    // Maximum number of modules kept loaded, the least recently used ones
+    // being unloaded first. 0 means no limit.
+    unsigned MaxLoadedModules;
     Options(FunctionNameKind PrintFunctions = FunctionNameKind::LinkageName,
             bool UseSymbolTable = true, bool PrintInlining = true,
             bool Demangle = true, bool RelativeAddresses = false,
-            std::string DefaultArch = "")
+            std::string DefaultArch = "", unsigned MaxLoadedModules = 0)
         : PrintFunctions(PrintFunctions), UseSymbolTable(UseSymbolTable),
           PrintInlining(PrintInlining), Demangle(Demangle),
-          RelativeAddresses(RelativeAddresses), DefaultArch(DefaultArch) {}
+          RelativeAddresses(RelativeAddresses), DefaultArch(DefaultArch),
+          MaxLoadedModules(MaxLoadedModules) {}
   };
 
   LLVMSymbolizer(const Options &Opts = Options()) : Opts(Opts) {}
@@ -57,46 +78,56 @@ public:
   }
 
   // Returns the result of symbolization for module name/offset as
-  // a string (possibly containing newlines).
+  // a string (possibly containing newlines). These can be called
+  // concurrently from several threads.
   std::string
   symbolizeCode(const std::string &ModuleName, uint64_t ModuleOffset);
   std::string
   symbolizeData(const std::string &ModuleName, uint64_t ModuleOffset);
+  // Returns the result of symbolizeCode for each of the offsets of a module,
+  // in the same order. Without inlining, the debug info of the module is
+  // queried once for all of them.
+  std::vector<std::string>
+  symbolizeCodeBatch(const std::string &ModuleName,
+                     ArrayRef<uint64_t> ModuleOffsets);
   void flush();
   static std::string DemangleName(const std::string &Name);
 private:
   typedef std::pair<ObjectFile*, ObjectFile*> ObjectPair;
 
-  ModuleInfo *getOrCreateModuleInfo(const std::string &ModuleName);
+  // A module that is unloaded stays alive until the symbolizations that
+  // use it are done.
+  std::shared_ptr<ModuleInfo>
+  getOrCreateModuleInfo(const std::string &ModuleName);
+  std::shared_ptr<ModuleInfo> createModuleInfo(const std::string &ModuleName);
   ObjectFile *lookUpDsymFile(const std::string &Path, const MachOObjectFile *ExeObj,
-                             const std::string &ArchName);
-
-  /// \brief Returns pair of pointers to object and debug object.
-  ObjectPair getOrCreateObjects(const std::string &Path,
-                                const std::string &ArchName);
+                             const std::string &ArchName,
+                             ModuleBinaries &Binaries);
+
+  /// \brief Returns pair of pointers to object and debug object. The
+  /// binaries they belong to are added to \p Binaries.
+  ObjectPair createObjects(const std::string &Path,
+                           const std::string &ArchName,
+                           ModuleBinaries &Binaries);
   /// \brief Returns a parsed object file for a given architecture in a
   /// universal binary (or the binary itself if it is an object file).
-  ObjectFile *getObjectFileFromBinary(Binary *Bin, const std::string &ArchName);
+  ObjectFile *getObjectFileFromBinary(Binary *Bin, const std::string &ArchName,
+                                      ModuleBinaries &Binaries);
 
   std::string printDILineInfo(DILineInfo LineInfo) const;
 
-  // Owns all the parsed binaries and object files.
-  SmallVector<std::unique_ptr<Binary>, 4> ParsedBinariesAndObjects;
-  SmallVector<std::unique_ptr<MemoryBuffer>, 4> MemoryBuffers;
-  void addOwningBinary(OwningBinary<Binary> OwningBin) {
-    std::unique_ptr<Binary> Bin;
-    std::unique_ptr<MemoryBuffer> MemBuf;
-    std::tie(Bin, MemBuf) = OwningBin.takeBinary();
-    ParsedBinariesAndObjects.push_back(std::move(Bin));
-    MemoryBuffers.push_back(std::move(MemBuf));
-  }
+  struct LoadedModule {
+    // Ready once the module is loaded, outside of ModulesMutex, by the first
+    // thread that needs it. Null if the module could not be loaded.
+    std::shared_future<std::shared_ptr<ModuleInfo>> Info;
+    std::list<std::string>::iterator LRUPosition;
+  };
 
-  // Owns module info objects.
-  std::map<std::string, ModuleInfo *> Modules;
-  std::map<std::pair<MachOUniversalBinary *, std::string>, ObjectFile *>
-      ObjectFileForArch;
-  std::map<std::pair<std::string, std::string>, ObjectPair>
-      ObjectPairForPathArch;
+  // Guards Modules and ModulesLRU, but not the loading of the modules.
+  std::mutex ModulesMutex;
+  std::map<std::string, LoadedModule> Modules;
+  // Names of the loaded modules, the most recently used first.
+  std::list<std::string> ModulesLRU;
 
   Options Opts;
   static const char kBadString[];
@@ -104,16 +135,24 @@ private:
 
 class ModuleInfo {
 public:
-  ModuleInfo(ObjectFile *Obj, DIContext *DICtx);
+  ModuleInfo(ObjectFile *Obj, DIContext *DICtx, ModuleBinaries Binaries);
 
   DILineInfo symbolizeCode(uint64_t ModuleOffset,
                            const LLVMSymbolizer::Options &Opts) const;
+  std::vector<DILineInfo>
+  symbolizeCode(ArrayRef<uint64_t> ModuleOffsets,
+                const LLVMSymbolizer::Options &Opts) const;
   DIInliningInfo symbolizeInlinedCode(
       uint64_t ModuleOffset, const LLVMSymbolizer::Options &Opts) const;
   bool symbolizeData(uint64_t ModuleOffset, std::string &Name, uint64_t &Start,
                      uint64_t &Size) const;
 
 private:
+  // Overrides the function name of LineInfo with the name from the symbol
+  // table, if the options ask for it.
+  void patchFunctionName(uint64_t ModuleOffset,
+                         const LLVMSymbolizer::Options &Opts,
+                         DILineInfo &LineInfo) const;
   bool getNameFromSymbolTable(SymbolRef::Type Type, uint64_t Address,
                               std::string &Name, uint64_t &Addr,
                               uint64_t &Size) const;
@@ -122,8 +161,11 @@ private:
   void addSymbol(const SymbolRef &Symbol, uint64_t SymbolSize,
                  DataExtractor *OpdExtractor = nullptr,
                  uint64_t OpdAddress = 0);
+  ModuleBinaries Binaries;
   ObjectFile *Module;
   std::unique_ptr<DIContext> DebugInfoContext;
+  // The debug info context parses lazily and is not thread-safe.
+  mutable std::mutex DebugInfoMutex;
 
   struct SymbolDesc {
     uint64_t Addr;
@@ -134,8 +176,11 @@ private:
       return s1.Addr < s2.Addr;
     }
   };
-  std::map<SymbolDesc, StringRef> Functions;
-  std::map<SymbolDesc, StringRef> Objects;
+  typedef std::vector<std::pair<SymbolDesc, StringRef>> SymbolTable;
+  // Sorted by address once all the symbols are added, with the first symbol
+  // added at each address.
+  SymbolTable Functions;
+  SymbolTable Objects;
 };
 
 } // namespace symbolize
@@ -25,10 +25,13 @@
 #include "llvm/Support/Path.h"
 #include "llvm/Support/PrettyStackTrace.h"
 #include "llvm/Support/Signals.h"
+#include "llvm/Support/ThreadPool.h"
 #include "llvm/Support/raw_ostream.h"
 #include <cstdio>
 #include <cstring>
+#include <map>
 #include <string>
+#include <vector>
 
 using namespace llvm;
 using namespace symbolize;
@@ -74,6 +77,24 @@ ClDsymHint("dsym-hint", cl::ZeroOrMore,
            cl::desc("Path to .dSYM bundles to search for debug info for the "
                     "object files"));
 
+static cl::opt<unsigned>
+ClMaxLoadedModules("max-loaded-modules", cl::init(0),
+                   cl::desc("Maximum number of object files kept loaded, the "
+                            "least recently used ones being unloaded first "
+                            "(0 = no limit)"));
+
+static cl::opt<unsigned>
+ClNumThreads("num-threads", cl::init(1),
+             cl::desc("Number of threads symbolizing the addresses. With more "
+                      "than one thread, the input is read in batches, whose "
+                      "results are only printed once the whole batch is "
+                      "symbolized"));
+
+static cl::opt<unsigned>
+ClBatchSize("batch-size", cl::init(4096),
+            cl::desc("Number of input lines symbolized together when "
+                     "--num-threads is greater than one"));
+
 static bool parseCommand(bool &IsData, std::string &ModuleName,
                          uint64_t &ModuleOffset) {
   const char *kDataCmd = "DATA ";
@@ -134,7 +155,8 @@ int main(int argc, char **argv) {
   cl::ParseCommandLineOptions(argc, argv, "llvm-symbolizer\n");
   LLVMSymbolizer::Options Opts(ClPrintFunctions, ClUseSymbolTable,
                                ClPrintInlining, ClDemangle,
-                               ClUseRelativeAddress, ClDefaultArch);
+                               ClUseRelativeAddress, ClDefaultArch,
+                               ClMaxLoadedModules);
   for (const auto &hint : ClDsymHint) {
     if (sys::path::extension(hint) == ".dSYM") {
       Opts.DsymHints.push_back(hint);
@@ -148,11 +170,62 @@ int main(int argc, char **argv) {
   bool IsData = false;
   std::string ModuleName;
   uint64_t ModuleOffset;
-  while (parseCommand(IsData, ModuleName, ModuleOffset)) {
-    std::string Result =
-        IsData ? Symbolizer.symbolizeData(ModuleName, ModuleOffset)
-               : Symbolizer.symbolizeCode(ModuleName, ModuleOffset);
-    outs() << Result << "\n";
+  if (ClNumThreads <= 1) {
+    while (parseCommand(IsData, ModuleName, ModuleOffset)) {
+      std::string Result =
+          IsData ? Symbolizer.symbolizeData(ModuleName, ModuleOffset)
+                 : Symbolizer.symbolizeCode(ModuleName, ModuleOffset);
+      outs() << Result << "\n";
+      outs().flush();
+    }
+    return 0;
+  }
+
+  // Symbolize the batches of input lines on a thread pool, and print the
+  // results in the order of the input.
+  struct Command {
+    bool IsData;
+    std::string ModuleName;
+    uint64_t ModuleOffset;
+    std::string Result;
+  };
+  ThreadPool Pool(ClNumThreads);
+  std::vector<Command> Batch;
+  bool MoreInput = true;
+  while (MoreInput) {
+    Batch.clear();
+    while (Batch.size() < std::max(1u, unsigned(ClBatchSize)) &&
+           (MoreInput = parseCommand(IsData, ModuleName, ModuleOffset)))
+      Batch.push_back({IsData, ModuleName, ModuleOffset, ""});
+    // The debug info of a module is only queried by one thread at a time, so
+    // the code addresses of each module are symbolized together, by a single
+    // lookup.
+    std::map<std::string, std::vector<Command *>> CodeByModule;
+    for (Command &C : Batch) {
+      if (!C.IsData) {
+        CodeByModule[C.ModuleName].push_back(&C);
+        continue;
+      }
+      Pool.async([&Symbolizer, &C]() {
+        C.Result = Symbolizer.symbolizeData(C.ModuleName, C.ModuleOffset);
+      });
+    }
+    for (auto &Module : CodeByModule) {
+      std::vector<Command *> &Commands = Module.second;
+      Pool.async([&Symbolizer, &Commands]() {
+        std::vector<uint64_t> Offsets;
+        for (const Command *C : Commands)
+          Offsets.push_back(C->ModuleOffset);
+        std::vector<std::string> Results =
+            Symbolizer.symbolizeCodeBatch(Commands.front()->ModuleName,
+                                          Offsets);
+        for (size_t I = 0, E = Commands.size(); I != E; ++I)
+          Commands[I]->Result = std::move(Results[I]);
+      });
+    }
+    Pool.wait();
+    for (const Command &C : Batch)
+      outs() << C.Result << "\n";
     outs().flush();
   }
 
@@ -84,6 +84,7 @@ struct LibLTOCodeGenerator : LTOCodeGenerator {
       : LTOCodeGenerator(std::move(Context)) {}
 
   std::unique_ptr<MemoryBuffer> NativeObjectFile;
+  std::vector<const char *> NativeObjectFileNames;
 };
 
 }
@@ -339,6 +340,36 @@ bool lto_codegen_compile_to_file(lto_code_gen_t cg, const char **name) {
       DisableLTOVectorization, sLastErrorString);
 }
 
+void lto_codegen_set_parallelism(lto_code_gen_t cg, unsigned parallelism) {
+  unwrap(cg)->setParallelism(parallelism);
+}
+
+bool lto_codegen_compile_to_files(lto_code_gen_t cg, const char ***names,
+                                  unsigned *num_names) {
+  maybeParseOptions(cg);
+  LibLTOCodeGenerator *CG = unwrap(cg);
+  if (!CG->compile_to_files(CG->NativeObjectFileNames, DisableInline,
+                            DisableGVNLoadPRE, DisableLTOVectorization,
+                            sLastErrorString))
+    return true;
+  *names = CG->NativeObjectFileNames.data();
+  *num_names = CG->NativeObjectFileNames.size();
+  return false;
+}
+
+bool lto_codegen_compile_optimized_to_files(lto_code_gen_t cg,
+                                            const char ***names,
+                                            unsigned *num_names) {
+  maybeParseOptions(cg);
+  LibLTOCodeGenerator *CG = unwrap(cg);
+  if (!CG->compileOptimizedToFiles(CG->NativeObjectFileNames,
+                                   sLastErrorString))
+    return true;
+  *names = CG->NativeObjectFileNames.data();
+  *num_names = CG->NativeObjectFileNames.size();
+  return false;
+}
+
 void lto_codegen_debug_options(lto_code_gen_t cg, const char *opt) {
   unwrap(cg)->setCodeGenDebugOptions(opt);
 }
@@ -354,3 +385,20 @@ void lto_codegen_set_should_embed_uselists(lto_code_gen_t cg,
                                            lto_bool_t ShouldEmbedUselists) {
   unwrap(cg)->setShouldEmbedUselists(ShouldEmbedUselists);
 }
+
+void lto_codegen_set_cache_dir(lto_code_gen_t cg, const char *cache_dir) {
+  unwrap(cg)->setCacheDir(cache_dir ? cache_dir : "");
+}
+
+void lto_codegen_set_cache_pruning_interval(lto_code_gen_t cg, int interval) {
+  unwrap(cg)->setCachePruningInterval(interval);
+}
+
+void lto_codegen_set_cache_entry_expiration(lto_code_gen_t cg,
+                                            unsigned expiration) {
+  unwrap(cg)->setCacheEntryExpiration(expiration);
+}
+
+void lto_codegen_set_cache_max_size(lto_code_gen_t cg, size_t max_size) {
+  unwrap(cg)->setMaxCacheSize(max_size);
+}
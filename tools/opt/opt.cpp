@@ -185,6 +185,11 @@ static cl::opt<bool> PreserveBitcodeUseListOrder(
     cl::desc("Preserve use-list order when writing LLVM bitcode."),
     cl::init(true), cl::Hidden);
 
+static cl::opt<bool>
+EmitFunctionSummary("function-summary",
+                    cl::desc("Emit function summary index"),
+                    cl::init(false));
+
 static cl::opt<bool> PreserveAssemblyUseListOrder(
     "preserve-ll-uselistorder",
     cl::desc("Preserve use-list order when writing LLVM assembly."),
@@ -588,8 +593,8 @@ int main(int argc, char **argv) {
       Passes.add(
           createPrintModulePass(Out->os(), "", PreserveAssemblyUseListOrder));
     else
-      Passes.add(
-          createBitcodeWriterPass(Out->os(), PreserveBitcodeUseListOrder));
+      Passes.add(createBitcodeWriterPass(Out->os(), PreserveBitcodeUseListOrder,
+                                         EmitFunctionSummary));
   }
 
   // Before executing passes, print the final values of the LLVM options.
@@ -8,6 +8,8 @@
 //===----------------------------------------------------------------------===//
 
 #include "llvm/ExecutionEngine/SectionMemoryManager.h"
+#include "llvm/ExecutionEngine/SlabMemoryManager.h"
+#include "llvm/Support/Process.h"
 #include "gtest/gtest.h"
 
 using namespace llvm;
@@ -166,5 +168,103 @@ TEST(MCJITMemoryManagerTest, ManyVariedAllocations) {
   }
 }
 
+TEST(MCJITMemoryManagerTest, SlabBasicAllocations) {
+  std::unique_ptr<SlabMemoryManager> MemMgr(new SlabMemoryManager());
+
+  MemMgr->reserveAllocationSpace(512, 256, 256);
+  uint8_t *code1 = MemMgr->allocateCodeSection(256, 0, 1, "");
+  uint8_t *data1 = MemMgr->allocateDataSection(256, 0, 2, "", true);
+  uint8_t *code2 = MemMgr->allocateCodeSection(256, 0, 3, "");
+  uint8_t *data2 = MemMgr->allocateDataSection(256, 0, 4, "", false);
+
+  EXPECT_NE((uint8_t*)nullptr, code1);
+  EXPECT_NE((uint8_t*)nullptr, code2);
+  EXPECT_NE((uint8_t*)nullptr, data1);
+  EXPECT_NE((uint8_t*)nullptr, data2);
+
+  // The code of the object is contiguous.
+  EXPECT_EQ(code1 + 256, code2);
+
+  for (unsigned i = 0; i < 256; ++i) {
+    code1[i] = 1;
+    code2[i] = 2;
+    data1[i] = 3;
+    data2[i] = 4;
+  }
+
+  for (unsigned i = 0; i < 256; ++i) {
+    EXPECT_EQ(1, code1[i]);
+    EXPECT_EQ(2, code2[i]);
+    EXPECT_EQ(3, data1[i]);
+    EXPECT_EQ(4, data2[i]);
+  }
+
+  std::string Error;
+  EXPECT_FALSE(MemMgr->finalizeMemory(&Error));
+}
+
+TEST(MCJITMemoryManagerTest, SlabManyObjects) {
+  std::unique_ptr<SlabMemoryManager> MemMgr(new SlabMemoryManager());
+  uintptr_t PageSize = sys::Process::getPageSize();
+
+  // Each object is finalized before the next one is loaded: the sections of
+  // an object must not share a page with the code of the previous ones.
+  uint8_t *PrevCode = nullptr;
+  for (unsigned i = 0; i < 100; ++i) {
+    MemMgr->reserveAllocationSpace(64, 32, 32);
+    uint8_t *code = MemMgr->allocateCodeSection(64, 16, 1, "");
+    uint8_t *rodata = MemMgr->allocateDataSection(32, 16, 2, "", true);
+    uint8_t *rwdata = MemMgr->allocateDataSection(32, 16, 3, "", false);
+    ASSERT_NE((uint8_t *)nullptr, code);
+    ASSERT_NE((uint8_t *)nullptr, rodata);
+    ASSERT_NE((uint8_t *)nullptr, rwdata);
+    for (unsigned j = 0; j < 64; ++j)
+      code[j] = i;
+    for (unsigned j = 0; j < 32; ++j)
+      rodata[j] = rwdata[j] = i;
+    if (PrevCode)
+      EXPECT_NE((uintptr_t)PrevCode / PageSize, (uintptr_t)code / PageSize);
+    PrevCode = code;
+    std::string Error;
+    EXPECT_FALSE(MemMgr->finalizeMemory(&Error));
+  }
+
+  // All the objects fit in a single slab.
+  EXPECT_EQ(4u * 1024 * 1024, MemMgr->getAllocator()->getMappedSize());
+}
+
+TEST(MCJITMemoryManagerTest, SlabReuseAfterRelease) {
+  auto Allocator = std::make_shared<SlabAllocator>(64 * 1024);
+
+  uint8_t *FirstCode;
+  {
+    SlabMemoryManager MemMgr(Allocator);
+    MemMgr.reserveAllocationSpace(1024, 0, 0);
+    FirstCode = MemMgr.allocateCodeSection(1024, 0, 1, "");
+    ASSERT_NE((uint8_t *)nullptr, FirstCode);
+    std::string Error;
+    EXPECT_FALSE(MemMgr.finalizeMemory(&Error));
+  }
+
+  // The pages of the destroyed memory manager are reused, writable.
+  SlabMemoryManager MemMgr(Allocator);
+  MemMgr.reserveAllocationSpace(1024, 0, 0);
+  uint8_t *Code = MemMgr.allocateCodeSection(1024, 0, 1, "");
+  EXPECT_EQ(FirstCode, Code);
+  for (unsigned i = 0; i < 1024; ++i)
+    Code[i] = 1;
+
+  // A large section gets a slab of its own, which is released with it.
+  {
+    SlabMemoryManager LargeMemMgr(Allocator);
+    uint8_t *Data = LargeMemMgr.allocateDataSection(0x100000, 0, 1, "", false);
+    ASSERT_NE((uint8_t *)nullptr, Data);
+    for (unsigned i = 0; i < 0x100000; ++i)
+      Data[i] = 2;
+    EXPECT_LE(64u * 1024 + 0x100000, Allocator->getMappedSize());
+  }
+  EXPECT_EQ(64u * 1024, Allocator->getMappedSize());
+}
+
 } // Namespace
 
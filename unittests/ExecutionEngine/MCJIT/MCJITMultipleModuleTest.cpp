@@ -13,6 +13,7 @@
 //===----------------------------------------------------------------------===//
 
 #include "llvm/ExecutionEngine/MCJIT.h"
+#include "llvm/ExecutionEngine/SlabMemoryManager.h"
 #include "MCJITTestBase.h"
 #include "gtest/gtest.h"
 
@@ -166,6 +167,27 @@ TEST_F(MCJITMultipleModuleTest, two_module_extern_case) {
   checkAdd(ptr);
 }
 
+// Module A { Function FA },
+// Module B { Extern FA, Function FB which calls FA },
+// execute FA then FB, with the modules in the slabs of a SlabMemoryManager
+TEST_F(MCJITMultipleModuleTest, two_module_extern_slab_case) {
+  SKIP_UNSUPPORTED_PLATFORM;
+
+  std::unique_ptr<Module> A, B;
+  Function *FA, *FB;
+  createTwoModuleExternCase(A, FA, B, FB);
+
+  MM.reset(new SlabMemoryManager());
+  createJIT(std::move(A));
+  TheJIT->addModule(std::move(B));
+
+  uint64_t ptr = TheJIT->getFunctionAddress(FA->getName().str());
+  checkAdd(ptr);
+
+  ptr = TheJIT->getFunctionAddress(FB->getName().str());
+  checkAdd(ptr);
+}
+
 // Module A { Function FA1, Function FA2 which calls FA1 },
 // Module B { Extern FA1, Function FB which calls FA1 },
 // execute FB then FA2
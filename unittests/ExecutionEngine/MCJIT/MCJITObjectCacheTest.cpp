@@ -11,9 +11,11 @@
 #include "llvm/ADT/SmallVector.h"
 #include "llvm/ADT/StringMap.h"
 #include "llvm/ADT/StringSet.h"
+#include "llvm/ExecutionEngine/FileObjectCache.h"
 #include "llvm/ExecutionEngine/MCJIT.h"
 #include "llvm/ExecutionEngine/ObjectCache.h"
 #include "llvm/ExecutionEngine/SectionMemoryManager.h"
+#include "llvm/Support/FileSystem.h"
 #include "gtest/gtest.h"
 
 using namespace llvm;
@@ -76,6 +78,37 @@ private:
   bool                            DuplicateInserted;
 };
 
+class CountingFileObjectCache : public FileObjectCache {
+public:
+  CountingFileObjectCache(StringRef Path, const TargetMachine &TM)
+      : FileObjectCache(Path, TM), NumCompiled(0) {}
+
+  void notifyObjectCompiled(const Module *M, MemoryBufferRef Obj) override {
+    ++NumCompiled;
+    FileObjectCache::notifyObjectCompiled(M, Obj);
+  }
+
+  unsigned NumCompiled;
+};
+
+static unsigned countCachedObjects(StringRef Dir) {
+  unsigned Count = 0;
+  std::error_code EC;
+  for (sys::fs::directory_iterator I(Dir, EC), E; I != E && !EC;
+       I.increment(EC))
+    if (StringRef(I->path()).endswith(".o"))
+      ++Count;
+  return Count;
+}
+
+static void removeCacheDirectory(StringRef Dir) {
+  std::error_code EC;
+  for (sys::fs::directory_iterator I(Dir, EC), E; I != E && !EC;
+       I.increment(EC))
+    sys::fs::remove(I->path());
+  sys::fs::remove(Dir);
+}
+
 class MCJITObjectCacheTest : public testing::Test, public MCJITTestBase {
 protected:
 
@@ -228,5 +261,47 @@ TEST_F(MCJITObjectCacheTest, VerifyNonLoadFromCache) {
   EXPECT_FALSE(Cache->wereDuplicatesInserted());
 }
 
-} // Namespace
+TEST_F(MCJITObjectCacheTest, FileObjectCache) {
+  SKIP_UNSUPPORTED_PLATFORM;
 
+  SmallString<128> CacheDir;
+  ASSERT_FALSE(
+      sys::fs::createUniqueDirectory("MCJITObjectCacheTest", CacheDir));
+
+  // The first compilation stores the object.
+  createJIT(std::move(M));
+  std::unique_ptr<CountingFileObjectCache> Cache(
+      new CountingFileObjectCache(CacheDir, *TheJIT->getTargetMachine()));
+  TheJIT->setObjectCache(Cache.get());
+  compileAndRun();
+  EXPECT_EQ(1u, Cache->NumCompiled);
+  EXPECT_EQ(1u, countCachedObjects(CacheDir));
+
+  // An identical module is loaded from the directory, even by another cache.
+  TheJIT.reset();
+  MM.reset(new SectionMemoryManager());
+  M.reset(createEmptyModule("<main>"));
+  Main = insertMainFunction(M.get(), OriginalRC);
+  createJIT(std::move(M));
+  Cache.reset(
+      new CountingFileObjectCache(CacheDir, *TheJIT->getTargetMachine()));
+  TheJIT->setObjectCache(Cache.get());
+  compileAndRun();
+  EXPECT_EQ(0u, Cache->NumCompiled);
+
+  // A module with the same name but different contents is compiled.
+  TheJIT.reset();
+  MM.reset(new SectionMemoryManager());
+  M.reset(createEmptyModule("<main>"));
+  Main = insertMainFunction(M.get(), ReplacementRC);
+  createJIT(std::move(M));
+  TheJIT->setObjectCache(Cache.get());
+  compileAndRun(ReplacementRC);
+  EXPECT_EQ(1u, Cache->NumCompiled);
+  EXPECT_EQ(2u, countCachedObjects(CacheDir));
+
+  TheJIT.reset();
+  removeCacheDirectory(CacheDir);
+}
+
+} // Namespace
@@ -8,9 +8,11 @@
 //===----------------------------------------------------------------------===//
 
 #include "llvm/MC/StringTableBuilder.h"
+#include "llvm/ADT/Twine.h"
 #include "llvm/Support/Endian.h"
 #include "gtest/gtest.h"
 #include <string>
+#include <vector>
 
 using namespace llvm;
 
@@ -68,4 +70,37 @@ TEST(StringTableBuilderTest, BasicWinCOFF) {
   EXPECT_EQ(23U, B.getOffset("river horse"));
 }
 
+TEST(StringTableBuilderTest, ParallelELF) {
+  // Enough strings to be sorted in parallel, many of them suffixes of others
+  // and some of them one or two characters long.
+  std::vector<std::string> Strings;
+  for (unsigned I = 0; I != 3 * StringTableBuilder::ParallelSortThreshold;
+       ++I) {
+    std::string S = (Twine(I % 97) + "_ZN4llvm" + Twine(I) + "E").str();
+    Strings.push_back(S);
+    Strings.push_back(S.substr(S.size() / 2));
+  }
+  for (char C = 'A'; C <= 'Z'; ++C) {
+    Strings.push_back(std::string(1, C));
+    Strings.push_back(std::string(2, C));
+  }
+
+  StringTableBuilder Serial, Parallel;
+  for (const std::string &S : Strings) {
+    Serial.add(S);
+    Parallel.add(S);
+  }
+  Serial.finalize(StringTableBuilder::ELF);
+  Parallel.finalize(StringTableBuilder::ELF, 4);
+
+  EXPECT_EQ(Serial.data(), Parallel.data());
+  StringRef Data = Parallel.data();
+  for (const std::string &S : Strings) {
+    size_t Offset = Parallel.getOffset(S);
+    EXPECT_EQ(Serial.getOffset(S), Offset);
+    EXPECT_EQ(S, Data.substr(Offset, S.size()));
+    EXPECT_EQ('\0', Data[Offset + S.size()]);
+  }
+}
+
 }
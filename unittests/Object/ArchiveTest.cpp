@@ -0,0 +1,213 @@
+//===- ArchiveTest.cpp - Tests for the archive symbol lookup -------------===//
+//
+//                     The LLVM Compiler Infrastructure
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+
+#include "llvm/Object/Archive.h"
+#include "llvm/ADT/STLExtras.h"
+#include "llvm/Support/Endian.h"
+#include "llvm/Support/MathExtras.h"
+#include "gtest/gtest.h"
+#include <string>
+
+using namespace llvm;
+using namespace object;
+
+namespace {
+
+// Append the header of an archive member.
+void writeHeader(std::string &Out, StringRef Name, size_t Size) {
+  std::string Header = Name.str();
+  Header.resize(16, ' ');
+  Header += "0           0     0     644     ";
+  std::string SizeStr = std::to_string(Size);
+  SizeStr.resize(10, ' ');
+  Header += SizeStr + "`\n";
+  Out += Header;
+}
+
+// Append a member with its contents, padded to an even size.
+void writeMember(std::string &Out, StringRef Name, StringRef Contents,
+                 bool Thin = false) {
+  writeHeader(Out, Name, Contents.size());
+  if (Thin)
+    return;
+  Out += Contents;
+  if (Out.size() & 1)
+    Out += '\n';
+}
+
+// Append a BSD member, whose name follows the header.
+void writeBSDMember(std::string &Out, StringRef Name, StringRef Contents) {
+  std::string PaddedName = Name.str();
+  PaddedName.resize(RoundUpToAlignment(Name.size() + 1, 4), '\0');
+  writeHeader(Out, "#1/" + std::to_string(PaddedName.size()),
+              PaddedName.size() + Contents.size());
+  Out += PaddedName;
+  Out += Contents;
+  if (Out.size() & 1)
+    Out += '\n';
+}
+
+std::string writeBE32(uint32_t V) {
+  char Buf[4];
+  support::endian::write32be(Buf, V);
+  return std::string(Buf, 4);
+}
+
+std::string writeLE32(uint32_t V) {
+  char Buf[4];
+  support::endian::write32le(Buf, V);
+  return std::string(Buf, 4);
+}
+
+struct Definition {
+  const char *Symbol;
+  unsigned Member;
+};
+
+// The symbols of the archives, by the index of the member that defines them.
+// "dup" is defined twice, and the first definition must win.
+const Definition Definitions[] = {
+  {"foo", 0}, {"bar", 1}, {"dup", 1}, {"baz", 2}, {"dup", 2}};
+const char *const MemberNames[] = {"a.o", "b.o", "c.o"};
+const unsigned NumMembers = 3;
+
+// Build a GNU archive, or a thin one, with a symbol table.
+std::string makeGNUArchive(bool Thin) {
+  std::string Members;
+  std::vector<uint32_t> Offsets;
+  for (const char *Name : MemberNames) {
+    Offsets.push_back(Members.size());
+    writeMember(Members, std::string(Name) + "/", "contents of member\n",
+                Thin);
+  }
+
+  std::string SymTab = writeBE32(array_lengthof(Definitions));
+  std::string Names;
+  for (const Definition &D : Definitions) {
+    SymTab += writeBE32(0);
+    Names += std::string(D.Symbol) + '\0';
+  }
+  SymTab += Names;
+
+  std::string Archive = Thin ? "!<thin>\n" : "!<arch>\n";
+  writeMember(Archive, "/", SymTab);
+  // The offsets of the members are from the start of the archive, which is
+  // known only now.
+  for (unsigned I = 0; I != array_lengthof(Definitions); ++I) {
+    uint32_t Offset = Archive.size() + Offsets[Definitions[I].Member];
+    std::string Encoded = writeBE32(Offset);
+    Archive.replace(8 + 60 + 4 + I * 4, 4, Encoded);
+  }
+  return Archive + Members;
+}
+
+// Build a BSD archive with a __.SYMDEF symbol table.
+std::string makeBSDArchive() {
+  std::string Names;
+  std::vector<uint32_t> NameOffsets;
+  for (const Definition &D : Definitions) {
+    NameOffsets.push_back(Names.size());
+    Names += std::string(D.Symbol) + '\0';
+  }
+  while (Names.size() % 4)
+    Names += '\0';
+
+  unsigned NumRanlibs = array_lengthof(Definitions);
+  size_t SymDefSize = 4 + NumRanlibs * 8 + 4 + Names.size();
+  // The header and the name "__.SYMDEF" padded to 12 bytes.
+  size_t MembersStart = 8 + 60 + 12 + SymDefSize;
+  std::vector<uint32_t> Offsets;
+  std::string Members;
+  for (const char *Name : MemberNames) {
+    Offsets.push_back(MembersStart + Members.size());
+    writeBSDMember(Members, Name, "contents of member\n");
+  }
+
+  std::string SymDef = writeLE32(NumRanlibs * 8);
+  for (unsigned I = 0; I != NumRanlibs; ++I)
+    SymDef += writeLE32(NameOffsets[I]) +
+              writeLE32(Offsets[Definitions[I].Member]);
+  SymDef += writeLE32(Names.size()) + Names;
+
+  std::string Archive = "!<arch>\n";
+  writeBSDMember(Archive, "__.SYMDEF", SymDef);
+  return Archive + Members;
+}
+
+void checkLookups(const Archive &A,
+                  ArrayRef<Archive::child_iterator> Children) {
+  EXPECT_TRUE(A.findSym("foo") == Children[0]);
+  EXPECT_TRUE(A.findSym("bar") == Children[1]);
+  EXPECT_TRUE(A.findSym("baz") == Children[2]);
+  EXPECT_TRUE(A.findSym("dup") == Children[1]);
+  EXPECT_TRUE(A.findSym("missing") == A.child_end());
+  EXPECT_TRUE(A.findSym("fo") == A.child_end());
+
+  StringRef Names[] = {"baz", "missing", "foo", "dup", "baz"};
+  SmallVector<Archive::child_iterator, 8> Members;
+  A.findSyms(Names, Members);
+  ASSERT_EQ(array_lengthof(Names), Members.size());
+  EXPECT_TRUE(Members[0] == Children[2]);
+  EXPECT_TRUE(Members[1] == A.child_end());
+  EXPECT_TRUE(Members[2] == Children[0]);
+  EXPECT_TRUE(Members[3] == Children[1]);
+  EXPECT_TRUE(Members[4] == Children[2]);
+
+  ErrorOr<StringRef> NameOrErr = Members[0]->getName();
+  ASSERT_FALSE(NameOrErr.getError());
+  EXPECT_EQ("c.o", *NameOrErr);
+}
+
+/// Check the lookups in the archive \p Buffer, first by scanning its symbol
+/// table, then through its index.
+void checkLookups(StringRef Buffer, Archive::Kind Kind) {
+  ErrorOr<std::unique_ptr<Archive>> ArchiveOrErr =
+      Archive::create(MemoryBufferRef(Buffer, "test.a"));
+  ASSERT_FALSE(ArchiveOrErr.getError());
+  Archive &A = **ArchiveOrErr;
+  EXPECT_EQ(Kind, A.kind());
+  ASSERT_TRUE(A.hasSymbolTable());
+
+  std::vector<Archive::child_iterator> Children;
+  for (Archive::child_iterator I = A.child_begin(), E = A.child_end(); I != E;
+       ++I)
+    Children.push_back(I);
+  ASSERT_EQ(NumMembers, Children.size());
+
+  checkLookups(A, Children);
+  A.buildSymbolIndex();
+  checkLookups(A, Children);
+}
+
+TEST(ArchiveTest, FindSymGNU) {
+  checkLookups(makeGNUArchive(/*Thin=*/false), Archive::K_GNU);
+}
+
+TEST(ArchiveTest, FindSymThin) {
+  checkLookups(makeGNUArchive(/*Thin=*/true), Archive::K_GNU);
+}
+
+TEST(ArchiveTest, FindSymBSD) {
+  checkLookups(makeBSDArchive(), Archive::K_BSD);
+}
+
+TEST(ArchiveTest, FindSymWithoutSymbolTable) {
+  std::string Buffer = "!<arch>\n";
+  writeMember(Buffer, "a.o/", "contents of member\n");
+  ErrorOr<std::unique_ptr<Archive>> ArchiveOrErr =
+      Archive::create(MemoryBufferRef(Buffer, "test.a"));
+  ASSERT_FALSE(ArchiveOrErr.getError());
+  Archive &A = **ArchiveOrErr;
+  EXPECT_FALSE(A.hasSymbolTable());
+  EXPECT_TRUE(A.findSym("foo") == A.child_end());
+  A.buildSymbolIndex();
+  EXPECT_TRUE(A.findSym("foo") == A.child_end());
+}
+
+} // end anonymous namespace
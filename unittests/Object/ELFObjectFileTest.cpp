@@ -0,0 +1,373 @@
+//===- ELFObjectFileTest.cpp - Tests for the ELF lookups by name ----------===//
+//
+//                     The LLVM Compiler Infrastructure
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+
+#include "llvm/Object/ELFObjectFile.h"
+#include "llvm/ADT/STLExtras.h"
+#include "llvm/Support/EndianStream.h"
+#include "llvm/Support/MathExtras.h"
+#include "llvm/Support/ThreadPool.h"
+#include "llvm/Support/raw_ostream.h"
+#include "gtest/gtest.h"
+#include <algorithm>
+#include <string>
+#include <vector>
+
+using namespace llvm;
+using namespace object;
+
+namespace {
+
+enum HashKind { NoHash, SysVHash, GnuHash };
+
+struct TestSymbol {
+  std::string Name;
+  bool Defined;
+  uint64_t Value;
+};
+
+typedef support::endian::Writer<support::little> LEWriter;
+
+// Append the names to a string table and return their offsets.
+std::vector<uint32_t> addNames(std::string &StrTab,
+                               ArrayRef<TestSymbol> Symbols) {
+  std::vector<uint32_t> Offsets;
+  for (const TestSymbol &Sym : Symbols) {
+    Offsets.push_back(StrTab.size());
+    StrTab += Sym.Name;
+    StrTab += '\0';
+  }
+  return Offsets;
+}
+
+// Write a symbol table, with the null symbol first.
+std::string writeSymbols(ArrayRef<TestSymbol> Symbols,
+                         ArrayRef<uint32_t> NameOffsets) {
+  std::string Data;
+  raw_string_ostream OS(Data);
+  OS << std::string(sizeof(ELF::Elf64_Sym), '\0');
+  for (unsigned I = 0, E = Symbols.size(); I != E; ++I) {
+    LEWriter(OS).write<uint32_t>(NameOffsets[I]);
+    LEWriter(OS).write<uint8_t>((ELF::STB_GLOBAL << 4) | ELF::STT_FUNC);
+    LEWriter(OS).write<uint8_t>(0);
+    LEWriter(OS).write<uint16_t>(Symbols[I].Defined ? 1 : ELF::SHN_UNDEF);
+    LEWriter(OS).write<uint64_t>(Symbols[I].Value);
+    LEWriter(OS).write<uint64_t>(0);
+  }
+  return OS.str();
+}
+
+// Write a SysV hash table of the dynamic symbols, with few buckets so that
+// the chains are long.
+std::string writeSysVHash(ArrayRef<TestSymbol> Symbols) {
+  const uint32_t NumBuckets = 3;
+  uint32_t NumChains = Symbols.size() + 1;
+  std::vector<uint32_t> Buckets(NumBuckets), Chains(NumChains);
+  for (uint32_t I = 1; I != NumChains; ++I) {
+    uint32_t Bucket = elf_hash(Symbols[I - 1].Name) % NumBuckets;
+    Chains[I] = Buckets[Bucket];
+    Buckets[Bucket] = I;
+  }
+
+  std::string Data;
+  raw_string_ostream OS(Data);
+  LEWriter(OS).write<uint32_t>(NumBuckets);
+  LEWriter(OS).write<uint32_t>(NumChains);
+  for (uint32_t Bucket : Buckets)
+    LEWriter(OS).write<uint32_t>(Bucket);
+  for (uint32_t Chain : Chains)
+    LEWriter(OS).write<uint32_t>(Chain);
+  return OS.str();
+}
+
+const uint32_t GnuHashBuckets = 4;
+
+// Sort the dynamic symbols as the GNU hash table needs them: the undefined
+// symbols first, then the defined ones by bucket.
+void sortForGnuHash(std::vector<TestSymbol> &Symbols) {
+  std::stable_sort(Symbols.begin(), Symbols.end(),
+                   [](const TestSymbol &A, const TestSymbol &B) {
+    if (A.Defined != B.Defined)
+      return !A.Defined;
+    return A.Defined && gnu_hash(A.Name) % GnuHashBuckets <
+                            gnu_hash(B.Name) % GnuHashBuckets;
+  });
+}
+
+// Write a GNU hash table of the symbols sorted by sortForGnuHash.
+std::string writeGnuHash(ArrayRef<TestSymbol> Symbols) {
+  uint32_t SymOffset = 1;
+  while (SymOffset <= Symbols.size() && !Symbols[SymOffset - 1].Defined)
+    ++SymOffset;
+
+  const uint32_t BloomShift = 6;
+  uint64_t Bloom = 0;
+  std::vector<uint32_t> Buckets(GnuHashBuckets), Chains;
+  for (uint32_t I = SymOffset; I <= Symbols.size(); ++I) {
+    uint32_t Hash = gnu_hash(Symbols[I - 1].Name);
+    Bloom |= uint64_t(1) << (Hash % 64);
+    Bloom |= uint64_t(1) << ((Hash >> BloomShift) % 64);
+    uint32_t Bucket = Hash % GnuHashBuckets;
+    if (!Buckets[Bucket])
+      Buckets[Bucket] = I;
+    bool Last = I == Symbols.size() ||
+                gnu_hash(Symbols[I].Name) % GnuHashBuckets != Bucket;
+    Chains.push_back((Hash & ~1U) | Last);
+  }
+
+  std::string Data;
+  raw_string_ostream OS(Data);
+  LEWriter(OS).write<uint32_t>(GnuHashBuckets);
+  LEWriter(OS).write<uint32_t>(SymOffset);
+  LEWriter(OS).write<uint32_t>(1);
+  LEWriter(OS).write<uint32_t>(BloomShift);
+  LEWriter(OS).write<uint64_t>(Bloom);
+  for (uint32_t Bucket : Buckets)
+    LEWriter(OS).write<uint32_t>(Bucket);
+  for (uint32_t Chain : Chains)
+    LEWriter(OS).write<uint32_t>(Chain);
+  return OS.str();
+}
+
+struct TestSection {
+  std::string Name;
+  uint32_t Type;
+  uint32_t Link;
+  uint64_t EntSize;
+  std::string Contents;
+};
+
+// Write a 64-bit little-endian ELF shared object with the sections, after
+// the null section.
+std::string writeELF(ArrayRef<TestSection> Sections) {
+  std::string ShStrTab(1, '\0');
+  std::vector<uint32_t> NameOffsets;
+  for (const TestSection &Sec : Sections) {
+    NameOffsets.push_back(ShStrTab.size());
+    ShStrTab += Sec.Name + '\0';
+  }
+  NameOffsets.push_back(ShStrTab.size());
+  ShStrTab += std::string(".shstrtab") + '\0';
+  std::vector<TestSection> All(Sections.begin(), Sections.end());
+  All.push_back({".shstrtab", ELF::SHT_STRTAB, 0, 0, ShStrTab});
+
+  std::string Data;
+  raw_string_ostream OS(Data);
+  std::vector<uint64_t> Offsets;
+  uint64_t Offset = sizeof(ELF::Elf64_Ehdr);
+  for (const TestSection &Sec : All) {
+    Offsets.push_back(Offset);
+    Offset = RoundUpToAlignment(Offset + Sec.Contents.size(), 8);
+  }
+  uint64_t SectionTableOffset = Offset;
+
+  // The header.
+  OS << ELF::ElfMagic;
+  LEWriter(OS).write<uint8_t>(ELF::ELFCLASS64);
+  LEWriter(OS).write<uint8_t>(ELF::ELFDATA2LSB);
+  LEWriter(OS).write<uint8_t>(ELF::EV_CURRENT);
+  OS << std::string(ELF::EI_NIDENT - ELF::EI_OSABI, '\0');
+  LEWriter(OS).write<uint16_t>(ELF::ET_DYN);
+  LEWriter(OS).write<uint16_t>(ELF::EM_X86_64);
+  LEWriter(OS).write<uint32_t>(ELF::EV_CURRENT);
+  LEWriter(OS).write<uint64_t>(0);
+  LEWriter(OS).write<uint64_t>(0);
+  LEWriter(OS).write<uint64_t>(SectionTableOffset);
+  LEWriter(OS).write<uint32_t>(0);
+  LEWriter(OS).write<uint16_t>(sizeof(ELF::Elf64_Ehdr));
+  LEWriter(OS).write<uint16_t>(0);
+  LEWriter(OS).write<uint16_t>(0);
+  LEWriter(OS).write<uint16_t>(sizeof(ELF::Elf64_Shdr));
+  LEWriter(OS).write<uint16_t>(All.size() + 1);
+  LEWriter(OS).write<uint16_t>(All.size());
+
+  // The contents of the sections.
+  for (unsigned I = 0, E = All.size(); I != E; ++I) {
+    OS << std::string(Offsets[I] - OS.tell(), '\0');
+    OS << All[I].Contents;
+  }
+  OS << std::string(SectionTableOffset - OS.tell(), '\0');
+
+  // The section table.
+  OS << std::string(sizeof(ELF::Elf64_Shdr), '\0');
+  for (unsigned I = 0, E = All.size(); I != E; ++I) {
+    LEWriter(OS).write<uint32_t>(NameOffsets[I]);
+    LEWriter(OS).write<uint32_t>(All[I].Type);
+    LEWriter(OS).write<uint64_t>(0);
+    LEWriter(OS).write<uint64_t>(0);
+    LEWriter(OS).write<uint64_t>(Offsets[I]);
+    LEWriter(OS).write<uint64_t>(All[I].Contents.size());
+    LEWriter(OS).write<uint32_t>(All[I].Link);
+    LEWriter(OS).write<uint32_t>(0);
+    LEWriter(OS).write<uint64_t>(8);
+    LEWriter(OS).write<uint64_t>(All[I].EntSize);
+  }
+  return OS.str();
+}
+
+// Write an object with the dynamic and the static symbols, and a hash table
+// of the dynamic symbols of the given kind. The dynamic symbols are sorted
+// for the GNU hash table.
+std::string writeObject(std::vector<TestSymbol> &DynSyms,
+                        ArrayRef<TestSymbol> StaticSyms, HashKind Kind) {
+  if (Kind == GnuHash)
+    sortForGnuHash(DynSyms);
+
+  std::string DynStr(1, '\0'), StrTab(1, '\0');
+  std::vector<uint32_t> DynNames = addNames(DynStr, DynSyms);
+  std::vector<uint32_t> StaticNames = addNames(StrTab, StaticSyms);
+
+  // Sections 1 to 6.
+  std::vector<TestSection> Sections;
+  Sections.push_back({".text", ELF::SHT_PROGBITS, 0, 0, "\xc3"});
+  Sections.push_back({".dynsym", ELF::SHT_DYNSYM, 3, sizeof(ELF::Elf64_Sym),
+                      writeSymbols(DynSyms, DynNames)});
+  Sections.push_back({".dynstr", ELF::SHT_STRTAB, 0, 0, DynStr});
+  Sections.push_back({".symtab", ELF::SHT_SYMTAB, 5, sizeof(ELF::Elf64_Sym),
+                      writeSymbols(StaticSyms, StaticNames)});
+  Sections.push_back({".strtab", ELF::SHT_STRTAB, 0, 0, StrTab});
+  if (Kind == SysVHash)
+    Sections.push_back({".hash", ELF::SHT_HASH, 2, 4, writeSysVHash(DynSyms)});
+  else if (Kind == GnuHash)
+    Sections.push_back(
+        {".gnu.hash", ELF::SHT_GNU_HASH, 2, 0, writeGnuHash(DynSyms)});
+  else
+    Sections.push_back({".comment", ELF::SHT_PROGBITS, 0, 0, "test"});
+  return writeELF(Sections);
+}
+
+StringRef getName(const SymbolRef &Sym) {
+  StringRef Name;
+  if (Sym.getName(Name))
+    return "<error>";
+  return Name;
+}
+
+TEST(ELFObjectFileTest, HashFunctions) {
+  EXPECT_EQ(0U, elf_hash(""));
+  EXPECT_EQ(0x077905a6U, elf_hash("printf"));
+  EXPECT_EQ(5381U, gnu_hash(""));
+  EXPECT_EQ(0x156b2bb8U, gnu_hash("printf"));
+}
+
+TEST(ELFObjectFileTest, FindDynamicSymbol) {
+  for (HashKind Kind : {NoHash, SysVHash, GnuHash}) {
+    std::vector<TestSymbol> DynSyms;
+    DynSyms.push_back({"undefined", false, 0});
+    for (unsigned I = 0; I != 40; ++I)
+      DynSyms.push_back({"sym" + std::to_string(I), true, 0x1000 + I});
+    DynSyms.push_back({"imported", false, 0});
+    std::string Data = writeObject(DynSyms, {}, Kind);
+
+    ErrorOr<std::unique_ptr<ObjectFile>> ObjOrErr =
+        ObjectFile::createObjectFile(MemoryBufferRef(Data, "test.so"));
+    ASSERT_TRUE(!!ObjOrErr) << "hash kind " << Kind;
+    auto *Obj = dyn_cast<ELFObjectFileBase>(ObjOrErr->get());
+    ASSERT_TRUE(Obj != nullptr);
+
+    auto End = Obj->getDynamicSymbolIterators().end();
+    for (unsigned I = 0; I != 40; ++I) {
+      std::string Name = "sym" + std::to_string(I);
+      elf_symbol_iterator Sym = Obj->findSymbol(Name, true);
+      ASSERT_TRUE(Sym != End) << Name << " with hash kind " << Kind;
+      EXPECT_EQ(Name, getName(*Sym));
+      EXPECT_EQ(0x1000U + I, Sym->getValue());
+    }
+
+    // The undefined symbols and the missing ones are not found.
+    EXPECT_TRUE(Obj->findSymbol("undefined", true) == End);
+    EXPECT_TRUE(Obj->findSymbol("imported", true) == End);
+    EXPECT_TRUE(Obj->findSymbol("sym40", true) == End);
+    EXPECT_TRUE(Obj->findSymbol("", true) == End);
+  }
+}
+
+TEST(ELFObjectFileTest, FindStaticSymbol) {
+  std::vector<TestSymbol> DynSyms;
+  DynSyms.push_back({"dynamic", true, 1});
+  std::vector<TestSymbol> StaticSyms;
+  StaticSyms.push_back({"undefined", false, 0});
+  StaticSyms.push_back({"first", true, 0x10});
+  StaticSyms.push_back({"duplicate", true, 0x20});
+  StaticSyms.push_back({"duplicate", true, 0x30});
+  StaticSyms.push_back({"last", true, 0x40});
+  std::string Data = writeObject(DynSyms, StaticSyms, GnuHash);
+
+  ErrorOr<std::unique_ptr<ObjectFile>> ObjOrErr =
+      ObjectFile::createObjectFile(MemoryBufferRef(Data, "test.so"));
+  ASSERT_TRUE(!!ObjOrErr);
+  auto *Obj = cast<ELFObjectFileBase>(ObjOrErr->get());
+  auto End = Obj->symbols().end();
+
+  EXPECT_EQ(0x10U, Obj->findSymbol("first", false)->getValue());
+  EXPECT_EQ(0x40U, Obj->findSymbol("last", false)->getValue());
+  // The first of the symbols with the same name is found.
+  EXPECT_EQ(0x20U, Obj->findSymbol("duplicate", false)->getValue());
+  EXPECT_TRUE(Obj->findSymbol("undefined", false) == End);
+  EXPECT_TRUE(Obj->findSymbol("dynamic", false) == End);
+  EXPECT_EQ("dynamic", getName(*Obj->findSymbol("dynamic", true)));
+}
+
+TEST(ELFObjectFileTest, FindSection) {
+  std::vector<TestSymbol> DynSyms;
+  std::string Data = writeObject(DynSyms, {}, SysVHash);
+
+  ErrorOr<std::unique_ptr<ObjectFile>> ObjOrErr =
+      ObjectFile::createObjectFile(MemoryBufferRef(Data, "test.so"));
+  ASSERT_TRUE(!!ObjOrErr);
+  auto *Obj = cast<ELFObjectFileBase>(ObjOrErr->get());
+
+  for (StringRef Name : {".text", ".dynsym", ".hash", ".shstrtab"}) {
+    section_iterator Sec = Obj->findSection(Name);
+    ASSERT_TRUE(Sec != Obj->section_end()) << Name;
+    StringRef SecName;
+    ASSERT_FALSE(Sec->getName(SecName));
+    EXPECT_EQ(Name, SecName);
+  }
+  StringRef Contents;
+  ASSERT_FALSE(Obj->findSection(".text")->getContents(Contents));
+  EXPECT_EQ("\xc3", Contents);
+  EXPECT_TRUE(Obj->findSection(".gnu.hash") == Obj->section_end());
+  EXPECT_TRUE(Obj->findSection("") == Obj->section_end());
+}
+
+TEST(ELFObjectFileTest, ConcurrentLookups) {
+  std::vector<TestSymbol> DynSyms;
+  std::vector<TestSymbol> StaticSyms;
+  for (unsigned I = 0; I != 100; ++I)
+    StaticSyms.push_back({"sym" + std::to_string(I), true, 0x1000 + I});
+  std::string Data = writeObject(DynSyms, StaticSyms, NoHash);
+
+  ErrorOr<std::unique_ptr<ObjectFile>> ObjOrErr =
+      ObjectFile::createObjectFile(MemoryBufferRef(Data, "test.so"));
+  ASSERT_TRUE(!!ObjOrErr);
+  auto *Obj = cast<ELFObjectFileBase>(ObjOrErr->get());
+
+  // The indexes are built by the first lookups, which race with each other.
+  const unsigned NumLookups = 8;
+  std::vector<uint64_t> Values(NumLookups);
+  std::vector<char> FoundSection(NumLookups, false);
+  {
+    ThreadPool Pool(4);
+    for (unsigned I = 0; I != NumLookups; ++I)
+      Pool.async([&, I]() {
+        elf_symbol_iterator Sym =
+            Obj->findSymbol("sym" + std::to_string(I * 10), false);
+        if (Sym != Obj->symbols().end())
+          Values[I] = Sym->getValue();
+        FoundSection[I] = Obj->findSection(".symtab") != Obj->section_end();
+      });
+    Pool.wait();
+  }
+  for (unsigned I = 0; I != NumLookups; ++I) {
+    EXPECT_EQ(0x1000U + I * 10, Values[I]);
+    EXPECT_TRUE(FoundSection[I]);
+  }
+}
+
+}
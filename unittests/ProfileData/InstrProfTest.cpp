@@ -101,4 +101,47 @@ TEST_F(InstrProfTest, get_max_function_count) {
   ASSERT_EQ(1ULL << 63, Reader->getMaximumFunctionCount());
 }
 
+TEST_F(InstrProfTest, merge_records_from_writer) {
+  Writer.addFunctionCounts("foo", 0x1234, {1, 2});
+  Writer.addFunctionCounts("bar", 0x1234, {3});
+
+  InstrProfWriter Writer2;
+  Writer2.addFunctionCounts("foo", 0x1234, {10, 20});
+  Writer2.addFunctionCounts("foo", 0x1235, {5});
+  Writer2.addFunctionCounts("bar", 0x1234, {1, 1});
+  Writer2.addFunctionCounts("baz", 0, {100});
+
+  std::vector<std::pair<StringRef, std::error_code>> Warnings;
+  Writer.mergeRecordsFromWriter(
+      std::move(Writer2), [&](StringRef FunctionName, std::error_code EC) {
+        Warnings.push_back(std::make_pair(FunctionName, EC));
+      });
+  ASSERT_EQ(1U, Warnings.size());
+  ASSERT_EQ(StringRef("bar"), Warnings[0].first);
+  ASSERT_TRUE(ErrorEquals(instrprof_error::count_mismatch, Warnings[0].second));
+
+  auto Profile = Writer.writeBuffer();
+  readProfile(std::move(Profile));
+
+  std::vector<uint64_t> Counts;
+  ASSERT_TRUE(NoError(Reader->getFunctionCounts("foo", 0x1234, Counts)));
+  ASSERT_EQ(2U, Counts.size());
+  ASSERT_EQ(11U, Counts[0]);
+  ASSERT_EQ(22U, Counts[1]);
+
+  ASSERT_TRUE(NoError(Reader->getFunctionCounts("foo", 0x1235, Counts)));
+  ASSERT_EQ(1U, Counts.size());
+  ASSERT_EQ(5U, Counts[0]);
+
+  ASSERT_TRUE(NoError(Reader->getFunctionCounts("bar", 0x1234, Counts)));
+  ASSERT_EQ(1U, Counts.size());
+  ASSERT_EQ(3U, Counts[0]);
+
+  ASSERT_TRUE(NoError(Reader->getFunctionCounts("baz", 0, Counts)));
+  ASSERT_EQ(1U, Counts.size());
+  ASSERT_EQ(100U, Counts[0]);
+
+  ASSERT_EQ(100U, Reader->getMaximumFunctionCount());
+}
+
 } // end anonymous namespace
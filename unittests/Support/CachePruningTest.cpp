@@ -0,0 +1,121 @@
+//===- unittests/Support/CachePruningTest.cpp - CachePruning tests --------===//
+//
+//                     The LLVM Compiler Infrastructure
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+
+#include "llvm/Support/CachePruning.h"
+#include "llvm/Support/FileSystem.h"
+#include "llvm/Support/Path.h"
+#include "llvm/Support/Process.h"
+#include "llvm/Support/raw_ostream.h"
+#include "gtest/gtest.h"
+
+using namespace llvm;
+
+namespace {
+
+class CachePruningTest : public testing::Test {
+protected:
+  void SetUp() override {
+    ASSERT_FALSE(sys::fs::createUniqueDirectory("CachePruningTestDir", Dir));
+  }
+
+  void TearDown() override {
+    std::error_code EC;
+    for (sys::fs::directory_iterator File(Dir, EC), FileEnd;
+         File != FileEnd && !EC; File.increment(EC))
+      sys::fs::remove(File->path());
+    sys::fs::remove(Dir);
+  }
+
+  std::string getPath(StringRef Name) {
+    SmallString<128> Path(Dir);
+    sys::path::append(Path, Name);
+    return Path.str();
+  }
+
+  /// Write a file of 100 bytes last modified \p Age seconds ago.
+  void writeFile(StringRef Name, unsigned Age) {
+    int FD;
+    ASSERT_FALSE(sys::fs::openFileForWrite(getPath(Name), FD,
+                                           sys::fs::F_None));
+    {
+      raw_fd_ostream OS(FD, /*shouldClose=*/false);
+      OS << std::string(100, 'x');
+    }
+    sys::TimeValue Time = sys::TimeValue::now();
+    Time -= sys::TimeValue(sys::TimeValue::SecondsType(Age));
+    ASSERT_FALSE(sys::fs::setLastModificationAndAccessTime(FD, Time));
+    sys::Process::SafelyCloseFileDescriptor(FD);
+  }
+
+  bool exists(StringRef Name) { return sys::fs::exists(getPath(Name)); }
+
+  /// Write the files of a cache with an entry of NativeObjectCache and one of
+  /// FileObjectCache, while other processes store more entries. The entries
+  /// and the files of the crashed stores are a day old.
+  void writeCache() {
+    const unsigned Day = 24 * 60 * 60;
+    writeFile("llvmcache-0123-0", Day);
+    writeFile("llvmcache-4567.o", Day);
+    // A store of NativeObjectCache in progress.
+    writeFile("llvmcache-89ab.lock", 0);
+    writeFile("llvmcache-89ab.lock-1a2b3c4d", 0);
+    writeFile("llvmcache-89ab-tmp-5e6f7a8b", 0);
+    // A store of FileObjectCache in progress.
+    writeFile("llvmcache-cdef.o-tmp-9c0d1e2f", 0);
+    // The stores of processes that crashed.
+    writeFile("llvmcache-0a1b.lock", Day);
+    writeFile("llvmcache-0a1b.lock-2c3d4e5f", Day);
+    writeFile("llvmcache-0a1b-tmp-6a7b8c9d", Day);
+    writeFile("llvmcache-2e3f.o-tmp-0e1f2a3b", Day);
+    // A file that does not belong to the cache.
+    writeFile("other", Day);
+  }
+
+  void expectEntriesAndStaleFilesPruned() {
+    EXPECT_FALSE(exists("llvmcache-0123-0"));
+    EXPECT_FALSE(exists("llvmcache-4567.o"));
+    EXPECT_TRUE(exists("llvmcache-89ab.lock"));
+    EXPECT_TRUE(exists("llvmcache-89ab.lock-1a2b3c4d"));
+    EXPECT_TRUE(exists("llvmcache-89ab-tmp-5e6f7a8b"));
+    EXPECT_TRUE(exists("llvmcache-cdef.o-tmp-9c0d1e2f"));
+    EXPECT_FALSE(exists("llvmcache-0a1b.lock"));
+    EXPECT_FALSE(exists("llvmcache-0a1b.lock-2c3d4e5f"));
+    EXPECT_FALSE(exists("llvmcache-0a1b-tmp-6a7b8c9d"));
+    EXPECT_FALSE(exists("llvmcache-2e3f.o-tmp-0e1f2a3b"));
+    EXPECT_TRUE(exists("other"));
+  }
+
+  SmallString<128> Dir;
+};
+
+TEST_F(CachePruningTest, ExpirationKeepsFreshLocksAndTemporaries) {
+  writeCache();
+  EXPECT_TRUE(CachePruning(Dir).setEntryExpiration(60).prune());
+  expectEntriesAndStaleFilesPruned();
+}
+
+TEST_F(CachePruningTest, MaxSizeKeepsFreshLocksAndTemporaries) {
+  writeCache();
+  EXPECT_TRUE(CachePruning(Dir).setMaxSize(1).prune());
+  expectEntriesAndStaleFilesPruned();
+  EXPECT_TRUE(exists("llvmcache.timestamp"));
+}
+
+TEST_F(CachePruningTest, StaleFileExpiration) {
+  writeFile("llvmcache-89ab.lock", 600);
+  writeFile("llvmcache-cdef.o-tmp-9c0d1e2f", 60);
+  EXPECT_TRUE(CachePruning(Dir)
+                  .setEntryExpiration(3600)
+                  .setStaleFileExpiration(300)
+                  .prune());
+  EXPECT_FALSE(exists("llvmcache-89ab.lock"));
+  EXPECT_TRUE(exists("llvmcache-cdef.o-tmp-9c0d1e2f"));
+}
+
+} // anonymous namespace
@@ -0,0 +1,184 @@
+//========- unittests/Support/ThreadPool.cpp - ThreadPool.h tests ---========//
+//
+//                     The LLVM Compiler Infrastructure
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+
+#include "llvm/Support/ThreadPool.h"
+
+#include "gtest/gtest.h"
+
+#include <atomic>
+
+using namespace llvm;
+
+namespace {
+
+class ThreadPoolTest : public ::testing::Test {
+protected:
+  std::condition_variable WaitMainThread;
+  std::mutex WaitMainThreadMutex;
+  bool MainThreadReady;
+
+  void SetUp() override { MainThreadReady = false; }
+
+  /// Block the current thread until setMainThreadReady() is called.
+  void waitForMainThread() {
+    std::unique_lock<std::mutex> LockGuard(WaitMainThreadMutex);
+    WaitMainThread.wait(LockGuard, [&] { return MainThreadReady; });
+  }
+
+  /// Release the threads blocked in waitForMainThread().
+  void setMainThreadReady() {
+    {
+      std::unique_lock<std::mutex> LockGuard(WaitMainThreadMutex);
+      MainThreadReady = true;
+    }
+    WaitMainThread.notify_all();
+  }
+};
+
+TEST_F(ThreadPoolTest, AsyncBarrier) {
+  // test that async & barrier work together properly.
+
+  std::atomic_int checked_in{0};
+
+  ThreadPool Pool;
+  for (size_t i = 0; i < 5; ++i) {
+    Pool.async([this, &checked_in] {
+      waitForMainThread();
+      ++checked_in;
+    });
+  }
+  ASSERT_EQ(0, checked_in);
+  setMainThreadReady();
+  Pool.wait();
+  ASSERT_EQ(5, checked_in);
+}
+
+static void TestFunc(std::atomic_int &checked_in, int i) { checked_in += i; }
+
+TEST_F(ThreadPoolTest, AsyncBarrierArgs) {
+  // Test that async works with a function requiring multiple parameters.
+  std::atomic_int checked_in{0};
+
+  ThreadPool Pool;
+  for (size_t i = 0; i < 5; ++i) {
+    Pool.async(TestFunc, std::ref(checked_in), i);
+  }
+  Pool.wait();
+  ASSERT_EQ(10, checked_in);
+}
+
+TEST_F(ThreadPoolTest, Async) {
+  ThreadPool Pool;
+  std::atomic_int i{0};
+  Pool.async([this, &i] {
+    waitForMainThread();
+    ++i;
+  });
+  Pool.async([&i] { ++i; });
+  ASSERT_NE(2, i.load());
+  setMainThreadReady();
+  Pool.wait();
+  ASSERT_EQ(2, i.load());
+}
+
+TEST_F(ThreadPoolTest, GetFuture) {
+  ThreadPool Pool(2);
+  std::atomic_int i{0};
+  Pool.async([this, &i] {
+    waitForMainThread();
+    ++i;
+  });
+  // Force the future using get()
+  Pool.async([&i] { ++i; }).get();
+  ASSERT_NE(2, i.load());
+  setMainThreadReady();
+  Pool.wait();
+  ASSERT_EQ(2, i.load());
+}
+
+TEST_F(ThreadPoolTest, PoolDestruction) {
+  // Test that we are waiting on destruction
+  std::atomic_int checked_in{0};
+  {
+    ThreadPool Pool;
+    for (size_t i = 0; i < 5; ++i) {
+      Pool.async([this, &checked_in] {
+        waitForMainThread();
+        ++checked_in;
+      });
+    }
+    ASSERT_EQ(0, checked_in);
+    setMainThreadReady();
+  }
+  ASSERT_EQ(5, checked_in);
+}
+
+TEST_F(ThreadPoolTest, ThreadCount) {
+  EXPECT_LE(1u, ThreadPool::getDefaultThreadCount());
+  ThreadPool Zero(0);
+  EXPECT_EQ(1u, Zero.getThreadCount());
+#if LLVM_ENABLE_THREADS
+  ThreadPool Three(3);
+  EXPECT_EQ(3u, Three.getThreadCount());
+#endif
+}
+
+TEST_F(ThreadPoolTest, TaskGroupWait) {
+  // Waiting on a group must not wait for the other tasks of the pool.
+  std::atomic_int checked_in{0};
+  std::atomic_int grouped{0};
+  ThreadPool Pool(2);
+  Pool.async([this, &checked_in] {
+    waitForMainThread();
+    ++checked_in;
+  });
+  {
+    ThreadPoolTaskGroup Group(Pool);
+    for (size_t i = 0; i < 5; ++i)
+      Group.async([&grouped] { ++grouped; });
+    Group.wait();
+    ASSERT_EQ(5, grouped);
+    ASSERT_EQ(0, checked_in);
+  }
+  setMainThreadReady();
+  Pool.wait();
+  ASSERT_EQ(1, checked_in);
+}
+
+TEST_F(ThreadPoolTest, TaskGroupDestruction) {
+  // Test that a group waits for its tasks on destruction.
+  std::atomic_int checked_in{0};
+  ThreadPool Pool;
+  {
+    ThreadPoolTaskGroup Group(Pool);
+    for (size_t i = 0; i < 5; ++i)
+      Group.async(TestFunc, std::ref(checked_in), i);
+  }
+  ASSERT_EQ(10, checked_in);
+}
+
+TEST_F(ThreadPoolTest, NestedTaskGroups) {
+  // Tasks waiting on their own group from a worker thread must not deadlock,
+  // even when the pool has a single thread.
+  std::atomic_int checked_in{0};
+  ThreadPool Pool(1);
+  ThreadPoolTaskGroup Outer(Pool);
+  for (size_t i = 0; i < 3; ++i) {
+    Outer.async([&Pool, &checked_in] {
+      ThreadPoolTaskGroup Inner(Pool);
+      for (size_t j = 0; j < 4; ++j)
+        Inner.async([&checked_in] { ++checked_in; });
+      Inner.wait();
+    });
+  }
+  Outer.wait();
+  ASSERT_EQ(12, checked_in);
+}
+
+} // end anonymous namespace
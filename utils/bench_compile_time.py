@@ -0,0 +1,234 @@
+#!/usr/bin/env python
+"""Compile-time benchmarks of the middle-end and of the backend.
+
+This generates large synthetic modules with llvm-stress, each made of several
+random functions linked together, and times the main components of LLVM on
+them:
+
+  llparser            parsing of the textual IR (opt, "Parse IR")
+  bitcode-reader      reading of the bitcode (opt, "Read bitcode")
+  bitcode-writer      writing of the bitcode (opt, "Bitcode Writer")
+  verifier            the IR verifier (opt, "Module Verifier")
+  instcombine, gvn, sroa
+                      each pass alone on the module (opt)
+  selectiondag-isel   the instruction selection (llc)
+  regalloc-greedy     the greedy register allocator (llc)
+  mc-object-emission  the asm printer and the assembler, writing an object
+                      file (llc)
+
+The times are measured by the tools themselves, with -pass-report and
+-time-trace, so they do not include the start-up of the process or the other
+passes. Each tool is run several times and the minimum of each time is kept,
+which is the most stable statistic on a busy machine.
+
+The results are written as JSON. Given the results of a previous run with
+--baseline, the benchmarks that became slower than the tolerance are reported
+and the script fails, to catch compile-time regressions.
+
+Example:
+  bench_compile_time.py --bin-dir=bin --output=new.json --baseline=old.json
+"""
+
+from __future__ import print_function
+
+import argparse
+import json
+import os
+import shutil
+import subprocess
+import sys
+import tempfile
+
+# The components timed in the pass report of opt, by pass argument, when the
+# module is run through a single pass.
+OPT_PASSES = ['instcombine', 'gvn', 'sroa']
+
+
+def run(tool, args):
+  cmd = [tool] + args
+  if subprocess.call(cmd) != 0:
+    raise RuntimeError('%s failed' % ' '.join(cmd))
+
+
+def read_json(path):
+  with open(path) as f:
+    return json.load(f)
+
+
+def pass_time(report, match):
+  """Total wall time of the passes of the report whose name matches."""
+  return sum(p['wall'] for p in report['passes'] if match(p))
+
+
+def trace_time(trace, name):
+  """Total duration of the events of the trace with the name, in seconds."""
+  return sum(e['dur'] for e in trace['traceEvents']
+             if e['name'] == name) / 1e6
+
+
+class Benchmark(object):
+  def __init__(self, args, directory):
+    self.args = args
+    self.directory = directory
+    self.report = os.path.join(directory, 'report.json')
+    self.trace = os.path.join(directory, 'trace.json')
+
+  def tool(self, name):
+    return os.path.join(self.args.bin_dir, name)
+
+  def generate_module(self, index):
+    """Write the module with the given index as text and as bitcode."""
+    args = self.args
+    functions = []
+    for f in range(args.functions):
+      seed = args.seed + index * args.functions + f
+      path = os.path.join(self.directory, 'stress%d.ll' % seed)
+      run(self.tool('llvm-stress'),
+          ['-seed=%d' % seed, '-size=%d' % args.size, '-o', path])
+      functions.append(path)
+    name = os.path.join(self.directory, 'module%d' % index)
+    run(self.tool('llvm-link'), ['-S', '-o', name + '.ll'] + functions)
+    run(self.tool('llvm-as'), ['-o', name + '.bc', name + '.ll'])
+    for path in functions:
+      os.remove(path)
+    return name
+
+  def run_with_reports(self, tool, args):
+    """Run the tool with -pass-report and -time-trace, and return both."""
+    run(self.tool(tool), args + ['-pass-report=' + self.report,
+                                 '-pass-report-executions=false',
+                                 '-time-trace=' + self.trace])
+    return read_json(self.report), read_json(self.trace)
+
+  def measure(self, module):
+    """Run the tools once on the module and return the time of each
+    component, by name."""
+    times = {}
+    output = os.path.join(self.directory, 'output')
+
+    _, trace = self.run_with_reports(
+        'opt', [module + '.ll', '-disable-output', '-disable-verify'])
+    times['llparser'] = trace_time(trace, 'Parse IR')
+
+    report, trace = self.run_with_reports(
+        'opt', [module + '.bc', '-o', output + '.bc'])
+    times['bitcode-reader'] = trace_time(trace, 'Read bitcode')
+    times['bitcode-writer'] = pass_time(
+        report, lambda p: p['name'] == 'Bitcode Writer')
+    times['verifier'] = pass_time(
+        report, lambda p: p['name'] == 'Module Verifier')
+
+    for name in OPT_PASSES:
+      report, _ = self.run_with_reports(
+          'opt', [module + '.bc', '-disable-output', '-disable-verify',
+                  '-' + name])
+      times[name] = pass_time(report, lambda p: p['arg'] == name)
+
+    report, trace = self.run_with_reports(
+        'llc', [module + '.bc', '-O2', '-mtriple=' + self.args.triple,
+                '-filetype=obj', '-o', output + '.o'])
+    # The instruction selector and the asm printer are named after the target.
+    times['selectiondag-isel'] = pass_time(
+        report, lambda p: p['name'].endswith('Instruction Selection'))
+    times['regalloc-greedy'] = pass_time(
+        report, lambda p: p['name'] == 'Greedy Register Allocator')
+    times['mc-object-emission'] = pass_time(
+        report, lambda p: 'Assembly' in p['name'] and
+                          ('Printer' in p['name'] or 'Emitter' in p['name'])
+    ) + trace_time(trace, 'Emit object')
+    return times
+
+
+def compare(results, baseline, tolerance, min_delta):
+  """Print the benchmarks slower than in the baseline, and return their
+  number."""
+  old = dict(((r['benchmark'], r['module']), r['time'])
+             for r in baseline['results'])
+  regressions = 0
+  for r in results:
+    before = old.get((r['benchmark'], r['module']))
+    if before is None:
+      continue
+    after = r['time']
+    if after > before * (1 + tolerance) and after - before > min_delta:
+      print('regression: %s on %s: %.4fs -> %.4fs (%+.1f%%)' %
+            (r['benchmark'], r['module'], before, after,
+             100.0 * (after - before) / before if before else 100.0))
+      regressions += 1
+  return regressions
+
+
+def main():
+  parser = argparse.ArgumentParser(
+      description=__doc__, formatter_class=argparse.RawDescriptionHelpFormatter)
+  parser.add_argument('--bin-dir', required=True,
+                      help='Directory of opt, llc, llvm-stress, llvm-link '
+                           'and llvm-as')
+  parser.add_argument('--output',
+                      help='File to write the results to, as JSON')
+  parser.add_argument('--baseline',
+                      help='Results of a previous run to compare with')
+  parser.add_argument('--tolerance', type=float, default=0.05,
+                      help='Relative slowdown reported as a regression')
+  parser.add_argument('--min-delta', type=float, default=0.002,
+                      help='Slowdown in seconds below which a benchmark is '
+                           'never reported')
+  parser.add_argument('--modules', type=int, default=2,
+                      help='Number of modules to generate')
+  parser.add_argument('--functions', type=int, default=8,
+                      help='Number of functions of each module')
+  parser.add_argument('--size', type=int, default=2000,
+                      help='Size of each function, in instructions')
+  parser.add_argument('--repeat', type=int, default=5,
+                      help='Number of runs on each module; the best is kept')
+  parser.add_argument('--seed', type=int, default=0,
+                      help='First seed of llvm-stress')
+  parser.add_argument('--triple', default='x86_64-unknown-linux',
+                      help='Target triple of the code generator')
+  args = parser.parse_args()
+
+  config = dict((key, getattr(args, key)) for key in
+                ['modules', 'functions', 'size', 'repeat', 'seed', 'triple'])
+  baseline = read_json(args.baseline) if args.baseline else None
+  if baseline and baseline['config'] != config:
+    print('warning: the baseline was run with another configuration',
+          file=sys.stderr)
+
+  directory = tempfile.mkdtemp(prefix='compile-time-bench-')
+  results = []
+  try:
+    bench = Benchmark(args, directory)
+    for index in range(args.modules):
+      module = bench.generate_module(index)
+      samples = {}
+      for _ in range(args.repeat):
+        for name, time in bench.measure(module).items():
+          samples.setdefault(name, []).append(time)
+      for name in sorted(samples):
+        runs = sorted(samples[name])
+        results.append({'benchmark': name,
+                        'module': 'module%d' % index,
+                        'time': runs[0],
+                        'median': runs[len(runs) // 2],
+                        'samples': samples[name]})
+  finally:
+    shutil.rmtree(directory)
+
+  print('%-20s %-8s %10s %10s' % ('benchmark', 'module', 'time (s)',
+                                  'median (s)'))
+  for r in results:
+    print('%-20s %-8s %10.4f %10.4f' % (r['benchmark'], r['module'],
+                                        r['time'], r['median']))
+
+  if args.output:
+    with open(args.output, 'w') as f:
+      json.dump({'config': config, 'results': results}, f, indent=2,
+                sort_keys=True)
+      f.write('\n')
+
+  if baseline and compare(results, baseline, args.tolerance, args.min_delta):
+    sys.exit(1)
+
+
+if __name__ == '__main__':
+  main()
@@ -0,0 +1,101 @@
+#!/usr/bin/env python
+"""Benchmark of llvm-profdata merge on synthetic profiles.
+
+This writes a set of synthetic instrumentation profiles in the text format,
+as produced by many runs of the same instrumented program: most functions
+appear in every profile, with varying counts. It then times the merge of the
+profiles, sequentially and with each given number of threads, both with
+per-thread profiles and with streaming, and reports the wall time and the
+peak memory of each merge.
+
+Example:
+  bench_profdata_merge.py --llvm-profdata=bin/llvm-profdata \\
+      --profiles=1000 --functions=5000 --threads=2,4,8
+"""
+
+import argparse
+import os
+import random
+import shutil
+import subprocess
+import tempfile
+import time
+
+
+def write_profiles(directory, num_profiles, num_functions, max_counters,
+                   coverage, seed):
+  rand = random.Random(seed)
+  counters = [rand.randint(1, max_counters) for _ in range(num_functions)]
+  paths = []
+  for p in range(num_profiles):
+    path = os.path.join(directory, 'profile%d.proftext' % p)
+    with open(path, 'w') as f:
+      for i in range(num_functions):
+        if rand.random() > coverage:
+          continue
+        f.write('function_%d\n%d\n%d\n' % (i, i, counters[i]))
+        for _ in range(counters[i]):
+          f.write('%d\n' % rand.randint(0, 1000))
+        f.write('\n')
+    paths.append(path)
+  return paths
+
+
+def run_merge(llvm_profdata, args, inputs, output):
+  cmd = [llvm_profdata, 'merge', '-o', output] + args + inputs
+  start = time.time()
+  process = subprocess.Popen(cmd)
+  _, status, usage = os.wait4(process.pid, 0)
+  elapsed = time.time() - start
+  if status != 0:
+    raise RuntimeError('%s failed' % ' '.join(cmd[:4 + len(args)]))
+  # ru_maxrss is in kilobytes on Linux.
+  return elapsed, usage.ru_maxrss / 1024.0
+
+
+def main():
+  parser = argparse.ArgumentParser(
+      description=__doc__, formatter_class=argparse.RawDescriptionHelpFormatter)
+  parser.add_argument('--llvm-profdata', default='llvm-profdata',
+                      help='Path to the llvm-profdata binary')
+  parser.add_argument('--profiles', type=int, default=200,
+                      help='Number of profiles to merge')
+  parser.add_argument('--functions', type=int, default=2000,
+                      help='Number of distinct functions')
+  parser.add_argument('--max-counters', type=int, default=16,
+                      help='Maximum number of counters of a function')
+  parser.add_argument('--coverage', type=float, default=0.9,
+                      help='Probability for a function to be in a profile')
+  parser.add_argument('--threads', default='2,4',
+                      help='Comma separated numbers of threads to try')
+  parser.add_argument('--repeat', type=int, default=3,
+                      help='Number of runs of each merge; the best is kept')
+  parser.add_argument('--seed', type=int, default=0,
+                      help='Seed of the profile generator')
+  args = parser.parse_args()
+
+  directory = tempfile.mkdtemp(prefix='profdata-bench-')
+  try:
+    inputs = write_profiles(directory, args.profiles, args.functions,
+                            args.max_counters, args.coverage, args.seed)
+    output = os.path.join(directory, 'merged.profdata')
+
+    configs = [('sequential', ['-j', '1'])]
+    for threads in args.threads.split(','):
+      configs.append(('%s threads' % threads, ['-j', threads]))
+      configs.append(('%s threads, streaming' % threads,
+                      ['-j', threads, '-stream']))
+
+    print('%-24s %10s %12s' % ('merge', 'time (s)', 'memory (MB)'))
+    for name, merge_args in configs:
+      runs = [run_merge(args.llvm_profdata, merge_args, inputs, output)
+              for _ in range(args.repeat)]
+      elapsed = min(run[0] for run in runs)
+      memory = max(run[1] for run in runs)
+      print('%-24s %10.3f %12.1f' % (name, elapsed, memory))
+  finally:
+    shutil.rmtree(directory)
+
+
+if __name__ == '__main__':
+  main()
@@ -0,0 +1,141 @@
+#!/usr/bin/env python
+"""Micro-benchmark of the string table builder of the object writers.
+
+This generates an assembly file defining many symbols with long mangled C++
+names, which share long suffixes like the names of real C++ programs, and
+assembles it into an ELF object with llvm-mc. The time spent writing the
+object is measured by llvm-mc itself, with the "Write object" event of
+-time-trace, so it does not include the parsing of the assembly or the layout.
+The generated file has a single instruction, so writing the object is mostly
+building the string table and writing the symbol table. The event exists in
+builds from before and after the changes to StringTableBuilder, so the two
+can be compared.
+
+Each count of threads given with --threads is run several times and the
+minimum time is kept. The throughput is reported in millions of strings per
+second.
+
+The results are written as JSON. Given the results of a previous run with
+--baseline, for instance of a build before a change to StringTableBuilder,
+the speedup of each benchmark is reported.
+
+Example:
+  bench_string_table.py --bin-dir=bin --threads 1 4 --output=new.json
+"""
+
+from __future__ import print_function
+
+import argparse
+import json
+import os
+import random
+import shutil
+import subprocess
+import tempfile
+
+# The parts of the generated names. The names of a namespace end with the
+# same arguments, so that many of them are suffixes of others.
+NAMESPACES = ['llvm', 'clang', 'std', 'boost', 'detail', 'impl']
+ARGUMENTS = ['', 'Ev', 'EPKcm', 'ERKNS_9StringRefE', 'EjRKNS_5TwineE',
+             'EPNS_8FunctionERNS_13AnalysisUsageE']
+
+
+def generate(path, count, seed):
+  """Write an assembly file defining count global symbols."""
+  rng = random.Random(seed)
+  with open(path, 'w') as f:
+    f.write('\t.text\n')
+    for i in range(count):
+      namespace = rng.choice(NAMESPACES)
+      name = '%s%d' % (rng.choice(['get', 'set', 'run', 'visit']), i)
+      name = '_ZN%d%s%d%sE%s' % (len(namespace), namespace, len(name), name,
+                                 rng.choice(ARGUMENTS))
+      f.write('\t.globl %s\n%s:\n' % (name, name))
+      # Some symbols are also defined by the full name without its _ZN prefix,
+      # which is a suffix of it.
+      if i % 4 == 0:
+        suffix = name[name.index(namespace):]
+        f.write('\t.globl %s\n%s:\n' % (suffix, suffix))
+    f.write('\tret\n')
+
+
+def measure(args, source, directory, threads):
+  """Assemble the file and return the time spent writing the object, in
+  seconds."""
+  trace = os.path.join(directory, 'trace.json')
+  cmd = [os.path.join(args.bin_dir, 'llvm-mc'), '-filetype=obj',
+         '-triple=x86_64-unknown-linux', '-time-trace=' + trace, '-o',
+         os.path.join(directory, 'output.o'), source]
+  # Only pass the option when needed, so that the builds from before the
+  # parallel ELF writer can run the serial benchmark.
+  if threads != 1:
+    cmd.append('-elf-writer-threads=%d' % threads)
+  if subprocess.call(cmd) != 0:
+    raise RuntimeError('%s failed' % ' '.join(cmd))
+  with open(trace) as f:
+    events = json.load(f)['traceEvents']
+  durations = [e['dur'] for e in events if e['name'] == 'Write object']
+  if not durations:
+    raise RuntimeError('%s recorded no "Write object" event' % cmd[0])
+  return sum(durations) / 1e6
+
+
+def main():
+  parser = argparse.ArgumentParser(
+      description=__doc__, formatter_class=argparse.RawDescriptionHelpFormatter)
+  parser.add_argument('--bin-dir', required=True,
+                      help='Directory of llvm-mc')
+  parser.add_argument('--output',
+                      help='File to write the results to, as JSON')
+  parser.add_argument('--baseline',
+                      help='Results of a previous run to compare with')
+  parser.add_argument('--symbols', type=int, default=500000,
+                      help='Number of symbols of the generated file')
+  parser.add_argument('--threads', type=int, nargs='+', default=[1],
+                      help='Counts of threads to run with')
+  parser.add_argument('--repeat', type=int, default=5,
+                      help='Number of runs of each benchmark; the best is '
+                           'kept')
+  parser.add_argument('--seed', type=int, default=0,
+                      help='Seed of the generated names')
+  args = parser.parse_args()
+
+  directory = tempfile.mkdtemp(prefix='string-table-bench-')
+  results = []
+  try:
+    source = os.path.join(directory, 'symbols.s')
+    generate(source, args.symbols, args.seed)
+    for threads in args.threads:
+      samples = sorted(measure(args, source, directory, threads)
+                       for _ in range(args.repeat))
+      results.append({'threads': threads, 'time': samples[0],
+                      'samples': samples})
+  finally:
+    shutil.rmtree(directory)
+
+  # The count of strings is about the count of symbols, plus the suffixes
+  # and the section names.
+  strings = args.symbols + args.symbols // 4
+  old = {}
+  if args.baseline:
+    with open(args.baseline) as f:
+      old = dict((r['threads'], r['time']) for r in json.load(f)['results'])
+
+  print('%-8s %10s %14s %8s' % ('threads', 'time (s)', 'Mstrings/s',
+                                'speedup'))
+  for r in results:
+    before = old.get(r['threads'])
+    speedup = '%.2fx' % (before / r['time']) if before and r['time'] else '-'
+    print('%-8d %10.4f %14.2f %8s' % (r['threads'], r['time'],
+                                      strings / r['time'] / 1e6
+                                      if r['time'] else 0, speedup))
+
+  if args.output:
+    with open(args.output, 'w') as f:
+      json.dump({'config': {'symbols': args.symbols, 'seed': args.seed},
+                 'results': results}, f, indent=2, sort_keys=True)
+      f.write('\n')
+
+
+if __name__ == '__main__':
+  main()